@@ -11,9 +11,25 @@
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
+#include "util/rate_limiter.h"
 
 namespace leveldb {
 
+CompressionType CompressionForLevel(const Options& options, int level) {
+  const std::vector<CompressionType>& per_level =
+      options.compression_per_level;
+  if (per_level.empty()) {
+    return options.compression;
+  }
+  if (level < 0) {
+    level = 0;
+  }
+  if (static_cast<size_t>(level) >= per_level.size()) {
+    level = static_cast<int>(per_level.size()) - 1;
+  }
+  return per_level[level];
+}
+
 //遍历iter，数据flush到x.ldb的文件
 //meta记录文件信息：internal_key的range，文件大小等
 Status BuildTable(const std::string& dbname,
@@ -21,22 +37,43 @@ Status BuildTable(const std::string& dbname,
                   const Options& options,
                   TableCache* table_cache,
                   Iterator* iter,
+                  Iterator* range_del_iter,
                   FileMetaData* meta) {
   Status s;
   meta->file_size = 0;
+  meta->has_range_deletions = false;
   iter->SeekToFirst();//iter指向memtable第一个元素
+  if (range_del_iter != nullptr) {
+    range_del_iter->SeekToFirst();
+  }
+  const bool has_range_dels =
+      (range_del_iter != nullptr && range_del_iter->Valid());
 
   std::string fname = TableFileName(dbname, meta->number);//"$dbname/$number.ldb"
-  if (iter->Valid()) {
+  if (iter->Valid() || has_range_dels) {
     WritableFile* file;
-    s = env->NewWritableFile(fname, &file);
+    if (options.use_direct_io_for_flush_and_compaction) {
+      s = env->NewDirectWritableFile(fname, &file);
+    } else {
+      s = env->NewWritableFile(fname, &file);
+    }
     if (!s.ok()) {
       return s;
     }
+    if (options.rate_limiter != nullptr) {
+      file = NewRateLimitedWritableFile(file, options.rate_limiter,
+                                        RateLimiter::kHigh);
+    }
 
-    TableBuilder* builder = new TableBuilder(options, file);
+    Options table_options = options;
+    table_options.compression = CompressionForLevel(options, 0);
+    // Training a dictionary would hold up the flush.
+    table_options.zstd_max_dict_bytes = 0;
+    TableBuilder* builder = new TableBuilder(table_options, file);
     //iter->key返回memtable的InternalKey，smallest记录最小internal_key
-    meta->smallest.DecodeFrom(iter->key());
+    if (iter->Valid()) {
+      meta->smallest.DecodeFrom(iter->key());
+    }
     //遍历memtable, 获取internal_key及value，写入builder
     //同时更新meta-largest记录最大的internal_key(iter->SeekToLast是相同的效果，但是多一遍遍历所以不用？)
     for (; iter->Valid(); iter->Next()) {
@@ -45,9 +82,43 @@ Status BuildTable(const std::string& dbname,
       builder->Add(key, iter->value());
     }
 
+    // The key range of the table also spans its range tombstones, so
+    // that lookups and compactions of the keys they cover find them.
+    if (has_range_dels) {
+      const InternalKeyComparator* icmp =
+          static_cast<const InternalKeyComparator*>(options.comparator);
+      const bool has_entries = (builder->NumEntries() > 0);
+      for (; range_del_iter->Valid(); range_del_iter->Next()) {
+        Slice key = range_del_iter->key();
+        Slice end = range_del_iter->value();
+        builder->AddRangeDeletion(key, end);
+        InternalKey limit(end, kMaxSequenceNumber, kTypeRangeDeletion);
+        if (!meta->has_range_deletions) {
+          // Tombstones are sorted, so the first one starts the earliest
+          if (!has_entries ||
+              icmp->Compare(key, meta->smallest.Encode()) < 0) {
+            meta->smallest.DecodeFrom(key);
+          }
+          if (!has_entries) {
+            meta->largest = limit;
+          }
+          meta->has_range_deletions = true;
+        }
+        if (icmp->Compare(limit, meta->largest) > 0) {
+          meta->largest = limit;
+        }
+      }
+      s = range_del_iter->status();
+      if (!s.ok()) {
+        builder->Abandon();
+      }
+    }
+
     // Finish and check for builder errors
     // Finish写入meta index block && meta block && index block && footer
-    s = builder->Finish();
+    if (s.ok()) {
+      s = builder->Finish();
+    }
     if (s.ok()) {
       meta->file_size = builder->FileSize();
       assert(meta->file_size > 0);
@@ -68,9 +139,12 @@ Status BuildTable(const std::string& dbname,
       // Verify that the table is usable
       // 尝试打开新的文件，添加到table_cache
       // 即使delete it，也不是真正的从table_cache里清理，因此也能起到预读的作用？
+      // Memtables are flushed to level-0 files (mostly; see
+      // PickLevelForMemTableOutput()).
       Iterator* it = table_cache->NewIterator(ReadOptions(),
                                               meta->number,
-                                              meta->file_size);
+                                              meta->file_size,
+                                              nullptr, 0);
       s = it->status();
       delete it;
     }
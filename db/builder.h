@@ -5,11 +5,11 @@
 #ifndef STORAGE_LEVELDB_DB_BUILDER_H_
 #define STORAGE_LEVELDB_DB_BUILDER_H_
 
+#include "leveldb/options.h"
 #include "leveldb/status.h"
 
 namespace leveldb {
 
-struct Options;
 struct FileMetaData;
 
 class Env;
@@ -17,16 +17,22 @@ class Iterator;
 class TableCache;
 class VersionEdit;
 
-// Build a Table file from the contents of *iter.  The generated file
+// Return the compression type for the tables written to "level", as
+// chosen by options.compression_per_level or else options.compression.
+CompressionType CompressionForLevel(const Options& options, int level);
+
+// Build a level-0 Table file from the contents of *iter and the range tombstones
+// yielded by *range_del_iter (which may be nullptr).  The generated file
 // will be named according to meta->number.  On success, the rest of
 // *meta will be filled with metadata about the generated table.
-// If no data is present in *iter, meta->file_size will be set to
-// zero, and no Table file will be produced.
+// If no data is present in either iterator, meta->file_size will be set
+// to zero, and no Table file will be produced.
 Status BuildTable(const std::string& dbname,
                   Env* env,
                   const Options& options,
                   TableCache* table_cache,
                   Iterator* iter,
+                  Iterator* range_del_iter,
                   FileMetaData* meta);
 
 }  // namespace leveldb
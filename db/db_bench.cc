@@ -5,10 +5,15 @@
 #include <sys/types.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "helpers/io_uring/io_uring_env.h"
 #include "leveldb/cache.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
+#include "leveldb/rate_limiter.h"
+#include "leveldb/statistics.h"
 #include "leveldb/write_batch.h"
 #include "port/port.h"
 #include "util/crc32c.h"
@@ -30,14 +35,24 @@
 //      readreverse   -- read N times in reverse order
 //      readrandom    -- read N times in random order
 //      readmissing   -- read N missing keys in random order
+//      multireadrandom -- read N times in random order, in DB::MultiGet()
+//                         batches of --multiget_batch keys
 //      readhot       -- read N times in random order from 1% section of DB
 //      seekrandom    -- N random seeks
 //      open          -- cost of opening a DB
 //      crc32c        -- repeated crc32c of 4K of data
 //      acquireload   -- load N*1000 times
+//      lz4comp       -- repeated LZ4 compression of 4K of data
+//      lz4uncomp     -- repeated LZ4 uncompression of 4K of data
+//      zstdcomp      -- repeated Zstandard compression of 4K of data
+//      zstduncomp    -- repeated Zstandard uncompression of 4K of data
+//      lrucache      -- N random lookups in a shared NewLRUCache()
+//      clockcache    -- N random lookups in a shared NewClockCache()
 //   Meta operations:
 //      compact     -- Compact the entire DB
 //      stats       -- Print DB stats
+//      cachestats  -- Print block cache hit rates by priority
+//      dbstats     -- Print the tickers and histograms of --statistics
 //      sstables    -- Print sstable info
 //      heapprofile -- Dump a heap profile (if supported by this port)
 static const char* FLAGS_benchmarks =
@@ -57,6 +72,10 @@ static const char* FLAGS_benchmarks =
     "crc32c,"
     "snappycomp,"
     "snappyuncomp,"
+    "lz4comp,"
+    "lz4uncomp,"
+    "zstdcomp,"
+    "zstduncomp,"
     "acquireload,"
     ;
 
@@ -83,6 +102,17 @@ static bool FLAGS_histogram = false;
 // (initialized to default value by "main")
 static int FLAGS_write_buffer_size = 0;
 
+// Number of level-0 files that starts a compaction, delays writes and
+// stops writes.
+// (initialized to default value by "main")
+static int FLAGS_level0_file_num_compaction_trigger = 0;
+static int FLAGS_level0_slowdown_writes_trigger = 0;
+static int FLAGS_level0_stop_writes_trigger = 0;
+
+// Bytes per second to which writes are first delayed.
+// (initialized to default value by "main")
+static int FLAGS_delayed_write_rate = 0;
+
 // Number of bytes written to each file.
 // (initialized to default value by "main")
 static int FLAGS_max_file_size = 0;
@@ -95,6 +125,60 @@ static int FLAGS_block_size = 0;
 // Negative means use default settings.
 static int FLAGS_cache_size = -1;
 
+// Cache implementation to use for the block cache: "lru" or "clock".
+static const char* FLAGS_cache_type = "lru";
+
+// The clock cache is split into 2^cache_shard_bits shards.
+static int FLAGS_cache_shard_bits = 4;
+
+// Fraction of the LRU cache reserved for high priority entries.
+static double FLAGS_cache_high_pri_pool_ratio = 0.0;
+
+// Compression of the tables: "none", "snappy", "lz4" or "zstd".
+static const char* FLAGS_compression_type = "snappy";
+
+// If non-empty, comma-separated compression types of the tables of
+// levels 0, 1, ..., as for Options::compression_per_level.
+static const char* FLAGS_compression_per_level = "";
+
+// Size of the Zstandard dictionaries that compactions train for their
+// output tables (0 for none), and the sample data to train them on.
+static int FLAGS_zstd_max_dict_bytes = 0;
+static int FLAGS_zstd_max_train_bytes = 256 << 10;
+
+// Number of threads that compress the data blocks of each table built.
+static int FLAGS_compression_threads = 1;
+
+// If true, read tables for user reads with direct I/O.
+static bool FLAGS_use_direct_reads = false;
+
+// If true, write flush and compaction output and read compaction input
+// with direct I/O.
+static bool FLAGS_use_direct_io_for_flush_and_compaction = false;
+
+// Bytes that compactions read ahead in their input tables (0 for none).
+static int FLAGS_compaction_readahead_size = 0;
+
+// Bytes that readseq iterators prefetch ahead of their position
+// (0 for none).
+static int FLAGS_readahead_size = 0;
+
+// Number of keys that multireadrandom looks up per DB::MultiGet() call.
+static int FLAGS_multiget_batch = 16;
+
+// If true, use the Env of NewIoUringEnv(), which reads batches of blocks
+// (as multireadrandom does) through io_uring.
+static bool FLAGS_use_io_uring = false;
+
+// Bytes per second that flushes and compactions may write (0 for no limit).
+static int FLAGS_rate_limit = 0;
+
+// If true, the rate limiter tunes its rate, up to --rate_limit.
+static bool FLAGS_rate_limit_auto_tune = false;
+
+// If true, collect the tickers and histograms of Options::statistics.
+static bool FLAGS_statistics = false;
+
 // Maximum number of files to keep open at the same time (use default if == 0)
 static int FLAGS_open_files = 0;
 
@@ -102,6 +186,17 @@ static int FLAGS_open_files = 0;
 // Negative means use default settings.
 static int FLAGS_bloom_bits = -1;
 
+// Layout of the bloom filters: 0 = per 2KB of blocks, 1 = one per table,
+// 2 = one per table, partitioned.
+static int FLAGS_filter_format = leveldb::kBlockBasedFilter;
+
+// If true, read index blocks and filters through the block cache.
+static bool FLAGS_cache_index_and_filter_blocks = false;
+
+// If true, pin the index blocks and filters of level-0 tables in the block
+// cache.
+static bool FLAGS_pin_l0_filter_and_index_blocks = false;
+
 // If true, do not destroy the existing database.  If you set this
 // flag and also specify a benchmark that wants a fresh database, that
 // benchmark will fail.
@@ -110,6 +205,14 @@ static bool FLAGS_use_existing_db = false;
 // If true, reuse existing log/MANIFEST files when re-opening a database.
 static bool FLAGS_reuse_logs = false;
 
+// If true, writers grouped into one log write insert into the memtable
+// in parallel.
+static bool FLAGS_allow_concurrent_memtable_write = false;
+
+// If true, overlap the log write of one write group with the memtable
+// inserts of the previous one.
+static bool FLAGS_enable_pipelined_write = false;
+
 // Use the db with the following name.
 static const char* FLAGS_db = nullptr;
 
@@ -118,6 +221,58 @@ namespace leveldb {
 namespace {
 leveldb::Env* g_env = nullptr;
 
+Cache* NewCacheOfType(const Slice& type, size_t capacity) {
+  if (type == Slice("clock")) {
+    return NewClockCache(capacity, FLAGS_cache_shard_bits);
+  }
+  return NewLRUCache(capacity, FLAGS_cache_high_pri_pool_ratio);
+}
+
+CompressionType CompressionTypeFromName(const Slice& name) {
+  if (name == Slice("none")) {
+    return kNoCompression;
+  } else if (name == Slice("lz4")) {
+    return kLZ4Compression;
+  } else if (name == Slice("zstd")) {
+    return kZstdCompression;
+  } else if (name == Slice("snappy")) {
+    return kSnappyCompression;
+  }
+  fprintf(stderr, "unknown compression type '%s'\n", name.ToString().c_str());
+  exit(1);
+}
+
+bool CompressBlock(CompressionType type, const Slice& input,
+                   std::string* output) {
+  output->clear();
+  switch (type) {
+    case kSnappyCompression:
+      return port::Snappy_Compress(input.data(), input.size(), output);
+    case kLZ4Compression:
+      return port::LZ4_Compress(input.data(), input.size(), output);
+    case kZstdCompression:
+      return port::Zstd_Compress(input.data(), input.size(), output);
+    default:
+      return false;
+  }
+}
+
+bool UncompressBlock(CompressionType type, const Slice& input,
+                     char* output, size_t output_length) {
+  switch (type) {
+    case kSnappyCompression:
+      return port::Snappy_Uncompress(input.data(), input.size(), output);
+    case kLZ4Compression:
+      return port::LZ4_Uncompress(input.data(), input.size(), output,
+                                  output_length);
+    case kZstdCompression:
+      return port::Zstd_Uncompress(input.data(), input.size(), output,
+                                   output_length);
+    default:
+      return false;
+  }
+}
+
 // Helper for quickly generating random data.
 class RandomGenerator {
  private:
@@ -317,7 +472,10 @@ struct ThreadState {
 class Benchmark {
  private:
   Cache* cache_;
+  Cache* bench_cache_;   // Shared by the threads of the cache benchmarks
   const FilterPolicy* filter_policy_;
+  RateLimiter* rate_limiter_;
+  Statistics* statistics_;
   DB* db_;
   int num_;
   int value_size_;
@@ -402,10 +560,18 @@ class Benchmark {
 
  public:
   Benchmark()
-  : cache_(FLAGS_cache_size >= 0 ? NewLRUCache(FLAGS_cache_size) : nullptr),
+  : cache_(FLAGS_cache_size >= 0
+           ? NewCacheOfType(FLAGS_cache_type, FLAGS_cache_size)
+           : nullptr),
+    bench_cache_(nullptr),
     filter_policy_(FLAGS_bloom_bits >= 0
                    ? NewBloomFilterPolicy(FLAGS_bloom_bits)
                    : nullptr),
+    rate_limiter_(FLAGS_rate_limit > 0
+                  ? NewGenericRateLimiter(FLAGS_rate_limit, 100 * 1000,
+                                          FLAGS_rate_limit_auto_tune)
+                  : nullptr),
+    statistics_(FLAGS_statistics ? CreateDBStatistics() : nullptr),
     db_(nullptr),
     num_(FLAGS_num),
     value_size_(FLAGS_value_size),
@@ -428,6 +594,8 @@ class Benchmark {
     delete db_;
     delete cache_;
     delete filter_policy_;
+    delete rate_limiter_;
+    delete statistics_;
   }
 
   void Run() {
@@ -454,6 +622,7 @@ class Benchmark {
       write_options_ = WriteOptions();
 
       void (Benchmark::*method)(ThreadState*) = nullptr;
+      const char* bench_cache_type = nullptr;
       bool fresh_db = false;
       int num_threads = FLAGS_threads;
 
@@ -490,6 +659,8 @@ class Benchmark {
         method = &Benchmark::ReadReverse;
       } else if (name == Slice("readrandom")) {
         method = &Benchmark::ReadRandom;
+      } else if (name == Slice("multireadrandom")) {
+        method = &Benchmark::MultiReadRandom;
       } else if (name == Slice("readmissing")) {
         method = &Benchmark::ReadMissing;
       } else if (name == Slice("seekrandom")) {
@@ -512,16 +683,34 @@ class Benchmark {
         method = &Benchmark::Crc32c;
       } else if (name == Slice("acquireload")) {
         method = &Benchmark::AcquireLoad;
+      } else if (name == Slice("lrucache")) {
+        bench_cache_type = "lru";
+        method = &Benchmark::CacheBench;
+      } else if (name == Slice("clockcache")) {
+        bench_cache_type = "clock";
+        method = &Benchmark::CacheBench;
       } else if (name == Slice("snappycomp")) {
         method = &Benchmark::SnappyCompress;
       } else if (name == Slice("snappyuncomp")) {
         method = &Benchmark::SnappyUncompress;
+      } else if (name == Slice("lz4comp")) {
+        method = &Benchmark::LZ4Compress;
+      } else if (name == Slice("lz4uncomp")) {
+        method = &Benchmark::LZ4Uncompress;
+      } else if (name == Slice("zstdcomp")) {
+        method = &Benchmark::ZstdCompress;
+      } else if (name == Slice("zstduncomp")) {
+        method = &Benchmark::ZstdUncompress;
       } else if (name == Slice("heapprofile")) {
         HeapProfile();
       } else if (name == Slice("stats")) {
         PrintStats("leveldb.stats");
       } else if (name == Slice("sstables")) {
         PrintStats("leveldb.sstables");
+      } else if (name == Slice("cachestats")) {
+        PrintStats("leveldb.block-cache-stats");
+      } else if (name == Slice("dbstats")) {
+        PrintStats("leveldb.statistics");
       } else {
         if (name != Slice()) {  // No error message for empty name
           fprintf(stderr, "unknown benchmark '%s'\n", name.ToString().c_str());
@@ -542,7 +731,12 @@ class Benchmark {
       }
 
       if (method != nullptr) {
+        if (bench_cache_type != nullptr) {
+          bench_cache_ = NewCacheOfType(bench_cache_type, BenchCacheSize());
+        }
         RunBenchmark(num_threads, name, method);
+        delete bench_cache_;
+        bench_cache_ = nullptr;
       }
     }
   }
@@ -623,7 +817,9 @@ class Benchmark {
   void Crc32c(ThreadState* thread) {
     // Checksum about 500MB of data total
     const int size = 4096;
-    const char* label = "(4K per op)";
+    std::string label = "(4K per op, ";
+    label.append(crc32c::ImplementationName());
+    label.append(")");
     std::string data(size, 'x');
     int64_t bytes = 0;
     uint32_t crc = 0;
@@ -639,6 +835,38 @@ class Benchmark {
     thread->stats.AddMessage(label);
   }
 
+  size_t BenchCacheSize() const {
+    return FLAGS_cache_size >= 0 ? FLAGS_cache_size : 8 << 20;
+  }
+
+  static void DeleteNothing(const Slice& key, void* value) { }
+
+  // Looks up random blocks in bench_cache_, which all threads share, and
+  // inserts the ones that miss.  There are twice as many blocks as fit in
+  // the cache.
+  void CacheBench(ThreadState* thread) {
+    const size_t charge = FLAGS_block_size;
+    const int blocks = static_cast<int>(2 * BenchCacheSize() / charge) + 1;
+    int64_t hits = 0;
+    char key[100];
+    for (int i = 0; i < reads_; i++) {
+      const int k = thread->rand.Next() % blocks;
+      snprintf(key, sizeof(key), "%016d", k);
+      Cache::Handle* handle = bench_cache_->Lookup(key);
+      if (handle != nullptr) {
+        hits++;
+      } else {
+        handle = bench_cache_->Insert(key, nullptr, charge, &DeleteNothing);
+      }
+      bench_cache_->Release(handle);
+      thread->stats.FinishedSingleOp();
+    }
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(%.1f%% hits)",
+             reads_ > 0 ? 100.0 * hits / reads_ : 0.0);
+    thread->stats.AddMessage(msg);
+  }
+
   void AcquireLoad(ThreadState* thread) {
     int dummy;
     port::AtomicPointer ap(&dummy);
@@ -656,6 +884,31 @@ class Benchmark {
   }
 
   void SnappyCompress(ThreadState* thread) {
+    Compress(thread, kSnappyCompression, "(snappy failure)");
+  }
+
+  void SnappyUncompress(ThreadState* thread) {
+    Uncompress(thread, kSnappyCompression, "(snappy failure)");
+  }
+
+  void LZ4Compress(ThreadState* thread) {
+    Compress(thread, kLZ4Compression, "(lz4 failure)");
+  }
+
+  void LZ4Uncompress(ThreadState* thread) {
+    Uncompress(thread, kLZ4Compression, "(lz4 failure)");
+  }
+
+  void ZstdCompress(ThreadState* thread) {
+    Compress(thread, kZstdCompression, "(zstd failure)");
+  }
+
+  void ZstdUncompress(ThreadState* thread) {
+    Uncompress(thread, kZstdCompression, "(zstd failure)");
+  }
+
+  void Compress(ThreadState* thread, CompressionType type,
+                const char* failure) {
     RandomGenerator gen;
     Slice input = gen.Generate(Options().block_size);
     int64_t bytes = 0;
@@ -663,14 +916,14 @@ class Benchmark {
     bool ok = true;
     std::string compressed;
     while (ok && bytes < 1024 * 1048576) {  // Compress 1G
-      ok = port::Snappy_Compress(input.data(), input.size(), &compressed);
+      ok = CompressBlock(type, input, &compressed);
       produced += compressed.size();
       bytes += input.size();
       thread->stats.FinishedSingleOp();
     }
 
     if (!ok) {
-      thread->stats.AddMessage("(snappy failure)");
+      thread->stats.AddMessage(failure);
     } else {
       char buf[100];
       snprintf(buf, sizeof(buf), "(output: %.1f%%)",
@@ -680,23 +933,23 @@ class Benchmark {
     }
   }
 
-  void SnappyUncompress(ThreadState* thread) {
+  void Uncompress(ThreadState* thread, CompressionType type,
+                  const char* failure) {
     RandomGenerator gen;
     Slice input = gen.Generate(Options().block_size);
     std::string compressed;
-    bool ok = port::Snappy_Compress(input.data(), input.size(), &compressed);
+    bool ok = CompressBlock(type, input, &compressed);
     int64_t bytes = 0;
     char* uncompressed = new char[input.size()];
     while (ok && bytes < 1024 * 1048576) {  // Compress 1G
-      ok =  port::Snappy_Uncompress(compressed.data(), compressed.size(),
-                                    uncompressed);
+      ok = UncompressBlock(type, compressed, uncompressed, input.size());
       bytes += input.size();
       thread->stats.FinishedSingleOp();
     }
     delete[] uncompressed;
 
     if (!ok) {
-      thread->stats.AddMessage("(snappy failure)");
+      thread->stats.AddMessage(failure);
     } else {
       thread->stats.AddBytes(bytes);
     }
@@ -709,11 +962,42 @@ class Benchmark {
     options.create_if_missing = !FLAGS_use_existing_db;
     options.block_cache = cache_;
     options.write_buffer_size = FLAGS_write_buffer_size;
+    options.level0_file_num_compaction_trigger =
+        FLAGS_level0_file_num_compaction_trigger;
+    options.level0_slowdown_writes_trigger =
+        FLAGS_level0_slowdown_writes_trigger;
+    options.level0_stop_writes_trigger = FLAGS_level0_stop_writes_trigger;
+    options.delayed_write_rate = FLAGS_delayed_write_rate;
     options.max_file_size = FLAGS_max_file_size;
     options.block_size = FLAGS_block_size;
     options.max_open_files = FLAGS_open_files;
     options.filter_policy = filter_policy_;
+    options.filter_format = static_cast<FilterFormat>(FLAGS_filter_format);
+    options.compression = CompressionTypeFromName(FLAGS_compression_type);
+    options.zstd_max_dict_bytes = FLAGS_zstd_max_dict_bytes;
+    options.zstd_max_train_bytes = FLAGS_zstd_max_train_bytes;
+    options.compression_threads = FLAGS_compression_threads;
+    options.use_direct_reads = FLAGS_use_direct_reads;
+    options.use_direct_io_for_flush_and_compaction =
+        FLAGS_use_direct_io_for_flush_and_compaction;
+    options.compaction_readahead_size = FLAGS_compaction_readahead_size;
+    options.rate_limiter = rate_limiter_;
+    options.statistics = statistics_;
+    for (const char* p = FLAGS_compression_per_level; *p != '\0'; ) {
+      const char* sep = strchr(p, ',');
+      size_t len = (sep == nullptr) ? strlen(p) : sep - p;
+      options.compression_per_level.push_back(
+          CompressionTypeFromName(Slice(p, len)));
+      p += (sep == nullptr) ? len : len + 1;
+    }
+    options.cache_index_and_filter_blocks =
+        FLAGS_cache_index_and_filter_blocks;
+    options.pin_l0_filter_and_index_blocks =
+        FLAGS_pin_l0_filter_and_index_blocks;
     options.reuse_logs = FLAGS_reuse_logs;
+    options.allow_concurrent_memtable_write =
+        FLAGS_allow_concurrent_memtable_write;
+    options.enable_pipelined_write = FLAGS_enable_pipelined_write;
     Status s = DB::Open(options, FLAGS_db, &db_);
     if (!s.ok()) {
       fprintf(stderr, "open error: %s\n", s.ToString().c_str());
@@ -768,7 +1052,9 @@ class Benchmark {
   }
 
   void ReadSequential(ThreadState* thread) {
-    Iterator* iter = db_->NewIterator(ReadOptions());
+    ReadOptions options;
+    options.readahead_size = FLAGS_readahead_size;
+    Iterator* iter = db_->NewIterator(options);
     int i = 0;
     int64_t bytes = 0;
     for (iter->SeekToFirst(); i < reads_ && iter->Valid(); iter->Next()) {
@@ -811,6 +1097,37 @@ class Benchmark {
     thread->stats.AddMessage(msg);
   }
 
+  void MultiReadRandom(ThreadState* thread) {
+    ReadOptions options;
+    std::vector<std::string> key_data(FLAGS_multiget_batch);
+    std::vector<Slice> keys(FLAGS_multiget_batch);
+    std::vector<std::string> values;
+    std::vector<Status> statuses;
+    int found = 0;
+    for (int i = 0; i < reads_; i += FLAGS_multiget_batch) {
+      const int batch = std::min(FLAGS_multiget_batch, reads_ - i);
+      key_data.resize(batch);
+      keys.resize(batch);
+      for (int j = 0; j < batch; j++) {
+        char key[100];
+        const int k = thread->rand.Next() % FLAGS_num;
+        snprintf(key, sizeof(key), "%016d", k);
+        key_data[j] = key;
+        keys[j] = key_data[j];
+      }
+      db_->MultiGet(options, keys, &values, &statuses);
+      for (int j = 0; j < batch; j++) {
+        if (statuses[j].ok()) {
+          found++;
+        }
+        thread->stats.FinishedSingleOp();
+      }
+    }
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(%d of %d found)", found, num_);
+    thread->stats.AddMessage(msg);
+  }
+
   void ReadMissing(ThreadState* thread) {
     ReadOptions options;
     std::string value;
@@ -951,6 +1268,13 @@ class Benchmark {
 
 int main(int argc, char** argv) {
   FLAGS_write_buffer_size = leveldb::Options().write_buffer_size;
+  FLAGS_level0_file_num_compaction_trigger =
+      leveldb::Options().level0_file_num_compaction_trigger;
+  FLAGS_level0_slowdown_writes_trigger =
+      leveldb::Options().level0_slowdown_writes_trigger;
+  FLAGS_level0_stop_writes_trigger =
+      leveldb::Options().level0_stop_writes_trigger;
+  FLAGS_delayed_write_rate = leveldb::Options().delayed_write_rate;
   FLAGS_max_file_size = leveldb::Options().max_file_size;
   FLAGS_block_size = leveldb::Options().block_size;
   FLAGS_open_files = leveldb::Options().max_open_files;
@@ -973,6 +1297,12 @@ int main(int argc, char** argv) {
     } else if (sscanf(argv[i], "--reuse_logs=%d%c", &n, &junk) == 1 &&
                (n == 0 || n == 1)) {
       FLAGS_reuse_logs = n;
+    } else if (sscanf(argv[i], "--allow_concurrent_memtable_write=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_allow_concurrent_memtable_write = n;
+    } else if (sscanf(argv[i], "--enable_pipelined_write=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_enable_pipelined_write = n;
     } else if (sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
       FLAGS_num = n;
     } else if (sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1) {
@@ -983,6 +1313,18 @@ int main(int argc, char** argv) {
       FLAGS_value_size = n;
     } else if (sscanf(argv[i], "--write_buffer_size=%d%c", &n, &junk) == 1) {
       FLAGS_write_buffer_size = n;
+    } else if (sscanf(argv[i], "--level0_file_num_compaction_trigger=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_level0_file_num_compaction_trigger = n;
+    } else if (sscanf(argv[i], "--level0_slowdown_writes_trigger=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_level0_slowdown_writes_trigger = n;
+    } else if (sscanf(argv[i], "--level0_stop_writes_trigger=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_level0_stop_writes_trigger = n;
+    } else if (sscanf(argv[i], "--delayed_write_rate=%d%c", &n, &junk) == 1 &&
+               n > 0) {
+      FLAGS_delayed_write_rate = n;
     } else if (sscanf(argv[i], "--max_file_size=%d%c", &n, &junk) == 1) {
       FLAGS_max_file_size = n;
     } else if (sscanf(argv[i], "--block_size=%d%c", &n, &junk) == 1) {
@@ -991,6 +1333,62 @@ int main(int argc, char** argv) {
       FLAGS_cache_size = n;
     } else if (sscanf(argv[i], "--bloom_bits=%d%c", &n, &junk) == 1) {
       FLAGS_bloom_bits = n;
+    } else if (sscanf(argv[i], "--filter_format=%d%c", &n, &junk) == 1 &&
+               n >= 0 && n <= 2) {
+      FLAGS_filter_format = n;
+    } else if (sscanf(argv[i], "--cache_index_and_filter_blocks=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_cache_index_and_filter_blocks = n;
+    } else if (sscanf(argv[i], "--pin_l0_filter_and_index_blocks=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_pin_l0_filter_and_index_blocks = n;
+    } else if (strncmp(argv[i], "--cache_type=", 13) == 0) {
+      FLAGS_cache_type = argv[i] + 13;
+    } else if (sscanf(argv[i], "--cache_shard_bits=%d%c", &n, &junk) == 1) {
+      FLAGS_cache_shard_bits = n;
+    } else if (sscanf(argv[i], "--cache_high_pri_pool_ratio=%lf%c",
+                      &d, &junk) == 1) {
+      FLAGS_cache_high_pri_pool_ratio = d;
+    } else if (strncmp(argv[i], "--compression_type=", 19) == 0) {
+      FLAGS_compression_type = argv[i] + 19;
+    } else if (strncmp(argv[i], "--compression_per_level=", 24) == 0) {
+      FLAGS_compression_per_level = argv[i] + 24;
+    } else if (sscanf(argv[i], "--zstd_max_dict_bytes=%d%c",
+                      &n, &junk) == 1 && n >= 0) {
+      FLAGS_zstd_max_dict_bytes = n;
+    } else if (sscanf(argv[i], "--zstd_max_train_bytes=%d%c",
+                      &n, &junk) == 1 && n >= 0) {
+      FLAGS_zstd_max_train_bytes = n;
+    } else if (sscanf(argv[i], "--compression_threads=%d%c",
+                      &n, &junk) == 1 && n >= 1) {
+      FLAGS_compression_threads = n;
+    } else if (sscanf(argv[i], "--use_direct_reads=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_use_direct_reads = n;
+    } else if (sscanf(argv[i], "--use_direct_io_for_flush_and_compaction=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_use_direct_io_for_flush_and_compaction = n;
+    } else if (sscanf(argv[i], "--compaction_readahead_size=%d%c",
+                      &n, &junk) == 1 && n >= 0) {
+      FLAGS_compaction_readahead_size = n;
+    } else if (sscanf(argv[i], "--rate_limit=%d%c", &n, &junk) == 1 &&
+               n >= 0) {
+      FLAGS_rate_limit = n;
+    } else if (sscanf(argv[i], "--rate_limit_auto_tune=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_rate_limit_auto_tune = n;
+    } else if (sscanf(argv[i], "--statistics=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_statistics = n;
+    } else if (sscanf(argv[i], "--readahead_size=%d%c",
+                      &n, &junk) == 1 && n >= 0) {
+      FLAGS_readahead_size = n;
+    } else if (sscanf(argv[i], "--multiget_batch=%d%c",
+                      &n, &junk) == 1 && n >= 1) {
+      FLAGS_multiget_batch = n;
+    } else if (sscanf(argv[i], "--use_io_uring=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_use_io_uring = n;
     } else if (sscanf(argv[i], "--open_files=%d%c", &n, &junk) == 1) {
       FLAGS_open_files = n;
     } else if (strncmp(argv[i], "--db=", 5) == 0) {
@@ -1001,7 +1399,8 @@ int main(int argc, char** argv) {
     }
   }
 
-  leveldb::g_env = leveldb::Env::Default();
+  leveldb::g_env = FLAGS_use_io_uring ? leveldb::NewIoUringEnv()
+                                      : leveldb::Env::Default();
 
   // Choose a location for the test database if none given with --db=<path>
   if (FLAGS_db == nullptr) {
@@ -19,6 +19,7 @@
 #include "db/log_reader.h"
 #include "db/log_writer.h"
 #include "db/memtable.h"
+#include "db/range_del.h"
 #include "db/table_cache.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
@@ -34,6 +35,9 @@
 #include "util/coding.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "util/perf_context.h"
+#include "util/rate_limiter.h"
+#include "util/statistics.h"
 
 namespace leveldb {
 
@@ -45,9 +49,36 @@ struct DBImpl::Writer {
   WriteBatch* batch;
   bool sync;
   bool done;
+  // Whether the writer is still in writers_.  With enable_pipelined_write
+  // a follower leaves the queue before it is done and must not look at
+  // writers_.front() again.
+  bool in_queue;
   port::CondVar cv;
 
-  explicit Writer(port::Mutex* mu) : cv(mu) { }
+  // Parallel memtable insertion (allow_concurrent_memtable_write).  The
+  // group leader sets insert_pending to ask this writer to insert its own
+  // batch at "sequence", and counts outstanding inserts in its own
+  // pending_inserts.
+  bool insert_pending;
+  SequenceNumber sequence;
+  Writer* leader;
+  int pending_inserts;
+
+  explicit Writer(port::Mutex* mu)
+      : in_queue(false),
+        cv(mu),
+        insert_pending(false),
+        sequence(0),
+        leader(nullptr),
+        pending_inserts(0) { }
+};
+
+// Writers whose batches went into one log record, in log order.  Used
+// when they are applied to the memtable one batch at a time rather than
+// as the combined batch.
+struct DBImpl::WriteGroup {
+  std::vector<Writer*> writers;   // writers[0] is the leader
+  SequenceNumber last_sequence;   // Last sequence number of the group
 };
 
 struct DBImpl::CompactionState {
@@ -64,6 +95,7 @@ struct DBImpl::CompactionState {
     uint64_t number;
     uint64_t file_size;
     InternalKey smallest, largest;
+    bool has_range_deletions;
   };
   std::vector<Output> outputs;
 
@@ -73,16 +105,53 @@ struct DBImpl::CompactionState {
 
   uint64_t total_bytes;
 
+  // Range tombstones of the inputs, shared by all parts of the compaction.
+  // Entries that range_dels hides as of smallest_snapshot are dropped;
+  // output_range_dels are the tombstones that the outputs still need.
+  // Both are nullptr if there are no such tombstones.
+  const RangeTombstoneList* range_dels;
+  const std::vector<RangeTombstone>* output_range_dels;
+
+  // Every output gets the part of output_range_dels from output_lower
+  // (or from the start, if !has_output_lower) up to the first user key
+  // of the next output, so outputs are only closed between user keys.
+  bool has_output_lower;
+  std::string output_lower;
+  bool close_pending;   // Close the current output before the next user key
+
   Output* current_output() { return &outputs[outputs.size()-1]; }
 
   explicit CompactionState(Compaction* c)
       : compaction(c),
         outfile(nullptr),
         builder(nullptr),
-        total_bytes(0) {
+        total_bytes(0),
+        range_dels(nullptr),
+        output_range_dels(nullptr),
+        has_output_lower(false),
+        close_pending(false) {
   }
 };
 
+// An event for options_.listeners that was raised while mutex_ was held.
+// Only the member that matches "type" is filled in.
+struct DBImpl::ListenerEvent {
+  enum Type {
+    kFlushCompleted,
+    kCompactionCompleted,
+    kStallConditionsChanged,
+    kTableFileDeleted
+  };
+
+  const Type type;
+  FlushJobInfo flush;
+  CompactionJobInfo compaction;
+  WriteStallInfo stall;
+  TableFileDeletionInfo deletion;
+
+  explicit ListenerEvent(Type t) : type(t) { }
+};
+
 // Fix user-supplied options to be reasonable
 template <class T, class V>
 static void ClipToRange(T* ptr, V minvalue, V maxvalue) {
@@ -92,14 +161,24 @@ static void ClipToRange(T* ptr, V minvalue, V maxvalue) {
 Options SanitizeOptions(const std::string& dbname,
                         const InternalKeyComparator* icmp,
                         const InternalFilterPolicy* ipolicy,
+                        const InternalKeySliceTransform* iprefix,
                         const Options& src) {
   Options result = src;
   result.comparator = icmp;
   result.filter_policy = (src.filter_policy != nullptr) ? ipolicy : nullptr;
+  result.prefix_extractor =
+      (src.prefix_extractor != nullptr) ? iprefix : nullptr;
   ClipToRange(&result.max_open_files,    64 + kNumNonTableCacheFiles, 50000);
   ClipToRange(&result.write_buffer_size, 64<<10,                      1<<30);//6K~1G
   ClipToRange(&result.max_file_size,     1<<20,                       1<<30);
   ClipToRange(&result.block_size,        1<<10,                       4<<20);//block在1K~4M之间，默认是4K
+  ClipToRange(&result.max_background_compactions, 1,                  64);
+  ClipToRange(&result.max_background_flushes,     0,                  1);
+  ClipToRange(&result.level0_file_num_compaction_trigger, 1,          1<<30);
+  ClipToRange(&result.level0_slowdown_writes_trigger,
+              result.level0_file_num_compaction_trigger,              1<<30);
+  ClipToRange(&result.level0_stop_writes_trigger,
+              result.level0_slowdown_writes_trigger,                  1<<30);
   if (result.info_log == nullptr) {
     // Open a log file in the same directory as the db
     src.env->CreateDir(dbname);  // In case it does not exist
@@ -112,7 +191,13 @@ Options SanitizeOptions(const std::string& dbname,
   }
   if (result.block_cache == nullptr) {
     // 默认缓存大小为8M
-    result.block_cache = NewLRUCache(8 << 20);
+    // Index blocks and filters only compete with data blocks for the
+    // cache when they are cached, so only then reserve them a pool.
+    if (result.cache_index_and_filter_blocks) {
+      result.block_cache = NewLRUCache(8 << 20, 0.5);
+    } else {
+      result.block_cache = NewLRUCache(8 << 20);
+    }
   }
   return result;
 }
@@ -127,8 +212,10 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
     : env_(raw_options.env),
       internal_comparator_(raw_options.comparator),
       internal_filter_policy_(raw_options.filter_policy),
+      internal_prefix_extractor_(raw_options.prefix_extractor),
       options_(SanitizeOptions(dbname, &internal_comparator_,
-                               &internal_filter_policy_, raw_options)),
+                               &internal_filter_policy_,
+                               &internal_prefix_extractor_, raw_options)),
       owns_info_log_(options_.info_log != raw_options.info_log),
       owns_cache_(options_.block_cache != raw_options.block_cache),
       dbname_(dbname),
@@ -143,20 +230,35 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
       log_(nullptr),
       seed_(0),
       tmp_batch_(new WriteBatch),
-      background_compaction_scheduled_(false),
+      last_batch_group_size_(0),
+      background_compactions_scheduled_(0),
+      background_flush_scheduled_(false),
+      version_edit_in_progress_(false),
+      stall_condition_(kWriteStallNormal),
       manual_compaction_(nullptr),
       versions_(new VersionSet(dbname_, &options_, table_cache_,
                                &internal_comparator_)) {
   has_imm_.Release_Store(nullptr);
+  if (options_.max_background_compactions > 1) {
+    env_->SetBackgroundThreads(options_.max_background_compactions, Env::LOW);
+  }
+  if (options_.max_background_flushes > 0) {
+    env_->SetBackgroundThreads(options_.max_background_flushes, Env::HIGH);
+  }
 }
 
 DBImpl::~DBImpl() {
   // Wait for background work to finish
   mutex_.Lock();
   shutting_down_.Release_Store(this);  // Any non-null value is ok
-  while (background_compaction_scheduled_) {
+  while (background_compactions_scheduled_ > 0 ||
+         background_flush_scheduled_) {
     background_work_finished_signal_.Wait();
   }
+  for (size_t i = 0; i < pending_listener_events_.size(); i++) {
+    delete pending_listener_events_[i];
+  }
+  pending_listener_events_.clear();
   mutex_.Unlock();
 
   if (db_lock_ != nullptr) {
@@ -267,12 +369,22 @@ void DBImpl::DeleteObsoleteFiles() {
 
       if (!keep) {
         if (type == kTableFile) {
-          table_cache_->Evict(number);
+          table_cache_->Evict(number, true);
         }
         Log(options_.info_log, "Delete type=%d #%lld\n",
             static_cast<int>(type),
             static_cast<unsigned long long>(number));
-        env_->DeleteFile(dbname_ + "/" + filenames[i]);
+        const std::string fname = dbname_ + "/" + filenames[i];
+        Status s = env_->DeleteFile(fname);
+        if (type == kTableFile && !options_.listeners.empty()) {
+          ListenerEvent* event =
+              new ListenerEvent(ListenerEvent::kTableFileDeleted);
+          event->deletion.db_name = dbname_;
+          event->deletion.file_path = fname;
+          event->deletion.file_number = number;
+          event->deletion.status = s;
+          QueueListenerEvent(event);
+        }
       }
     }
   }
@@ -503,7 +615,7 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
 //mem持久化到x.ldb，并将新文件记录到edit
 //注意新文件不一定只在level 0，也可能记录到1 2
 Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
-                                Version* base) {
+                                Version* base, FlushJobInfo* flush_info) {
   mutex_.AssertHeld();
   const uint64_t start_micros = env_->NowMicros();
   FileMetaData meta;
@@ -511,6 +623,7 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
   //写入pending_outputs_避免BuildTable长期持有锁？
   pending_outputs_.insert(meta.number);
   Iterator* iter = mem->NewIterator();//memtable迭代器
+  Iterator* range_del_iter = mem->NewRangeTombstoneIterator();
   Log(options_.info_log, "Level-0 table #%llu: started",
       (unsigned long long) meta.number);
 
@@ -519,15 +632,27 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
     mutex_.Unlock();
     //更新memtable中全部数据到xxx.ldb文件
     //meta记录key range, file_size等sst信息
-    s = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta);
+    s = BuildTable(dbname_, env_, options_, table_cache_, iter,
+                   range_del_iter, &meta);
+    if (!s.ok() || meta.file_size > 0) {
+      NotifyTableFileCreated(meta.number, meta.file_size, kTableFileFromFlush,
+                             s);
+    }
     mutex_.Lock();
   }
+  if (base != nullptr) {
+    // Claim the right to apply *edit before choosing the output level, so
+    // that no compaction is picked or installed between that choice and
+    // the caller's LogAndApply().
+    BeginVersionEdit();
+  }
 
   Log(options_.info_log, "Level-0 table #%llu: %lld bytes %s",
       (unsigned long long) meta.number,
       (unsigned long long) meta.file_size,
       s.ToString().c_str());
   delete iter;
+  delete range_del_iter;
   pending_outputs_.erase(meta.number);
 
 
@@ -538,31 +663,55 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
     const Slice min_user_key = meta.smallest.user_key();
     const Slice max_user_key = meta.largest.user_key();
     //为新生成sstable选择合适的level(不一定总是0)
+    // Other background threads may have installed newer versions than
+    // base while the table was being built.
     if (base != nullptr) {
-      level = base->PickLevelForMemTableOutput(min_user_key, max_user_key);
+      level = versions_->current()->PickLevelForMemTableOutput(min_user_key,
+                                                               max_user_key);
+    }
+    if (level > 0 && options_.pin_l0_filter_and_index_blocks) {
+      // BuildTable() opened the table as a level-0 file, with its index
+      // and filter pinned; let it be opened again as what it is.
+      table_cache_->Evict(meta.number);
     }
     //level及file meta记录到edit
     edit->AddFile(level, meta.number, meta.file_size,
-                  meta.smallest, meta.largest);
+                  meta.smallest, meta.largest, meta.has_range_deletions);
   }
 
   CompactionStats stats;
   stats.micros = env_->NowMicros() - start_micros;
   stats.bytes_written = meta.file_size;
   stats_[level].Add(stats);
+  RecordTick(options_.statistics, kFlushWriteBytes, stats.bytes_written);
+  MeasureTime(options_.statistics, kFlushMicros, stats.micros);
+  if (flush_info != nullptr) {
+    const bool written = (s.ok() && meta.file_size > 0);
+    flush_info->db_name = dbname_;
+    flush_info->file_path = written ? TableFileName(dbname_, meta.number) : "";
+    flush_info->file_number = written ? meta.number : 0;
+    flush_info->file_size = written ? meta.file_size : 0;
+    flush_info->level = level;
+    flush_info->micros = stats.micros;
+  }
   return s;
 }
 
 void DBImpl::CompactMemTable() {
   mutex_.AssertHeld();
   assert(imm_ != nullptr);
+  assert(has_imm_.NoBarrier_Load() != nullptr);
+
+  // Keep other background threads from compacting imm_ as well
+  has_imm_.Release_Store(nullptr);
 
   // Save the contents of the memtable as a new Table
   VersionEdit edit;
   Version* base = versions_->current();
   base->Ref();
   // imm_持久化到x.ldb文件,使用edit记录文件信息
-  Status s = WriteLevel0Table(imm_, &edit, base);
+  FlushJobInfo flush_info;
+  Status s = WriteLevel0Table(imm_, &edit, base, &flush_info);
   base->Unref();
 
   if (s.ok() && shutting_down_.Acquire_Load()) {
@@ -574,16 +723,23 @@ void DBImpl::CompactMemTable() {
     edit.SetPrevLogNumber(0);
     edit.SetLogNumber(logfile_number_);  // Earlier logs no longer needed
     //应用edit
-    s = versions_->LogAndApply(&edit, &mutex_);
+    s = LogAndApply(&edit);
+  } else {
+    EndVersionEdit();
   }
 
   if (s.ok()) {
     // Commit to the new state
     imm_->Unref();
     imm_ = nullptr;
-    has_imm_.Release_Store(nullptr);
+    if (!options_.listeners.empty()) {
+      ListenerEvent* event = new ListenerEvent(ListenerEvent::kFlushCompleted);
+      event->flush = flush_info;
+      QueueListenerEvent(event);
+    }
     DeleteObsoleteFiles();
   } else {
+    has_imm_.Release_Store(imm_);
     RecordBackgroundError(s);
   }
 }
@@ -615,6 +771,7 @@ void DBImpl::TEST_CompactRange(int level, const Slice* begin,
   ManualCompaction manual;
   manual.level = level;
   manual.done = false;
+  manual.in_progress = false;
   if (begin == nullptr) {
     manual.begin = nullptr;
   } else {
@@ -669,19 +826,27 @@ void DBImpl::RecordBackgroundError(const Status& s) {
 
 void DBImpl::MaybeScheduleCompaction() {
   mutex_.AssertHeld();
-  if (background_compaction_scheduled_) {
-    // Already scheduled
-  } else if (shutting_down_.Acquire_Load()) {
+  if (shutting_down_.Acquire_Load()) {
     // DB is being deleted; no more background compactions
+    return;
   } else if (!bg_error_.ok()) {
     // Already got an error; no more changes
-  } else if (imm_ == nullptr &&
-             manual_compaction_ == nullptr &&
-             !versions_->NeedsCompaction()) {
-    // No work to be done
-  } else {
-    background_compaction_scheduled_ = true;
-    env_->Schedule(&DBImpl::BGWork, this);
+    return;
+  }
+
+  if (imm_ != nullptr && !background_flush_scheduled_) {
+    background_flush_scheduled_ = true;
+    env_->Schedule(&DBImpl::BGFlushWork, this, Env::HIGH);
+  }
+
+  // Start as many compactions as allowed.  A compaction that finds no
+  // work that does not overlap the running ones simply exits, and the
+  // running ones reschedule when they finish.
+  while (background_compactions_scheduled_ <
+             options_.max_background_compactions &&
+         (manual_compaction_ != nullptr || versions_->NeedsCompaction())) {
+    background_compactions_scheduled_++;
+    env_->Schedule(&DBImpl::BGWork, this, Env::LOW);
   }
 }
 
@@ -689,42 +854,78 @@ void DBImpl::BGWork(void* db) {
   reinterpret_cast<DBImpl*>(db)->BackgroundCall();
 }
 
+void DBImpl::BGFlushWork(void* db) {
+  reinterpret_cast<DBImpl*>(db)->BackgroundFlushCall();
+}
+
 void DBImpl::BackgroundCall() {
   MutexLock l(&mutex_);
-  assert(background_compaction_scheduled_);
+  assert(background_compactions_scheduled_ > 0);
+  bool made_progress = false;
   if (shutting_down_.Acquire_Load()) {
     // No more background work when shutting down.
   } else if (!bg_error_.ok()) {
     // No more background work after a background error.
   } else {
-    BackgroundCompaction();
+    made_progress = BackgroundCompaction();
   }
+  NotifyListeners();
 
-  background_compaction_scheduled_ = false;
+  background_compactions_scheduled_--;
 
   // Previous compaction may have produced too many files in a level,
   // so reschedule another compaction if needed.
+  if (made_progress) {
+    MaybeScheduleCompaction();
+  }
+  background_work_finished_signal_.SignalAll();
+}
+
+void DBImpl::BackgroundFlushCall() {
+  MutexLock l(&mutex_);
+  assert(background_flush_scheduled_);
+  if (shutting_down_.Acquire_Load()) {
+    // No more background work when shutting down.
+  } else if (!bg_error_.ok()) {
+    // No more background work after a background error.
+  } else if (has_imm_.NoBarrier_Load() != nullptr) {
+    // imm_ may already have been compacted by a compaction thread
+    CompactMemTable();
+  }
+  NotifyListeners();
+
+  background_flush_scheduled_ = false;
+
+  // The new level-0 file may call for a compaction, and the memtable
+  // may have filled up again in the meantime.
   MaybeScheduleCompaction();
   background_work_finished_signal_.SignalAll();
 }
 
 //实际Compact
-void DBImpl::BackgroundCompaction() {
+bool DBImpl::BackgroundCompaction() {
   mutex_.AssertHeld();
 
-  //如果immutable memtable存在，则本次先compact，即Minor Compaction
-  if (imm_ != nullptr) {
-    CompactMemTable();
-    return;
+  // Pick against the version that the in-flight edit (if any) installs;
+  // a memtable compaction may have chosen its output level assuming that
+  // nothing new gets picked before its edit is applied.
+  while (version_edit_in_progress_) {
+    background_work_finished_signal_.Wait();
   }
 
-  //如果immutable memtable不存在，则合并各层level的文件，称为Major Compaction
+  //合并各层level的文件，称为Major Compaction
+  //immutable memtable由BackgroundFlushCall()负责
   Compaction* c;
   bool is_manual = (manual_compaction_ != nullptr);
   InternalKey manual_end;
   //手动指定compact
   if (is_manual) {
     ManualCompaction* m = manual_compaction_;
+    if (m->in_progress || versions_->NumRunningCompactions() > 0) {
+      // Manual compactions run alone; wait for the running ones to finish.
+      return false;
+    }
+    m->in_progress = true;
     c = versions_->CompactRange(m->level, m->begin, m->end);
     m->done = (c == nullptr);
     if (c != nullptr) {
@@ -739,6 +940,9 @@ void DBImpl::BackgroundCompaction() {
   } else {
   //自动compact，c记录了待参与compact的所有文件
     c = versions_->PickCompaction();
+    if (c == nullptr) {
+      return false;
+    }
   }
 
   Status status;
@@ -752,10 +956,15 @@ void DBImpl::BackgroundCompaction() {
     //直接把这个文件从level移动level + 1层
     c->edit()->DeleteFile(c->level(), f->number);
     c->edit()->AddFile(c->level() + 1, f->number, f->file_size,
-                       f->smallest, f->largest);
-    status = versions_->LogAndApply(c->edit(), &mutex_);
+                       f->smallest, f->largest, f->has_range_deletions);
+    BeginVersionEdit();
+    status = LogAndApply(c->edit());
     if (!status.ok()) {
       RecordBackgroundError(status);
+    } else if (c->level() == 0 && options_.pin_l0_filter_and_index_blocks) {
+      // The table is still open as a level-0 file, with its index and
+      // filter pinned; let it be opened again as what it is.
+      table_cache_->Evict(f->number);
     }
     VersionSet::LevelSummaryStorage tmp;
     Log(options_.info_log, "Moved #%lld to level-%d %lld bytes %s: %s\n",
@@ -796,8 +1005,10 @@ void DBImpl::BackgroundCompaction() {
       m->tmp_storage = manual_end;
       m->begin = &m->tmp_storage;
     }
+    m->in_progress = false;
     manual_compaction_ = nullptr;
   }
+  return true;
 }
 
 void DBImpl::CleanupCompaction(CompactionState* compact) {
@@ -830,38 +1041,102 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
     out.number = file_number;
     out.smallest.Clear();
     out.largest.Clear();
+    out.has_range_deletions = false;
     compact->outputs.push_back(out);
     mutex_.Unlock();
   }
 
   // Make the output file
   std::string fname = TableFileName(dbname_, file_number);
-  Status s = env_->NewWritableFile(fname, &compact->outfile);
+  Status s;
+  if (options_.use_direct_io_for_flush_and_compaction) {
+    s = env_->NewDirectWritableFile(fname, &compact->outfile);
+  } else {
+    s = env_->NewWritableFile(fname, &compact->outfile);
+  }
+  if (s.ok() && options_.rate_limiter != nullptr) {
+    compact->outfile = NewRateLimitedWritableFile(
+        compact->outfile, options_.rate_limiter, RateLimiter::kLow);
+  }
   if (s.ok()) {
-    compact->builder = new TableBuilder(options_, compact->outfile);
+    Options table_options = options_;
+    table_options.compression =
+        CompressionForLevel(options_, compact->compaction->level() + 1);
+    compact->builder = new TableBuilder(table_options, compact->outfile);
   }
   return s;
 }
 
+// Add to *clipped the parts of the tombstones in "tombstones" that fall
+// in [*lower, *upper); a null bound leaves that side unclipped.
+static void ClipRangeTombstones(const std::vector<RangeTombstone>& tombstones,
+                                const Comparator* ucmp,
+                                const Slice* lower, const Slice* upper,
+                                RangeTombstoneList* clipped) {
+  for (size_t i = 0; i < tombstones.size(); i++) {
+    const RangeTombstone& t = tombstones[i];
+    Slice begin = t.begin;
+    Slice end = t.end;
+    if (lower != nullptr && ucmp->Compare(begin, *lower) < 0) {
+      begin = *lower;
+    }
+    if (upper != nullptr && ucmp->Compare(end, *upper) > 0) {
+      end = *upper;
+    }
+    clipped->Add(begin, end, t.seq);   // Ignores empty ranges
+  }
+  clipped->Finish();
+}
+
 Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
-                                          Iterator* input) {
+                                          Iterator* input,
+                                          const Slice* limit) {
   assert(compact != nullptr);
   assert(compact->outfile != nullptr);
   assert(compact->builder != nullptr);
 
-  const uint64_t output_number = compact->current_output()->number;
+  CompactionState::Output* out = compact->current_output();
+  const uint64_t output_number = out->number;
   assert(output_number != 0);
 
   // Check for iterator errors
   Status s = input->status();
   const uint64_t current_entries = compact->builder->NumEntries();
+  if (s.ok() && compact->output_range_dels != nullptr) {
+    Slice lower(compact->output_lower);
+    RangeTombstoneList clipped(user_comparator());
+    ClipRangeTombstones(*compact->output_range_dels, user_comparator(),
+                        compact->has_output_lower ? &lower : nullptr, limit,
+                        &clipped);
+    const std::vector<RangeTombstone>& tombstones = clipped.tombstones();
+    for (size_t i = 0; i < tombstones.size(); i++) {
+      const RangeTombstone& t = tombstones[i];
+      InternalKey begin(t.begin, t.seq, kTypeRangeDeletion);
+      InternalKey end(t.end, kMaxSequenceNumber, kTypeRangeDeletion);
+      compact->builder->AddRangeDeletion(begin.Encode(), t.end);
+      // The key range of the output also spans its tombstones
+      const bool first = (current_entries == 0 && i == 0);
+      if (first || internal_comparator_.Compare(begin, out->smallest) < 0) {
+        out->smallest = begin;
+      }
+      if (first || internal_comparator_.Compare(end, out->largest) > 0) {
+        out->largest = end;
+      }
+      out->has_range_deletions = true;
+    }
+    if (limit != nullptr) {
+      compact->has_output_lower = true;
+      compact->output_lower.assign(limit->data(), limit->size());
+    }
+  }
+  compact->close_pending = false;
   if (s.ok()) {
     s = compact->builder->Finish();
   } else {
     compact->builder->Abandon();
   }
   const uint64_t current_bytes = compact->builder->FileSize();
-  compact->current_output()->file_size = current_bytes;
+  out->file_size = current_bytes;
   compact->total_bytes += current_bytes;
   delete compact->builder;
   compact->builder = nullptr;
@@ -875,8 +1150,10 @@ Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
   }
   delete compact->outfile;
   compact->outfile = nullptr;
+  NotifyTableFileCreated(output_number, current_bytes,
+                         kTableFileFromCompaction, s);
 
-  if (s.ok() && current_entries > 0) {
+  if (s.ok() && (current_entries > 0 || out->has_range_deletions)) {
     // Verify that the table is usable
     Iterator* iter = table_cache_->NewIterator(ReadOptions(),
                                                output_number,
@@ -913,12 +1190,173 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
     //新生成的文件增加到edit
     compact->compaction->edit()->AddFile(
         level + 1,
-        out.number, out.file_size, out.smallest, out.largest);
+        out.number, out.file_size, out.smallest, out.largest,
+        out.has_range_deletions);
+  }
+  BeginVersionEdit();
+  return LogAndApply(compact->compaction->edit());
+}
+
+void DBImpl::BeginVersionEdit() {
+  mutex_.AssertHeld();
+  while (version_edit_in_progress_) {
+    background_work_finished_signal_.Wait();
+  }
+  version_edit_in_progress_ = true;
+}
+
+void DBImpl::EndVersionEdit() {
+  mutex_.AssertHeld();
+  assert(version_edit_in_progress_);
+  version_edit_in_progress_ = false;
+  background_work_finished_signal_.SignalAll();
+}
+
+Status DBImpl::LogAndApply(VersionEdit* edit) {
+  mutex_.AssertHeld();
+  assert(version_edit_in_progress_);
+  Status s = versions_->LogAndApply(edit, &mutex_);
+  EndVersionEdit();
+  return s;
+}
+
+// Arguments and result of a part of a compaction's key range that runs
+// in its own thread.
+struct DBImpl::Subcompaction {
+  DBImpl* db;
+  CompactionState* compact;  // Own Compaction copy and output files
+  const Slice* begin;        // First user key, or null
+  const Slice* end;          // Limit user key, or null
+  int* pending;              // Unfinished parts, guarded by db->mutex_
+  int64_t imm_micros;
+  Status status;
+};
+
+void DBImpl::SubcompactionWork(void* arg) {
+  Subcompaction* sub = reinterpret_cast<Subcompaction*>(arg);
+  DBImpl* db = sub->db;
+  sub->status = db->DoCompactionRange(sub->compact, sub->begin, sub->end,
+                                      &sub->imm_micros);
+  MutexLock l(&db->mutex_);
+  (*sub->pending)--;
+  db->background_work_finished_signal_.SignalAll();
+}
+
+void DBImpl::GenSubcompactionBoundaries(
+    Compaction* c, std::vector<std::string>* boundaries) {
+  boundaries->clear();
+  if (options_.max_subcompactions <= 1) {
+    return;
+  }
+
+  // Candidate boundaries are the smallest keys of the input files, so
+  // every part starts at a file boundary and all entries for a user key
+  // stay in the same part.
+  std::vector<std::pair<Slice, uint64_t> > starts;
+  uint64_t total = 0;
+  for (int which = 0; which < 2; which++) {
+    for (int i = 0; i < c->num_input_files(which); i++) {
+      FileMetaData* f = c->input(which, i);
+      starts.push_back(std::make_pair(f->smallest.user_key(), f->file_size));
+      total += f->file_size;
+    }
+  }
+  int parts = std::min<uint64_t>(options_.max_subcompactions,
+                                 total / c->MaxOutputFileSize());
+  if (parts <= 1) {
+    return;
+  }
+
+  const Comparator* ucmp = user_comparator();
+  struct StartOrder {
+    const Comparator* ucmp;
+    bool operator()(const std::pair<Slice, uint64_t>& a,
+                    const std::pair<Slice, uint64_t>& b) const {
+      return ucmp->Compare(a.first, b.first) < 0;
+    }
+  };
+  StartOrder order = { ucmp };
+  std::sort(starts.begin(), starts.end(), order);
+
+  // Start part k at the first file that begins after k/parts of the
+  // input bytes
+  uint64_t before = 0;
+  for (size_t i = 0; i < starts.size(); i++) {
+    const int k = boundaries->size() + 1;
+    if (k < parts && before >= total * k / parts &&
+        ucmp->Compare(starts[i].first, starts[0].first) > 0 &&
+        (boundaries->empty() ||
+         ucmp->Compare(starts[i].first, boundaries->back()) > 0)) {
+      boundaries->push_back(starts[i].first.ToString());
+    }
+    before += starts[i].second;
   }
-  return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
 }
 
 //真正的compaction，compact里记录了本次所有参与compact的文件
+Status DBImpl::PrepareCompactionTombstones(
+    CompactionState* compact, RangeTombstoneList* range_dels,
+    std::vector<RangeTombstone>* output_range_dels) {
+  mutex_.AssertHeld();
+  Compaction* c = compact->compaction;
+  bool any = false;
+  for (int which = 0; which < 2; which++) {
+    for (int i = 0; i < c->num_input_files(which); i++) {
+      any = any || c->input(which, i)->has_range_deletions;
+    }
+  }
+  if (!any) {
+    range_dels->Finish();
+    return Status::OK();
+  }
+
+  // Reading the tombstones may open tables; do it without the mutex.
+  mutex_.Unlock();
+  RangeTombstoneList upper(user_comparator());
+  Status s;
+  for (int which = 0; which < 2 && s.ok(); which++) {
+    for (int i = 0; i < c->num_input_files(which) && s.ok(); i++) {
+      const FileMetaData* f = c->input(which, i);
+      if (!f->has_range_deletions) {
+        continue;
+      }
+      s = table_cache_->AddRangeTombstones(f->number, f->file_size,
+                                           range_dels);
+      if (s.ok() && which == 0) {
+        s = table_cache_->AddRangeTombstones(f->number, f->file_size,
+                                             &upper);
+      }
+    }
+  }
+  range_dels->Finish();
+  upper.Finish();
+
+  if (s.ok()) {
+    // Data in level-(L+1) is older than the tombstones of level-L, so a
+    // file of level-(L+1) that lies inside a tombstone every snapshot
+    // sees is dropped without being read.
+    for (int i = 0; i < c->num_input_files(1); i++) {
+      const FileMetaData* f = c->input(1, i);
+      if (upper.CoversRange(f->smallest.user_key(), f->largest.user_key(),
+                            compact->smallest_snapshot)) {
+        c->SkipInput(i);
+      }
+    }
+
+    // A tombstone that every snapshot sees and that has no data to hide
+    // in the levels below the output is obsolete.
+    const std::vector<RangeTombstone>& all = range_dels->tombstones();
+    for (size_t i = 0; i < all.size(); i++) {
+      if (all[i].seq > compact->smallest_snapshot ||
+          !c->IsBaseLevelForRange(all[i].begin, all[i].end)) {
+        output_range_dels->push_back(all[i]);
+      }
+    }
+  }
+  mutex_.Lock();
+  return s;
+}
+
 Status DBImpl::DoCompactionWork(CompactionState* compact) {
   const uint64_t start_micros = env_->NowMicros();
   int64_t imm_micros = 0;  // Micros spent doing imm_ compactions
@@ -938,12 +1376,148 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     compact->smallest_snapshot = snapshots_.oldest()->sequence_number();
   }
 
+  RangeTombstoneList range_dels(user_comparator());
+  std::vector<RangeTombstone> output_range_dels;
+  Status status = PrepareCompactionTombstones(compact, &range_dels,
+                                              &output_range_dels);
+  if (!status.ok()) {
+    return status;
+  }
+  if (!range_dels.empty()) {
+    compact->range_dels = &range_dels;
+  }
+  if (!output_range_dels.empty()) {
+    compact->output_range_dels = &output_range_dels;
+  }
+
+  // Large compactions are split into key ranges that are merged in
+  // parallel.  This thread handles the first range; the others run in
+  // threads of their own, since the background thread pool may be fully
+  // occupied by compactions waiting for their parts.
+  std::vector<std::string> boundaries;
+  GenSubcompactionBoundaries(compact->compaction, &boundaries);
+  std::vector<Slice> bounds(boundaries.begin(), boundaries.end());
+  std::vector<Subcompaction> subs(bounds.size());
+  int pending = subs.size();
+  for (size_t i = 0; i < subs.size(); i++) {
+    Subcompaction* sub = &subs[i];
+    sub->db = this;
+    sub->compact =
+        new CompactionState(compact->compaction->NewSubcompaction());
+    sub->compact->smallest_snapshot = compact->smallest_snapshot;
+    sub->compact->range_dels = compact->range_dels;
+    sub->compact->output_range_dels = compact->output_range_dels;
+    sub->begin = &bounds[i];
+    sub->end = (i + 1 < bounds.size()) ? &bounds[i + 1] : nullptr;
+    sub->pending = &pending;
+    sub->imm_micros = 0;
+  }
+  if (!subs.empty()) {
+    Log(options_.info_log, "Compaction split into %d parts",
+        static_cast<int>(subs.size() + 1));
+  }
+
   // Release mutex while we're actually doing the compaction work
   mutex_.Unlock();
 
+  for (size_t i = 0; i < subs.size(); i++) {
+    env_->StartThread(&DBImpl::SubcompactionWork, &subs[i]);
+  }
+  status = DoCompactionRange(
+      compact, nullptr, bounds.empty() ? nullptr : &bounds[0], &imm_micros);
+
+  mutex_.Lock();
+  while (pending > 0) {
+    background_work_finished_signal_.Wait();
+  }
+
+  // Gather the output files of all parts, in key order, so that they are
+  // installed together by a single VersionEdit.
+  for (size_t i = 0; i < subs.size(); i++) {
+    CompactionState* part = subs[i].compact;
+    if (status.ok()) {
+      status = subs[i].status;
+    }
+    imm_micros = std::max(imm_micros, subs[i].imm_micros);
+    if (part->builder != nullptr) {
+      part->builder->Abandon();
+      delete part->builder;
+    }
+    delete part->outfile;
+    compact->outputs.insert(compact->outputs.end(), part->outputs.begin(),
+                            part->outputs.end());
+    compact->total_bytes += part->total_bytes;
+    delete part->compaction;
+    delete part;
+  }
+
+  //统计信息
+  CompactionStats stats;
+  stats.micros = env_->NowMicros() - start_micros - imm_micros;
+  for (int which = 0; which < 2; which++) {
+    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
+      stats.bytes_read += compact->compaction->input(which, i)->file_size;
+    }
+  }
+  for (size_t i = 0; i < compact->outputs.size(); i++) {
+    stats.bytes_written += compact->outputs[i].file_size;
+  }
+  stats_[compact->compaction->level() + 1].Add(stats);
+  RecordTick(options_.statistics, kCompactReadBytes, stats.bytes_read);
+  RecordTick(options_.statistics, kCompactWriteBytes, stats.bytes_written);
+  MeasureTime(options_.statistics, kCompactionMicros, stats.micros);
+
+  if (status.ok()) {
+    status = InstallCompactionResults(compact);
+  }
+  if (!status.ok()) {
+    RecordBackgroundError(status);
+  }
+  if (!options_.listeners.empty()) {
+    ListenerEvent* event =
+        new ListenerEvent(ListenerEvent::kCompactionCompleted);
+    CompactionJobInfo* info = &event->compaction;
+    info->db_name = dbname_;
+    info->base_level = compact->compaction->level();
+    info->output_level = compact->compaction->level() + 1;
+    for (int which = 0; which < 2; which++) {
+      for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
+        info->input_files.push_back(TableFileName(
+            dbname_, compact->compaction->input(which, i)->number));
+      }
+    }
+    for (size_t i = 0; i < compact->outputs.size(); i++) {
+      info->output_files.push_back(
+          TableFileName(dbname_, compact->outputs[i].number));
+    }
+    info->bytes_read = stats.bytes_read;
+    info->bytes_written = stats.bytes_written;
+    info->micros = stats.micros;
+    info->status = status;
+    QueueListenerEvent(event);
+  }
+  VersionSet::LevelSummaryStorage tmp;
+  Log(options_.info_log,
+      "compacted to: %s", versions_->LevelSummary(&tmp));
+  return status;
+}
+
+Status DBImpl::DoCompactionRange(CompactionState* compact,
+                                 const Slice* begin, const Slice* end,
+                                 int64_t* imm_micros) {
   //input用于遍历compact里所有文件的key
   Iterator* input = versions_->MakeInputIterator(compact->compaction);
-  input->SeekToFirst();
+  if (begin == nullptr) {
+    input->SeekToFirst();
+  } else {
+    InternalKey start(*begin, kMaxSequenceNumber, kValueTypeForSeek);
+    input->Seek(start.Encode());
+  }
+  compact->has_output_lower = (begin != nullptr);
+  if (begin != nullptr) {
+    compact->output_lower.assign(begin->data(), begin->size());
+  }
+  compact->close_pending = false;
   Status status;
   ParsedInternalKey ikey;
   std::string current_user_key;
@@ -955,21 +1529,38 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     if (has_imm_.NoBarrier_Load() != nullptr) {
       const uint64_t imm_start = env_->NowMicros();
       mutex_.Lock();
-      if (imm_ != nullptr) {
+      if (has_imm_.NoBarrier_Load() != nullptr) {
         CompactMemTable();
         // Wake up MakeRoomForWrite() if necessary.
         background_work_finished_signal_.SignalAll();
       }
       mutex_.Unlock();
-      imm_micros += (env_->NowMicros() - imm_start);
+      *imm_micros += (env_->NowMicros() - imm_start);
     }
 
     Slice key = input->key();
+    const bool parsed = ParseInternalKey(key, &ikey);
+    if (end != nullptr && parsed &&
+        user_comparator()->Compare(ikey.user_key, *end) >= 0) {
+      // The rest belongs to the next part of the compaction
+      break;
+    }
+
     //与level + 2层的文件比较，如果目前的compact已经会导致后续level + 1 与 level + 2 compact压力过大
     //那么结束本次compact
     if (compact->compaction->ShouldStopBefore(key) &&
         compact->builder != nullptr) {
-      status = FinishCompactionOutputFile(compact, input);
+      compact->close_pending = true;
+    }
+    // The tombstones of an output end at the first key of the next one,
+    // so all entries for a user key must go to the same output.
+    if (compact->close_pending &&
+        (compact->output_range_dels == nullptr ||
+         (parsed && user_comparator()->Compare(
+              ikey.user_key,
+              compact->current_output()->largest.user_key()) != 0))) {
+      status = FinishCompactionOutputFile(compact, input,
+                                          parsed ? &ikey.user_key : nullptr);
       if (!status.ok()) {
         break;
       }
@@ -977,7 +1568,7 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
 
     // Handle key/value, add to state, etc.
     bool drop = false;
-    if (!ParseInternalKey(key, &ikey)) {
+    if (!parsed) {
       // Do not hide error keys
       current_user_key.clear();
       has_current_user_key = false;
@@ -1014,6 +1605,12 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         //     few iterations of this loop (by rule (A) above).
         // Therefore this deletion marker is obsolete and can be dropped.
         drop = true;
+      } else if (compact->range_dels != nullptr &&
+                 compact->range_dels->MaxCoveringSequence(
+                     ikey.user_key, compact->smallest_snapshot) >
+                     ikey.sequence) {
+        // Hidden by a range tombstone that every snapshot sees
+        drop = true;
       }
 
       last_sequence_for_key = ikey.sequence;//更新为真正的SequenceNumber
@@ -1047,10 +1644,7 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
       if (compact->builder->FileSize() >=
           compact->compaction->MaxOutputFileSize()) {
         //compact的文件超过了大小(默认2M)，则关闭当前打开的sstable，持久化到磁盘。
-        status = FinishCompactionOutputFile(compact, input);
-        if (!status.ok()) {
-          break;
-        }
+        compact->close_pending = true;
       }
     }
 
@@ -1061,40 +1655,26 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   if (status.ok() && shutting_down_.Acquire_Load()) {
     status = Status::IOError("Deleting DB during compaction");
   }
+  if (status.ok() && compact->builder == nullptr &&
+      compact->output_range_dels != nullptr) {
+    // Tombstones past the last output still need a file
+    Slice lower(compact->output_lower);
+    RangeTombstoneList rest(user_comparator());
+    ClipRangeTombstones(*compact->output_range_dels, user_comparator(),
+                        compact->has_output_lower ? &lower : nullptr, end,
+                        &rest);
+    if (!rest.empty()) {
+      status = OpenCompactionOutputFile(compact);
+    }
+  }
   //持久化尚未落盘的文件
   if (status.ok() && compact->builder != nullptr) {
-    status = FinishCompactionOutputFile(compact, input);
+    status = FinishCompactionOutputFile(compact, input, end);
   }
   if (status.ok()) {
     status = input->status();
   }
   delete input;
-  input = nullptr;
-
-  //统计信息
-  CompactionStats stats;
-  stats.micros = env_->NowMicros() - start_micros - imm_micros;
-  for (int which = 0; which < 2; which++) {
-    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
-      stats.bytes_read += compact->compaction->input(which, i)->file_size;
-    }
-  }
-  for (size_t i = 0; i < compact->outputs.size(); i++) {
-    stats.bytes_written += compact->outputs[i].file_size;
-  }
-
-  mutex_.Lock();
-  stats_[compact->compaction->level() + 1].Add(stats);
-
-  if (status.ok()) {
-    status = InstallCompactionResults(compact);
-  }
-  if (!status.ok()) {
-    RecordBackgroundError(status);
-  }
-  VersionSet::LevelSummaryStorage tmp;
-  Log(options_.info_log,
-      "compacted to: %s", versions_->LevelSummary(&tmp));
   return status;
 }
 
@@ -1124,7 +1704,10 @@ static void CleanupIteratorState(void* arg1, void* arg2) {
 
 Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
                                       SequenceNumber* latest_snapshot,
-                                      uint32_t* seed) {
+                                      uint32_t* seed,
+                                      RangeTombstoneList** range_dels,
+                                      const RangeTombstoneList**
+                                          table_range_dels) {
   mutex_.Lock();
   *latest_snapshot = versions_->LastSequence();
 
@@ -1145,7 +1728,39 @@ Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
   internal_iter->RegisterCleanup(CleanupIteratorState, cleanup, nullptr);
 
   *seed = ++seed_;
+  MemTable* const mems[2] = { mem_, imm_ };
+  Version* const current = versions_->current();
   mutex_.Unlock();
+
+  if (range_dels != nullptr) {
+    // The references taken above keep the memtables and the version alive
+    RangeTombstoneList* list = new RangeTombstoneList(user_comparator());
+    Status s;
+    for (int i = 0; i < 2 && s.ok(); i++) {
+      if (mems[i] != nullptr) {
+        Iterator* iter = mems[i]->NewRangeTombstoneIterator();
+        s = list->AddAll(iter);
+        delete iter;
+      }
+    }
+    list->Finish();
+    if (!s.ok() || list->empty()) {
+      delete list;
+      list = nullptr;
+    }
+    const RangeTombstoneList* table_list = nullptr;
+    if (s.ok()) {
+      s = current->GetRangeTombstones(&table_list);
+    }
+    if (!s.ok()) {
+      delete list;
+      list = nullptr;
+      delete internal_iter;
+      internal_iter = NewErrorIterator(s);
+    }
+    *range_dels = list;
+    *table_range_dels = table_list;
+  }
   return internal_iter;
 }
 
@@ -1163,8 +1778,12 @@ int64_t DBImpl::TEST_MaxNextLevelOverlappingBytes() {
 Status DBImpl::Get(const ReadOptions& options,
                    const Slice& key,
                    std::string* value) {
+  StopWatch sw(env_, options_.statistics, kDbGetMicros);
   Status s;
+  PerfTimer mutex_timer(&PerfContext::db_mutex_lock_nanos);
+  mutex_timer.Start();
   MutexLock l(&mutex_);
+  mutex_timer.Stop();
   SequenceNumber snapshot;
   //如果ReadOptions指定了snapshot，使用对应的sequence_number用于后续的查找
   if (options.snapshot != nullptr) {
@@ -1191,18 +1810,33 @@ Status DBImpl::Get(const ReadOptions& options,
     // First look in the memtable, then in the immutable memtable (if any).
     // 查找时需要指定SequenceNumber
     LookupKey lkey(key, snapshot);
+    PerfTimer memtable_timer(&PerfContext::get_from_memtable_nanos);
+    memtable_timer.Start();
     //先查找memtable
-    if (mem->Get(lkey, value, &s)) {
-      // Done
+    bool done = mem->Get(lkey, value, &s);
+    PerfCount(&PerfContext::get_from_memtable_count);
     //再查找immutable memtable
-    } else if (imm != nullptr && imm->Get(lkey, value, &s)) {
-      // Done
-    } else {
+    if (!done && imm != nullptr) {
+      done = imm->Get(lkey, value, &s);
+      PerfCount(&PerfContext::get_from_memtable_count);
+    }
+    memtable_timer.Stop();
+    if (!done) {
       //查找sstable
+      PerfTimer files_timer(&PerfContext::get_from_output_files_nanos);
+      files_timer.Start();
       s = current->Get(options, lkey, value, &stats);
       have_stat_update = true;
     }
+    Statistics* const statistics = options_.statistics;
+    RecordTick(statistics, have_stat_update ? kMemtableMiss : kMemtableHit);
+    RecordTick(statistics, kNumberKeysRead);
+    if (s.ok()) {
+      RecordTick(statistics, kBytesRead, value->size());
+    }
+    mutex_timer.Start();
     mutex_.Lock();
+    mutex_timer.Stop();
   }
 
   if (have_stat_update && current->UpdateStats(stats)) {
@@ -1214,16 +1848,154 @@ Status DBImpl::Get(const ReadOptions& options,
   return s;
 }
 
+namespace {
+
+// Orders MultiGet() key indices by user key, so that keys which land in
+// the same file or block are looked up next to each other.
+struct MultiGetKeyOrder {
+  const Comparator* ucmp;
+  const std::vector<Slice>* keys;
+
+  bool operator()(size_t a, size_t b) const {
+    return ucmp->Compare((*keys)[a], (*keys)[b]) < 0;
+  }
+};
+
+}  // anonymous namespace
+
+void DBImpl::MultiGet(const ReadOptions& options,
+                      const std::vector<Slice>& keys,
+                      std::vector<std::string>* values,
+                      std::vector<Status>* statuses) {
+  StopWatch sw(env_, options_.statistics, kDbMultiGetMicros);
+  const size_t n = keys.size();
+  values->clear();
+  values->resize(n);
+  statuses->clear();
+  statuses->resize(n);
+
+  PerfTimer mutex_timer(&PerfContext::db_mutex_lock_nanos);
+  mutex_timer.Start();
+  MutexLock l(&mutex_);
+  mutex_timer.Stop();
+  SequenceNumber snapshot;
+  if (options.snapshot != nullptr) {
+    snapshot =
+        static_cast<const SnapshotImpl*>(options.snapshot)->sequence_number();
+  } else {
+    snapshot = versions_->LastSequence();
+  }
+
+  MemTable* mem = mem_;
+  MemTable* imm = imm_;
+  Version* current = versions_->current();
+  mem->Ref();
+  if (imm != nullptr) imm->Ref();
+  current->Ref();
+
+  // Requests that missed both memtables and go to the sstables
+  std::vector<Version::GetRequest> file_reqs;
+  file_reqs.reserve(n);
+
+  // Unlock while reading from files and memtables
+  {
+    mutex_.Unlock();
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++) {
+      order[i] = i;
+    }
+    MultiGetKeyOrder key_order;
+    key_order.ucmp = user_comparator();
+    key_order.keys = &keys;
+    std::stable_sort(order.begin(), order.end(), key_order);
+
+    std::deque<LookupKey> lkeys;
+    std::vector<Version::GetRequest*> reqs;
+    std::vector<size_t> req_index;  // Position of reqs[j] in "keys"
+    for (size_t j = 0; j < n; j++) {
+      const size_t i = order[j];
+      lkeys.emplace_back(keys[i], snapshot);
+      const LookupKey& lkey = lkeys.back();
+      std::string* value = &(*values)[i];
+      Status* s = &(*statuses)[i];
+      PerfTimer memtable_timer(&PerfContext::get_from_memtable_nanos);
+      memtable_timer.Start();
+      bool done = mem->Get(lkey, value, s);
+      PerfCount(&PerfContext::get_from_memtable_count);
+      if (!done && imm != nullptr) {
+        done = imm->Get(lkey, value, s);
+        PerfCount(&PerfContext::get_from_memtable_count);
+      }
+      memtable_timer.Stop();
+      if (!done) {
+        file_reqs.push_back(Version::GetRequest());
+        Version::GetRequest* req = &file_reqs.back();
+        req->key = &lkey;
+        req->value = value;
+        reqs.push_back(req);
+        req_index.push_back(i);
+      }
+    }
+    if (!reqs.empty()) {
+      // Still sorted by user key since "order" was
+      PerfTimer files_timer(&PerfContext::get_from_output_files_nanos);
+      files_timer.Start();
+      current->MultiGet(options, reqs);
+      files_timer.Stop();
+      for (size_t j = 0; j < reqs.size(); j++) {
+        (*statuses)[req_index[j]] = reqs[j]->status;
+      }
+    }
+    Statistics* const statistics = options_.statistics;
+    if (statistics != nullptr) {
+      uint64_t bytes_read = 0;
+      for (size_t i = 0; i < n; i++) {
+        if ((*statuses)[i].ok()) {
+          bytes_read += (*values)[i].size();
+        }
+      }
+      statistics->RecordTick(kMemtableHit, n - reqs.size());
+      statistics->RecordTick(kMemtableMiss, reqs.size());
+      statistics->RecordTick(kNumberKeysRead, n);
+      statistics->RecordTick(kBytesRead, bytes_read);
+    }
+    mutex_timer.Start();
+    mutex_.Lock();
+    mutex_timer.Stop();
+  }
+
+  bool need_compaction = false;
+  for (size_t j = 0; j < file_reqs.size(); j++) {
+    if (current->UpdateStats(file_reqs[j].stats)) {
+      need_compaction = true;
+    }
+  }
+  if (need_compaction) {
+    MaybeScheduleCompaction();
+  }
+  mem->Unref();
+  if (imm != nullptr) imm->Unref();
+  current->Unref();
+}
+
 Iterator* DBImpl::NewIterator(const ReadOptions& options) {
   SequenceNumber latest_snapshot;
   uint32_t seed;
-  Iterator* iter = NewInternalIterator(options, &latest_snapshot, &seed);
+  RangeTombstoneList* range_dels;
+  const RangeTombstoneList* table_range_dels;
+  Iterator* iter = NewInternalIterator(options, &latest_snapshot, &seed,
+                                       &range_dels, &table_range_dels);
+  const SliceTransform* prefix_extractor =
+      (options.prefix_same_as_start && options_.prefix_extractor != nullptr)
+      ? internal_prefix_extractor_.user_transform()
+      : nullptr;
   return NewDBIterator(
       this, user_comparator(), iter,
       (options.snapshot != nullptr
        ? static_cast<const SnapshotImpl*>(options.snapshot)->sequence_number()
        : latest_snapshot),
-      seed);
+      seed, range_dels, table_range_dels, prefix_extractor, env_,
+      options_.statistics);
 }
 
 void DBImpl::RecordReadSample(Slice key) {
@@ -1255,6 +2027,7 @@ Status DBImpl::Delete(const WriteOptions& options, const Slice& key) {
 //调用流程: DBImpl::Put -> DB::Put -> DBImpl::Write
 Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
   //一次Write写入内容会首先封装到Writer里，Writer同时记录是否完成写入、触发Writer写入的条件变量等
+  StopWatch sw(env_, options_.statistics, kDbWriteMicros);
   Writer w(&mutex_);
   w.batch = my_batch;
   w.sync = options.sync;
@@ -1262,10 +2035,14 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
 
   MutexLock l(&mutex_);//多个线程调用的写入操作通过mutex_串行化
   writers_.push_back(&w);
+  w.in_queue = true;
   //数据先放到queue里，如果不在queue顶部则等待
   //这里是对数据流的一个优化，wirters_里Writer写入时，可能会把queue里其他Writer也完成写入
-  while (!w.done && &w != writers_.front()) {
+  while (!w.done && (!w.in_queue || &w != writers_.front())) {
     w.cv.Wait();
+    if (w.insert_pending) {
+      InsertFollowerBatch(&w);
+    }
   }
   //如果醒来并且抢到了mutex_，检查是否已经完成了写入(by其他Writer)，则直接返回写入status
   if (w.done) {
@@ -1274,33 +2051,59 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
 
   // May temporarily unlock and wait.
   Status status = MakeRoomForWrite(my_batch == nullptr);
-  uint64_t last_sequence = versions_->LastSequence();//本次写入的SequenceNumber
+  //本次写入的SequenceNumber
+  uint64_t last_sequence = LastAllocatedSequence();
   Writer* last_writer = &w;
+  WriteGroup group;
   if (status.ok() && my_batch != nullptr) {  // nullptr batch is for compactions
     //updates存储合并后的所有WriteBatch
     WriteBatch* updates = BuildBatchGroup(&last_writer);
     WriteBatchInternal::SetSequence(updates, last_sequence + 1);
+    last_batch_group_size_ = WriteBatchInternal::ByteSize(updates);
+    // Batches are inserted one by one, from their own writers' threads or
+    // after the log stage, instead of as the combined "updates".
+    const bool per_writer_insert =
+        options_.enable_pipelined_write ||
+        (options_.allow_concurrent_memtable_write && last_writer != &w);
+    if (per_writer_insert) {
+      CollectWriteGroup(last_writer, last_sequence + 1, &group);
+    }
     last_sequence += WriteBatchInternal::Count(updates);
+    group.last_sequence = last_sequence;
 
     // Add to log and apply to memtable.  We can release the lock
     // during this phase since &w is currently responsible for logging
     // and protects against concurrent loggers and concurrent writes
-    // into mem_.
+    // into mem_.  With enable_pipelined_write, the memtable is
+    // updated later by WriteMemTableGroup().
     {
       mutex_.Unlock();
+      Statistics* const statistics = options_.statistics;
+      RecordTick(statistics, kNumberKeysWritten,
+                 WriteBatchInternal::Count(updates));
+      RecordTick(statistics, kBytesWritten,
+                 WriteBatchInternal::ByteSize(updates));
       //WriterBatch写入log文件，包括:sequence,操作count,每次操作的类型(Put/Delete)，key/value及其长度
       status = log_->AddRecord(WriteBatchInternal::Contents(updates));
+      RecordTick(statistics, kWalFileBytes,
+                 WriteBatchInternal::Contents(updates).size());
       bool sync_error = false;
       if (status.ok() && options.sync) {
         //log_底层使用logfile_与文件系统交互，调用Sync完成写入
+        StopWatch sync_sw(env_, statistics, kWalFileSyncMicros);
+        RecordTick(statistics, kWalFileSynced);
         status = logfile_->Sync();
         if (!status.ok()) {
           sync_error = true;
         }
       }
       //写入文件系统后不用担心数据丢失，继续插入MemTable
-      if (status.ok()) {
-        status = WriteBatchInternal::InsertInto(updates, mem_);
+      if (status.ok() && !options_.enable_pipelined_write) {
+        if (per_writer_insert) {
+          status = InsertBatchGroup(group);
+        } else {
+          status = WriteBatchInternal::InsertInto(updates, mem_);
+        }
       }
       mutex_.Lock();
       if (sync_error) {
@@ -1308,19 +2111,58 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
         // just added may or may not show up when the DB is re-opened.
         // So we force the DB into a mode where all future writes fail.
         RecordBackgroundError(status);
+      } else if (!status.ok() && options_.enable_pipelined_write) {
+        // Part of the record may have reached the log, but LastSequence()
+        // cannot move past our sequence numbers while earlier groups are
+        // unpublished.  Fail all future writes so that no later group
+        // logs another batch under the same sequence numbers.
+        RecordBackgroundError(status);
       }
     }
     if (updates == tmp_batch_) tmp_batch_->Clear();
 
-    versions_->SetLastSequence(last_sequence);
+    if (options_.enable_pipelined_write) {
+      if (status.ok()) {
+        // Hand the log over to the next group while we update the
+        // memtable.
+        PopWriters(&w, last_writer, status, false);
+        return WriteMemTableGroup(&group);
+      }
+      // Sequence numbers of earlier groups may still be unpublished, so
+      // leave LastSequence() alone; the background error recorded above
+      // keeps ours from being handed out again.
+    } else {
+      versions_->SetLastSequence(last_sequence);
+    }
   }
 
+  PopWriters(&w, last_writer, status, true);
+  return status;
+}
+
+// REQUIRES: mutex_ is held
+SequenceNumber DBImpl::LastAllocatedSequence() {
+  mutex_.AssertHeld();
+  if (memtable_groups_.empty()) {
+    return versions_->LastSequence();
+  }
+  return memtable_groups_.back()->last_sequence;
+}
+
+// REQUIRES: mutex_ is held
+// REQUIRES: leader is at the front of writers_
+// Remove the writers from leader through last_writer from writers_ and
+// wake up the next writer in line.  If "finish" is set, also hand
+// "status" to every removed writer other than the leader and wake it up.
+void DBImpl::PopWriters(Writer* leader, Writer* last_writer,
+                        const Status& status, bool finish) {
   //last_writer记录了writers_里合并的最后一个Writer
   //逐个遍历弹出writers_里的元素，并环形等待write的线程，直到遇到last_writer
   while (true) {
     Writer* ready = writers_.front();
     writers_.pop_front();
-    if (ready != &w) {
+    ready->in_queue = false;
+    if (ready != leader && finish) {
       ready->status = status;
       ready->done = true;
       ready->cv.Signal();
@@ -1333,7 +2175,78 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
   if (!writers_.empty()) {
     writers_.front()->cv.Signal();
   }
+}
 
+// REQUIRES: mutex_ is held
+// REQUIRES: the front of writers_ leads a group ending at last_writer
+// Fill *group with the writers of the group, and give each writer that
+// carries a batch the sequence number of its first entry.
+void DBImpl::CollectWriteGroup(Writer* last_writer, SequenceNumber seq,
+                               WriteGroup* group) {
+  std::deque<Writer*>::iterator iter = writers_.begin();
+  while (true) {
+    Writer* w = *iter;
+    if (w->batch != nullptr) {
+      w->sequence = seq;
+      seq += WriteBatchInternal::Count(w->batch);
+    }
+    group->writers.push_back(w);
+    if (w == last_writer) break;
+    ++iter;
+  }
+}
+
+// REQUIRES: mutex_ is held
+// Called by a writer whose group leader asked it to apply its own batch.
+void DBImpl::InsertFollowerBatch(Writer* w) {
+  mutex_.AssertHeld();
+  w->insert_pending = false;
+  MemTable* mem = mem_;
+  mutex_.Unlock();
+  Status s = WriteBatchInternal::InsertIntoConcurrently(w->batch,
+                                                        w->sequence, mem);
+  mutex_.Lock();
+  Writer* leader = w->leader;
+  if (!s.ok() && leader->status.ok()) {
+    leader->status = s;
+  }
+  if (--leader->pending_inserts == 0) {
+    leader->cv.Signal();
+  }
+}
+
+// REQUIRES: mutex_ is held
+// REQUIRES: the log record of "group" has been written
+// Wait for the groups that were logged before "group" to reach the
+// memtable, apply "group", publish its sequence numbers and finish its
+// writers.
+Status DBImpl::WriteMemTableGroup(WriteGroup* group) {
+  mutex_.AssertHeld();
+  Writer* leader = group->writers[0];
+  memtable_groups_.push_back(group);
+  while (memtable_groups_.front() != group) {
+    leader->cv.Wait();
+  }
+
+  mutex_.Unlock();
+  Status status = InsertBatchGroup(*group);
+  mutex_.Lock();
+
+  versions_->SetLastSequence(group->last_sequence);
+  memtable_groups_.pop_front();
+  if (!memtable_groups_.empty()) {
+    memtable_groups_.front()->writers[0]->cv.Signal();
+  } else {
+    // MakeRoomForWrite() may be waiting to switch memtables.
+    background_work_finished_signal_.SignalAll();
+  }
+
+  for (size_t i = 1; i < group->writers.size(); i++) {
+    Writer* w = group->writers[i];
+    w->status = status;
+    w->done = true;
+    w->cv.Signal();
+  }
   return status;
 }
 
@@ -1392,6 +2305,50 @@ WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer) {
   return result;
 }
 
+Status DBImpl::InsertBatchGroup(const WriteGroup& group) {
+  const std::vector<Writer*>& writers = group.writers;
+  if (!options_.allow_concurrent_memtable_write) {
+    Status s;
+    for (size_t i = 0; i < writers.size() && s.ok(); i++) {
+      if (writers[i]->batch != nullptr) {
+        s = WriteBatchInternal::InsertInto(writers[i]->batch,
+                                           writers[i]->sequence, mem_);
+      }
+    }
+    return s;
+  }
+
+  Writer* leader = writers[0];
+  mutex_.Lock();
+  leader->status = Status::OK();
+  leader->pending_inserts = 0;
+  for (size_t i = 1; i < writers.size(); i++) {
+    Writer* w = writers[i];
+    if (w->batch == nullptr) {
+      continue;
+    }
+    w->leader = leader;
+    w->insert_pending = true;
+    leader->pending_inserts++;
+    w->cv.Signal();
+  }
+  mutex_.Unlock();
+
+  Status s = WriteBatchInternal::InsertIntoConcurrently(leader->batch,
+                                                        leader->sequence,
+                                                        mem_);
+
+  mutex_.Lock();
+  while (leader->pending_inserts > 0) {
+    leader->cv.Wait();
+  }
+  if (s.ok()) {
+    s = leader->status;
+  }
+  mutex_.Unlock();
+  return s;
+}
+
 // REQUIRES: mutex_ is held
 // REQUIRES: this thread is currently at the front of the writer queue
 // 正常写入key:value的情况下,force = false
@@ -1401,24 +2358,27 @@ Status DBImpl::MakeRoomForWrite(bool force) {
   bool allow_delay = !force;
   Status s;
   while (true) {
+    UpdateWriteController();
     if (!bg_error_.ok()) {
       // Yield previous error
       s = bg_error_;
       break;
-    } else if (
-        allow_delay &&
-        versions_->NumLevelFiles(0) >= config::kL0_SlowdownWritesTrigger) {
-      // We are getting close to hitting a hard limit on the number of
-      // L0 files.  Rather than delaying a single write by several
-      // seconds when we hit the hard limit, start delaying each
-      // individual write by 1ms to reduce latency variance.  Also,
-      // this delay hands over some CPU to the compaction thread in
-      // case it is sharing the same core as the writer.
-      // 0层文件超过8个，则等待，至多等待一次
-      mutex_.Unlock();
-      env_->SleepForMicroseconds(1000);
+    } else if (allow_delay && write_controller_.NeedsDelay()) {
+      // We are getting close to the point where writes stop.  Rather than
+      // delaying a single write by several seconds when we get there,
+      // pace every write to a rate that falls as compactions fall
+      // further behind.  Also, the delays hand over some CPU to the
+      // compaction thread in case it is sharing the same core as the
+      // writer.
+      const uint64_t delay =
+          write_controller_.GetDelay(env_->NowMicros(), last_batch_group_size_);
       allow_delay = false;  // Do not delay a single write more than once
-      mutex_.Lock();
+      if (delay > 0) {
+        mutex_.Unlock();
+        env_->SleepForMicroseconds(static_cast<int>(delay));
+        RecordTick(options_.statistics, kStallMicros, delay);
+        mutex_.Lock();
+      }
     } else if (!force &&
                (mem_->ApproximateMemoryUsage() <= options_.write_buffer_size)) {
       // mem_不足4M，可以继续写入
@@ -1428,12 +2388,18 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       // We have filled up the current memtable, but the previous
       // one is still being compacted, so we wait.
       Log(options_.info_log, "Current memtable full; waiting...\n");
-      background_work_finished_signal_.Wait();
-    } else if (versions_->NumLevelFiles(0) >= config::kL0_StopWritesTrigger) {
-      // There are too many level-0 files.
+      WaitForBackgroundWorkWhileStalled();
+    } else if (write_controller_.IsStopped()) {
+      // There are too many level-0 files, or too many bytes pending
+      // compaction.
       // level-0文件个数需要控制，避免影响查找速度
       // 因此>=12个，则停止写入
-      Log(options_.info_log, "Too many L0 files; waiting...\n");
+      Log(options_.info_log,
+          "Too many L0 files or pending compaction bytes; waiting...\n");
+      WaitForBackgroundWorkWhileStalled();
+    } else if (!memtable_groups_.empty()) {
+      // Pipelined writes are still being applied to mem_; it must be
+      // complete before it becomes imm_.
       background_work_finished_signal_.Wait();
     } else {
       // Attempt to switch to a new memtable and trigger compaction of old
@@ -1462,6 +2428,104 @@ Status DBImpl::MakeRoomForWrite(bool force) {
   return s;
 }
 
+// REQUIRES: mutex_ is held
+void DBImpl::QueueListenerEvent(ListenerEvent* event) {
+  mutex_.AssertHeld();
+  pending_listener_events_.push_back(event);
+}
+
+// REQUIRES: mutex_ is held
+void DBImpl::NotifyListeners() {
+  mutex_.AssertHeld();
+  if (options_.listeners.empty()) {
+    return;
+  }
+
+  // Only background work changes the number of level-0 files and the
+  // bytes pending compaction, so the stall condition is up to date here.
+  UpdateWriteController();
+  WriteStallCondition stall = kWriteStallNormal;
+  if (write_controller_.IsStopped()) {
+    stall = kWriteStallStopped;
+  } else if (write_controller_.NeedsDelay()) {
+    stall = kWriteStallDelayed;
+  }
+  if (stall != stall_condition_) {
+    ListenerEvent* event =
+        new ListenerEvent(ListenerEvent::kStallConditionsChanged);
+    event->stall.db_name = dbname_;
+    event->stall.cur = stall;
+    event->stall.prev = stall_condition_;
+    stall_condition_ = stall;
+    QueueListenerEvent(event);
+  }
+  if (pending_listener_events_.empty()) {
+    return;
+  }
+
+  std::vector<ListenerEvent*> events;
+  events.swap(pending_listener_events_);
+  mutex_.Unlock();
+  for (size_t i = 0; i < events.size(); i++) {
+    const ListenerEvent* event = events[i];
+    for (size_t j = 0; j < options_.listeners.size(); j++) {
+      EventListener* listener = options_.listeners[j];
+      switch (event->type) {
+        case ListenerEvent::kFlushCompleted:
+          listener->OnFlushCompleted(event->flush);
+          break;
+        case ListenerEvent::kCompactionCompleted:
+          listener->OnCompactionCompleted(event->compaction);
+          break;
+        case ListenerEvent::kStallConditionsChanged:
+          listener->OnStallConditionsChanged(event->stall);
+          break;
+        case ListenerEvent::kTableFileDeleted:
+          listener->OnTableFileDeleted(event->deletion);
+          break;
+      }
+    }
+    delete event;
+  }
+  mutex_.Lock();
+}
+
+void DBImpl::NotifyTableFileCreated(uint64_t file_number, uint64_t file_size,
+                                    TableFileCreationReason reason,
+                                    const Status& status) {
+  if (options_.listeners.empty()) {
+    return;
+  }
+  TableFileCreationInfo info;
+  info.db_name = dbname_;
+  info.file_path = TableFileName(dbname_, file_number);
+  info.file_number = file_number;
+  info.file_size = file_size;
+  info.reason = reason;
+  info.status = status;
+  for (size_t i = 0; i < options_.listeners.size(); i++) {
+    options_.listeners[i]->OnTableFileCreated(info);
+  }
+}
+
+// REQUIRES: mutex_ is held
+void DBImpl::WaitForBackgroundWorkWhileStalled() {
+  mutex_.AssertHeld();
+  Statistics* const statistics = options_.statistics;
+  const uint64_t start = (statistics != nullptr) ? env_->NowMicros() : 0;
+  background_work_finished_signal_.Wait();
+  if (statistics != nullptr) {
+    statistics->RecordTick(kStallMicros, env_->NowMicros() - start);
+  }
+}
+
+// REQUIRES: mutex_ is held
+void DBImpl::UpdateWriteController() {
+  mutex_.AssertHeld();
+  write_controller_.Update(options_, versions_->NumLevelFiles(0),
+                           versions_->EstimatedPendingCompactionBytes());
+}
+
 bool DBImpl::GetProperty(const Slice& property, std::string* value) {
   value->clear();
 
@@ -1524,6 +2588,48 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
              static_cast<unsigned long long>(total_usage));
     value->append(buf);
     return true;
+  } else if (in == "estimate-pending-compaction-bytes") {
+    char buf[50];
+    snprintf(buf, sizeof(buf), "%llu",
+             static_cast<unsigned long long>(
+                 versions_->EstimatedPendingCompactionBytes()));
+    value->append(buf);
+    return true;
+  } else if (in == "actual-delayed-write-rate") {
+    UpdateWriteController();
+    char buf[50];
+    snprintf(buf, sizeof(buf), "%llu",
+             static_cast<unsigned long long>(
+                 write_controller_.delayed_write_rate()));
+    value->append(buf);
+    return true;
+  } else if (in == "is-write-stopped") {
+    UpdateWriteController();
+    value->append(write_controller_.IsStopped() ? "1" : "0");
+    return true;
+  } else if (in == "statistics") {
+    if (options_.statistics == nullptr) {
+      return false;
+    }
+    value->append(options_.statistics->ToString());
+    return true;
+  } else if (in == "block-cache-stats") {
+    value->append("Priority    Lookups       Hits  Hit(%)\n");
+    static const Cache::Priority kPriorities[] = {
+      Cache::kHighPriority, Cache::kLowPriority
+    };
+    for (int i = 0; i < 2; i++) {
+      uint64_t lookups, hits;
+      options_.block_cache->GetLookupStats(kPriorities[i], &lookups, &hits);
+      char buf[100];
+      snprintf(buf, sizeof(buf), "%-8s %10llu %10llu %7.1f\n",
+               kPriorities[i] == Cache::kHighPriority ? "high" : "low",
+               static_cast<unsigned long long>(lookups),
+               static_cast<unsigned long long>(hits),
+               lookups > 0 ? 100.0 * hits / lookups : 0.0);
+      value->append(buf);
+    }
+    return true;
   }
 
   return false;
@@ -1570,6 +2676,26 @@ Status DB::Delete(const WriteOptions& opt, const Slice& key) {
   return Write(opt, &batch);
 }
 
+Status DB::DeleteRange(const WriteOptions& opt,
+                       const Slice& begin, const Slice& end) {
+  WriteBatch batch;
+  batch.DeleteRange(begin, end);
+  return Write(opt, &batch);
+}
+
+void DB::MultiGet(const ReadOptions& options,
+                  const std::vector<Slice>& keys,
+                  std::vector<std::string>* values,
+                  std::vector<Status>* statuses) {
+  values->clear();
+  values->resize(keys.size());
+  statuses->clear();
+  statuses->resize(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    (*statuses)[i] = Get(options, keys[i], &(*values)[i]);
+  }
+}
+
 DB::~DB() { }
 
 Status DB::Open(const Options& options, const std::string& dbname,
@@ -1606,6 +2732,8 @@ Status DB::Open(const Options& options, const std::string& dbname,
   if (s.ok()) {
     impl->DeleteObsoleteFiles();
     impl->MaybeScheduleCompaction();
+    // Report the tables written and deleted by the recovery
+    impl->NotifyListeners();
   }
   impl->mutex_.Unlock();
   if (s.ok()) {
@@ -7,17 +7,23 @@
 
 #include <deque>
 #include <set>
+#include <vector>
 #include "db/dbformat.h"
 #include "db/log_writer.h"
 #include "db/snapshot.h"
+#include "db/write_controller.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/listener.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
 
 namespace leveldb {
 
+class Compaction;
 class MemTable;
+class RangeTombstoneList;
+struct RangeTombstone;
 class TableCache;
 class Version;
 class VersionEdit;
@@ -35,6 +41,10 @@ class DBImpl : public DB {
   virtual Status Get(const ReadOptions& options,
                      const Slice& key,
                      std::string* value);
+  virtual void MultiGet(const ReadOptions& options,
+                        const std::vector<Slice>& keys,
+                        std::vector<std::string>* values,
+                        std::vector<Status>* statuses);
   virtual Iterator* NewIterator(const ReadOptions&);
   virtual const Snapshot* GetSnapshot();
   virtual void ReleaseSnapshot(const Snapshot* snapshot);
@@ -67,11 +77,20 @@ class DBImpl : public DB {
  private:
   friend class DB;
   struct CompactionState;
+  struct ListenerEvent;
+  struct Subcompaction;
   struct Writer;
-
-  Iterator* NewInternalIterator(const ReadOptions&,
-                                SequenceNumber* latest_snapshot,
-                                uint32_t* seed);
+  struct WriteGroup;
+
+  // If range_dels is not nullptr, also sets *range_dels to a new list of
+  // the range tombstones in the memtables of the returned state, and
+  // *table_range_dels to the list of those in its table files, which
+  // lives as long as the returned iterator.  Either is set to nullptr if
+  // there are no such tombstones.
+  Iterator* NewInternalIterator(
+      const ReadOptions&, SequenceNumber* latest_snapshot, uint32_t* seed,
+      RangeTombstoneList** range_dels = nullptr,
+      const RangeTombstoneList** table_range_dels = nullptr);
 
   Status NewDB();
 
@@ -89,40 +108,120 @@ class DBImpl : public DB {
   // Compact the in-memory write buffer to disk.  Switches to a new
   // log-file/memtable and writes a new descriptor iff successful.
   // Errors are recorded in bg_error_.
+  // REQUIRES: has_imm_ is set, i.e. no other thread is compacting imm_.
   void CompactMemTable() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   Status RecoverLogFile(uint64_t log_number, bool last_log, bool* save_manifest,
                         VersionEdit* edit, SequenceNumber* max_sequence)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base)
+  // If base is non-null the new table may be placed above level 0, and
+  // the caller is left holding the BeginVersionEdit() claim for *edit.
+  // If flush_info is non-null, it is filled in for OnFlushCompleted().
+  Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base,
+                          FlushJobInfo* flush_info = nullptr)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   Status MakeRoomForWrite(bool force /* compact even if there is room? */)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void UpdateWriteController() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Wait for background work while writes are stalled, counting the wait
+  // in the kStallMicros ticker of options_.statistics.
+  void WaitForBackgroundWorkWhileStalled() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   WriteBatch* BuildBatchGroup(Writer** last_writer)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  void PopWriters(Writer* leader, Writer* last_writer, const Status& status,
+                  bool finish) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void CollectWriteGroup(Writer* last_writer, SequenceNumber seq,
+                         WriteGroup* group) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  SequenceNumber LastAllocatedSequence() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Insert the batches of "group" into mem_ at the sequence numbers
+  // assigned by CollectWriteGroup().  With allow_concurrent_memtable_write
+  // every writer inserts its own batch from its own thread.  Called by
+  // the group leader without mutex_ held.
+  Status InsertBatchGroup(const WriteGroup& group) LOCKS_EXCLUDED(mutex_);
+  void InsertFollowerBatch(Writer* w) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Memtable stage of enable_pipelined_write.
+  Status WriteMemTableGroup(WriteGroup* group)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   void RecordBackgroundError(const Status& s);
 
   void MaybeScheduleCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   static void BGWork(void* db);
+  static void BGFlushWork(void* db);
   void BackgroundCall();
-  void BackgroundCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void BackgroundFlushCall();
+  // Returns false if there was nothing that this thread could compact.
+  bool BackgroundCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void CleanupCompaction(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   Status DoCompactionWork(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Collect the range tombstones of the inputs of *compact into
+  // *range_dels, and the ones the outputs must keep into
+  // *output_range_dels.  Also marks the inputs that are entirely deleted
+  // as skipped.  May release mutex_ while reading tables.
+  Status PrepareCompactionTombstones(
+      CompactionState* compact, RangeTombstoneList* range_dels,
+      std::vector<RangeTombstone>* output_range_dels)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Merge the input entries of *compact whose user keys fall in
+  // [*begin,*end) into new output files of *compact.  begin==nullptr is
+  // treated as a key before all keys, end==nullptr as a key after all keys.
+  Status DoCompactionRange(CompactionState* compact,
+                           const Slice* begin, const Slice* end,
+                           int64_t* imm_micros) LOCKS_EXCLUDED(mutex_);
+
+  // Split the key range of *c into at most options_.max_subcompactions
+  // parts of similar input size.  Stores the first user key of every part
+  // but the first in *boundaries, in ascending order.
+  void GenSubcompactionBoundaries(Compaction* c,
+                                  std::vector<std::string>* boundaries);
+  static void SubcompactionWork(void* arg);
+
   Status OpenCompactionOutputFile(CompactionState* compact);
-  Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
+  // Finish the current output of *compact.  If the compaction carries
+  // range tombstones, the output gets their part below *limit (nullptr
+  // means no limit).
+  Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input,
+                                    const Slice* limit);
   Status InstallCompactionResults(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // VersionSet::LogAndApply() releases mutex_ while it writes the
+  // MANIFEST, and the edits of concurrent background threads must not be
+  // interleaved.  BeginVersionEdit() waits until no other thread is
+  // applying an edit and claims that right for the caller; the claim is
+  // ended by LogAndApply() or by EndVersionEdit().
+  void BeginVersionEdit() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void EndVersionEdit() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  Status LogAndApply(VersionEdit* edit) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Events for options_.listeners that arise while mutex_ is held are
+  // queued by QueueListenerEvent() and delivered by NotifyListeners(),
+  // which releases mutex_ while it calls the listeners.  NotifyListeners()
+  // also reports changes of the write stall condition.  Background
+  // threads call it once their work is done.
+  void QueueListenerEvent(ListenerEvent* event)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void NotifyListeners() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Tables are created while mutex_ is released, so listeners are told
+  // right away.
+  void NotifyTableFileCreated(uint64_t file_number, uint64_t file_size,
+                              TableFileCreationReason reason,
+                              const Status& status) LOCKS_EXCLUDED(mutex_);
+
   // Constant after construction
   Env* const env_;
   const InternalKeyComparator internal_comparator_;
   const InternalFilterPolicy internal_filter_policy_;
+  const InternalKeySliceTransform internal_prefix_extractor_;
   const Options options_;  // options_.comparator == &internal_comparator_
   const bool owns_info_log_;
   const bool owns_cache_;
@@ -141,6 +240,7 @@ class DBImpl : public DB {
   MemTable* mem_;
   MemTable* imm_ GUARDED_BY(mutex_);  // Memtable being compacted
   port::AtomicPointer has_imm_;       // So bg thread can detect non-null imm_
+                                      // that nobody is compacting yet
   WritableFile* logfile_;
   uint64_t logfile_number_ GUARDED_BY(mutex_);
   log::Writer* log_;
@@ -148,7 +248,15 @@ class DBImpl : public DB {
 
   // Queue of writers.
   std::deque<Writer*> writers_ GUARDED_BY(mutex_);
+  // Groups that have been logged but not yet applied to mem_, in log
+  // order (enable_pipelined_write only).
+  std::deque<WriteGroup*> memtable_groups_ GUARDED_BY(mutex_);
   WriteBatch* tmp_batch_ GUARDED_BY(mutex_);
+  // Paces writes while compactions are behind.
+  WriteController write_controller_ GUARDED_BY(mutex_);
+  // Size of the last group of batches written; the next write is charged
+  // for it while writes are delayed.
+  uint64_t last_batch_group_size_ GUARDED_BY(mutex_);
 
   SnapshotList snapshots_ GUARDED_BY(mutex_);
 
@@ -156,13 +264,25 @@ class DBImpl : public DB {
   // part of ongoing compactions.
   std::set<uint64_t> pending_outputs_ GUARDED_BY(mutex_);
 
-  // Has a background compaction been scheduled or is running?
-  bool background_compaction_scheduled_ GUARDED_BY(mutex_);
+  // Number of background compactions that are scheduled or running.
+  int background_compactions_scheduled_ GUARDED_BY(mutex_);
+
+  // Has a background memtable compaction been scheduled or is running?
+  bool background_flush_scheduled_ GUARDED_BY(mutex_);
+
+  // Is some thread between BeginVersionEdit() and the end of its claim?
+  bool version_edit_in_progress_ GUARDED_BY(mutex_);
+
+  // Listener events not yet delivered, and the write stall condition that
+  // listeners were last told about.
+  std::vector<ListenerEvent*> pending_listener_events_ GUARDED_BY(mutex_);
+  WriteStallCondition stall_condition_ GUARDED_BY(mutex_);
 
   // Information for a manual compaction
   struct ManualCompaction {
     int level;
     bool done;
+    bool in_progress;           // Picked up by a background thread
     const InternalKey* begin;   // null means beginning of key range
     const InternalKey* end;     // null means end of key range
     InternalKey tmp_storage;    // Used to keep track of compaction progress
@@ -206,6 +326,7 @@ class DBImpl : public DB {
 Options SanitizeOptions(const std::string& db,
                         const InternalKeyComparator* icmp,
                         const InternalFilterPolicy* ipolicy,
+                        const InternalKeySliceTransform* iprefix,
                         const Options& src);
 
 }  // namespace leveldb
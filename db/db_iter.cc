@@ -7,12 +7,16 @@
 #include "db/filename.h"
 #include "db/db_impl.h"
 #include "db/dbformat.h"
+#include "db/range_del.h"
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
+#include "leveldb/slice_transform.h"
 #include "port/port.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "util/perf_context.h"
 #include "util/random.h"
+#include "util/statistics.h"
 
 namespace leveldb {
 
@@ -49,11 +53,20 @@ class DBIter: public Iterator {
   };
 
   DBIter(DBImpl* db, const Comparator* cmp, Iterator* iter, SequenceNumber s,
-         uint32_t seed)
+         uint32_t seed, RangeTombstoneList* range_dels,
+         const RangeTombstoneList* table_range_dels,
+         const SliceTransform* prefix_extractor, Env* env,
+         Statistics* stats)
       : db_(db),
         user_comparator_(cmp),
         iter_(iter),
         sequence_(s),
+        range_dels_(range_dels),
+        table_range_dels_(table_range_dels),
+        prefix_extractor_(prefix_extractor),
+        env_(env),
+        stats_(stats),
+        has_prefix_(false),
         direction_(kForward),
         valid_(false),
         rnd_(seed),
@@ -61,6 +74,7 @@ class DBIter: public Iterator {
   }
   virtual ~DBIter() {
     delete iter_;
+    delete range_dels_;
   }
   virtual bool Valid() const { return valid_; }
   virtual Slice key() const {
@@ -90,6 +104,43 @@ class DBIter: public Iterator {
   void FindPrevUserEntry();
   bool ParseKey(ParsedInternalKey* key);
 
+  // Return the type of *ikey, or kTypeDeletion if a range tombstone
+  // hides it.
+  ValueType EffectiveType(const ParsedInternalKey& ikey) const {
+    if (ikey.type == kTypeValue &&
+        (Covered(range_dels_, ikey) || Covered(table_range_dels_, ikey))) {
+      return kTypeDeletion;
+    }
+    return ikey.type;
+  }
+
+  bool Covered(const RangeTombstoneList* list,
+               const ParsedInternalKey& ikey) const {
+    return list != nullptr &&
+           list->MaxCoveringSequence(ikey.user_key, sequence_) >
+               ikey.sequence;
+  }
+
+  // Return true iff the last Seek() limited the iteration to a prefix
+  // that "user_key" lacks.
+  bool OutsidePrefix(const Slice& user_key) const {
+    return has_prefix_ &&
+           (!prefix_extractor_->InDomain(user_key) ||
+            prefix_extractor_->Transform(user_key) != Slice(prefix_));
+  }
+
+  // Make the iterator invalid if it is limited to a prefix, since
+  // only Seek() and Next() are supported then.
+  bool RejectInPrefixMode() {
+    if (prefix_extractor_ == nullptr) {
+      return false;
+    }
+    valid_ = false;
+    status_ = Status::NotSupported(
+        "only Seek() and Next() work with prefix_same_as_start");
+    return true;
+  }
+
   inline void SaveKey(const Slice& k, std::string* dst) {
     dst->assign(k.data(), k.size());
   }
@@ -112,6 +163,15 @@ class DBIter: public Iterator {
   const Comparator* const user_comparator_;
   Iterator* const iter_;
   SequenceNumber const sequence_;
+  RangeTombstoneList* const range_dels_;
+  // Not owned; kept alive by iter_
+  const RangeTombstoneList* const table_range_dels_;
+  // Non-null iff ReadOptions::prefix_same_as_start was set
+  const SliceTransform* const prefix_extractor_;
+  Env* const env_;
+  Statistics* const stats_;   // Non-null iff Options::statistics was set
+  bool has_prefix_;
+  std::string prefix_;        // Prefix of the last Seek() target
 
   Status status_;
   std::string saved_key_;     // == current key when direction_==kReverse
@@ -145,6 +205,7 @@ inline bool DBIter::ParseKey(ParsedInternalKey* ikey) {
 
 void DBIter::Next() {
   assert(valid_);
+  RecordTick(stats_, kNumberDbNext);
 
   if (direction_ == kReverse) {  // Switch directions?
     direction_ = kForward;
@@ -176,11 +237,18 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
   assert(direction_ == kForward);
   do {
     ParsedInternalKey ikey;
-    if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
-      switch (ikey.type) {
+    const bool parsed = ParseKey(&ikey);
+    if (parsed && OutsidePrefix(ikey.user_key)) {
+      // Keys that share a prefix are adjacent, so none are left
+      break;
+    }
+    if (parsed && ikey.sequence <= sequence_) {
+      switch (EffectiveType(ikey)) {
         case kTypeDeletion:
+        case kTypeRangeDeletion:
           // Arrange to skip all upcoming entries for this key since
           // they are hidden by this deletion.
+          PerfCount(&PerfContext::internal_delete_skipped_count);
           SaveKey(ikey.user_key, skip);
           skipping = true;
           break;
@@ -188,6 +256,7 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
           if (skipping &&
               user_comparator_->Compare(ikey.user_key, *skip) <= 0) {
             // Entry hidden
+            PerfCount(&PerfContext::internal_key_skipped_count);
           } else {
             valid_ = true;
             saved_key_.clear();
@@ -204,6 +273,10 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
 
 void DBIter::Prev() {
   assert(valid_);
+  RecordTick(stats_, kNumberDbPrev);
+  if (RejectInPrefixMode()) {
+    return;
+  }
 
   if (direction_ == kForward) {  // Switch directions?
     // iter_ is pointing at the current entry.  Scan backwards until
@@ -242,7 +315,7 @@ void DBIter::FindPrevUserEntry() {
           // We encountered a non-deleted value in entries for previous keys,
           break;
         }
-        value_type = ikey.type;
+        value_type = EffectiveType(ikey);
         if (value_type == kTypeDeletion) {
           saved_key_.clear();
           ClearSavedValue();
@@ -272,12 +345,23 @@ void DBIter::FindPrevUserEntry() {
 }
 
 void DBIter::Seek(const Slice& target) {
+  StopWatch sw(env_, stats_, kDbSeekMicros);
+  RecordTick(stats_, kNumberDbSeek);
   direction_ = kForward;
   ClearSavedValue();
+  has_prefix_ = (prefix_extractor_ != nullptr &&
+                 prefix_extractor_->InDomain(target));
+  if (has_prefix_) {
+    Slice prefix = prefix_extractor_->Transform(target);
+    prefix_.assign(prefix.data(), prefix.size());
+  }
   saved_key_.clear();
   AppendInternalKey(
       &saved_key_, ParsedInternalKey(target, sequence_, kValueTypeForSeek));
+  PerfTimer seek_timer(&PerfContext::seek_internal_seek_nanos);
+  seek_timer.Start();
   iter_->Seek(saved_key_);
+  seek_timer.Stop();
   if (iter_->Valid()) {
     FindNextUserEntry(false, &saved_key_ /* temporary storage */);
   } else {
@@ -286,9 +370,17 @@ void DBIter::Seek(const Slice& target) {
 }
 
 void DBIter::SeekToFirst() {
+  if (RejectInPrefixMode()) {
+    return;
+  }
+  StopWatch sw(env_, stats_, kDbSeekMicros);
+  RecordTick(stats_, kNumberDbSeek);
   direction_ = kForward;
   ClearSavedValue();
+  PerfTimer seek_timer(&PerfContext::seek_internal_seek_nanos);
+  seek_timer.Start();
   iter_->SeekToFirst();
+  seek_timer.Stop();
   if (iter_->Valid()) {
     FindNextUserEntry(false, &saved_key_ /* temporary storage */);
   } else {
@@ -297,9 +389,17 @@ void DBIter::SeekToFirst() {
 }
 
 void DBIter::SeekToLast() {
+  if (RejectInPrefixMode()) {
+    return;
+  }
+  StopWatch sw(env_, stats_, kDbSeekMicros);
+  RecordTick(stats_, kNumberDbSeek);
   direction_ = kReverse;
   ClearSavedValue();
+  PerfTimer seek_timer(&PerfContext::seek_internal_seek_nanos);
+  seek_timer.Start();
   iter_->SeekToLast();
+  seek_timer.Stop();
   FindPrevUserEntry();
 }
 
@@ -310,8 +410,15 @@ Iterator* NewDBIterator(
     const Comparator* user_key_comparator,
     Iterator* internal_iter,
     SequenceNumber sequence,
-    uint32_t seed) {
-  return new DBIter(db, user_key_comparator, internal_iter, sequence, seed);
+    uint32_t seed,
+    RangeTombstoneList* range_dels,
+    const RangeTombstoneList* table_range_dels,
+    const SliceTransform* prefix_extractor,
+    Env* env,
+    Statistics* stats) {
+  return new DBIter(db, user_key_comparator, internal_iter, sequence, seed,
+                    range_dels, table_range_dels, prefix_extractor, env,
+                    stats);
 }
 
 }  // namespace leveldb
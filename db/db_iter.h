@@ -12,15 +12,32 @@
 namespace leveldb {
 
 class DBImpl;
+class Env;
+class RangeTombstoneList;
+class SliceTransform;
+class Statistics;
 
 // Return a new iterator that converts internal keys (yielded by
 // "*internal_iter") that were live at the specified "sequence" number
-// into appropriate user keys.
+// into appropriate user keys.  Entries hidden by a tombstone of
+// "*range_dels" or "*table_range_dels" are skipped.  The result takes
+// ownership of "range_dels"; "table_range_dels" must outlive
+// "internal_iter".  Either may be nullptr.  If "prefix_extractor" is
+// non-null, Seek() limits the iteration to the keys that share the prefix
+// of its target, and SeekToFirst(), SeekToLast() and Prev() are not
+// supported.
+// If "stats" is non-null, the seeks and steps of the iterator are counted
+// in it and the seeks are timed with "env".
 Iterator* NewDBIterator(DBImpl* db,
                         const Comparator* user_key_comparator,
                         Iterator* internal_iter,
                         SequenceNumber sequence,
-                        uint32_t seed);
+                        uint32_t seed,
+                        RangeTombstoneList* range_dels = nullptr,
+                        const RangeTombstoneList* table_range_dels = nullptr,
+                        const SliceTransform* prefix_extractor = nullptr,
+                        Env* env = nullptr,
+                        Statistics* stats = nullptr);
 
 }  // namespace leveldb
 
@@ -4,12 +4,18 @@
 
 #include "leveldb/db.h"
 #include "leveldb/filter_policy.h"
+#include "leveldb/listener.h"
+#include "db/builder.h"
 #include "db/db_impl.h"
 #include "db/filename.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
 #include "leveldb/cache.h"
 #include "leveldb/env.h"
+#include "leveldb/perf_context.h"
+#include "leveldb/rate_limiter.h"
+#include "leveldb/slice_transform.h"
+#include "leveldb/statistics.h"
 #include "leveldb/table.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
@@ -27,6 +33,12 @@ static std::string RandomString(Random* rnd, int len) {
   return r;
 }
 
+static std::string Key(int i) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "key%06d", i);
+  return std::string(buf);
+}
+
 static std::string RandomKey(Random* rnd) {
   int len = (rnd->OneIn(3)
              ? 1                // Short sometimes to encourage collisions
@@ -102,6 +114,9 @@ class SpecialEnv : public EnvWrapper {
   // sstable/log Sync() calls return an error.
   port::AtomicPointer data_sync_error_;
 
+  // sstable/log Append() calls return an error.
+  port::AtomicPointer data_write_error_;
+
   // Simulate no-space errors while this pointer is non-null.
   port::AtomicPointer no_space_;
 
@@ -117,9 +132,18 @@ class SpecialEnv : public EnvWrapper {
   bool count_random_reads_;
   AtomicCounter random_read_counter_;
 
-  explicit SpecialEnv(Env* base) : EnvWrapper(base) {
+  // Work scheduled at Env::LOW priority (compactions) is held back while
+  // hold_low_priority_work_ is set, until ReleaseLowPriorityWork().
+  port::Mutex held_mu_;
+  bool hold_low_priority_work_ GUARDED_BY(held_mu_);
+  std::vector<std::pair<void (*)(void*), void*> > held_work_
+      GUARDED_BY(held_mu_);
+
+  explicit SpecialEnv(Env* base)
+      : EnvWrapper(base), hold_low_priority_work_(false) {
     delay_data_sync_.Release_Store(nullptr);
     data_sync_error_.Release_Store(nullptr);
+    data_write_error_.Release_Store(nullptr);
     no_space_.Release_Store(nullptr);
     non_writable_.Release_Store(nullptr);
     count_random_reads_ = false;
@@ -143,6 +167,8 @@ class SpecialEnv : public EnvWrapper {
         if (env_->no_space_.Acquire_Load() != nullptr) {
           // Drop writes on the floor
           return Status::OK();
+        } else if (env_->data_write_error_.Acquire_Load() != nullptr) {
+          return Status::IOError("simulated data write error");
         } else {
           return base_->Append(data);
         }
@@ -200,29 +226,70 @@ class SpecialEnv : public EnvWrapper {
     return s;
   }
 
-  Status NewRandomAccessFile(const std::string& f, RandomAccessFile** r) {
-    class CountingFile : public RandomAccessFile {
-     private:
-      RandomAccessFile* target_;
-      AtomicCounter* counter_;
-     public:
-      CountingFile(RandomAccessFile* target, AtomicCounter* counter)
-          : target_(target), counter_(counter) {
-      }
-      virtual ~CountingFile() { delete target_; }
-      virtual Status Read(uint64_t offset, size_t n, Slice* result,
-                          char* scratch) const {
-        counter_->Increment();
-        return target_->Read(offset, n, result, scratch);
-      }
-    };
+  class CountingFile : public RandomAccessFile {
+   private:
+    RandomAccessFile* target_;
+    AtomicCounter* counter_;
+   public:
+    CountingFile(RandomAccessFile* target, AtomicCounter* counter)
+        : target_(target), counter_(counter) {
+    }
+    virtual ~CountingFile() { delete target_; }
+    virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                        char* scratch) const {
+      counter_->Increment();
+      return target_->Read(offset, n, result, scratch);
+    }
+    virtual void Hint(AccessPattern pattern) { target_->Hint(pattern); }
+    virtual void Prefetch(uint64_t offset, size_t n) {
+      target_->Prefetch(offset, n);
+    }
+  };
 
+  Status NewRandomAccessFile(const std::string& f, RandomAccessFile** r) {
     Status s = target()->NewRandomAccessFile(f, r);
     if (s.ok() && count_random_reads_) {
       *r = new CountingFile(*r, &random_read_counter_);
     }
     return s;
   }
+
+  Status NewDirectRandomAccessFile(const std::string& f,
+                                   RandomAccessFile** r) {
+    Status s = target()->NewDirectRandomAccessFile(f, r);
+    if (s.ok() && count_random_reads_) {
+      *r = new CountingFile(*r, &random_read_counter_);
+    }
+    return s;
+  }
+
+  void Schedule(void (*f)(void*), void* a, Priority pri) {
+    if (pri == LOW) {
+      MutexLock l(&held_mu_);
+      if (hold_low_priority_work_) {
+        held_work_.push_back(std::make_pair(f, a));
+        return;
+      }
+    }
+    target()->Schedule(f, a, pri);
+  }
+
+  void HoldLowPriorityWork() {
+    MutexLock l(&held_mu_);
+    hold_low_priority_work_ = true;
+  }
+
+  void ReleaseLowPriorityWork() {
+    std::vector<std::pair<void (*)(void*), void*> > work;
+    {
+      MutexLock l(&held_mu_);
+      hold_low_priority_work_ = false;
+      work.swap(held_work_);
+    }
+    for (size_t i = 0; i < work.size(); i++) {
+      target()->Schedule(work[i].first, work[i].second, LOW);
+    }
+  }
 };
 
 class DBTest {
@@ -234,7 +301,14 @@ class DBTest {
     kDefault,
     kReuse,
     kFilter,
+    kWholeTableFilter,
+    kFilterPartitions,
+    kCachedMetaBlocks,
     kUncompressed,
+    kParallelCompression,
+    kConcurrentMemTableWrite,
+    kPipelinedWrite,
+    kPipelinedConcurrentWrite,
     kEnd
   };
   int option_config_;
@@ -285,9 +359,37 @@ class DBTest {
       case kFilter:
         options.filter_policy = filter_policy_;
         break;
+      case kWholeTableFilter:
+        options.filter_policy = filter_policy_;
+        options.filter_format = kFullFilter;
+        break;
+      case kFilterPartitions:
+        options.filter_policy = filter_policy_;
+        options.filter_format = kPartitionedFilter;
+        options.filter_partition_keys = 16;  // Exercise many partitions
+        break;
+      case kCachedMetaBlocks:
+        options.filter_policy = filter_policy_;
+        options.cache_index_and_filter_blocks = true;
+        options.pin_l0_filter_and_index_blocks = true;
+        break;
       case kUncompressed:
         options.compression = kNoCompression;
         break;
+      case kParallelCompression:
+        options.filter_policy = filter_policy_;
+        options.compression_threads = 2;
+        break;
+      case kConcurrentMemTableWrite:
+        options.allow_concurrent_memtable_write = true;
+        break;
+      case kPipelinedWrite:
+        options.enable_pipelined_write = true;
+        break;
+      case kPipelinedConcurrentWrite:
+        options.enable_pipelined_write = true;
+        options.allow_concurrent_memtable_write = true;
+        break;
       default:
         break;
     }
@@ -350,6 +452,34 @@ class DBTest {
     return result;
   }
 
+  // Look up all of "keys" with one MultiGet() call and return the
+  // results formatted like Get() would, separated by commas.
+  std::string MultiGet(const std::vector<std::string>& keys,
+                       const Snapshot* snapshot = nullptr) {
+    ReadOptions options;
+    options.snapshot = snapshot;
+    std::vector<Slice> key_slices(keys.begin(), keys.end());
+    std::vector<std::string> values;
+    std::vector<Status> statuses;
+    db_->MultiGet(options, key_slices, &values, &statuses);
+    ASSERT_EQ(keys.size(), values.size());
+    ASSERT_EQ(keys.size(), statuses.size());
+    std::string result;
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (i > 0) {
+        result.push_back(',');
+      }
+      if (statuses[i].IsNotFound()) {
+        result += "NOT_FOUND";
+      } else if (!statuses[i].ok()) {
+        result += statuses[i].ToString();
+      } else {
+        result += values[i];
+      }
+    }
+    return result;
+  }
+
   // Return a string that contains all key,value pairs in order,
   // formatted like "(k1->v1)(k2->v2)".
   std::string Contents() {
@@ -406,6 +536,10 @@ class DBTest {
             case kTypeDeletion:
               result += "DEL";
               break;
+            case kTypeRangeDeletion:
+              // Not expected: range tombstones are kept apart
+              result += "RANGEDEL";
+              break;
           }
         }
         iter->Next();
@@ -427,6 +561,12 @@ class DBTest {
     return atoi(property.c_str());
   }
 
+  std::string Property(const std::string& name) {
+    std::string property;
+    ASSERT_TRUE(db_->GetProperty(name, &property));
+    return property;
+  }
+
   int TotalTableFiles() {
     int result = 0;
     for (int level = 0; level < config::kNumLevels; level++) {
@@ -485,6 +625,44 @@ class DBTest {
     MakeTables(config::kNumLevels, smallest, largest);
   }
 
+  // Write the keys Key(0) .. Key(499) three times and flush after each
+  // pass; the three tables land in levels 2, 1 and 0.  The values are
+  // "value_size" bytes long, plus a random number of bytes below
+  // "extra_size" if it is set, and made of a random part that is
+  // "compressed_fraction" of them.  *values holds the last pass.
+  void FillThreeLevels(std::vector<std::string>* values, int value_size,
+                       double compressed_fraction = 1.0, int extra_size = 0) {
+    Random rnd(301);
+    values->resize(500);
+    for (int n = 0; n < 3; n++) {
+      for (int i = 0; i < 500; i++) {
+        int len = value_size;
+        if (extra_size > 0) {
+          len += rnd.Uniform(extra_size);
+        }
+        test::CompressibleString(&rnd, compressed_fraction, len,
+                                 &(*values)[i]);
+        ASSERT_OK(Put(Key(i), (*values)[i]));
+      }
+      dbfull()->TEST_CompactMemTable();
+    }
+    ASSERT_EQ("1,1,1", FilesPerLevel());
+  }
+
+  // Merge the tables of FillThreeLevels() down into level 2.  If
+  // "values" is given, read some of the keys back after each level.
+  void MergeThreeLevels(const std::vector<std::string>* values = nullptr) {
+    for (int level = 0; level < 2; level++) {
+      dbfull()->TEST_CompactRange(level, nullptr, nullptr);
+      if (values != nullptr) {
+        for (size_t i = 0; i < values->size(); i += 13) {
+          ASSERT_EQ((*values)[i], Get(Key(i)));
+        }
+      }
+    }
+    ASSERT_EQ("0,0,1", FilesPerLevel());
+  }
+
   void DumpFileCounts(const char* label) {
     fprintf(stderr, "---\n%s:\n", label);
     fprintf(stderr, "maxoverlap: %lld\n",
@@ -613,6 +791,33 @@ TEST(DBTest, GetMemUsage) {
   } while (ChangeOptions());
 }
 
+TEST(DBTest, BlockCacheStats) {
+  Options options = CurrentOptions();
+  options.block_cache = NewLRUCache(1 << 20, 0.5);
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+  ASSERT_OK(Put("foo", "v1"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ("v1", Get("foo"));
+
+  std::string val;
+  ASSERT_TRUE(db_->GetProperty("leveldb.block-cache-stats", &val));
+  unsigned long long high_lookups, high_hits, low_lookups, low_hits;
+  double high_rate, low_rate;
+  ASSERT_EQ(6, sscanf(val.c_str(),
+                      "Priority Lookups Hits Hit(%%) "
+                      "high %llu %llu %lf low %llu %llu %lf",
+                      &high_lookups, &high_hits, &high_rate,
+                      &low_lookups, &low_hits, &low_rate)) << val;
+  ASSERT_EQ(0u, high_lookups);
+  ASSERT_EQ(2u, low_lookups);
+  ASSERT_LE(low_hits, 1u);
+
+  Close();
+  delete options.block_cache;
+}
+
 TEST(DBTest, GetSnapshot) {
   do {
     // Try with both a short key and a long key
@@ -761,6 +966,39 @@ TEST(DBTest, GetEncountersEmptyLevel) {
   } while (ChangeOptions());
 }
 
+TEST(DBTest, MultiGet) {
+  do {
+    ASSERT_EQ("", MultiGet(std::vector<std::string>()));
+
+    // Spread the keys over a deeper level, level-0, imm and the memtable
+    ASSERT_OK(Put("a", "va"));
+    ASSERT_OK(Put("c", "vc"));
+    ASSERT_OK(Put("e", "ve"));
+    Compact("a", "z");
+    ASSERT_OK(Put("c", "vc2"));
+    ASSERT_OK(Delete("e"));
+    dbfull()->TEST_CompactMemTable();
+    ASSERT_OK(Put("g", "vg"));
+    const Snapshot* snapshot = db_->GetSnapshot();
+    ASSERT_OK(Put("a", "va2"));
+    ASSERT_OK(Delete("g"));
+
+    std::vector<std::string> keys;
+    keys.push_back("g");
+    keys.push_back("a");
+    keys.push_back("b");
+    keys.push_back("e");
+    keys.push_back("c");
+    keys.push_back("a");
+    keys.push_back("zz");
+    ASSERT_EQ("NOT_FOUND,va2,NOT_FOUND,NOT_FOUND,vc2,va2,NOT_FOUND",
+              MultiGet(keys));
+    ASSERT_EQ("vg,va,NOT_FOUND,NOT_FOUND,vc2,va,NOT_FOUND",
+              MultiGet(keys, snapshot));
+    db_->ReleaseSnapshot(snapshot);
+  } while (ChangeOptions());
+}
+
 TEST(DBTest, IterEmpty) {
   Iterator* iter = db_->NewIterator(ReadOptions());
 
@@ -1009,10 +1247,574 @@ TEST(DBTest, RecoverDuringMemtableCompaction) {
   } while (ChangeOptions());
 }
 
-static std::string Key(int i) {
-  char buf[100];
-  snprintf(buf, sizeof(buf), "key%06d", i);
-  return std::string(buf);
+TEST(DBTest, CacheIndexAndFilterBlocks) {
+  for (int pin = 0; pin < 2; pin++) {
+    Options options = CurrentOptions();
+    options.filter_policy = NewBloomFilterPolicy(10);
+    options.block_cache = NewLRUCache(1 << 20);
+    options.cache_index_and_filter_blocks = true;
+    options.pin_l0_filter_and_index_blocks = (pin != 0);
+    options.create_if_missing = true;
+    DestroyAndReopen(&options);
+
+    // The third flush of the same keys stays in level 0.
+    for (int i = 0; i < 3; i++) {
+      for (int k = 0; k < 100; k++) {
+        ASSERT_OK(Put(Key(k), "v" + NumberToString(i)));
+      }
+      dbfull()->TEST_CompactMemTable();
+    }
+    ASSERT_EQ("1,1,1", FilesPerLevel());
+
+    Cache* cache = options.block_cache;
+    ASSERT_EQ("v2", Get(Key(7)));
+    ASSERT_GT(cache->TotalCharge(), 0u);
+    cache->Prune();
+    if (pin) {
+      // Only the blocks of the level-0 table are left
+      ASSERT_GT(cache->TotalCharge(), 0u);
+    } else {
+      ASSERT_EQ(0u, cache->TotalCharge());
+    }
+
+    // Evicted blocks are read again
+    ASSERT_EQ("v2", Get(Key(7)));
+    ASSERT_EQ("NOT_FOUND", Get("missing"));
+    ASSERT_GT(cache->TotalCharge(), 0u);
+
+    // Closing the DB unpins the blocks
+    Close();
+    cache->Prune();
+    ASSERT_EQ(0u, cache->TotalCharge());
+    delete cache;
+    delete options.filter_policy;
+  }
+}
+
+TEST(DBTest, UnpinIndexAndFilterBlocksOnTrivialMove) {
+  Options options = CurrentOptions();
+  options.filter_policy = NewBloomFilterPolicy(10);
+  options.block_cache = NewLRUCache(1 << 20);
+  options.cache_index_and_filter_blocks = true;
+  options.pin_l0_filter_and_index_blocks = true;
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+
+  for (int i = 0; i < 3; i++) {
+    for (int k = 0; k < 100; k++) {
+      ASSERT_OK(Put(Key(k), "v" + NumberToString(i)));
+    }
+    dbfull()->TEST_CompactMemTable();
+  }
+  dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+  ASSERT_EQ("1,0,1", FilesPerLevel());
+
+  Cache* cache = options.block_cache;
+  cache->Prune();
+  ASSERT_GT(cache->TotalCharge(), 0u);
+
+  // Misses that read both tables charge seeks to the level-0 file until
+  // it is moved to level 1, which has nothing it overlaps.
+  for (int i = 0; i < 1000 && FilesPerLevel() != "0,1,1"; i++) {
+    ASSERT_EQ("NOT_FOUND", Get(Key(50) + "x"));
+    if (i >= 100) {
+      DelayMilliseconds(10);
+    }
+  }
+  ASSERT_EQ("0,1,1", FilesPerLevel());
+
+  // Nothing is pinned once the table has left level 0
+  cache->Prune();
+  ASSERT_EQ(0u, cache->TotalCharge());
+  ASSERT_EQ("v2", Get(Key(7)));
+
+  Close();
+  delete cache;
+  delete options.filter_policy;
+}
+
+TEST(DBTest, CompressionPerLevel) {
+  Options options = CurrentOptions();
+  options.compression_per_level.push_back(kNoCompression);
+  options.compression_per_level.push_back(kLZ4Compression);
+  options.compression_per_level.push_back(kZstdCompression);
+  ASSERT_EQ(kNoCompression, CompressionForLevel(options, 0));
+  ASSERT_EQ(kLZ4Compression, CompressionForLevel(options, 1));
+  ASSERT_EQ(kZstdCompression, CompressionForLevel(options, 2));
+  ASSERT_EQ(kZstdCompression, CompressionForLevel(options, 6));
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+
+  std::vector<std::string> values;
+  FillThreeLevels(&values, 200, 0.25);
+  for (int i = 0; i < 500; i += 13) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+
+  // Merge the keys down into level 1 and then level 2, so that every
+  // compression type writes and reads them.
+  MergeThreeLevels(&values);
+
+  Reopen(&options);
+  for (int i = 0; i < 500; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+}
+
+TEST(DBTest, DirectIO) {
+  // Direct I/O for compactions only (whose inputs are then opened apart
+  // from the table cache), for user reads only, and for both.
+  for (int mode = 0; mode < 3; mode++) {
+    Options options = CurrentOptions();
+    options.use_direct_io_for_flush_and_compaction = (mode != 1);
+    options.use_direct_reads = (mode != 0);
+    options.create_if_missing = true;
+    DestroyAndReopen(&options);
+
+    // Random value sizes keep the records unaligned
+    std::vector<std::string> values;
+    FillThreeLevels(&values, 100, 1.0, 1000);
+    for (int i = 0; i < 500; i += 7) {
+      ASSERT_EQ(values[i], Get(Key(i)));
+    }
+    MergeThreeLevels();
+
+    Reopen(&options);
+    Iterator* iter = db_->NewIterator(ReadOptions());
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      ASSERT_EQ(Key(i), iter->key().ToString());
+      ASSERT_EQ(values[i], iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(500, i);
+    delete iter;
+  }
+}
+
+TEST(DBTest, CompactionReadahead) {
+  // Count the reads of compaction inputs, read with direct I/O so that
+  // they are not served from memory-mapped files.
+  int reads[2];
+  for (int readahead = 0; readahead < 2; readahead++) {
+    env_->count_random_reads_ = true;
+    Options options = CurrentOptions();
+    options.env = env_;
+    options.use_direct_io_for_flush_and_compaction = true;
+    options.compaction_readahead_size = readahead ? (1 << 20) : 0;
+    options.create_if_missing = true;
+    DestroyAndReopen(&options);
+
+    std::vector<std::string> values;
+    FillThreeLevels(&values, 1000);
+
+    env_->random_read_counter_.Reset();
+    MergeThreeLevels();
+    reads[readahead] = env_->random_read_counter_.Read();
+    env_->count_random_reads_ = false;
+
+    for (int i = 0; i < 500; i++) {
+      ASSERT_EQ(values[i], Get(Key(i)));
+    }
+  }
+  // Four input tables of about 500KB in 4KB blocks, read once each
+  ASSERT_GE(reads[0], 300);
+  ASSERT_LE(reads[1], reads[0] / 10);
+}
+
+TEST(DBTest, RateLimiter) {
+  RateLimiter* limiter = NewGenericRateLimiter(16 << 20);
+  Options options = CurrentOptions();
+  options.rate_limiter = limiter;
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+
+  std::vector<std::string> values;
+  FillThreeLevels(&values, 1000);
+  const int64_t flushed = limiter->GetTotalBytesThrough(RateLimiter::kHigh);
+  ASSERT_GE(flushed, 2 * 500 * 1000);
+  ASSERT_EQ(0, limiter->GetTotalBytesThrough(RateLimiter::kLow));
+
+  MergeThreeLevels();
+  ASSERT_EQ(flushed, limiter->GetTotalBytesThrough(RateLimiter::kHigh));
+  ASSERT_GE(limiter->GetTotalBytesThrough(RateLimiter::kLow), 500 * 1000);
+  for (int i = 0; i < 500; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+
+  Close();
+  delete limiter;
+}
+
+TEST(DBTest, DelayedWrites) {
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.max_background_flushes = 1;
+  options.level0_file_num_compaction_trigger = 2;
+  options.level0_slowdown_writes_trigger = 2;
+  options.level0_stop_writes_trigger = 6;
+  options.delayed_write_rate = 1 << 20;
+  Reopen(&options);
+  ASSERT_EQ("0", Property("leveldb.actual-delayed-write-rate"));
+  ASSERT_EQ("0", Property("leveldb.estimate-pending-compaction-bytes"));
+
+  // Overlapping memtables pile up in level-0 while compactions are held
+  env_->HoldLowPriorityWork();
+  for (int i = 0; i < 5; i++) {
+    ASSERT_OK(Put("a", "va"));
+    ASSERT_OK(Put("z", "vz"));
+    dbfull()->TEST_CompactMemTable();
+  }
+  ASSERT_EQ("3,1,1", FilesPerLevel());
+  ASSERT_NE("0", Property("leveldb.estimate-pending-compaction-bytes"));
+  ASSERT_EQ("0", Property("leveldb.is-write-stopped"));
+
+  // Three files, a quarter of the way from the slowdown to the stop
+  // trigger, delay writes to three quarters of delayed_write_rate
+  ASSERT_EQ("786432", Property("leveldb.actual-delayed-write-rate"));
+  const uint64_t start = env_->NowMicros();
+  for (int i = 0; i < 192; i++) {
+    ASSERT_OK(Put(Key(i), std::string(1000, 'x')));
+  }
+  // 192KB at 768KB/s
+  ASSERT_GE(env_->NowMicros() - start, 150u * 1000);
+
+  env_->ReleaseLowPriorityWork();
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  ASSERT_EQ("0", Property("leveldb.actual-delayed-write-rate"));
+  ASSERT_EQ("va", Get("a"));
+  ASSERT_EQ("vz", Get("z"));
+}
+
+TEST(DBTest, Statistics) {
+  Statistics* stats = CreateDBStatistics();
+  const FilterPolicy* policy = NewBloomFilterPolicy(10);
+  Options options = CurrentOptions();
+  options.filter_policy = policy;
+  options.statistics = stats;
+  // Blocks of memory-mapped files are not cached
+  options.use_direct_reads = true;
+  Reopen(&options);
+
+  ASSERT_OK(Put("a", "va"));
+  ASSERT_OK(Put("c", "vc"));
+  ASSERT_EQ(2u, stats->GetTickerCount(kNumberKeysWritten));
+  ASSERT_GT(stats->GetTickerCount(kBytesWritten), 0u);
+  ASSERT_GE(stats->GetTickerCount(kWalFileBytes),
+            stats->GetTickerCount(kBytesWritten));
+  ASSERT_EQ("va", Get("a"));
+  ASSERT_EQ(1u, stats->GetTickerCount(kMemtableHit));
+
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_GT(stats->GetTickerCount(kFlushWriteBytes), 0u);
+  ASSERT_EQ("vc", Get("c"));
+  ASSERT_EQ("vc", Get("c"));
+  ASSERT_EQ(2u, stats->GetTickerCount(kMemtableMiss));
+  ASSERT_EQ(2u, stats->GetTickerCount(kBloomFilterPositive));
+  ASSERT_EQ(2u, stats->GetTickerCount(kBloomFilterTruePositive));
+  ASSERT_EQ(1u, stats->GetTickerCount(kBlockCacheDataMiss));
+  ASSERT_EQ(1u, stats->GetTickerCount(kBlockCacheDataHit));
+  ASSERT_GE(stats->GetTickerCount(kBlockCacheMiss),
+            stats->GetTickerCount(kBlockCacheDataMiss));
+  ASSERT_GE(stats->GetTickerCount(kBlockCacheAdd), 1u);
+
+  // Keys between those of the file are ruled out by its filter
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ("NOT_FOUND", Get("b" + Key(i)));
+  }
+  ASSERT_GE(stats->GetTickerCount(kBloomFilterUseful), 8u);
+  ASSERT_EQ(13u, stats->GetTickerCount(kNumberKeysRead));
+  ASSERT_EQ(6u, stats->GetTickerCount(kBytesRead));
+
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  iter->Seek("a");
+  iter->Next();
+  iter->Prev();
+  iter->SeekToFirst();
+  delete iter;
+  ASSERT_EQ(2u, stats->GetTickerCount(kNumberDbSeek));
+  ASSERT_EQ(1u, stats->GetTickerCount(kNumberDbNext));
+  ASSERT_EQ(1u, stats->GetTickerCount(kNumberDbPrev));
+
+  HistogramData data;
+  stats->GetHistogramData(kDbGetMicros, &data);
+  ASSERT_EQ(13u, data.count);
+  stats->GetHistogramData(kDbWriteMicros, &data);
+  ASSERT_EQ(3u, data.count);  // With the empty write of the memtable flush
+  stats->GetHistogramData(kFlushMicros, &data);
+  ASSERT_EQ(1u, data.count);
+
+  const std::string dump = Property("leveldb.statistics");
+  ASSERT_NE(std::string::npos, dump.find("leveldb.block.cache.data.hit"));
+  ASSERT_NE(std::string::npos, dump.find("leveldb.db.get.micros"));
+
+  Close();
+  delete stats;
+  options.statistics = nullptr;
+  Reopen(&options);
+  std::string unused;
+  ASSERT_TRUE(!db_->GetProperty("leveldb.statistics", &unused));
+  Close();
+  delete policy;
+}
+
+TEST(DBTest, PerfContext) {
+  const FilterPolicy* policy = NewBloomFilterPolicy(10);
+  Options options = CurrentOptions();
+  options.filter_policy = policy;
+  // Blocks of memory-mapped files are not cached
+  options.use_direct_reads = true;
+  Reopen(&options);
+  ASSERT_OK(Put("a", "va"));
+  ASSERT_OK(Put("c", "vc"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(Put("d", "vd"));
+
+  // Nothing is collected by default
+  PerfContext* ctx = GetPerfContext();
+  ASSERT_EQ(kDisablePerf, GetPerfLevel());
+  ctx->Reset();
+  ASSERT_EQ("vc", Get("c"));
+  ASSERT_EQ("", ctx->ToString(true));
+
+  // Counters only
+  SetPerfLevel(kEnableCount);
+  ASSERT_EQ("vd", Get("d"));
+  ASSERT_EQ(1u, ctx->get_from_memtable_count);
+  ASSERT_EQ(0u, ctx->file_probe_count);
+  ctx->Reset();
+  ASSERT_EQ("vc", Get("c"));
+  ASSERT_EQ(1u, ctx->get_from_memtable_count);
+  ASSERT_EQ(1u, ctx->file_probe_count);
+  ASSERT_EQ(1u, ctx->bloom_sst_hit_count);
+  ASSERT_GE(ctx->block_cache_hit_count, 1u);
+  ASSERT_EQ(0u, ctx->block_read_count);
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  ASSERT_EQ(1u, ctx->bloom_sst_miss_count);
+  ASSERT_EQ(0u, ctx->db_mutex_lock_nanos);
+  ASSERT_EQ(0u, ctx->get_from_output_files_nanos);
+
+  // Counters and timers, with the table and its blocks read anew
+  Reopen(&options);
+  SetPerfLevel(kEnableTime);
+  ctx->Reset();
+  ASSERT_EQ("va", Get("a"));
+  ASSERT_EQ(1u, ctx->file_probe_count);
+  ASSERT_GE(ctx->block_read_count, 1u);
+  ASSERT_GT(ctx->block_read_byte, 0u);
+  ASSERT_GT(ctx->block_read_nanos, 0u);
+  ASSERT_GT(ctx->find_table_nanos, 0u);
+  ASSERT_GT(ctx->get_from_output_files_nanos, 0u);
+  ASSERT_GE(ctx->get_from_output_files_nanos,
+            ctx->find_table_nanos + ctx->index_seek_nanos);
+  ASSERT_NE(std::string::npos, ctx->ToString().find("block_read_count = "));
+
+  ctx->Reset();
+  ASSERT_OK(Delete("a"));
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  iter->SeekToFirst();
+  ASSERT_EQ("c", iter->key().ToString());
+  delete iter;
+  ASSERT_EQ(1u, ctx->internal_delete_skipped_count);
+  ASSERT_EQ(1u, ctx->internal_key_skipped_count);
+  ASSERT_GT(ctx->seek_internal_seek_nanos, 0u);
+
+  SetPerfLevel(kDisablePerf);
+  Close();
+  delete policy;
+}
+
+namespace {
+
+// Records the events of a DB, which arrive on its background threads.
+class RecordingListener : public EventListener {
+ public:
+  RecordingListener() : cv_(&mu_) { }
+
+  virtual void OnFlushCompleted(const FlushJobInfo& info) {
+    MutexLock l(&mu_);
+    flushes_.push_back(info);
+    cv_.SignalAll();
+  }
+  virtual void OnCompactionCompleted(const CompactionJobInfo& info) {
+    MutexLock l(&mu_);
+    compactions_.push_back(info);
+    cv_.SignalAll();
+  }
+  virtual void OnStallConditionsChanged(const WriteStallInfo& info) {
+    MutexLock l(&mu_);
+    stalls_.push_back(info);
+    cv_.SignalAll();
+  }
+  virtual void OnTableFileCreated(const TableFileCreationInfo& info) {
+    MutexLock l(&mu_);
+    created_.push_back(info);
+    cv_.SignalAll();
+  }
+  virtual void OnTableFileDeleted(const TableFileDeletionInfo& info) {
+    MutexLock l(&mu_);
+    deleted_.push_back(info);
+    cv_.SignalAll();
+  }
+
+  // Wait until *events holds at least n events; a callback may still be
+  // on its way after the work that raised it is visible.
+  template <typename T>
+  void WaitFor(const std::vector<T>* events, size_t n) {
+    MutexLock l(&mu_);
+    while (events->size() < n) {
+      cv_.Wait();
+    }
+  }
+
+  port::Mutex mu_;
+  port::CondVar cv_;
+  std::vector<FlushJobInfo> flushes_;
+  std::vector<CompactionJobInfo> compactions_;
+  std::vector<WriteStallInfo> stalls_;
+  std::vector<TableFileCreationInfo> created_;
+  std::vector<TableFileDeletionInfo> deleted_;
+};
+
+}  // namespace
+
+TEST(DBTest, EventListener) {
+  RecordingListener listener;
+  Options options = CurrentOptions();
+  options.listeners.push_back(&listener);
+  Reopen(&options);
+
+  // Two overlapping memtables end up in levels 2 and 1
+  for (int i = 0; i < 2; i++) {
+    ASSERT_OK(Put("a", "va"));
+    ASSERT_OK(Put("z", "vz"));
+    dbfull()->TEST_CompactMemTable();
+  }
+  ASSERT_EQ("0,1,1", FilesPerLevel());
+  listener.WaitFor(&listener.flushes_, 2);
+  listener.WaitFor(&listener.created_, 2);
+  {
+    MutexLock l(&listener.mu_);
+    ASSERT_EQ(2, listener.flushes_[0].level);
+    ASSERT_EQ(1, listener.flushes_[1].level);
+    for (int i = 0; i < 2; i++) {
+      const FlushJobInfo& flush = listener.flushes_[i];
+      const TableFileCreationInfo& created = listener.created_[i];
+      ASSERT_EQ(dbname_, flush.db_name);
+      ASSERT_GT(flush.file_size, 0u);
+      ASSERT_EQ(TableFileName(dbname_, flush.file_number), flush.file_path);
+      ASSERT_EQ(flush.file_path, created.file_path);
+      ASSERT_EQ(flush.file_size, created.file_size);
+      ASSERT_EQ(kTableFileFromFlush, created.reason);
+      ASSERT_OK(created.status);
+    }
+    ASSERT_TRUE(listener.compactions_.empty());
+    ASSERT_TRUE(listener.deleted_.empty());
+  }
+
+  dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+  ASSERT_EQ("0,0,1", FilesPerLevel());
+  listener.WaitFor(&listener.compactions_, 1);
+  listener.WaitFor(&listener.deleted_, 2);
+  {
+    MutexLock l(&listener.mu_);
+    ASSERT_EQ(1u, listener.compactions_.size());
+    const CompactionJobInfo& compaction = listener.compactions_[0];
+    ASSERT_OK(compaction.status);
+    ASSERT_EQ(1, compaction.base_level);
+    ASSERT_EQ(2, compaction.output_level);
+    ASSERT_EQ(2u, compaction.input_files.size());
+    ASSERT_EQ(listener.flushes_[1].file_path, compaction.input_files[0]);
+    ASSERT_EQ(listener.flushes_[0].file_path, compaction.input_files[1]);
+    ASSERT_EQ(1u, compaction.output_files.size());
+    ASSERT_EQ(listener.flushes_[0].file_size +
+              listener.flushes_[1].file_size, compaction.bytes_read);
+    ASSERT_GT(compaction.bytes_written, 0u);
+
+    ASSERT_EQ(3u, listener.created_.size());
+    ASSERT_EQ(kTableFileFromCompaction, listener.created_[2].reason);
+    ASSERT_EQ(compaction.output_files[0], listener.created_[2].file_path);
+    ASSERT_EQ(compaction.bytes_written, listener.created_[2].file_size);
+
+    ASSERT_EQ(2u, listener.deleted_.size());
+    for (int i = 0; i < 2; i++) {
+      ASSERT_OK(listener.deleted_[i].status);
+      const std::string& path = listener.deleted_[i].file_path;
+      ASSERT_TRUE(path == compaction.input_files[0] ||
+                  path == compaction.input_files[1]);
+      ASSERT_TRUE(!env_->FileExists(path));
+    }
+    ASSERT_TRUE(listener.stalls_.empty());
+  }
+  Close();
+}
+
+TEST(DBTest, EventListenerStallConditions) {
+  RecordingListener listener;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.listeners.push_back(&listener);
+  options.max_background_flushes = 1;
+  options.level0_file_num_compaction_trigger = 2;
+  options.level0_slowdown_writes_trigger = 2;
+  options.level0_stop_writes_trigger = 6;
+  Reopen(&options);
+
+  // Overlapping memtables pile up in level-0 while compactions are held
+  env_->HoldLowPriorityWork();
+  for (int i = 0; i < 5; i++) {
+    ASSERT_OK(Put("a", "va"));
+    ASSERT_OK(Put("z", "vz"));
+    dbfull()->TEST_CompactMemTable();
+  }
+  ASSERT_EQ("3,1,1", FilesPerLevel());
+  listener.WaitFor(&listener.stalls_, 1);
+  {
+    MutexLock l(&listener.mu_);
+    ASSERT_EQ(1u, listener.stalls_.size());
+    ASSERT_EQ(kWriteStallNormal, listener.stalls_[0].prev);
+    ASSERT_EQ(kWriteStallDelayed, listener.stalls_[0].cur);
+  }
+
+  env_->ReleaseLowPriorityWork();
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  listener.WaitFor(&listener.stalls_, 2);
+  {
+    MutexLock l(&listener.mu_);
+    ASSERT_EQ(kWriteStallDelayed, listener.stalls_[1].prev);
+    ASSERT_EQ(kWriteStallNormal, listener.stalls_.back().cur);
+  }
+  Close();
+}
+
+TEST(DBTest, MultiGetManyBlocks) {
+  do {
+    // Enough keys that one file holds many data blocks
+    Random rnd(301);
+    std::vector<std::string> keys;
+    for (int i = 0; i < 2000; i++) {
+      keys.push_back(Key(i));
+      if (i % 3 != 0) {
+        ASSERT_OK(Put(Key(i), RandomString(&rnd, 100)));
+      }
+    }
+    Compact(Key(0), Key(2000));
+    for (int i = 0; i < 2000; i += 7) {
+      ASSERT_OK(Put(Key(i), "new"));
+    }
+    dbfull()->TEST_CompactMemTable();
+
+    // Look up in reverse order to exercise the sorting
+    std::reverse(keys.begin(), keys.end());
+    std::string expected;
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (i > 0) {
+        expected.push_back(',');
+      }
+      expected += Get(keys[i]);
+    }
+    ASSERT_EQ(expected, MultiGet(keys));
+  } while (ChangeOptions());
 }
 
 TEST(DBTest, MinorCompactionsHappen) {
@@ -1040,6 +1842,90 @@ TEST(DBTest, MinorCompactionsHappen) {
   }
 }
 
+TEST(DBTest, ConcurrentCompactions) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000;
+  options.max_file_size = 100000;
+  options.max_background_compactions = 4;
+  options.max_background_flushes = 1;
+  Reopen(&options);
+
+  // Random overwrites keep several levels busy at the same time
+  Random rnd(301);
+  std::map<std::string, std::string> model;
+  for (int i = 0; i < 20000; i++) {
+    std::string key = Key(rnd.Uniform(5000));
+    std::string value = RandomString(&rnd, 100);
+    ASSERT_OK(Put(key, value));
+    model[key] = value;
+  }
+
+  for (int run = 0; run < 2; run++) {
+    for (std::map<std::string, std::string>::iterator it = model.begin();
+         it != model.end(); ++it) {
+      ASSERT_EQ(it->second, Get(it->first));
+    }
+    Iterator* iter = db_->NewIterator(ReadOptions());
+    std::map<std::string, std::string>::iterator it = model.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++it) {
+      ASSERT_TRUE(it != model.end());
+      ASSERT_EQ(it->first, iter->key().ToString());
+    }
+    ASSERT_TRUE(it == model.end());
+    delete iter;
+
+    Reopen(&options);
+  }
+}
+
+TEST(DBTest, Subcompactions) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 1000000;
+  options.max_subcompactions = 4;
+  Reopen(&options);
+
+  // Several MB of input so that a full compaction is split
+  Random rnd(301);
+  std::map<std::string, std::string> model;
+  for (int i = 0; i < 5000; i++) {
+    model[Key(i)] = RandomString(&rnd, 1000);
+    ASSERT_OK(Put(Key(i), model[Key(i)]));
+  }
+  db_->CompactRange(nullptr, nullptr);
+
+  // Overwrite and delete across all parts, with a snapshot that keeps
+  // some of the old values alive
+  const Snapshot* snapshot = db_->GetSnapshot();
+  std::map<std::string, std::string> old_model = model;
+  for (int i = 0; i < 5000; i += 3) {
+    if (i % 2 == 0) {
+      model[Key(i)] = RandomString(&rnd, 1000);
+      ASSERT_OK(Put(Key(i), model[Key(i)]));
+    } else {
+      model.erase(Key(i));
+      ASSERT_OK(Delete(Key(i)));
+    }
+  }
+  db_->CompactRange(nullptr, nullptr);
+
+  for (int i = 0; i < 5000; i++) {
+    std::string k = Key(i);
+    ASSERT_EQ(model.count(k) ? model[k] : "NOT_FOUND", Get(k));
+    ASSERT_EQ(old_model[k], Get(k, snapshot));
+  }
+  db_->ReleaseSnapshot(snapshot);
+
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  std::map<std::string, std::string>::iterator it = model.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++it) {
+    ASSERT_TRUE(it != model.end());
+    ASSERT_EQ(it->first, iter->key().ToString());
+    ASSERT_EQ(it->second, iter->value().ToString());
+  }
+  ASSERT_TRUE(it == model.end());
+  delete iter;
+}
+
 TEST(DBTest, RecoverWithLargeLog) {
   {
     Options options = CurrentOptions();
@@ -1097,8 +1983,8 @@ TEST(DBTest, RepeatedWritesToSameKey) {
   Reopen(&options);
 
   // We must have at most one file per level except for level-0,
-  // which may have up to kL0_StopWritesTrigger files.
-  const int kMaxFiles = config::kNumLevels + config::kL0_StopWritesTrigger;
+  // which may have up to level0_stop_writes_trigger files.
+  const int kMaxFiles = config::kNumLevels + options.level0_stop_writes_trigger;
 
   Random rnd(301);
   std::string value = RandomString(&rnd, 2 * options.write_buffer_size);
@@ -1398,6 +2284,137 @@ TEST(DBTest, DeletionMarkers2) {
   ASSERT_EQ(AllEntriesFor("foo"), "[ ]");
 }
 
+TEST(DBTest, DeleteRange) {
+  do {
+    // Spread the keys over a deeper level, level-0 and the memtable
+    ASSERT_OK(Put("a", "va"));
+    ASSERT_OK(Put("c", "vc"));
+    ASSERT_OK(Put("e", "ve"));
+    Compact("a", "z");
+    ASSERT_OK(Put("d", "vd"));
+    dbfull()->TEST_CompactMemTable();
+    ASSERT_OK(Put("b", "vb"));
+    const Snapshot* snapshot = db_->GetSnapshot();
+    ASSERT_OK(db_->DeleteRange(WriteOptions(), "b", "e"));
+    ASSERT_OK(Put("c", "vc2"));   // Newer than the tombstone
+
+    std::vector<std::string> keys;
+    keys.push_back("a");
+    keys.push_back("b");
+    keys.push_back("c");
+    keys.push_back("d");
+    keys.push_back("e");
+    for (int pass = 0; pass < 4; pass++) {
+      ASSERT_EQ("NOT_FOUND", Get("b"));
+      ASSERT_EQ("vc2", Get("c"));
+      ASSERT_EQ("NOT_FOUND", Get("d"));
+      ASSERT_EQ("ve", Get("e"));
+      ASSERT_EQ("(a->va)(c->vc2)(e->ve)", Contents());
+      ASSERT_EQ("va,NOT_FOUND,vc2,NOT_FOUND,ve", MultiGet(keys));
+      if (snapshot != nullptr) {
+        ASSERT_EQ("vb", Get("b", snapshot));
+        ASSERT_EQ("va,vb,vc,vd,ve", MultiGet(keys, snapshot));
+      }
+
+      // Same results with the tombstone in a table, after compactions and
+      // after reopening
+      switch (pass) {
+        case 0:
+          dbfull()->TEST_CompactMemTable();
+          break;
+        case 1:
+          db_->ReleaseSnapshot(snapshot);
+          snapshot = nullptr;
+          Compact("a", "z");
+          break;
+        case 2:
+          Reopen();
+          break;
+      }
+    }
+  } while (ChangeOptions());
+}
+
+TEST(DBTest, DeleteRangeDropsCoveredData) {
+  // "b", "c" and "y" are in the last level
+  Put("b", "vb");
+  Put("c", "vc");
+  Put("y", "vy");
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  const int last = config::kMaxMemCompactLevel;
+  ASSERT_EQ(NumTableFilesAtLevel(last), 1);
+
+  // Place a table at level last-1 to prevent merging with preceding mutation
+  Put("a", "begin");
+  Put("z", "end");
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ(NumTableFilesAtLevel(last-1), 1);
+
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), "b", "d"));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());  // Moves to level last-2
+  ASSERT_EQ(AllEntriesFor("b"), "[ vb ]");
+  dbfull()->TEST_CompactRange(last-2, nullptr, nullptr);
+  // Tombstone kept: "last" file overlaps
+  ASSERT_EQ(AllEntriesFor("b"), "[ vb ]");
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  dbfull()->TEST_CompactRange(last-1, nullptr, nullptr);
+  // Merging last-1 w/ last drops the covered entries and the tombstone
+  ASSERT_EQ(AllEntriesFor("b"), "[ ]");
+  ASSERT_EQ(AllEntriesFor("c"), "[ ]");
+  ASSERT_EQ(AllEntriesFor("y"), "[ vy ]");
+  ASSERT_EQ("(a->begin)(y->vy)(z->end)", Contents());
+}
+
+TEST(DBTest, DeleteRangeSkipsCoveredFiles) {
+  Put("b", "vb");
+  Put("c", "vc");
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  const int last = config::kMaxMemCompactLevel;
+  ASSERT_EQ(NumTableFilesAtLevel(last), 1);
+  Put("a", "begin");
+  Put("z", "end");
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ(NumTableFilesAtLevel(last-1), 1);
+
+  // The tombstone hides the whole file of the last level
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), "a0", "d"));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  dbfull()->TEST_CompactRange(last-2, nullptr, nullptr);
+  dbfull()->TEST_CompactRange(last-1, nullptr, nullptr);
+  ASSERT_EQ("0,0,1", FilesPerLevel());
+  ASSERT_EQ(AllEntriesFor("b"), "[ ]");
+  ASSERT_EQ(AllEntriesFor("c"), "[ ]");
+  ASSERT_EQ("(a->begin)(z->end)", Contents());
+}
+
+TEST(DBTest, DeleteRangeKeepsSnapshotData) {
+  Put("b", "vb");
+  Put("c", "vc");
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  const int last = config::kMaxMemCompactLevel;
+  Put("a", "begin");
+  Put("z", "end");
+  dbfull()->TEST_CompactMemTable();
+
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), "a0", "d"));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  dbfull()->TEST_CompactRange(last-2, nullptr, nullptr);
+  dbfull()->TEST_CompactRange(last-1, nullptr, nullptr);
+  // The snapshot still sees the covered entries
+  ASSERT_EQ(AllEntriesFor("b"), "[ vb ]");
+  ASSERT_EQ("vb", Get("b", snapshot));
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  ASSERT_EQ("(a->begin)(z->end)", Contents());
+  db_->ReleaseSnapshot(snapshot);
+
+  Reopen();
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  dbfull()->TEST_CompactRange(last, nullptr, nullptr);
+  ASSERT_EQ(AllEntriesFor("b"), "[ ]");
+  ASSERT_EQ("(a->begin)(z->end)", Contents());
+}
+
 TEST(DBTest, OverlapInLevel0) {
   do {
     ASSERT_EQ(config::kMaxMemCompactLevel, 2) << "Fix test to match config";
@@ -1771,6 +2788,32 @@ TEST(DBTest, WriteSyncError) {
   ASSERT_EQ("NOT_FOUND", Get("k3"));
 }
 
+TEST(DBTest, PipelinedWriteLogError) {
+  // Check that a failed log write stops later writes from reusing its
+  // sequence numbers when the memtable is updated after the log.
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.enable_pipelined_write = true;
+  Reopen(&options);
+  ASSERT_OK(Put("k1", "v1"));
+
+  env_->data_write_error_.Release_Store(env_);
+  ASSERT_TRUE(!Put("k2", "v2").ok());
+  env_->data_write_error_.Release_Store(nullptr);
+
+  // Later writes fail as well
+  ASSERT_TRUE(!Put("k3", "v3").ok());
+  ASSERT_EQ("v1", Get("k1"));
+  ASSERT_EQ("NOT_FOUND", Get("k2"));
+  ASSERT_EQ("NOT_FOUND", Get("k3"));
+
+  Reopen(&options);
+  ASSERT_EQ("v1", Get("k1"));
+  ASSERT_EQ("NOT_FOUND", Get("k3"));
+  ASSERT_OK(Put("k4", "v4"));
+  ASSERT_EQ("v4", Get("k4"));
+}
+
 TEST(DBTest, ManifestWriteError) {
   // Test for the following problem:
   // (a) Compaction produces file F
@@ -1904,6 +2947,234 @@ TEST(DBTest, BloomFilter) {
   delete options.filter_policy;
 }
 
+TEST(DBTest, WholeTableFilters) {
+  const FilterFormat kFormats[] = {
+    leveldb::kFullFilter, leveldb::kPartitionedFilter
+  };
+  for (int f = 0; f < 2; f++) {
+    env_->count_random_reads_ = true;
+    Options options = CurrentOptions();
+    options.env = env_;
+    // Filter partitions stay cached; data blocks are not (see fill_cache)
+    options.block_cache = NewLRUCache(8 << 20);
+    options.filter_policy = NewBloomFilterPolicy(10);
+    options.filter_format = kFormats[f];
+    options.filter_partition_keys = 256;
+    options.create_if_missing = true;
+    DestroyAndReopen(&options);
+
+    // Populate multiple layers
+    const int N = 10000;
+    for (int i = 0; i < N; i++) {
+      ASSERT_OK(Put(Key(i), Key(i)));
+    }
+    Compact("a", "z");
+    for (int i = 0; i < N; i += 100) {
+      ASSERT_OK(Put(Key(i), Key(i)));
+    }
+    dbfull()->TEST_CompactMemTable();
+
+    // Prevent auto compactions triggered by seeks
+    env_->delay_data_sync_.Release_Store(env_);
+
+    ReadOptions ro;
+    ro.fill_cache = false;
+    std::string value;
+    for (int i = 0; i < N; i++) {
+      // Load the filter partitions
+      db_->Get(ro, Key(i) + ".missing", &value);
+    }
+
+    // Lookup present keys.  Should rarely read from small sstable.
+    env_->random_read_counter_.Reset();
+    for (int i = 0; i < N; i++) {
+      ASSERT_OK(db_->Get(ro, Key(i), &value));
+      ASSERT_EQ(Key(i), value);
+    }
+    int reads = env_->random_read_counter_.Read();
+    fprintf(stderr, "format %d: %d present => %d reads\n", kFormats[f], N,
+            reads);
+    ASSERT_GE(reads, N);
+    ASSERT_LE(reads, N + 2*N/100);
+
+    // Lookup missing keys.  Should rarely read from either sstable.
+    env_->random_read_counter_.Reset();
+    for (int i = 0; i < N; i++) {
+      ASSERT_TRUE(db_->Get(ro, Key(i) + ".missing", &value).IsNotFound());
+    }
+    reads = env_->random_read_counter_.Read();
+    fprintf(stderr, "format %d: %d missing => %d reads\n", kFormats[f], N,
+            reads);
+    ASSERT_LE(reads, 3*N/100);
+
+    env_->delay_data_sync_.Release_Store(nullptr);
+    Close();
+    delete options.block_cache;
+    delete options.filter_policy;
+  }
+}
+
+static std::string PrefixKey(int prefix, int i) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "p%03d|%04d", prefix, i);
+  return std::string(buf);
+}
+
+TEST(DBTest, PrefixSameAsStart) {
+  const FilterFormat kFormats[] = {
+    kBlockBasedFilter, leveldb::kFullFilter, leveldb::kPartitionedFilter
+  };
+  for (int f = 0; f < 3; f++) {
+    env_->count_random_reads_ = true;
+    Options options = CurrentOptions();
+    options.env = env_;
+    // Filter partitions stay cached; data blocks are not (see fill_cache)
+    options.block_cache = NewLRUCache(8 << 20);
+    options.filter_policy = NewBloomFilterPolicy(10);
+    options.filter_format = kFormats[f];
+    options.filter_partition_keys = 64;
+    options.prefix_extractor = NewFixedPrefixTransform(5);
+    options.create_if_missing = true;
+    DestroyAndReopen(&options);
+
+    // Populate multiple layers with the even prefixes only
+    const int kPrefixes = 100;
+    const int kPerPrefix = 20;
+    for (int p = 0; p < kPrefixes; p += 2) {
+      for (int i = 0; i < kPerPrefix; i++) {
+        ASSERT_OK(Put(PrefixKey(p, i), PrefixKey(p, i)));
+      }
+    }
+    Compact("a", "z");
+    for (int p = 0; p < kPrefixes; p += 4) {
+      ASSERT_OK(Put(PrefixKey(p, kPerPrefix), "new"));
+    }
+    dbfull()->TEST_CompactMemTable();
+
+    // Prevent auto compactions triggered by seeks
+    env_->delay_data_sync_.Release_Store(env_);
+
+    ReadOptions ro;
+    ro.fill_cache = false;
+    ro.prefix_same_as_start = true;
+    Iterator* iter = db_->NewIterator(ro);
+
+    // Iteration stops at the end of the prefix of the target
+    for (int p = 0; p < kPrefixes; p += 2) {
+      int expected = kPerPrefix - 5 + (p % 4 == 0 ? 1 : 0);
+      int count = 0;
+      for (iter->Seek(PrefixKey(p, 5)); iter->Valid(); iter->Next()) {
+        ASSERT_EQ(PrefixKey(p, 0).substr(0, 5),
+                  iter->key().ToString().substr(0, 5));
+        count++;
+      }
+      ASSERT_OK(iter->status());
+      ASSERT_EQ(expected, count);
+    }
+
+    // Missing prefixes are rejected by the filters without reading data
+    for (int p = 1; p < kPrefixes; p += 2) {
+      iter->Seek(PrefixKey(p, 0));  // Load the filter partitions
+    }
+    env_->random_read_counter_.Reset();
+    for (int p = 1; p < kPrefixes; p += 2) {
+      iter->Seek(PrefixKey(p, 0));
+      ASSERT_TRUE(!iter->Valid());
+      ASSERT_OK(iter->status());
+    }
+    int reads = env_->random_read_counter_.Read();
+    fprintf(stderr, "format %d: %d missing prefixes => %d reads\n",
+            kFormats[f], kPrefixes / 2, reads);
+    ASSERT_LE(reads, kPrefixes / 20);
+
+    // A target without a prefix does not limit the iteration
+    iter->Seek("p");
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(PrefixKey(0, 0), iter->key().ToString());
+    int count = 0;
+    for (; iter->Valid(); iter->Next()) {
+      count++;
+    }
+    ASSERT_EQ(kPrefixes / 2 * kPerPrefix + kPrefixes / 4, count);
+
+    // Only Seek() and Next() are supported
+    iter->Seek(PrefixKey(2, 0));
+    ASSERT_TRUE(iter->Valid());
+    iter->Prev();
+    ASSERT_TRUE(!iter->Valid());
+    ASSERT_TRUE(iter->status().IsNotSupportedError());
+    delete iter;
+
+    iter = db_->NewIterator(ro);
+    iter->SeekToFirst();
+    ASSERT_TRUE(!iter->Valid());
+    ASSERT_TRUE(iter->status().IsNotSupportedError());
+    delete iter;
+
+    env_->delay_data_sync_.Release_Store(nullptr);
+    Close();
+    delete options.block_cache;
+    delete options.filter_policy;
+    delete options.prefix_extractor;
+  }
+}
+
+namespace {
+// Counts the keys and bytes of the filters made by a bloom filter policy
+class CountingFilterPolicy : public FilterPolicy {
+ public:
+  CountingFilterPolicy() : bloom_(NewBloomFilterPolicy(10)), keys_(0),
+                           bytes_(0) { }
+  ~CountingFilterPolicy() { delete bloom_; }
+  virtual const char* Name() const { return bloom_->Name(); }
+  virtual void CreateFilter(const Slice* keys, int n, std::string* dst) const {
+    const size_t before = dst->size();
+    bloom_->CreateFilter(keys, n, dst);
+    keys_ += n;
+    bytes_ += dst->size() - before;
+  }
+  virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const {
+    return bloom_->KeyMayMatch(key, filter);
+  }
+
+  const FilterPolicy* const bloom_;
+  mutable int keys_;
+  mutable size_t bytes_;
+};
+}  // namespace
+
+TEST(DBTest, PrefixFilterSize) {
+  const int kPrefixes = 50;
+  const int kPerPrefix = 20;
+  CountingFilterPolicy policy;
+  Options options = CurrentOptions();
+  options.filter_policy = &policy;
+  options.filter_format = leveldb::kFullFilter;
+  options.prefix_extractor = NewFixedPrefixTransform(5);
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+
+  for (int p = 0; p < kPrefixes; p++) {
+    for (int i = 0; i < kPerPrefix; i++) {
+      ASSERT_OK(Put(PrefixKey(p, i), "v"));
+    }
+  }
+  policy.keys_ = 0;
+  policy.bytes_ = 0;
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ("0,0,1", FilesPerLevel());
+
+  // Every key, and every prefix once
+  const int kKeys = kPrefixes * kPerPrefix;
+  ASSERT_EQ(kKeys + kPrefixes, policy.keys_);
+  // Ten bits per key, rounded up to a byte, and the number of probes
+  ASSERT_EQ(static_cast<size_t>((kKeys + kPrefixes) * 10 / 8 + 2),
+            policy.bytes_);
+
+  Close();
+  delete options.prefix_extractor;
+}
+
 // Multi-threaded test:
 namespace {
 
@@ -2056,6 +3327,12 @@ class ModelDB: public DB {
       virtual void Delete(const Slice& key) {
         map_->erase(key.ToString());
       }
+      virtual void DeleteRange(const Slice& begin, const Slice& end) {
+        if (begin.compare(end) < 0) {
+          map_->erase(map_->lower_bound(begin.ToString()),
+                      map_->lower_bound(end.ToString()));
+        }
+      }
     };
     Handler handler;
     handler.map_ = &map_;
@@ -2227,6 +3504,68 @@ TEST(DBTest, Randomized) {
   } while (ChangeOptions());
 }
 
+TEST(DBTest, DeleteRangeRandomized) {
+  Random rnd(test::RandomSeed());
+  do {
+    // Several output files and subcompactions split the tombstones
+    Options options = CurrentOptions();
+    options.max_file_size = 1 << 20;
+    options.max_subcompactions = 3;
+    Reopen(&options);
+    ModelDB model(options);
+    const int N = 3000;
+    const Snapshot* model_snap = nullptr;
+    const Snapshot* db_snap = nullptr;
+    for (int step = 0; step < N; step++) {
+      const int p = rnd.Uniform(100);
+      const int i = rnd.Uniform(1000);
+      const std::string k = Key(i);
+      if (p < 60) {                               // Put
+        const std::string v = RandomString(&rnd, 4000);
+        ASSERT_OK(model.Put(WriteOptions(), k, v));
+        ASSERT_OK(db_->Put(WriteOptions(), k, v));
+      } else if (p < 80) {                        // Delete
+        ASSERT_OK(model.Delete(WriteOptions(), k));
+        ASSERT_OK(db_->Delete(WriteOptions(), k));
+      } else {                                    // DeleteRange
+        WriteBatch b;
+        b.DeleteRange(k, Key(i + rnd.Uniform(50)));
+        ASSERT_OK(model.Write(WriteOptions(), &b));
+        ASSERT_OK(db_->Write(WriteOptions(), &b));
+      }
+
+      if ((step % 200) == 0) {
+        dbfull()->TEST_CompactMemTable();
+      }
+      if ((step % 1000) == 999) {
+        db_->CompactRange(nullptr, nullptr);
+      }
+      if ((step % 500) == 0) {
+        ASSERT_TRUE(CompareIterators(step, &model, db_, nullptr, nullptr));
+        ASSERT_TRUE(CompareIterators(step, &model, db_, model_snap, db_snap));
+        for (int i = 0; i < 20; i++) {
+          const std::string key = Key(rnd.Uniform(1000));
+          Iterator* miter = model.NewIterator(ReadOptions());
+          miter->Seek(key);
+          const bool found = miter->Valid() && miter->key() == key;
+          ASSERT_EQ(found ? miter->value().ToString() : "NOT_FOUND", Get(key));
+          delete miter;
+        }
+        if (model_snap != nullptr) model.ReleaseSnapshot(model_snap);
+        if (db_snap != nullptr) db_->ReleaseSnapshot(db_snap);
+
+        Reopen(&options);
+        ASSERT_TRUE(CompareIterators(step, &model, db_, nullptr, nullptr));
+
+        model_snap = model.GetSnapshot();
+        db_snap = db_->GetSnapshot();
+      }
+    }
+    if (model_snap != nullptr) model.ReleaseSnapshot(model_snap);
+    if (db_snap != nullptr) db_->ReleaseSnapshot(db_snap);
+  } while (ChangeOptions());
+}
+
 std::string MakeKey(unsigned int num) {
   char buf[30];
   snprintf(buf, sizeof(buf), "%016u", num);
@@ -109,18 +109,45 @@ void InternalFilterPolicy::CreateFilter(const Slice* keys, int n,
                                         std::string* dst) const {
   // We rely on the fact that the code in table.cc does not mind us
   // adjusting keys[].
+  // Several versions of a user key are adjacent, so dropping consecutive
+  // duplicates suppresses them all.
   Slice* mkey = const_cast<Slice*>(keys);
+  int m = 0;
   for (int i = 0; i < n; i++) {
-    mkey[i] = ExtractUserKey(keys[i]);
-    // TODO(sanjay): Suppress dups?
+    Slice user_key = ExtractUserKey(keys[i]);
+    if (m == 0 || mkey[m - 1] != user_key) {
+      mkey[m++] = user_key;
+    }
   }
-  user_policy_->CreateFilter(keys, n, dst);
+  user_policy_->CreateFilter(keys, m, dst);
 }
 
 bool InternalFilterPolicy::KeyMayMatch(const Slice& key, const Slice& f) const {
   return user_policy_->KeyMayMatch(ExtractUserKey(key), f);
 }
 
+const char* InternalKeySliceTransform::Name() const {
+  return user_transform_->Name();
+}
+
+bool InternalKeySliceTransform::InDomain(const Slice& key) const {
+  return key.size() >= 8 && user_transform_->InDomain(ExtractUserKey(key));
+}
+
+Slice InternalKeySliceTransform::Transform(const Slice& key) const {
+  Slice user_prefix = user_transform_->Transform(ExtractUserKey(key));
+  assert(user_prefix.data() == key.data());
+  return Slice(key.data(), user_prefix.size() + 8);
+}
+
+bool InternalKeySliceTransform::SamePrefix(const Slice& a,
+                                           const Slice& b) const {
+  // The last eight bytes follow the user prefix in the key and differ
+  // from key to key; only the user prefixes are compared.
+  assert(a.size() >= 8 && b.size() >= 8);
+  return Slice(a.data(), a.size() - 8) == Slice(b.data(), b.size() - 8);
+}
+
 LookupKey::LookupKey(const Slice& user_key, SequenceNumber s) {
   size_t usize = user_key.size();
   //SequenceNumber + ValueType占8个字节，encode(internal_key_size)至多占5个字节，因此预估至多+13个字节
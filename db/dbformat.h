@@ -10,6 +10,7 @@
 #include "leveldb/db.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/slice.h"
+#include "leveldb/slice_transform.h"
 #include "leveldb/table_builder.h"
 #include "util/coding.h"
 #include "util/logging.h"
@@ -21,15 +22,6 @@ namespace leveldb {
 namespace config {
 static const int kNumLevels = 7;
 
-// Level-0 compaction is started when we hit this many files.
-static const int kL0_CompactionTrigger = 4;
-
-// Soft limit on number of level-0 files.  We slow down writes at this point.
-static const int kL0_SlowdownWritesTrigger = 8;
-
-// Maximum number of level-0 files.  We stop writes at this point.
-static const int kL0_StopWritesTrigger = 12;
-
 // Maximum level to which a new compacted memtable is pushed if it
 // does not create overlap.  We try to push to level 2 to avoid the
 // relatively expensive level 0=>1 compactions and to avoid some
@@ -50,7 +42,10 @@ class InternalKey;
 // data structures.
 enum ValueType {
   kTypeDeletion = 0x0,
-  kTypeValue = 0x1
+  kTypeValue = 0x1,
+  // Deletes every user key in [key, value).  Never mixed with the other
+  // entries: memtables and tables keep range tombstones on the side.
+  kTypeRangeDeletion = 0x2
 };
 // kValueTypeForSeek defines the ValueType that should be passed when
 // constructing a ParsedInternalKey object for seeking to a particular
@@ -58,7 +53,7 @@ enum ValueType {
 // and the value type is embedded as the low 8 bits in the sequence
 // number in internal keys, we need to use the highest-numbered
 // ValueType, not the lowest).
-static const ValueType kValueTypeForSeek = kTypeValue;
+static const ValueType kValueTypeForSeek = kTypeRangeDeletion;
 
 typedef uint64_t SequenceNumber;
 
@@ -136,6 +131,24 @@ class InternalFilterPolicy : public FilterPolicy {
   virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const;
 };
 
+// Filter and iterator code in the table layer sees internal keys, so
+// the prefix extractor of a database is wrapped in this transform.  The
+// "prefix" of an internal key is its user prefix followed by eight more
+// bytes, which lets InternalFilterPolicy strip them like a tag.
+class InternalKeySliceTransform : public SliceTransform {
+ private:
+  const SliceTransform* const user_transform_;
+ public:
+  explicit InternalKeySliceTransform(const SliceTransform* t)
+      : user_transform_(t) { }
+  virtual const char* Name() const;
+  virtual bool InDomain(const Slice& key) const;
+  virtual Slice Transform(const Slice& key) const;
+  virtual bool SamePrefix(const Slice& a, const Slice& b) const;
+
+  const SliceTransform* user_transform() const { return user_transform_; }
+};
+
 // Modules in this directory should keep internal keys wrapped inside
 // the following class instead of plain strings so that we do not
 // incorrectly use string comparisons instead of an InternalKeyComparator.
@@ -183,7 +196,7 @@ inline bool ParseInternalKey(const Slice& internal_key,
   result->sequence = num >> 8;
   result->type = static_cast<ValueType>(c);
   result->user_key = Slice(internal_key.data(), n - 8);
-  return (c <= static_cast<unsigned char>(kTypeValue));
+  return (c <= static_cast<unsigned char>(kTypeRangeDeletion));
 }
 
 // A helper class useful for DBImpl::Get()
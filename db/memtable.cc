@@ -4,10 +4,12 @@
 
 #include "db/memtable.h"
 #include "db/dbformat.h"
+#include "db/range_del.h"
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
 #include "util/coding.h"
+#include "util/mutexlock.h"
 
 namespace leveldb {
 
@@ -26,11 +28,16 @@ static Slice GetLengthPrefixedSlice(const char* data) {
 MemTable::MemTable(const InternalKeyComparator& cmp)
     : comparator_(cmp),
       refs_(0),
-      table_(comparator_, &arena_) {
+      table_(comparator_, &arena_),
+      range_del_table_(comparator_, &arena_),
+      num_range_dels_(0),
+      range_dels_(nullptr),
+      range_dels_count_(0) {
 }
 
 MemTable::~MemTable() {
   assert(refs_ == 0);
+  delete range_dels_;
 }
 
 size_t MemTable::ApproximateMemoryUsage() { return arena_.MemoryUsage(); }
@@ -90,9 +97,13 @@ Iterator* MemTable::NewIterator() {
   return new MemTableIterator(&table_);
 }
 
-void MemTable::Add(SequenceNumber s, ValueType type,
-                   const Slice& key,
-                   const Slice& value) {
+Iterator* MemTable::NewRangeTombstoneIterator() {
+  return new MemTableIterator(&range_del_table_);
+}
+
+const char* MemTable::EncodeEntry(SequenceNumber s, ValueType type,
+                                  const Slice& key, const Slice& value,
+                                  bool concurrent) {
   // Format of an entry is concatenation of:
   //  key_size     : varint32 of internal_key.size()
   //  key bytes    : char[internal_key.size()]
@@ -109,7 +120,8 @@ void MemTable::Add(SequenceNumber s, ValueType type,
   const size_t encoded_len =
       VarintLength(internal_key_size) + internal_key_size +
       VarintLength(val_size) + val_size;
-  char* buf = arena_.Allocate(encoded_len);
+  char* buf = concurrent ? arena_.AllocateConcurrent(encoded_len)
+                         : arena_.Allocate(encoded_len);
   //append key_size
   char* p = EncodeVarint32(buf, internal_key_size);
   //append key bytes
@@ -126,12 +138,67 @@ void MemTable::Add(SequenceNumber s, ValueType type,
   //append value bytes
   memcpy(p, value.data(), val_size);
   assert(p + val_size == buf + encoded_len);
+  return buf;
+}
+
+void MemTable::Add(SequenceNumber s, ValueType type,
+                   const Slice& key,
+                   const Slice& value) {
   //写入table_的buffer包含了key/value及附属信息
-  table_.Insert(buf);
+  if (type == kTypeRangeDeletion) {
+    // Empty ranges delete nothing
+    if (comparator_.comparator.user_comparator()->Compare(key, value) < 0) {
+      range_del_table_.Insert(EncodeEntry(s, type, key, value, false));
+      AddedTombstone();
+    }
+    return;
+  }
+  table_.Insert(EncodeEntry(s, type, key, value, false));
+}
+
+void MemTable::AddConcurrently(SequenceNumber s, ValueType type,
+                               const Slice& key,
+                               const Slice& value) {
+  if (type == kTypeRangeDeletion) {
+    if (comparator_.comparator.user_comparator()->Compare(key, value) < 0) {
+      range_del_table_.InsertConcurrently(
+          EncodeEntry(s, type, key, value, true));
+      AddedTombstone();
+    }
+    return;
+  }
+  table_.InsertConcurrently(EncodeEntry(s, type, key, value, true));
+}
+
+SequenceNumber MemTable::MaxCoveringTombstone(const Slice& user_key,
+                                              SequenceNumber snapshot) {
+  const int count = num_range_dels_.load(std::memory_order_acquire);
+  if (count == 0) {
+    return 0;
+  }
+  MutexLock l(&range_dels_mu_);
+  if (range_dels_ == nullptr || range_dels_count_ != count) {
+    // Tombstones that are visible as of "snapshot" were all counted
+    // before "snapshot" was published, so the rebuilt list holds them.
+    RangeTombstoneList* list =
+        new RangeTombstoneList(comparator_.comparator.user_comparator());
+    MemTableIterator iter(&range_del_table_);
+    Status s = list->AddAll(&iter);
+    assert(s.ok());
+    (void) s;
+    list->Finish();
+    delete range_dels_;
+    range_dels_ = list;
+    range_dels_count_ = count;
+  }
+  return range_dels_->MaxCoveringSequence(user_key, snapshot);
 }
 
 bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
   Slice memkey = key.memtable_key();
+  Slice ikey = key.internal_key();
+  const SequenceNumber covering = MaxCoveringTombstone(
+      key.user_key(), DecodeFixed64(ikey.data() + ikey.size() - 8) >> 8);
   Table::Iterator iter(&table_);
   iter.Seek(memkey.data());
   if (iter.Valid()) {
@@ -157,6 +224,11 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
       // Correct user key
       // tag = (s << 8) | type
       const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
+      if ((tag >> 8) < covering) {
+        // Hidden by a range tombstone
+        *s = Status::NotFound(Slice());
+        return true;
+      }
       //type存储在最后一个字节
       switch (static_cast<ValueType>(tag & 0xff)) {
         case kTypeValue: {
@@ -165,11 +237,17 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
           return true;
         }
         case kTypeDeletion:
+        case kTypeRangeDeletion:
           *s = Status::NotFound(Slice());
           return true;
       }
     }
   }
+  if (covering > 0) {
+    // No newer entry for key; older ones are hidden by a range tombstone
+    *s = Status::NotFound(Slice());
+    return true;
+  }
   return false;
 }
 
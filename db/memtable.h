@@ -5,16 +5,20 @@
 #ifndef STORAGE_LEVELDB_DB_MEMTABLE_H_
 #define STORAGE_LEVELDB_DB_MEMTABLE_H_
 
+#include <atomic>
 #include <string>
 #include "leveldb/db.h"
 #include "db/dbformat.h"
 #include "db/skiplist.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
 #include "util/arena.h"
 
 namespace leveldb {
 
 class InternalKeyComparator;
 class MemTableIterator;
+class RangeTombstoneList;
 
 class MemTable {
  public:
@@ -46,16 +50,29 @@ class MemTable {
   // db/format.{h,cc} module.
   Iterator* NewIterator();
 
+  // Return an iterator over the range tombstones added to this memtable,
+  // encoded as described in db/range_del.h.  Same lifetime rules as
+  // NewIterator().
+  Iterator* NewRangeTombstoneIterator();
+
   // Add an entry into memtable that maps key to value at the
   // specified sequence number and with the specified type.
-  // Typically value will be empty if type==kTypeDeletion.
+  // Typically value will be empty if type==kTypeDeletion.  If
+  // type==kTypeRangeDeletion, key and value are the bounds of the range.
   void Add(SequenceNumber seq, ValueType type,
            const Slice& key,
            const Slice& value);
 
+  // Same as Add(), but any number of threads may call it at the same time
+  // as long as none of them calls Add() meanwhile.
+  void AddConcurrently(SequenceNumber seq, ValueType type,
+                       const Slice& key,
+                       const Slice& value);
+
   // If memtable contains a value for key, store it in *value and return true.
-  // If memtable contains a deletion for key, store a NotFound() error
-  // in *status and return true.
+  // If memtable contains a deletion for key, or a range tombstone that
+  // hides every older value of key, store a NotFound() error in *status
+  // and return true.
   // Else, return false.
   bool Get(const LookupKey& key, std::string* value, Status* s);
 
@@ -72,10 +89,34 @@ class MemTable {
 
   typedef SkipList<const char*, KeyComparator> Table;
 
+  // Encode an entry for Add()/AddConcurrently() into a buffer obtained
+  // from the arena and return it.
+  const char* EncodeEntry(SequenceNumber seq, ValueType type,
+                          const Slice& key, const Slice& value,
+                          bool concurrent);
+
+  // Return the largest sequence number <= snapshot of the range tombstones
+  // in this memtable that cover user_key, or zero if there is none.
+  SequenceNumber MaxCoveringTombstone(const Slice& user_key,
+                                      SequenceNumber snapshot);
+
+  // Count a tombstone just inserted into range_del_table_.
+  void AddedTombstone() {
+    num_range_dels_.fetch_add(1, std::memory_order_release);
+  }
+
   KeyComparator comparator_;
   int refs_;
   Arena arena_;
   Table table_;
+  Table range_del_table_;   // Range tombstones, kept out of table_
+  std::atomic<int> num_range_dels_;   // Entries of range_del_table_
+
+  // Tombstones of range_del_table_ indexed for lookups, rebuilt by
+  // MaxCoveringTombstone() once more tombstones have been added
+  port::Mutex range_dels_mu_;
+  RangeTombstoneList* range_dels_ GUARDED_BY(range_dels_mu_);
+  int range_dels_count_ GUARDED_BY(range_dels_mu_);
 
   // No copying allowed
   MemTable(const MemTable&);
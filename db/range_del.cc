@@ -0,0 +1,194 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/range_del.h"
+
+#include <algorithm>
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+
+namespace leveldb {
+
+namespace {
+
+// Orders tombstones by increasing begin key, then decreasing sequence.
+struct TombstoneOrder {
+  const Comparator* ucmp;
+  bool operator()(const RangeTombstone& a, const RangeTombstone& b) const {
+    int r = ucmp->Compare(a.begin, b.begin);
+    if (r != 0) {
+      return r < 0;
+    }
+    return a.seq > b.seq;
+  }
+};
+
+struct SliceOrder {
+  const Comparator* ucmp;
+  bool operator()(const Slice& a, const Slice& b) const {
+    return ucmp->Compare(a, b) < 0;
+  }
+};
+
+}  // namespace
+
+RangeTombstoneList::RangeTombstoneList(const Comparator* user_comparator)
+    : ucmp_(user_comparator),
+      finished_(false) {
+}
+
+RangeTombstoneList::~RangeTombstoneList() { }
+
+void RangeTombstoneList::Add(const Slice& begin, const Slice& end,
+                             SequenceNumber seq) {
+  assert(!finished_);
+  if (ucmp_->Compare(begin, end) >= 0) {
+    return;
+  }
+  RangeTombstone t;
+  t.begin = begin.ToString();
+  t.end = end.ToString();
+  t.seq = seq;
+  tombstones_.push_back(t);
+}
+
+Status RangeTombstoneList::AddAll(Iterator* iter) {
+  ParsedInternalKey ikey;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    if (!ParseInternalKey(iter->key(), &ikey) ||
+        ikey.type != kTypeRangeDeletion) {
+      return Status::Corruption("bad range tombstone");
+    }
+    Add(ikey.user_key, iter->value(), ikey.sequence);
+  }
+  return iter->status();
+}
+
+void RangeTombstoneList::AddList(const RangeTombstoneList& other) {
+  assert(!finished_);
+  tombstones_.insert(tombstones_.end(), other.tombstones_.begin(),
+                     other.tombstones_.end());
+}
+
+void RangeTombstoneList::Finish() {
+  assert(!finished_);
+  finished_ = true;
+  if (tombstones_.empty()) {
+    return;
+  }
+
+  // Pieces of one tombstone that were stored in different tables share
+  // their sequence number; merge the ones that start at the same key.
+  TombstoneOrder order = { ucmp_ };
+  std::sort(tombstones_.begin(), tombstones_.end(), order);
+  size_t live = 0;
+  for (size_t i = 0; i < tombstones_.size(); i++) {
+    if (live > 0 && tombstones_[live - 1].seq == tombstones_[i].seq &&
+        tombstones_[live - 1].begin == tombstones_[i].begin) {
+      if (ucmp_->Compare(tombstones_[i].end, tombstones_[live - 1].end) > 0) {
+        tombstones_[live - 1].end.swap(tombstones_[i].end);
+      }
+    } else {
+      if (live != i) {
+        std::swap(tombstones_[live], tombstones_[i]);
+      }
+      live++;
+    }
+  }
+  tombstones_.resize(live);
+
+  std::vector<Slice> points;
+  points.reserve(2 * tombstones_.size());
+  for (size_t i = 0; i < tombstones_.size(); i++) {
+    points.push_back(tombstones_[i].begin);
+    points.push_back(tombstones_[i].end);
+  }
+  SliceOrder slice_order = { ucmp_ };
+  std::sort(points.begin(), points.end(), slice_order);
+  size_t distinct = 0;
+  for (size_t i = 0; i < points.size(); i++) {
+    if (distinct == 0 ||
+        ucmp_->Compare(points[distinct - 1], points[i]) != 0) {
+      points[distinct++] = points[i];
+    }
+  }
+  points.resize(distinct);
+
+  // Sweep the points from left to right, keeping the tombstones that
+  // cover [points[i], points[i+1]) in "active".
+  std::vector<const RangeTombstone*> active;
+  size_t next = 0;
+  for (size_t i = 0; i + 1 < points.size(); i++) {
+    size_t kept = 0;
+    for (size_t j = 0; j < active.size(); j++) {
+      if (ucmp_->Compare(active[j]->end, points[i]) > 0) {
+        active[kept++] = active[j];
+      }
+    }
+    active.resize(kept);
+    while (next < tombstones_.size() &&
+           ucmp_->Compare(tombstones_[next].begin, points[i]) == 0) {
+      active.push_back(&tombstones_[next++]);
+    }
+    if (active.empty()) {
+      continue;
+    }
+    Fragment f;
+    f.begin = points[i];
+    f.end = points[i + 1];
+    for (size_t j = 0; j < active.size(); j++) {
+      f.seqs.push_back(active[j]->seq);
+    }
+    std::sort(f.seqs.begin(), f.seqs.end());
+    std::reverse(f.seqs.begin(), f.seqs.end());
+    fragments_.push_back(f);
+  }
+}
+
+SequenceNumber RangeTombstoneList::MaxCoveringSequence(
+    const Slice& user_key, SequenceNumber snapshot) const {
+  assert(finished_);
+  // Find the last fragment that starts at or before user_key
+  size_t left = 0;
+  size_t right = fragments_.size();
+  while (left < right) {
+    size_t mid = (left + right) / 2;
+    if (ucmp_->Compare(fragments_[mid].begin, user_key) <= 0) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  if (left == 0) {
+    return 0;
+  }
+  const Fragment& f = fragments_[left - 1];
+  if (ucmp_->Compare(user_key, f.end) >= 0) {
+    return 0;
+  }
+  for (size_t i = 0; i < f.seqs.size(); i++) {
+    if (f.seqs[i] <= snapshot) {
+      return f.seqs[i];
+    }
+  }
+  return 0;
+}
+
+bool RangeTombstoneList::CoversRange(const Slice& smallest,
+                                     const Slice& largest,
+                                     SequenceNumber snapshot) const {
+  assert(finished_);
+  for (size_t i = 0; i < tombstones_.size(); i++) {
+    const RangeTombstone& t = tombstones_[i];
+    if (ucmp_->Compare(t.begin, smallest) > 0) {
+      break;
+    }
+    if (t.seq <= snapshot && ucmp_->Compare(largest, t.end) < 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,101 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Range tombstones are written by WriteBatch::DeleteRange().  Memtables
+// and tables keep them apart from the other entries, as internal keys
+// (begin, sequence, kTypeRangeDeletion) that map to the limit user key
+// "end".  A tombstone deletes every entry with a user key in [begin, end)
+// and a smaller sequence number.
+
+#ifndef STORAGE_LEVELDB_DB_RANGE_DEL_H_
+#define STORAGE_LEVELDB_DB_RANGE_DEL_H_
+
+#include <string>
+#include <vector>
+#include "db/dbformat.h"
+
+namespace leveldb {
+
+class Comparator;
+class Iterator;
+
+struct RangeTombstone {
+  std::string begin;    // First deleted user key
+  std::string end;      // Limit user key (not deleted)
+  SequenceNumber seq;
+};
+
+// A set of range tombstones that answers "which tombstone hides this
+// entry" in logarithmic time.  Not thread-safe while it is being built;
+// after Finish() any number of threads may query it.
+class RangeTombstoneList {
+ public:
+  explicit RangeTombstoneList(const Comparator* user_comparator);
+  ~RangeTombstoneList();
+
+  // Add the tombstone that deletes [begin, end) at sequence number "seq".
+  // Empty ranges are ignored.
+  // REQUIRES: Finish() has not been called
+  void Add(const Slice& begin, const Slice& end, SequenceNumber seq);
+
+  // Add every tombstone yielded by "*iter", which must use the memtable
+  // and table encoding described at the top of this file.  Returns a
+  // non-OK status if an entry cannot be parsed or "*iter" fails.
+  // REQUIRES: Finish() has not been called
+  Status AddAll(Iterator* iter);
+
+  // Add every tombstone of "other".
+  // REQUIRES: Finish() has not been called
+  void AddList(const RangeTombstoneList& other);
+
+  // Prepare the list for queries.  No more tombstones may be added.
+  void Finish();
+
+  bool empty() const { return tombstones_.empty(); }
+
+  // Tombstones added so far, ordered by increasing begin key and then by
+  // decreasing sequence number.
+  // REQUIRES: Finish() has been called
+  const std::vector<RangeTombstone>& tombstones() const {
+    assert(finished_);
+    return tombstones_;
+  }
+
+  // Return the largest sequence number <= snapshot of the tombstones
+  // that cover "user_key", or zero if there is no such tombstone.  An
+  // entry for "user_key" with sequence number s is deleted as of
+  // "snapshot" iff s < MaxCoveringSequence(user_key, snapshot).
+  // REQUIRES: Finish() has been called
+  SequenceNumber MaxCoveringSequence(const Slice& user_key,
+                                     SequenceNumber snapshot) const;
+
+  // Return true iff a single tombstone with a sequence number <= snapshot
+  // covers every user key in [smallest, largest].
+  // REQUIRES: Finish() has been called
+  bool CoversRange(const Slice& smallest, const Slice& largest,
+                   SequenceNumber snapshot) const;
+
+ private:
+  // Tombstones may overlap each other.  Finish() cuts their union at
+  // every begin and end key into disjoint fragments, each of which lists
+  // the sequence numbers of the tombstones that cover it.
+  struct Fragment {
+    Slice begin;
+    Slice end;
+    std::vector<SequenceNumber> seqs;   // Decreasing
+  };
+
+  const Comparator* const ucmp_;
+  std::vector<RangeTombstone> tombstones_;
+  std::vector<Fragment> fragments_;    // Sorted, point into tombstones_
+  bool finished_;
+
+  // No copying allowed
+  RangeTombstoneList(const RangeTombstoneList&);
+  void operator=(const RangeTombstoneList&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_RANGE_DEL_H_
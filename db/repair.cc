@@ -31,6 +31,7 @@
 #include "db/log_reader.h"
 #include "db/log_writer.h"
 #include "db/memtable.h"
+#include "db/range_del.h"
 #include "db/table_cache.h"
 #include "db/version_edit.h"
 #include "db/write_batch_internal.h"
@@ -49,7 +50,9 @@ class Repairer {
         env_(options.env),
         icmp_(options.comparator),
         ipolicy_(options.filter_policy),
-        options_(SanitizeOptions(dbname, &icmp_, &ipolicy_, options)),
+        iprefix_(options.prefix_extractor),
+        options_(SanitizeOptions(dbname, &icmp_, &ipolicy_, &iprefix_,
+                                 options)),
         owns_info_log_(options_.info_log != options.info_log),
         owns_cache_(options_.block_cache != options.block_cache),
         next_file_number_(1) {
@@ -101,6 +104,7 @@ class Repairer {
   Env* const env_;
   InternalKeyComparator const icmp_;
   InternalFilterPolicy const ipolicy_;
+  InternalKeySliceTransform const iprefix_;
   Options const options_;
   bool owns_info_log_;
   bool owns_cache_;
@@ -224,8 +228,11 @@ class Repairer {
     FileMetaData meta;
     meta.number = next_file_number_++;
     Iterator* iter = mem->NewIterator();
-    status = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta);
+    Iterator* range_del_iter = mem->NewRangeTombstoneIterator();
+    status = BuildTable(dbname_, env_, options_, table_cache_, iter,
+                        range_del_iter, &meta);
     delete iter;
+    delete range_del_iter;
     mem->Unref();
     mem = nullptr;
     if (status.ok()) {
@@ -306,6 +313,32 @@ class Repairer {
       status = iter->status();
     }
     delete iter;
+
+    // The key range of the table also spans its range tombstones
+    if (status.ok()) {
+      RangeTombstoneList range_dels(icmp_.user_comparator());
+      status = table_cache_->AddRangeTombstones(t.meta.number,
+                                                t.meta.file_size,
+                                                &range_dels);
+      range_dels.Finish();
+      const std::vector<RangeTombstone>& tombstones = range_dels.tombstones();
+      for (size_t i = 0; i < tombstones.size(); i++) {
+        const RangeTombstone& r = tombstones[i];
+        InternalKey begin(r.begin, r.seq, kTypeRangeDeletion);
+        InternalKey limit(r.end, kMaxSequenceNumber, kTypeRangeDeletion);
+        if (empty || icmp_.Compare(begin, t.meta.smallest) < 0) {
+          t.meta.smallest = begin;
+        }
+        if (empty || icmp_.Compare(limit, t.meta.largest) > 0) {
+          t.meta.largest = limit;
+        }
+        empty = false;
+        if (r.seq > t.max_sequence) {
+          t.max_sequence = r.seq;
+        }
+        t.meta.has_range_deletions = true;
+      }
+    }
     Log(options_.info_log, "Table #%llu: %d entries %s",
         (unsigned long long) t.meta.number,
         counter,
@@ -339,6 +372,19 @@ class Repairer {
       counter++;
     }
     delete iter;
+    if (t.meta.has_range_deletions) {
+      RangeTombstoneList range_dels(icmp_.user_comparator());
+      table_cache_->AddRangeTombstones(t.meta.number, t.meta.file_size,
+                                       &range_dels);
+      range_dels.Finish();
+      const std::vector<RangeTombstone>& tombstones = range_dels.tombstones();
+      for (size_t i = 0; i < tombstones.size(); i++) {
+        const RangeTombstone& r = tombstones[i];
+        InternalKey begin(r.begin, r.seq, kTypeRangeDeletion);
+        builder->AddRangeDeletion(begin.Encode(), r.end);
+        counter++;
+      }
+    }
 
     ArchiveFile(src);
     if (counter == 0) {
@@ -396,7 +442,8 @@ class Repairer {
       // TODO(opt): separate out into multiple levels
       const TableInfo& t = tables_[i];
       edit_.AddFile(0, t.meta.number, t.meta.file_size,
-                    t.meta.smallest, t.meta.largest);
+                    t.meta.smallest, t.meta.largest,
+                    t.meta.has_range_deletions);
     }
 
     //fprintf(stderr, "NewDescriptor:\n%s\n", edit_.DebugString().c_str());
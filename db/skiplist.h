@@ -8,7 +8,9 @@
 // Thread safety
 // -------------
 //
-// Writes require external synchronization, most likely a mutex.
+// Writes require external synchronization, most likely a mutex, with
+// one exception: any number of threads may call InsertConcurrently() at
+// the same time, as long as no thread calls Insert() meanwhile.
 // Reads require a guarantee that the SkipList will not be destroyed
 // while the read is in progress.  Apart from that, reads progress
 // without any internal locking or synchronization.
@@ -57,6 +59,12 @@ class SkipList {
   // REQUIRES: nothing that compares equal to key is currently in the list.
   void Insert(const Key& key);
 
+  // Like Insert(), but safe to call from several threads at once.  Nodes
+  // are linked level by level with compare-and-swap, and allocated with
+  // Arena::AllocateAlignedConcurrent().
+  // REQUIRES: no concurrent call to Insert().
+  void InsertConcurrently(const Key& key);
+
   // Returns true iff an entry that compares equal to key is in the list.
   bool Contains(const Key& key) const;
 
@@ -112,8 +120,8 @@ class SkipList {
 
   Node* const head_;
 
-  // Modified only by Insert().  Read racily by readers, but stale
-  // values are ok.
+  // Modified only by Insert() and InsertConcurrently().  Read racily by
+  // readers, but stale values are ok.
   port::AtomicPointer max_height_;   // Height of the entire list
 
   inline int GetMaxHeight() const {
@@ -126,7 +134,9 @@ class SkipList {
   Random rnd_;
 
   Node* NewNode(const Key& key, int height);
-  int RandomHeight();//通过抛硬币的方法(1/4概率)决定高度值，范围[1, kMaxHeight]
+  Node* NewNodeConcurrently(const Key& key, int height);
+  static int RandomHeight(Random* rnd);
+  int RandomHeight() { return RandomHeight(&rnd_); }//通过抛硬币的方法(1/4概率)决定高度值，范围[1, kMaxHeight]
   bool Equal(const Key& a, const Key& b) const { return (compare_(a, b) == 0); }
 
   // Return true if key is greater than the data stored in "n"
@@ -141,6 +151,11 @@ class SkipList {
   // 如果prev不为nullptr，则记录每层[0..max_height_-1]最后一个<key的Node
   Node* FindGreaterOrEqual(const Key& key, Node** prev) const;
 
+  // Starting at "before", whose key is < key, walk "level" and store the
+  // last node with a key < key in *prev and its successor in *next.
+  void FindSpliceForLevel(const Key& key, Node* before, int level,
+                          Node** prev, Node** next) const;
+
   // Return the latest node with a key < key.
   // Return head_ if there is no such node.
   Node* FindLessThan(const Key& key) const;
@@ -187,6 +202,13 @@ struct SkipList<Key,Comparator>::Node {
     next_[n].NoBarrier_Store(x);
   }
 
+  // Link x in as the successor at level n if the successor is still
+  // "expected".  Publishes x like SetNext() does.
+  bool CasNext(int n, Node* expected, Node* x) {
+    assert(n >= 0);
+    return next_[n].CompareAndSwap(expected, x);
+  }
+
  private:
   // Array of length equal to the node height.  next_[0] is lowest level link.
   // 作为Node的最后一个成员变量
@@ -205,6 +227,14 @@ SkipList<Key,Comparator>::NewNode(const Key& key, int height) {
   return new (mem) Node(key);
 }
 
+template<typename Key, class Comparator>
+typename SkipList<Key,Comparator>::Node*
+SkipList<Key,Comparator>::NewNodeConcurrently(const Key& key, int height) {
+  char* mem = arena_->AllocateAlignedConcurrent(
+      sizeof(Node) + sizeof(port::AtomicPointer) * (height - 1));
+  return new (mem) Node(key);
+}
+
 template<typename Key, class Comparator>
 inline SkipList<Key,Comparator>::Iterator::Iterator(const SkipList* list) {
   list_ = list;
@@ -258,11 +288,11 @@ inline void SkipList<Key,Comparator>::Iterator::SeekToLast() {
 }
 
 template<typename Key, class Comparator>
-int SkipList<Key,Comparator>::RandomHeight() {
+int SkipList<Key,Comparator>::RandomHeight(Random* rnd) {
   // Increase height with probability 1 in kBranching
   static const unsigned int kBranching = 4;
   int height = 1;
-  while (height < kMaxHeight && ((rnd_.Next() % kBranching) == 0)) {
+  while (height < kMaxHeight && ((rnd->Next() % kBranching) == 0)) {
     height++;
   }
   assert(height > 0);
@@ -298,6 +328,22 @@ typename SkipList<Key,Comparator>::Node* SkipList<Key,Comparator>::FindGreaterOr
   }
 }
 
+template<typename Key, class Comparator>
+void SkipList<Key,Comparator>::FindSpliceForLevel(const Key& key, Node* before,
+                                                  int level, Node** prev,
+                                                  Node** next) const {
+  while (true) {
+    Node* after = before->Next(level);
+    if (KeyIsAfterNode(key, after)) {
+      before = after;
+    } else {
+      *prev = before;
+      *next = after;
+      return;
+    }
+  }
+}
+
 template<typename Key, class Comparator>
 typename SkipList<Key,Comparator>::Node*
 SkipList<Key,Comparator>::FindLessThan(const Key& key) const {
@@ -395,6 +441,55 @@ void SkipList<Key,Comparator>::Insert(const Key& key) {
   }
 }
 
+template<typename Key, class Comparator>
+void SkipList<Key,Comparator>::InsertConcurrently(const Key& key) {
+  // rnd_ belongs to Insert(); give every inserting thread its own
+  // generator, seeded from its address so threads do not draw the same
+  // sequence of heights.
+  static thread_local Random rnd(
+      static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&rnd) >> 4));
+  const int height = RandomHeight(&rnd);
+
+  // Raise max_height_ first so that the search below covers every level
+  // the new node will be linked into.
+  int max_height = GetMaxHeight();
+  while (height > max_height) {
+    if (max_height_.CompareAndSwap(reinterpret_cast<void*>(max_height),
+                                   reinterpret_cast<void*>(height))) {
+      max_height = height;
+      break;
+    }
+    max_height = GetMaxHeight();
+  }
+
+  Node* prev[kMaxHeight];
+  Node* next[kMaxHeight];
+  Node* before = head_;
+  for (int i = max_height - 1; i >= 0; i--) {
+    FindSpliceForLevel(key, before, i, &prev[i], &next[i]);
+    before = prev[i];
+  }
+
+  // Our data structure does not allow duplicate insertion
+  assert(next[0] == nullptr || !Equal(key, next[0]->key));
+
+  // Link bottom-up so that the node is reachable at level i only once it
+  // is reachable at every level below i.  If another thread linked a
+  // node between prev[i] and next[i] in the meantime, the CAS fails and
+  // the splice is recomputed from prev[i], which is still < key since
+  // nodes are never removed.
+  Node* x = NewNodeConcurrently(key, height);
+  for (int i = 0; i < height; i++) {
+    while (true) {
+      x->NoBarrier_SetNext(i, next[i]);
+      if (prev[i]->CasNext(i, next[i], x)) {
+        break;
+      }
+      FindSpliceForLevel(key, prev[i], i, &prev[i], &next[i]);
+    }
+  }
+}
+
 template<typename Key, class Comparator>
 bool SkipList<Key,Comparator>::Contains(const Key& key) const {
   //x记录第一个>= key的Node
@@ -10,6 +10,7 @@
 #include "port/thread_annotations.h"
 #include "util/arena.h"
 #include "util/hash.h"
+#include "util/mutexlock.h"
 #include "util/random.h"
 #include "util/testharness.h"
 
@@ -400,6 +401,114 @@ TEST(SkipTest, Concurrent3) { RunConcurrent(3); }
 TEST(SkipTest, Concurrent4) { RunConcurrent(4); }
 TEST(SkipTest, Concurrent5) { RunConcurrent(5); }
 
+// Several threads call InsertConcurrently() on the same list while a
+// reader scans it.  Afterwards every key must be present exactly once
+// and in order.
+class ConcurrentInsertState {
+ public:
+  static const int kWriters = 4;
+  static const int kKeysPerWriter = 20000;
+
+  Arena arena_;
+  SkipList<Key, Comparator> list_;
+  port::AtomicPointer quit_flag_;
+
+  ConcurrentInsertState()
+      : list_(Comparator(), &arena_),
+        quit_flag_(nullptr),
+        next_id_(0),
+        running_(0),
+        cv_(&mu_) { }
+
+  int NextId() LOCKS_EXCLUDED(mu_) {
+    MutexLock l(&mu_);
+    running_++;
+    return next_id_++;
+  }
+
+  void Done() LOCKS_EXCLUDED(mu_) {
+    MutexLock l(&mu_);
+    running_--;
+    cv_.SignalAll();
+  }
+
+  void WaitForAll() LOCKS_EXCLUDED(mu_) {
+    MutexLock l(&mu_);
+    while (next_id_ < kWriters + 1 || running_ > 0) {
+      cv_.Wait();
+    }
+  }
+
+ private:
+  port::Mutex mu_;
+  int next_id_ GUARDED_BY(mu_);
+  int running_ GUARDED_BY(mu_);
+  port::CondVar cv_ GUARDED_BY(mu_);
+};
+
+static void ConcurrentInserter(void* arg) {
+  ConcurrentInsertState* state = reinterpret_cast<ConcurrentInsertState*>(arg);
+  const int id = state->NextId();
+  if (id == ConcurrentInsertState::kWriters) {
+    // Reader: keys must always come out in strictly increasing order.
+    while (!state->quit_flag_.Acquire_Load()) {
+      SkipList<Key, Comparator>::Iterator iter(&state->list_);
+      Key last = 0;
+      bool first = true;
+      for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+        ASSERT_TRUE(first || iter.key() > last);
+        last = iter.key();
+        first = false;
+      }
+    }
+  } else {
+    // Writer "id" inserts every key that is congruent to id, in a
+    // scrambled order so that writers collide all over the list.
+    const uint64_t n = ConcurrentInsertState::kKeysPerWriter;
+    for (uint64_t i = 0; i < n; i++) {
+      uint64_t k = (i * 7919) % n;
+      state->list_.InsertConcurrently(k * ConcurrentInsertState::kWriters +
+                                      id);
+    }
+  }
+  state->Done();
+}
+
+TEST(SkipTest, ConcurrentInsert) {
+  ConcurrentInsertState state;
+  Env::Default()->StartThread(ConcurrentInserter, &state);  // Reader
+  for (int i = 0; i < ConcurrentInsertState::kWriters; i++) {
+    Env::Default()->StartThread(ConcurrentInserter, &state);
+  }
+  // Wait for the writers, then stop the reader.
+  while (true) {
+    int inserted = 0;
+    SkipList<Key, Comparator>::Iterator iter(&state.list_);
+    for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+      inserted++;
+    }
+    if (inserted == ConcurrentInsertState::kWriters *
+                    ConcurrentInsertState::kKeysPerWriter) {
+      break;
+    }
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  state.quit_flag_.Release_Store(&state);
+  state.WaitForAll();
+
+  SkipList<Key, Comparator>::Iterator iter(&state.list_);
+  iter.SeekToFirst();
+  for (Key k = 0; k < static_cast<Key>(ConcurrentInsertState::kWriters *
+                                       ConcurrentInsertState::kKeysPerWriter);
+       k++) {
+    ASSERT_TRUE(iter.Valid());
+    ASSERT_EQ(k, iter.key());
+    ASSERT_TRUE(state.list_.Contains(k));
+    iter.Next();
+  }
+  ASSERT_TRUE(!iter.Valid());
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
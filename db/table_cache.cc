@@ -4,20 +4,26 @@
 
 #include "db/table_cache.h"
 
+#include <vector>
+
 #include "db/filename.h"
 #include "leveldb/env.h"
 #include "leveldb/table.h"
 #include "util/coding.h"
+#include "util/perf_context.h"
+#include "util/readahead_file.h"
 
 namespace leveldb {
 
 struct TableAndFile {
   RandomAccessFile* file;
   Table* table;
+  RangeTombstoneList* range_dels;  // nullptr if the table has none
 };
 
 static void DeleteEntry(const Slice& key, void* value) {
   TableAndFile* tf = reinterpret_cast<TableAndFile*>(value);
+  delete tf->range_dels;
   delete tf->table;
   delete tf->file;
   delete tf;
@@ -35,6 +41,8 @@ TableCache::TableCache(const std::string& dbname,
     : env_(options.env),
       dbname_(dbname),
       options_(options),
+      block_cache_id_(options.block_cache != nullptr
+                      ? options.block_cache->NewId() : 0),
       cache_(NewLRUCache(entries)) {
 }
 
@@ -42,29 +50,64 @@ TableCache::~TableCache() {
   delete cache_;
 }
 
+const Comparator* TableCache::user_comparator() const {
+  // The DB always opens tables with its InternalKeyComparator
+  return static_cast<const InternalKeyComparator*>(options_.comparator)
+      ->user_comparator();
+}
+
+Status TableCache::OpenTableFile(uint64_t file_number, bool direct,
+                                 RandomAccessFile** file) {
+  std::string fname = TableFileName(dbname_, file_number);//x.ldb
+  Status s = direct ? env_->NewDirectRandomAccessFile(fname, file)
+                    : env_->NewRandomAccessFile(fname, file);
+  if (!s.ok()) {
+    std::string old_fname = SSTTableFileName(dbname_, file_number);//x.sst
+    Status old_s = direct ? env_->NewDirectRandomAccessFile(old_fname, file)
+                          : env_->NewRandomAccessFile(old_fname, file);
+    if (old_s.ok()) {
+      s = Status::OK();
+    }
+  }
+  return s;
+}
+
 //查找file_number对应的sst是否在缓存中，如果存在则直接返回缓存的值
 //否则打开对一个的sst，填充到缓存并且返回
 //handle里存储的对应的value(类型为TableAndFile*)
 Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
-                             Cache::Handle** handle) {
+                             int level, Cache::Handle** handle) {
+  PerfTimer timer(&PerfContext::find_table_nanos);
+  timer.Start();
   Status s;
   char buf[sizeof(file_number)];
   EncodeFixed64(buf, file_number);
   Slice key(buf, sizeof(buf));
   *handle = cache_->Lookup(key);
   if (*handle == nullptr) {
-    std::string fname = TableFileName(dbname_, file_number);//x.ldb
     RandomAccessFile* file = nullptr;
     Table* table = nullptr;
-    s = env_->NewRandomAccessFile(fname, &file);
-    if (!s.ok()) {
-      std::string old_fname = SSTTableFileName(dbname_, file_number);//x.sst
-      if (env_->NewRandomAccessFile(old_fname, &file).ok()) {
-        s = Status::OK();
-      }
+    s = OpenTableFile(file_number, options_.use_direct_reads, &file);
+    if (s.ok()) {
+      s = Table::Open(options_, file, file_size, block_cache_id_, file_number,
+                      level, &table);
     }
+    RangeTombstoneList* range_dels = nullptr;
     if (s.ok()) {
-      s = Table::Open(options_, file, file_size, &table);
+      // Parse the range tombstones once for every lookup in the table
+      range_dels = new RangeTombstoneList(user_comparator());
+      Iterator* iter = table->NewRangeDeletionIterator(ReadOptions());
+      s = range_dels->AddAll(iter);
+      delete iter;
+      range_dels->Finish();
+      if (!s.ok() || range_dels->empty()) {
+        delete range_dels;
+        range_dels = nullptr;
+      }
+      if (!s.ok()) {
+        delete table;
+        table = nullptr;
+      }
     }
 
     if (!s.ok()) {
@@ -76,6 +119,7 @@ Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
       TableAndFile* tf = new TableAndFile;
       tf->file = file;
       tf->table = table;
+      tf->range_dels = range_dels;
       *handle = cache_->Insert(key, tf, 1, &DeleteEntry);
     }
   }
@@ -85,13 +129,14 @@ Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
 Iterator* TableCache::NewIterator(const ReadOptions& options,
                                   uint64_t file_number,
                                   uint64_t file_size,
-                                  Table** tableptr) {
+                                  Table** tableptr,
+                                  int level) {
   if (tableptr != nullptr) {
     *tableptr = nullptr;
   }
 
   Cache::Handle* handle = nullptr;
-  Status s = FindTable(file_number, file_size, &handle);
+  Status s = FindTable(file_number, file_size, level, &handle);
   if (!s.ok()) {
     return NewErrorIterator(s);
   }
@@ -105,27 +150,205 @@ Iterator* TableCache::NewIterator(const ReadOptions& options,
   return result;
 }
 
+static void DeleteTableAndFile(void* arg1, void* arg2) {
+  delete reinterpret_cast<Table*>(arg1);
+  delete reinterpret_cast<RandomAccessFile*>(arg2);
+}
+
+Iterator* TableCache::NewCompactionIterator(const ReadOptions& options,
+                                            uint64_t file_number,
+                                            uint64_t file_size) {
+  const bool direct = options_.use_direct_io_for_flush_and_compaction;
+  if ((!direct || options_.use_direct_reads) &&
+      options_.compaction_readahead_size == 0) {
+    return NewIterator(options, file_number, file_size);
+  }
+
+  // A private table, so that the compaction does not share the file (and
+  // its page cache use) with user reads.
+  RandomAccessFile* file = nullptr;
+  Table* table = nullptr;
+  Status s = OpenTableFile(file_number, direct, &file);
+  if (s.ok()) {
+    file->Hint(RandomAccessFile::kSequential);
+    if (options_.compaction_readahead_size > 0) {
+      file = NewReadaheadRandomAccessFile(file,
+                                          options_.compaction_readahead_size);
+    }
+    s = Table::Open(options_, file, file_size, block_cache_id_, file_number,
+                    -1, &table);
+  }
+  if (!s.ok()) {
+    delete file;
+    return NewErrorIterator(s);
+  }
+  Iterator* result = table->NewIterator(options);
+  result->RegisterCleanup(&DeleteTableAndFile, table, file);
+  return result;
+}
+
+namespace {
+
+// Sits between Table::InternalGet() and the caller's handler to apply
+// the table's range tombstones to one lookup.
+struct TombstoneSaver {
+  void* arg;
+  void (*saver)(void*, const Slice&, const Slice&);
+  const Comparator* ucmp;
+  Slice user_key;
+  SequenceNumber covering;   // From MaxCoveringSequence(), or zero
+  bool called;
+};
+
+// Pass the entry found by the table on unless it is hidden.
+void SaveUnlessCovered(void* arg, const Slice& k, const Slice& v) {
+  TombstoneSaver* s = reinterpret_cast<TombstoneSaver*>(arg);
+  s->called = true;
+  ParsedInternalKey parsed;
+  if (s->covering == 0 || !ParseInternalKey(k, &parsed) ||
+      (parsed.sequence > s->covering &&
+       s->ucmp->Compare(parsed.user_key, s->user_key) == 0)) {
+    (*s->saver)(s->arg, k, v);
+  } else {
+    InternalKey deletion(s->user_key, s->covering, kTypeDeletion);
+    (*s->saver)(s->arg, deletion.Encode(), Slice());
+  }
+}
+
+// Report a covered key that the table did not find at all.
+void FinishTombstoneSaver(TombstoneSaver* s) {
+  if (!s->called && s->covering != 0) {
+    InternalKey deletion(s->user_key, s->covering, kTypeDeletion);
+    (*s->saver)(s->arg, deletion.Encode(), Slice());
+  }
+}
+
+void InitTombstoneSaver(TombstoneSaver* s, const RangeTombstoneList* l,
+                        const Slice& k, void* arg,
+                        void (*saver)(void*, const Slice&, const Slice&),
+                        const Comparator* ucmp) {
+  s->arg = arg;
+  s->saver = saver;
+  s->ucmp = ucmp;
+  s->user_key = ExtractUserKey(k);
+  s->covering = l->MaxCoveringSequence(
+      s->user_key, DecodeFixed64(k.data() + k.size() - 8) >> 8);
+  s->called = false;
+}
+
+}  // namespace
+
 Status TableCache::Get(const ReadOptions& options,
                        uint64_t file_number,
                        uint64_t file_size,
                        const Slice& k,
                        void* arg,
-                       void (*saver)(void*, const Slice&, const Slice&)) {
+                       void (*saver)(void*, const Slice&, const Slice&),
+                       int level) {
   Cache::Handle* handle = nullptr;
-  Status s = FindTable(file_number, file_size, &handle);
+  Status s = FindTable(file_number, file_size, level, &handle);
   if (s.ok()) {
     //file_number对应唯一的sst文件，t用于读取该文件
-    Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
-    s = t->InternalGet(options, k, arg, saver);
+    TableAndFile* tf = reinterpret_cast<TableAndFile*>(cache_->Value(handle));
+    Table* t = tf->table;
+    if (tf->range_dels == nullptr) {
+      s = t->InternalGet(options, k, arg, saver);
+    } else {
+      TombstoneSaver ts;
+      InitTombstoneSaver(&ts, tf->range_dels, k, arg, saver,
+                         user_comparator());
+      s = t->InternalGet(options, k, &ts, SaveUnlessCovered);
+      if (s.ok()) {
+        FinishTombstoneSaver(&ts);
+      }
+    }
+    cache_->Release(handle);
+  }
+  return s;
+}
+
+void TableCache::MultiGet(const ReadOptions& options,
+                          uint64_t file_number,
+                          uint64_t file_size,
+                          int n,
+                          const Slice* keys,
+                          void* const* args,
+                          void (*saver)(void*, const Slice&, const Slice&),
+                          Status* statuses,
+                          int level) {
+  Cache::Handle* handle = nullptr;
+  Status s = FindTable(file_number, file_size, level, &handle);
+  if (!s.ok()) {
+    for (int i = 0; i < n; i++) {
+      statuses[i] = s;
+    }
+    return;
+  }
+  TableAndFile* tf = reinterpret_cast<TableAndFile*>(cache_->Value(handle));
+  Table* t = tf->table;
+  if (tf->range_dels == nullptr) {
+    t->InternalMultiGet(options, n, keys, args, saver, statuses);
+  } else {
+    std::vector<TombstoneSaver> savers(n);
+    std::vector<void*> saver_args(n);
+    for (int i = 0; i < n; i++) {
+      InitTombstoneSaver(&savers[i], tf->range_dels, keys[i], args[i], saver,
+                         user_comparator());
+      saver_args[i] = &savers[i];
+    }
+    t->InternalMultiGet(options, n, keys, &saver_args[0], SaveUnlessCovered,
+                        statuses);
+    for (int i = 0; i < n; i++) {
+      if (statuses[i].ok()) {
+        FinishTombstoneSaver(&savers[i]);
+      }
+    }
+  }
+  cache_->Release(handle);
+}
+
+Status TableCache::AddRangeTombstones(uint64_t file_number,
+                                      uint64_t file_size,
+                                      RangeTombstoneList* list) {
+  Cache::Handle* handle = nullptr;
+  Status s = FindTable(file_number, file_size, -1, &handle);
+  if (s.ok()) {
+    TableAndFile* tf = reinterpret_cast<TableAndFile*>(cache_->Value(handle));
+    if (tf->range_dels != nullptr) {
+      list->AddList(*tf->range_dels);
+    }
     cache_->Release(handle);
   }
   return s;
 }
 
-void TableCache::Evict(uint64_t file_number) {
+bool TableCache::PrefixMayMatch(uint64_t file_number,
+                                uint64_t file_size,
+                                const Slice& target) {
+  Cache::Handle* handle = nullptr;
+  Status s = FindTable(file_number, file_size, -1, &handle);
+  if (!s.ok()) {
+    // Let the iterator report the error
+    return true;
+  }
+  Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+  bool may_match = t->PrefixMayMatch(target);
+  cache_->Release(handle);
+  return may_match;
+}
+
+void TableCache::Evict(uint64_t file_number, bool deleting) {
   char buf[sizeof(file_number)];
   EncodeFixed64(buf, file_number);
-  cache_->Erase(Slice(buf, sizeof(buf)));
+  Slice key(buf, sizeof(buf));
+  Cache::Handle* handle = deleting ? cache_->Lookup(key) : nullptr;
+  if (handle != nullptr) {
+    // Iterators may keep the file open past its deletion
+    reinterpret_cast<TableAndFile*>(cache_->Value(handle))->file->Hint(
+        RandomAccessFile::kDontNeed);
+    cache_->Release(handle);
+  }
+  cache_->Erase(key);
 }
 
 }  // namespace leveldb
@@ -10,6 +10,7 @@
 #include <string>
 #include <stdint.h>
 #include "db/dbformat.h"
+#include "db/range_del.h"
 #include "leveldb/cache.h"
 #include "leveldb/table.h"
 #include "port/port.h"
@@ -30,30 +31,85 @@ class TableCache {
   // underlies the returned iterator.  The returned "*tableptr" object is owned
   // by the cache and should not be deleted, and is valid for as long as the
   // returned iterator is live.
+  //
+  // "level" is the level of the file, or -1 if it is not known.  If the
+  // file has to be opened, it decides whether the table pins its index
+  // and filter blocks (see Options::pin_l0_filter_and_index_blocks).
   Iterator* NewIterator(const ReadOptions& options,
                         uint64_t file_number,
                         uint64_t file_size,
-                        Table** tableptr = nullptr);
+                        Table** tableptr = nullptr,
+                        int level = -1);
+
+  // Like NewIterator(), for a compaction that reads the whole file once.
+  // If the compaction reads differently from user reads (with direct I/O
+  // under options.use_direct_io_for_flush_and_compaction, or with
+  // options.compaction_readahead_size), the file is opened anew for the
+  // returned iterator instead of being looked up in the cache, and is
+  // advised of the sequential access.
+  Iterator* NewCompactionIterator(const ReadOptions& options,
+                                  uint64_t file_number,
+                                  uint64_t file_size);
 
   // If a seek to internal key "k" in specified file finds an entry,
-  // call (*handle_result)(arg, found_key, found_value).
+  // call (*handle_result)(arg, found_key, found_value).  If a range
+  // tombstone of the file hides the entry (or any entry for the user key
+  // of "k" that the file may lack), a deletion at the tombstone's
+  // sequence number is passed instead.  "level" is as for NewIterator().
   Status Get(const ReadOptions& options,
              uint64_t file_number,
              uint64_t file_size,
              const Slice& k,
              void* arg,
-             void (*handle_result)(void*, const Slice&, const Slice&));
+             void (*handle_result)(void*, const Slice&, const Slice&),
+             int level = -1);
+
+  // Batched form of Get() for internal keys[0,n-1], sorted in ascending
+  // order.  Looks the file up in the cache only once for all keys, calls
+  // (*handle_result)(args[i], found_key, found_value) for every key that
+  // finds an entry and stores the status of each lookup in statuses[i].
+  void MultiGet(const ReadOptions& options,
+                uint64_t file_number,
+                uint64_t file_size,
+                int n,
+                const Slice* keys,
+                void* const* args,
+                void (*handle_result)(void*, const Slice&, const Slice&),
+                Status* statuses,
+                int level = -1);
+
+  // Add the range tombstones of the specified file to *list.
+  Status AddRangeTombstones(uint64_t file_number,
+                            uint64_t file_size,
+                            RangeTombstoneList* list);
+
+  // Return false only if the specified file holds no key that is >= the
+  // internal key "target" and shares its prefix under
+  // options.prefix_extractor.  Reads at most the index and filter blocks
+  // of the file; errors are reported as a possible match.
+  bool PrefixMayMatch(uint64_t file_number,
+                      uint64_t file_size,
+                      const Slice& target);
 
-  // Evict any entry for the specified file number
-  void Evict(uint64_t file_number);
+  // Evict any entry for the specified file number.  If "deleting" is
+  // true, the file is about to be deleted and its open file is advised
+  // to drop its data from the page cache.
+  void Evict(uint64_t file_number, bool deleting = false);
 
  private:
   Env* const env_;
   const std::string dbname_;
   const Options& options_;
+  // Id from options_.block_cache->NewId() that, with the file number,
+  // keys the cached blocks of every table of the DB.
+  const uint64_t block_cache_id_;
   Cache* cache_;
 
-  Status FindTable(uint64_t file_number, uint64_t file_size, Cache::Handle**);
+  Status OpenTableFile(uint64_t file_number, bool direct,
+                       RandomAccessFile** file);
+  Status FindTable(uint64_t file_number, uint64_t file_size, int level,
+                   Cache::Handle**);
+  const Comparator* user_comparator() const;
 };
 
 }  // namespace leveldb
@@ -39,6 +39,29 @@ TEST(VersionEditTest, EncodeDecode) {
   TestEncodeDecode(edit);
 }
 
+TEST(VersionEditTest, RangeDeletions) {
+  VersionEdit edit;
+  edit.AddFile(1, 10, 1000,
+               InternalKey("a", 5, kTypeRangeDeletion),
+               InternalKey("m", kMaxSequenceNumber, kTypeRangeDeletion),
+               true);
+  edit.AddFile(1, 11, 1000,
+               InternalKey("n", 6, kTypeValue),
+               InternalKey("z", 7, kTypeValue));
+  TestEncodeDecode(edit);
+
+  std::string encoded;
+  edit.EncodeTo(&encoded);
+  VersionEdit parsed;
+  ASSERT_OK(parsed.DecodeFrom(encoded));
+  // Only the first file is flagged
+  const std::string debug = parsed.DebugString();
+  const size_t flag = debug.find(" (range deletions)");
+  ASSERT_TRUE(flag != std::string::npos) << debug;
+  ASSERT_LT(flag, debug.find("AddFile: 1 11 "));
+  ASSERT_EQ(std::string::npos, debug.find(" (range deletions)", flag + 1));
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
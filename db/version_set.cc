@@ -10,6 +10,7 @@
 #include "db/log_reader.h"
 #include "db/log_writer.h"
 #include "db/memtable.h"
+#include "db/range_del.h"
 #include "db/table_cache.h"
 #include "leveldb/env.h"
 #include "leveldb/table_builder.h"
@@ -17,6 +18,9 @@
 #include "table/two_level_iterator.h"
 #include "util/coding.h"
 #include "util/logging.h"
+#include "util/mutexlock.h"
+#include "util/perf_context.h"
+#include "util/statistics.h"
 
 namespace leveldb {
 
@@ -82,6 +86,7 @@ Version::~Version() {
       }
     }
   }
+  delete range_dels_;
 }
 
 //二分查找第一个满足条件的file:file->largest>=key，如果key存在于files，那么一定存在于该file
@@ -249,11 +254,41 @@ static Iterator* GetFileIterator(void* arg,
   }
 }
 
+static Iterator* GetCompactionFileIterator(void* arg,
+                                           const ReadOptions& options,
+                                           const Slice& file_value) {
+  TableCache* cache = reinterpret_cast<TableCache*>(arg);
+  if (file_value.size() != 16) {
+    return NewErrorIterator(
+        Status::Corruption("FileReader invoked with unexpected value"));
+  } else {
+    return cache->NewCompactionIterator(options,
+                                        DecodeFixed64(file_value.data()),
+                                        DecodeFixed64(file_value.data() + 8));
+  }
+}
+
+static bool FileMayHoldPrefix(void* arg,
+                              const Slice& file_key,
+                              const Slice& file_value,
+                              const Slice& target) {
+  TableCache* cache = reinterpret_cast<TableCache*>(arg);
+  if (file_value.size() != 16) {
+    // GetFileIterator() reports the corruption
+    return true;
+  }
+  return cache->PrefixMayMatch(DecodeFixed64(file_value.data()),
+                               DecodeFixed64(file_value.data() + 8),
+                               target);
+}
+
 Iterator* Version::NewConcatenatingIterator(const ReadOptions& options,
                                             int level) const {
   return NewTwoLevelIterator(
       new LevelFileNumIterator(vset_->icmp_, &files_[level]),
-      &GetFileIterator, vset_->table_cache_, options);
+      &GetFileIterator, vset_->table_cache_, options,
+      vset_->options_->prefix_extractor != nullptr ? &FileMayHoldPrefix
+                                                   : nullptr);
 }
 
 void Version::AddIterators(const ReadOptions& options,
@@ -262,7 +297,8 @@ void Version::AddIterators(const ReadOptions& options,
   for (size_t i = 0; i < files_[0].size(); i++) {
     iters->push_back(
         vset_->table_cache_->NewIterator(
-            options, files_[0][i]->number, files_[0][i]->file_size));
+            options, files_[0][i]->number, files_[0][i]->file_size,
+            nullptr, 0));
   }
 
   // For levels > 0, we can use a concatenating iterator that sequentially
@@ -275,6 +311,39 @@ void Version::AddIterators(const ReadOptions& options,
   }
 }
 
+Status Version::GetRangeTombstones(const RangeTombstoneList** list) {
+  MutexLock l(&range_dels_mu_);
+  if (!range_dels_built_) {
+    RangeTombstoneList* all =
+        new RangeTombstoneList(vset_->icmp_.user_comparator());
+    Status s;
+    for (int level = 0; level < config::kNumLevels && s.ok(); level++) {
+      for (size_t i = 0; i < files_[level].size() && s.ok(); i++) {
+        FileMetaData* f = files_[level][i];
+        if (f->has_range_deletions) {
+          s = vset_->table_cache_->AddRangeTombstones(f->number, f->file_size,
+                                                      all);
+        }
+      }
+    }
+    if (!s.ok()) {
+      // Try again on the next call
+      delete all;
+      *list = nullptr;
+      return s;
+    }
+    all->Finish();
+    if (all->empty()) {
+      delete all;
+      all = nullptr;
+    }
+    range_dels_ = all;
+    range_dels_built_ = true;
+  }
+  *list = range_dels_;
+  return Status::OK();
+}
+
 // Callback from TableCache::Get()
 namespace {
 enum SaverState {
@@ -310,6 +379,13 @@ static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
   }
 }
 
+// Return the Statistics that lookups which find their key in a table
+// should count as filter true positives, or nullptr if tables have no
+// filters.
+static Statistics* FilterStatistics(const Options* options) {
+  return options->filter_policy != nullptr ? options->statistics : nullptr;
+}
+
 static bool NewestFirst(FileMetaData* a, FileMetaData* b) {
   return a->number > b->number;
 }
@@ -452,8 +528,9 @@ Status Version::Get(const ReadOptions& options,
       saver.value = value;//当读取成功时，存储读取到的value
       //读取f->number对应的文件，查找ikey对应的value
       //如果ikey存在，则执行SaveValue(&saver, ikey, value)
+      PerfCount(&PerfContext::file_probe_count);
       s = vset_->table_cache_->Get(options, f->number, f->file_size,
-                                   ikey, &saver, SaveValue);
+                                   ikey, &saver, SaveValue, level);
       if (!s.ok()) {
         return s;
       }
@@ -463,8 +540,12 @@ Status Version::Get(const ReadOptions& options,
           // 没有发现，则继续下一层查找
           break;      // Keep searching in other files
         case kFound:
+          RecordTick(FilterStatistics(vset_->options_),
+                     kBloomFilterTruePositive);
           return s;
         case kDeleted:
+          RecordTick(FilterStatistics(vset_->options_),
+                     kBloomFilterTruePositive);
           s = Status::NotFound(Slice());  // Use empty error message for speed
           return s;
         case kCorrupt:
@@ -477,6 +558,175 @@ Status Version::Get(const ReadOptions& options,
   return Status::NotFound(Slice());  // Use an empty error message for speed
 }
 
+// State kept by Version::MultiGet() for each request across levels.
+namespace {
+struct MultiGetState {
+  Version::GetRequest* req;
+  Saver saver;
+  FileMetaData* last_file_read;
+  int last_file_read_level;
+  bool done;
+};
+}
+
+// Probe file "f" at "level" with every request in "batch" (sorted by
+// user key) in one go, and mark the requests that the file resolves.
+// Found keys are counted as filter true positives in "filter_stats".
+static void MultiGetFromFile(TableCache* table_cache,
+                             Statistics* filter_stats,
+                             const ReadOptions& options,
+                             int level, FileMetaData* f,
+                             const std::vector<MultiGetState*>& batch) {
+  const size_t n = batch.size();
+  PerfCount(&PerfContext::file_probe_count);
+  std::vector<Slice> ikeys(n);
+  std::vector<void*> args(n);
+  std::vector<Status> statuses(n);
+  for (size_t i = 0; i < n; i++) {
+    MultiGetState* state = batch[i];
+    Version::GetStats* stats = &state->req->stats;
+    if (state->last_file_read != nullptr && stats->seek_file == nullptr) {
+      // We have had more than one seek for this read.  Charge the 1st file.
+      stats->seek_file = state->last_file_read;
+      stats->seek_file_level = state->last_file_read_level;
+    }
+    state->last_file_read = f;
+    state->last_file_read_level = level;
+    state->saver.state = kNotFound;
+    ikeys[i] = state->req->key->internal_key();
+    args[i] = &state->saver;
+  }
+
+  table_cache->MultiGet(options, f->number, f->file_size, n,
+                        &ikeys[0], &args[0], SaveValue, &statuses[0], level);
+
+  for (size_t i = 0; i < n; i++) {
+    MultiGetState* state = batch[i];
+    if (!statuses[i].ok()) {
+      state->req->status = statuses[i];
+      state->done = true;
+      continue;
+    }
+    switch (state->saver.state) {
+      case kNotFound:
+        break;      // Keep searching in other files
+      case kFound:
+        RecordTick(filter_stats, kBloomFilterTruePositive);
+        state->req->status = Status::OK();
+        state->done = true;
+        break;
+      case kDeleted:
+        RecordTick(filter_stats, kBloomFilterTruePositive);
+        state->req->status = Status::NotFound(Slice());
+        state->done = true;
+        break;
+      case kCorrupt:
+        state->req->status =
+            Status::Corruption("corrupted key for ", state->saver.user_key);
+        state->done = true;
+        break;
+    }
+  }
+}
+
+void Version::MultiGet(const ReadOptions& options,
+                       const std::vector<GetRequest*>& reqs) {
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+  std::vector<MultiGetState> states(reqs.size());
+  std::vector<MultiGetState*> pending;
+  pending.reserve(reqs.size());
+  for (size_t i = 0; i < reqs.size(); i++) {
+    MultiGetState* state = &states[i];
+    state->req = reqs[i];
+    state->req->stats.seek_file = nullptr;
+    state->req->stats.seek_file_level = -1;
+    state->saver.ucmp = ucmp;
+    state->saver.user_key = reqs[i]->key->user_key();
+    state->saver.value = reqs[i]->value;
+    state->last_file_read = nullptr;
+    state->last_file_read_level = -1;
+    state->done = false;
+    pending.push_back(state);
+  }
+
+  // As in Get(), search level-by-level: a key resolved in a smaller level
+  // is never looked up in later ones.
+  std::vector<MultiGetState*> batch;
+  for (int level = 0; level < config::kNumLevels && !pending.empty();
+       level++) {
+    const std::vector<FileMetaData*>& files = files_[level];
+    if (files.empty()) continue;
+
+    if (level == 0) {
+      // Level-0 files may overlap each other.  Visit them from newest to
+      // oldest and probe each one with the unresolved keys in its range.
+      std::vector<FileMetaData*> tmp(files);
+      std::sort(tmp.begin(), tmp.end(), NewestFirst);
+      for (size_t j = 0; j < tmp.size(); j++) {
+        FileMetaData* f = tmp[j];
+        batch.clear();
+        for (size_t i = 0; i < pending.size(); i++) {
+          MultiGetState* state = pending[i];
+          if (!state->done &&
+              ucmp->Compare(state->saver.user_key,
+                            f->smallest.user_key()) >= 0 &&
+              ucmp->Compare(state->saver.user_key,
+                            f->largest.user_key()) <= 0) {
+            batch.push_back(state);
+          }
+        }
+        if (!batch.empty()) {
+          MultiGetFromFile(vset_->table_cache_,
+                           FilterStatistics(vset_->options_), options, 0, f,
+                           batch);
+        }
+      }
+    } else {
+      // Both the files of this level and the keys are sorted, so walk
+      // them in step and hand each file all of its keys at once.
+      size_t i = 0;
+      while (i < pending.size()) {
+        Slice ikey = pending[i]->req->key->internal_key();
+        uint32_t index = FindFile(vset_->icmp_, files, ikey);
+        if (index >= files.size()) {
+          break;  // This key and all later ones are past the last file
+        }
+        FileMetaData* f = files[index];
+        batch.clear();
+        for (; i < pending.size(); i++) {
+          MultiGetState* state = pending[i];
+          if (vset_->icmp_.Compare(state->req->key->internal_key(),
+                                   f->largest.Encode()) > 0) {
+            break;
+          }
+          if (ucmp->Compare(state->saver.user_key,
+                            f->smallest.user_key()) >= 0) {
+            batch.push_back(state);
+          }
+        }
+        if (!batch.empty()) {
+          MultiGetFromFile(vset_->table_cache_,
+                           FilterStatistics(vset_->options_), options, level,
+                           f, batch);
+        }
+      }
+    }
+
+    // Drop the requests resolved at this level
+    size_t live = 0;
+    for (size_t i = 0; i < pending.size(); i++) {
+      if (!pending[i]->done) {
+        pending[live++] = pending[i];
+      }
+    }
+    pending.resize(live);
+  }
+
+  for (size_t i = 0; i < pending.size(); i++) {
+    pending[i]->req->status = Status::NotFound(Slice());
+  }
+}
+
 bool Version::UpdateStats(const GetStats& stats) {
   FileMetaData* f = stats.seek_file;
   if (f != nullptr) {
@@ -573,6 +823,12 @@ int Version::PickLevelForMemTableOutput(
       if (OverlapInLevel(level + 1, &smallest_user_key, &largest_user_key)) {
         break;
       }
+      // A running compaction may still add files to level + 1 in this
+      // range, or depend on its contents not changing.
+      if (vset_->RangeInCompaction(level + 1, smallest_user_key,
+                                   largest_user_key)) {
+        break;
+      }
       if (level + 2 < config::kNumLevels) {
         //如果level + 2(下两层)的文件与key range有重叠的文件大小超过20M
         //目的是避免放入level + 1层后，与level + 2 compact时文件过大
@@ -1192,7 +1448,7 @@ void VersionSet::Finalize(Version* v) {
       // setting, or very high compression ratios, or lots of
       // overwrites/deletions).
       score = v->files_[level].size() /
-          static_cast<double>(config::kL0_CompactionTrigger);
+          static_cast<double>(options_->level0_file_num_compaction_trigger);
     } else {
       // Compute the ratio of current size to size limit.
       const uint64_t level_bytes = TotalFileSize(v->files_[level]);
@@ -1200,6 +1456,7 @@ void VersionSet::Finalize(Version* v) {
           static_cast<double>(level_bytes) / MaxBytesForLevel(options_, level);
     }
 
+    v->level_scores_[level] = score;
     if (score > best_score) {
       best_level = level;
       best_score = score;
@@ -1208,6 +1465,29 @@ void VersionSet::Finalize(Version* v) {
 
   v->compaction_level_ = best_level;
   v->compaction_score_ = best_score;
+
+  // Estimate the bytes pending compaction: a compaction of level-0 rewrites
+  // its files and level-1, and every byte that a level holds beyond its
+  // limit is rewritten together with its share of the next level.
+  uint64_t pending = 0;
+  uint64_t incoming = 0;
+  if (v->files_[0].size() >=
+      static_cast<size_t>(options_->level0_file_num_compaction_trigger)) {
+    incoming = TotalFileSize(v->files_[0]);
+    pending += incoming + TotalFileSize(v->files_[1]);
+  }
+  for (int level = 1; level < config::kNumLevels - 1; level++) {
+    const uint64_t level_bytes = TotalFileSize(v->files_[level]) + incoming;
+    const double limit = MaxBytesForLevel(options_, level);
+    if (level_bytes <= limit) {
+      incoming = 0;
+      continue;
+    }
+    incoming = level_bytes - static_cast<uint64_t>(limit);
+    const double fanout = MaxBytesForLevel(options_, level + 1) / limit;
+    pending += static_cast<uint64_t>(incoming * (fanout + 1));
+  }
+  v->pending_compaction_bytes_ = pending;
 }
 
 //记录comparator_name、compact_pointer、每一层的每个文件信息
@@ -1233,7 +1513,8 @@ Status VersionSet::WriteSnapshot(log::Writer* log) {
     const std::vector<FileMetaData*>& files = current_->files_[level];
     for (size_t i = 0; i < files.size(); i++) {
       const FileMetaData* f = files[i];
-      edit.AddFile(level, f->number, f->file_size, f->smallest, f->largest);
+      edit.AddFile(level, f->number, f->file_size, f->smallest, f->largest,
+                   f->has_range_deletions);
     }
   }
 
@@ -1384,21 +1665,25 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
   Iterator** list = new Iterator*[space];
   int num = 0;
   for (int which = 0; which < 2; which++) {
-    if (!c->inputs_[which].empty()) {
+    const std::vector<FileMetaData*>* inputs = &c->inputs_[which];
+    if (which == 1 && c->skipped_inputs_) {
+      inputs = &c->read_inputs_;
+    }
+    if (!inputs->empty()) {
       //第0层
       if (c->level() + which == 0) {
-        const std::vector<FileMetaData*>& files = c->inputs_[which];
+        const std::vector<FileMetaData*>& files = *inputs;
         // Iterator* Table::NewIterator
         for (size_t i = 0; i < files.size(); i++) {
-          list[num++] = table_cache_->NewIterator(
+          list[num++] = table_cache_->NewCompactionIterator(
               options, files[i]->number, files[i]->file_size);
         }
       } else {
         // Create concatenating iterator for the files from this level
         list[num++] = NewTwoLevelIterator(
             // 遍历文件列表的iterator
-            new Version::LevelFileNumIterator(icmp_, &c->inputs_[which]),
-            &GetFileIterator, table_cache_, options);
+            new Version::LevelFileNumIterator(icmp_, inputs),
+            &GetCompactionFileIterator, table_cache_, options);
       }
     }
   }
@@ -1410,42 +1695,69 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
 
 //选取一层需要compact的文件列表，及相关的下层文件列表，记录在Compaction*
 Compaction* VersionSet::PickCompaction() {
-  Compaction* c;
-  int level;
+  Compaction* c = nullptr;
 
   // We prefer compactions triggered by too much data in a level over
   // the compactions triggered by seeks.
-  const bool size_compaction = (current_->compaction_score_ >= 1);//文件数过多
-  const bool seek_compaction = (current_->file_to_compact_ != nullptr);//seek了多次文件但是没有查到，记录到的file_to_compact_
-  if (size_compaction) {
-    //该层第一个>compact_pointer_的文件，或者第一个文件
-    level = current_->compaction_level_;
-    assert(level >= 0);
-    assert(level+1 < config::kNumLevels);
-    c = new Compaction(options_, level);
-
-    // Pick the first file that comes after compact_pointer_[level]
-    for (size_t i = 0; i < current_->files_[level].size(); i++) {
-      FileMetaData* f = current_->files_[level][i];
-      if (compact_pointer_[level].empty() ||
-          icmp_.Compare(f->largest.Encode(), compact_pointer_[level]) > 0) {
-        c->inputs_[0].push_back(f);
-        break;
+  //
+  // Levels that need a size compaction are tried from the highest score
+  // down, and within a level files are tried starting after
+  // compact_pointer_[level], so that compactions that are already
+  // running only divert us to the next best candidate.
+  int levels[config::kNumLevels - 1];
+  int num_levels = 0;
+  for (int level = 0; level < config::kNumLevels - 1; level++) {
+    const double score = current_->level_scores_[level];
+    if (score < 1) {
+      continue;
+    }
+    int i = num_levels++;
+    while (i > 0 && current_->level_scores_[levels[i - 1]] < score) {
+      levels[i] = levels[i - 1];
+      i--;
+    }
+    levels[i] = level;
+  }
+
+  for (int n = 0; n < num_levels && c == nullptr; n++) {
+    const int level = levels[n];
+    const std::vector<FileMetaData*>& files = current_->files_[level];
+
+    // Pick the first file that comes after compact_pointer_[level],
+    // wrapping around to the beginning of the key space
+    size_t first = 0;
+    if (!compact_pointer_[level].empty()) {
+      while (first < files.size() &&
+             icmp_.Compare(files[first]->largest.Encode(),
+                           compact_pointer_[level]) <= 0) {
+        first++;
+      }
+      if (first == files.size()) {
+        first = 0;
       }
     }
-    if (c->inputs_[0].empty()) {
-      // Wrap-around to the beginning of the key space
-      c->inputs_[0].push_back(current_->files_[level][0]);
+    for (size_t i = 0; i < files.size() && c == nullptr; i++) {
+      c = SetupCompaction(level, files[(first + i) % files.size()]);
     }
-  } else if (seek_compaction) {
+  }
+
+  if (c == nullptr && current_->file_to_compact_ != nullptr) {
     //直接填入之前记录的file_to_compact_
-    level = current_->file_to_compact_level_;
-    c = new Compaction(options_, level);
-    c->inputs_[0].push_back(current_->file_to_compact_);
-  } else {
-    return nullptr;
+    c = SetupCompaction(current_->file_to_compact_level_,
+                        current_->file_to_compact_);
   }
 
+  if (c != nullptr) {
+    StartCompaction(c);
+  }
+  return c;
+}
+
+Compaction* VersionSet::SetupCompaction(int level, FileMetaData* f) {
+  assert(level >= 0);
+  assert(level+1 < config::kNumLevels);
+  Compaction* c = new Compaction(options_, level);
+  c->inputs_[0].push_back(f);
   c->input_version_ = current_;
   c->input_version_->Ref();
 
@@ -1466,9 +1778,66 @@ Compaction* VersionSet::PickCompaction() {
   //此时c->inputs_[0]记录了要参与 compact 的第一层文件
   SetupOtherInputs(c);
 
+  if (OverlapsRunningCompaction(c)) {
+    delete c;
+    return nullptr;
+  }
   return c;
 }
 
+bool VersionSet::OverlapsRunningCompaction(const Compaction* c) const {
+  const Comparator* user_cmp = icmp_.user_comparator();
+  for (size_t i = 0; i < running_compactions_.size(); i++) {
+    const Compaction* r = running_compactions_[i];
+    if (r->level_ > c->level_ + 1 || c->level_ > r->level_ + 1) {
+      continue;  // No level in common
+    }
+    if (user_cmp->Compare(c->largest_.user_key(),
+                          r->smallest_.user_key()) < 0 ||
+        user_cmp->Compare(r->largest_.user_key(),
+                          c->smallest_.user_key()) < 0) {
+      continue;  // Disjoint key ranges
+    }
+    return true;
+  }
+  return false;
+}
+
+bool VersionSet::RangeInCompaction(int level,
+                                   const Slice& smallest_user_key,
+                                   const Slice& largest_user_key) const {
+  const Comparator* user_cmp = icmp_.user_comparator();
+  for (size_t i = 0; i < running_compactions_.size(); i++) {
+    const Compaction* r = running_compactions_[i];
+    if (r->level_ != level && r->level_ + 1 != level) {
+      continue;
+    }
+    if (user_cmp->Compare(largest_user_key, r->smallest_.user_key()) >= 0 &&
+        user_cmp->Compare(r->largest_.user_key(), smallest_user_key) >= 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void VersionSet::StartCompaction(Compaction* c) {
+  const int level = c->level();
+  InternalKey smallest, largest;
+  GetRange(c->inputs_[0], &smallest, &largest);
+
+  // Update the place where we will do the next compaction for this level.
+  // We update this immediately instead of waiting for the VersionEdit
+  // to be applied so that if the compaction fails, we will try a different
+  // key range next time.
+  // 记录该层本次compact的最大key
+  compact_pointer_[level] = largest.Encode().ToString();
+  c->edit_.SetCompactPointer(level, largest);
+
+  assert(c->vset_ == nullptr);
+  c->vset_ = this;
+  running_compactions_.push_back(c);
+}
+
 void VersionSet::SetupOtherInputs(Compaction* c) {
   const int level = c->level();
   InternalKey smallest, largest;
@@ -1518,8 +1887,6 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
             int(expanded0.size()),
             int(expanded1.size()),
             long(expanded0_size), long(inputs1_size));
-        smallest = new_start;
-        largest = new_limit;
         c->inputs_[0] = expanded0;
         c->inputs_[1] = expanded1;
         GetRange2(c->inputs_[0], c->inputs_[1], &all_start, &all_limit);
@@ -1536,13 +1903,8 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
                                    &c->grandparents_);
   }
 
-  // Update the place where we will do the next compaction for this level.
-  // We update this immediately instead of waiting for the VersionEdit
-  // to be applied so that if the compaction fails, we will try a different
-  // key range next time.
-  // 记录该层本次compact的最大key
-  compact_pointer_[level] = largest.Encode().ToString();
-  c->edit_.SetCompactPointer(level, largest);
+  c->smallest_ = all_start;
+  c->largest_ = all_limit;
 }
 
 Compaction* VersionSet::CompactRange(
@@ -1582,6 +1944,7 @@ Compaction* VersionSet::CompactRange(
   c->input_version_->Ref();
   c->inputs_[0] = inputs;//inputs_[0]记录当前level的所有需要compact的文件
   SetupOtherInputs(c);
+  StartCompaction(c);
   return c;
 }
 
@@ -1589,6 +1952,8 @@ Compaction::Compaction(const Options* options, int level)
     : level_(level),
       max_output_file_size_(MaxFileSizeForLevel(options, level)),
       input_version_(nullptr),
+      vset_(nullptr),
+      skipped_inputs_(false),
       grandparent_index_(0),
       seen_key_(false),
       overlapped_bytes_(0) {
@@ -1601,6 +1966,10 @@ Compaction::~Compaction() {
   if (input_version_ != nullptr) {
     input_version_->Unref();
   }
+  if (vset_ != nullptr) {
+    std::vector<Compaction*>* running = &vset_->running_compactions_;
+    running->erase(std::find(running->begin(), running->end(), this));
+  }
 }
 
 bool Compaction::IsTrivialMove() const {
@@ -1649,6 +2018,24 @@ bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
   return true;
 }
 
+bool Compaction::IsBaseLevelForRange(const Slice& begin, const Slice& end) {
+  for (int lvl = level_ + 2; lvl < config::kNumLevels; lvl++) {
+    if (input_version_->OverlapInLevel(lvl, &begin, &end)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Compaction::SkipInput(int i) {
+  FileMetaData* f = inputs_[1][i];
+  if (!skipped_inputs_) {
+    skipped_inputs_ = true;
+    read_inputs_ = inputs_[1];
+  }
+  read_inputs_.erase(std::find(read_inputs_.begin(), read_inputs_.end(), f));
+}
+
 //如果已经合并的key跟level+2的文件已经overlap太大，则返回true，通知compact提前停止.
 //具体的：
 //grandparents_记录了本次compact的文件，在level+2层有多少overlap的文件
@@ -1691,4 +2078,18 @@ void Compaction::ReleaseInputs() {
   }
 }
 
+Compaction* Compaction::NewSubcompaction() const {
+  Compaction* c = new Compaction(input_version_->vset_->options_, level_);
+  c->input_version_ = input_version_;
+  c->input_version_->Ref();
+  c->inputs_[0] = inputs_[0];
+  c->inputs_[1] = inputs_[1];
+  c->skipped_inputs_ = skipped_inputs_;
+  c->read_inputs_ = read_inputs_;
+  c->grandparents_ = grandparents_;
+  c->smallest_ = smallest_;
+  c->largest_ = largest_;
+  return c;
+}
+
 }  // namespace leveldb
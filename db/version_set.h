@@ -30,6 +30,7 @@ namespace log { class Writer; }
 class Compaction;
 class Iterator;
 class MemTable;
+class RangeTombstoneList;
 class TableBuilder;
 class TableCache;
 class Version;
@@ -62,6 +63,12 @@ class Version {
   // REQUIRES: This version has been saved (see VersionSet::SaveTo)
   void AddIterators(const ReadOptions&, std::vector<Iterator*>* iters);
 
+  // Store in *list the range tombstones of every file in this Version,
+  // or nullptr if there are none.  The list is read from the table cache
+  // on the first call and then kept for as long as this Version lives.
+  // REQUIRES: lock is not held
+  Status GetRangeTombstones(const RangeTombstoneList** list);
+
   // Lookup the value for key.  If found, store it in *val and
   // return OK.  Else return a non-OK status.  Fills *stats.
   // REQUIRES: lock is not held
@@ -72,6 +79,20 @@ class Version {
   Status Get(const ReadOptions&, const LookupKey& key, std::string* val,
              GetStats* stats);
 
+  // One lookup of a MultiGet() batch.
+  struct GetRequest {
+    const LookupKey* key;
+    std::string* value;
+    Status status;
+    GetStats stats;
+  };
+
+  // Batched form of Get().  "*reqs" must be sorted by user key.  Fills
+  // in the value, status and stats of every request exactly as Get()
+  // would, but probes each file once for all the keys that may be in it.
+  // REQUIRES: lock is not held
+  void MultiGet(const ReadOptions&, const std::vector<GetRequest*>& reqs);
+
   // Adds "stats" into the current state.  Returns true if a new
   // compaction may need to be triggered, false otherwise.
   // REQUIRES: lock is held
@@ -104,6 +125,8 @@ class Version {
 
   // Return the level at which we should place a new memtable compaction
   // result that covers the range [smallest_user_key,largest_user_key].
+  // Levels that a running compaction touches within that range are
+  // never picked.
   int PickLevelForMemTableOutput(const Slice& smallest_user_key,
                                  const Slice& largest_user_key);
 
@@ -150,12 +173,32 @@ class Version {
   double compaction_score_;
   int compaction_level_;
 
+  // Compaction score of every level that can be compacted, so that
+  // PickCompaction() can fall back to another level when the best one
+  // is busy.  Also initialized by Finalize().
+  double level_scores_[config::kNumLevels - 1];
+
+  // Estimated bytes that compactions must rewrite to bring every level
+  // within its size limit.  Also initialized by Finalize().
+  uint64_t pending_compaction_bytes_;
+
+  // Built by the first GetRangeTombstones() call
+  port::Mutex range_dels_mu_;
+  bool range_dels_built_ GUARDED_BY(range_dels_mu_);
+  RangeTombstoneList* range_dels_ GUARDED_BY(range_dels_mu_);
+
   explicit Version(VersionSet* vset)
       : vset_(vset), next_(this), prev_(this), refs_(0),
         file_to_compact_(nullptr),
         file_to_compact_level_(-1),
         compaction_score_(-1),
-        compaction_level_(-1) {
+        compaction_level_(-1),
+        pending_compaction_bytes_(0),
+        range_dels_built_(false),
+        range_dels_(nullptr) {
+    for (int level = 0; level < config::kNumLevels - 1; level++) {
+      level_scores_[level] = -1;
+    }
   }
 
   ~Version();
@@ -208,6 +251,12 @@ class VersionSet {
   // Return the combined file size of all files at the specified level.
   int64_t NumLevelBytes(int level) const;
 
+  // Return the estimated number of bytes that compactions must rewrite to
+  // bring every level of the current version within its size limit.
+  uint64_t EstimatedPendingCompactionBytes() const {
+    return current_->pending_compaction_bytes_;
+  }
+
   // Return the last sequence number.
   uint64_t LastSequence() const { return last_sequence_; }
 
@@ -228,20 +277,39 @@ class VersionSet {
   uint64_t PrevLogNumber() const { return prev_log_number_; }
 
   // Pick level and inputs for a new compaction.
-  // Returns nullptr if there is no compaction to be done.
+  // Returns nullptr if there is no compaction to be done, or if every
+  // candidate overlaps a compaction that is still running.
   // Otherwise returns a pointer to a heap-allocated object that
   // describes the compaction.  Caller should delete the result.
+  //
+  // The returned compaction counts as running until it is deleted: it
+  // shares no files and no key range in levels level() and level()+1
+  // with any other running compaction, so both may proceed concurrently.
   Compaction* PickCompaction();
 
   // Return a compaction object for compacting the range [begin,end] in
   // the specified level.  Returns nullptr if there is nothing in that
   // level that overlaps the specified range.  Caller should delete
   // the result.
+  //
+  // Unlike PickCompaction(), this does not check for overlap with
+  // running compactions.
+  // REQUIRES: NumRunningCompactions() == 0
   Compaction* CompactRange(
       int level,
       const InternalKey* begin,
       const InternalKey* end);
 
+  // Return the number of compactions handed out by PickCompaction() or
+  // CompactRange() that have not been deleted yet.
+  int NumRunningCompactions() const { return running_compactions_.size(); }
+
+  // Returns true iff some running compaction reads or writes files in
+  // "level" whose user keys overlap [smallest_user_key,largest_user_key].
+  bool RangeInCompaction(int level,
+                         const Slice& smallest_user_key,
+                         const Slice& largest_user_key) const;
+
   // Return the maximum overlapping data (in bytes) at next level for any
   // file at a level >= 1.
   int64_t MaxNextLevelOverlappingBytes();
@@ -292,6 +360,18 @@ class VersionSet {
 
   void SetupOtherInputs(Compaction* c);
 
+  // Build the compaction that starts with file "f" at "level".  Returns
+  // nullptr if it would overlap a running compaction.
+  Compaction* SetupCompaction(int level, FileMetaData* f);
+
+  // Returns true iff *c shares a level and some user key range with a
+  // running compaction.
+  bool OverlapsRunningCompaction(const Compaction* c) const;
+
+  // Advance compact_pointer_ past the inputs of *c and register *c as
+  // running.
+  void StartCompaction(Compaction* c);
+
   // Save current contents to *log
   Status WriteSnapshot(log::Writer* log);
 
@@ -318,6 +398,9 @@ class VersionSet {
   // Either an empty string, or a valid InternalKey.
   std::string compact_pointer_[config::kNumLevels];
 
+  // Compactions that have been handed out and not deleted yet.
+  std::vector<Compaction*> running_compactions_;
+
   // No copying allowed
   VersionSet(const VersionSet&);
   void operator=(const VersionSet&);
@@ -357,6 +440,14 @@ class Compaction {
   // in levels greater than "level+1".
   bool IsBaseLevelForKey(const Slice& user_key);
 
+  // Same as IsBaseLevelForKey() for every user key in [begin, end].
+  bool IsBaseLevelForRange(const Slice& begin, const Slice& end);
+
+  // Do not read input(1, i): a range tombstone of level() hides all of
+  // its contents.  The file is still deleted by AddInputDeletions().
+  // REQUIRES: NewSubcompaction() has not been called yet
+  void SkipInput(int i);
+
   // Returns true iff we should stop building the current output
   // before processing "internal_key".
   bool ShouldStopBefore(const Slice& internal_key);
@@ -365,6 +456,13 @@ class Compaction {
   // is successful.
   void ReleaseInputs();
 
+  // Return a copy of this compaction that can process part of its key
+  // range in another thread: the copy has its own ShouldStopBefore() and
+  // IsBaseLevelForKey() state and does not count as a running compaction.
+  // Caller should delete the result.
+  // REQUIRES: lock is held
+  Compaction* NewSubcompaction() const;
+
  private:
   friend class Version;
   friend class VersionSet;
@@ -376,9 +474,20 @@ class Compaction {
   Version* input_version_;
   VersionEdit edit_;
 
+  // Non-null while this compaction is registered as running in *vset_
+  VersionSet* vset_;
+
+  // Key range covered by the inputs in both levels
+  InternalKey smallest_;
+  InternalKey largest_;
+
   // Each compaction reads inputs from "level_" and "level_+1"
   std::vector<FileMetaData*> inputs_[2];      // The two sets of inputs
 
+  // The files of inputs_[1] that have to be read, if SkipInput() was called
+  bool skipped_inputs_;
+  std::vector<FileMetaData*> read_inputs_;
+
   // State used to check for number of of overlapping grandparent files
   // (parent == level_ + 1, grandparent == level_ + 2)
   std::vector<FileMetaData*> grandparents_;
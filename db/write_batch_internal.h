@@ -41,6 +41,18 @@ class WriteBatchInternal {
 
   static Status InsertInto(const WriteBatch* batch, MemTable* memtable);
 
+  // Insert the entries of "batch" into "memtable" with sequence numbers
+  // starting at "seq", ignoring the sequence stored in the batch.
+  static Status InsertInto(const WriteBatch* batch, SequenceNumber seq,
+                           MemTable* memtable);
+
+  // Like InsertInto(batch, seq, memtable), but uses
+  // MemTable::AddConcurrently() so that other threads may insert other
+  // batches into the same memtable at the same time.
+  static Status InsertIntoConcurrently(const WriteBatch* batch,
+                                       SequenceNumber seq,
+                                       MemTable* memtable);
+
   static void Append(WriteBatch* dst, const WriteBatch* src);
 };
 
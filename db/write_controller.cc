@@ -0,0 +1,77 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/write_controller.h"
+
+#include <algorithm>
+#include "leveldb/options.h"
+
+namespace leveldb {
+
+// Slowest rate to which writes are delayed before they stop.
+static const uint64_t kMinDelayedWriteRate = 16 << 10;
+
+// Delays shorter than this are carried over rather than slept.
+static const uint64_t kMinDelayMicros = 1000;
+
+// Return how far "value" has gone from "soft" towards "hard", from 0 at
+// "soft" to 1 at "hard", or a negative number below "soft".
+static double Severity(double value, double soft, double hard) {
+  if (value < soft) {
+    return -1;
+  }
+  if (hard <= soft) {
+    return 0;
+  }
+  return std::min(1.0, (value - soft) / (hard - soft));
+}
+
+WriteController::WriteController()
+    : stopped_(false),
+      delayed_write_rate_(0),
+      next_write_micros_(0) {
+}
+
+void WriteController::Update(const Options& options, int level0_files,
+                             uint64_t pending_compaction_bytes) {
+  const uint64_t soft_bytes = options.soft_pending_compaction_bytes_limit;
+  const uint64_t hard_bytes = options.hard_pending_compaction_bytes_limit;
+  stopped_ = level0_files >= options.level0_stop_writes_trigger ||
+             (hard_bytes > 0 && pending_compaction_bytes >= hard_bytes);
+
+  double severity = Severity(level0_files,
+                             options.level0_slowdown_writes_trigger,
+                             options.level0_stop_writes_trigger);
+  if (soft_bytes > 0) {
+    severity = std::max(severity,
+                        Severity(pending_compaction_bytes, soft_bytes,
+                                 hard_bytes > 0 ? hard_bytes : soft_bytes));
+  }
+  if (severity < 0) {
+    delayed_write_rate_ = 0;
+    return;
+  }
+
+  const uint64_t max_rate =
+      std::max(options.delayed_write_rate, kMinDelayedWriteRate);
+  const uint64_t rate = static_cast<uint64_t>(max_rate * (1 - severity));
+  if (delayed_write_rate_ == 0) {
+    // Writes were not delayed until now; pace them from here on
+    next_write_micros_ = 0;
+  }
+  delayed_write_rate_ = std::max(rate, kMinDelayedWriteRate);
+}
+
+uint64_t WriteController::GetDelay(uint64_t now_micros, uint64_t num_bytes) {
+  if (delayed_write_rate_ == 0) {
+    return 0;
+  }
+  // Time that has passed without writes earns no credit
+  next_write_micros_ = std::max(next_write_micros_, now_micros);
+  next_write_micros_ += num_bytes * 1000000 / delayed_write_rate_;
+  const uint64_t delay = next_write_micros_ - now_micros;
+  return delay < kMinDelayMicros ? 0 : delay;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,54 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_DB_WRITE_CONTROLLER_H_
+#define STORAGE_LEVELDB_DB_WRITE_CONTROLLER_H_
+
+#include <stdint.h>
+
+namespace leveldb {
+
+struct Options;
+
+// WriteController decides whether writes run freely, are delayed, or are
+// stopped, given how far compactions have fallen behind.  While writes
+// are delayed it paces them to a rate that falls in proportion as the DB
+// approaches the point where writes stop, so that writers slow down
+// gradually instead of running into the stop.
+//
+// Not thread-safe: the DB calls it with its mutex held.
+class WriteController {
+ public:
+  WriteController();
+
+  // Recompute the state of writes from the sanitized "options", the
+  // number of level-0 files and the estimated bytes pending compaction.
+  void Update(const Options& options, int level0_files,
+              uint64_t pending_compaction_bytes);
+
+  // Writes that need a new memtable must wait for compactions.
+  bool IsStopped() const { return stopped_; }
+
+  // Writes must be paced to delayed_write_rate().
+  bool NeedsDelay() const { return delayed_write_rate_ > 0; }
+
+  // Bytes per second to which writes are delayed, or 0 if they are not.
+  uint64_t delayed_write_rate() const { return delayed_write_rate_; }
+
+  // Return the number of microseconds that a write of "num_bytes" bytes
+  // made at "now_micros" should sleep to keep to the delayed rate.
+  // Delays shorter than a millisecond are not slept but carried over to
+  // the next writes.
+  uint64_t GetDelay(uint64_t now_micros, uint64_t num_bytes);
+
+ private:
+  bool stopped_;
+  uint64_t delayed_write_rate_;
+  // Time by which the writes paced so far would have finished
+  uint64_t next_write_micros_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_WRITE_CONTROLLER_H_
@@ -0,0 +1,102 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/write_controller.h"
+
+#include "leveldb/options.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class WriteControllerTest {
+ public:
+  Options options_;
+  WriteController controller_;
+
+  WriteControllerTest() {
+    options_.level0_slowdown_writes_trigger = 8;
+    options_.level0_stop_writes_trigger = 12;
+    options_.soft_pending_compaction_bytes_limit = 100 << 20;
+    options_.hard_pending_compaction_bytes_limit = 200 << 20;
+    options_.delayed_write_rate = 1 << 20;
+  }
+};
+
+TEST(WriteControllerTest, Level0Files) {
+  controller_.Update(options_, 7, 0);
+  ASSERT_TRUE(!controller_.NeedsDelay());
+  ASSERT_TRUE(!controller_.IsStopped());
+  ASSERT_EQ(0u, controller_.delayed_write_rate());
+
+  // The rate falls in proportion between the two triggers
+  controller_.Update(options_, 8, 0);
+  ASSERT_TRUE(controller_.NeedsDelay());
+  ASSERT_EQ(1u << 20, controller_.delayed_write_rate());
+  controller_.Update(options_, 10, 0);
+  ASSERT_EQ(1u << 19, controller_.delayed_write_rate());
+  ASSERT_TRUE(!controller_.IsStopped());
+
+  controller_.Update(options_, 12, 0);
+  ASSERT_TRUE(controller_.IsStopped());
+  ASSERT_GT(controller_.delayed_write_rate(), 0u);
+
+  controller_.Update(options_, 4, 0);
+  ASSERT_TRUE(!controller_.NeedsDelay());
+  ASSERT_TRUE(!controller_.IsStopped());
+}
+
+TEST(WriteControllerTest, PendingCompactionBytes) {
+  controller_.Update(options_, 0, 50 << 20);
+  ASSERT_TRUE(!controller_.NeedsDelay());
+  controller_.Update(options_, 0, 150 << 20);
+  ASSERT_EQ(1u << 19, controller_.delayed_write_rate());
+
+  // The worse of the two signals decides the rate
+  controller_.Update(options_, 11, 150 << 20);
+  ASSERT_EQ(1u << 18, controller_.delayed_write_rate());
+
+  controller_.Update(options_, 0, 200 << 20);
+  ASSERT_TRUE(controller_.IsStopped());
+
+  options_.soft_pending_compaction_bytes_limit = 0;
+  options_.hard_pending_compaction_bytes_limit = 0;
+  controller_.Update(options_, 0, 1ull << 40);
+  ASSERT_TRUE(!controller_.NeedsDelay());
+  ASSERT_TRUE(!controller_.IsStopped());
+}
+
+TEST(WriteControllerTest, Delay) {
+  controller_.Update(options_, 0, 0);
+  ASSERT_EQ(0u, controller_.GetDelay(1000000, 1 << 20));
+
+  // At 1MB/s, 1KB takes about 1ms; the first write carries its time over
+  controller_.Update(options_, 8, 0);
+  uint64_t now = 1000000;
+  ASSERT_EQ(0u, controller_.GetDelay(now, 512));
+  uint64_t delay = controller_.GetDelay(now, 1024);
+  ASSERT_GE(delay, 1400u);
+  ASSERT_LE(delay, 1500u);
+
+  // The delays add up to the time the bytes take at the rate
+  uint64_t total = 0;
+  for (int i = 0; i < 100; i++) {
+    delay = controller_.GetDelay(now, 10 << 10);
+    total += delay;
+    now += delay;
+  }
+  ASSERT_GE(total, 950000u);
+  ASSERT_LE(total, 1000000u);
+
+  // Idle time earns no credit
+  now += 10 * 1000000;
+  delay = controller_.GetDelay(now, 10 << 10);
+  ASSERT_GE(delay, 9000u);
+  ASSERT_LE(delay, 10000u);
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
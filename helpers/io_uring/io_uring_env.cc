@@ -0,0 +1,350 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "helpers/io_uring/io_uring_env.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include "leveldb/env.h"
+#include "leveldb/status.h"
+#include "port/port.h"
+
+// HAVE_IO_URING is defined in the auto-generated port_config.h, which is
+// included by port_stdcxx.h.
+#if HAVE_IO_URING && defined(__NR_io_uring_setup) && \
+    defined(__NR_io_uring_enter)
+#include <linux/io_uring.h>
+#define LEVELDB_USE_IO_URING 1
+#else
+#define LEVELDB_USE_IO_URING 0
+#endif
+
+namespace leveldb {
+
+namespace {
+
+Status PosixError(const std::string& context, int err_number) {
+  if (err_number == ENOENT) {
+    return Status::NotFound(context, strerror(err_number));
+  } else {
+    return Status::IOError(context, strerror(err_number));
+  }
+}
+
+// Read scratch[done, n-1] at offset + done, until the end of the file.
+// Returns the total number of bytes read in *done.
+Status PreadFrom(int fd, const std::string& fname, uint64_t offset,
+                 size_t n, char* scratch, size_t* done) {
+  while (*done < n) {
+    ssize_t r = pread(fd, scratch + *done, n - *done,
+                      static_cast<off_t>(offset + *done));
+    if (r < 0) {
+      if (errno == EINTR) {
+        continue;  // Retry
+      }
+      return PosixError(fname, errno);
+    }
+    if (r == 0) {
+      break;
+    }
+    *done += r;
+  }
+  return Status::OK();
+}
+
+#if LEVELDB_USE_IO_URING
+
+// An io_uring instance, driven with the raw system calls.  Each thread
+// uses its own ring, so that a ring is never shared.
+class IoUring {
+ public:
+  // Maximum number of reads submitted at once
+  static const unsigned kEntries = 64;
+
+  // Number of times io_uring_enter() may fail with EAGAIN or EBUSY
+  // during one Read() before the ring is given up on
+  static const int kMaxBusyRetries = 100;
+
+  // Return the ring of the calling thread, or nullptr if the kernel does
+  // not provide io_uring.
+  static IoUring* ForThisThread() {
+    static thread_local std::unique_ptr<IoUring> ring;
+    static thread_local bool tried = false;
+    if (!tried) {
+      tried = true;
+      std::unique_ptr<IoUring> r(new IoUring);
+      if (r->Init()) {
+        ring.swap(r);
+      }
+    }
+    return ring.get();
+  }
+
+  ~IoUring() {
+    if (sqes_ != nullptr) munmap(sqes_, sqes_size_);
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr) munmap(sq_ring_, sq_ring_size_);
+    if (ring_fd_ >= 0) close(ring_fd_);
+  }
+
+  // Number of reads that Read() accepts at once
+  unsigned entries() const { return entries_; }
+
+  // Read requests[0,n-1] from fd, with n <= entries(), and wait for all
+  // of them.  Returns false, with nothing read, if the reads could not be
+  // submitted.  If only some of them could be, the others are read with
+  // pread().
+  bool Read(int fd, const std::string& fname, ReadRequest* requests, int n) {
+    const unsigned old_tail = *sq_tail_;
+    unsigned tail = old_tail;
+    for (int i = 0; i < n; i++) {
+      const unsigned index = tail & *sq_mask_;
+      io_uring_sqe* sqe = &sqes_[index];
+      memset(sqe, 0, sizeof(*sqe));
+      iovecs_[i].iov_base = requests[i].scratch;
+      iovecs_[i].iov_len = requests[i].n;
+      sqe->opcode = IORING_OP_READV;
+      sqe->fd = fd;
+      sqe->addr = reinterpret_cast<uintptr_t>(&iovecs_[i]);
+      sqe->len = 1;
+      sqe->off = requests[i].offset;
+      sqe->user_data = i;
+      sq_array_[index] = index;
+      tail++;
+    }
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+    int submitted = 0;
+    int completed = 0;
+    int busy_retries = 0;
+    bool stop_submitting = false;
+    while (completed < (stop_submitting ? submitted : n)) {
+      const int to_submit = stop_submitting ? 0 : n - submitted;
+      int r = syscall(__NR_io_uring_enter, ring_fd_, to_submit, 1,
+                      IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (r >= 0) {
+        submitted += r;
+      } else if (errno != EINTR &&
+                 ((errno != EAGAIN && errno != EBUSY) ||
+                  ++busy_retries > kMaxBusyRetries)) {
+        if (submitted == 0) {
+          // Nothing was submitted; take the entries back
+          __atomic_store_n(sq_tail_, old_tail, __ATOMIC_RELEASE);
+          return false;
+        }
+        if (!stop_submitting) {
+          // Take back the entries that the kernel did not consume; they
+          // are read with pread() below.
+          __atomic_store_n(sq_tail_, old_tail + submitted, __ATOMIC_RELEASE);
+          stop_submitting = true;
+        } else {
+          // The kernel still owes us completions that write into the
+          // requests' scratch space, and they arrive without its help.
+          sched_yield();
+        }
+      }
+
+      unsigned head = *cq_head_;
+      const unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      while (head != cq_tail) {
+        const io_uring_cqe* cqe = &cqes_[head & *cq_mask_];
+        Complete(fd, fname, &requests[cqe->user_data], cqe->res);
+        head++;
+        completed++;
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+    for (int i = submitted; i < n; i++) {
+      Complete(fd, fname, &requests[i], -EIO);
+    }
+    return true;
+  }
+
+ private:
+  IoUring()
+      : ring_fd_(-1),
+        entries_(0),
+        sq_ring_(nullptr),
+        sq_ring_size_(0),
+        cq_ring_(nullptr),
+        cq_ring_size_(0),
+        sqes_(nullptr),
+        sqes_size_(0) {
+  }
+
+  bool Init() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd_ = syscall(__NR_io_uring_setup, kEntries, &params);
+    if (ring_fd_ < 0) {
+      return false;
+    }
+    entries_ = std::min(params.sq_entries, kEntries);
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = Map(sq_ring_size_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == nullptr) {
+      return false;
+    }
+    cq_ring_ = single_mmap ? sq_ring_ : Map(cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = reinterpret_cast<io_uring_sqe*>(Map(sqes_size_, IORING_OFF_SQES));
+    if (cq_ring_ == nullptr || sqes_ == nullptr) {
+      return false;
+    }
+
+    char* sq = reinterpret_cast<char*>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = reinterpret_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  void* Map(size_t size, off_t offset) {
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+    return (p == MAP_FAILED) ? nullptr : p;
+  }
+
+  // Fill in the outcome "res" of the read of "r".  Short reads are
+  // finished, and failed reads retried, with pread().
+  static void Complete(int fd, const std::string& fname, ReadRequest* r,
+                       int res) {
+    size_t done = (res > 0) ? res : 0;
+    r->status = Status::OK();
+    if (res != 0 && done < r->n) {
+      r->status = PreadFrom(fd, fname, r->offset, r->n, r->scratch, &done);
+    }
+    r->result = Slice(r->scratch, r->status.ok() ? done : 0);
+  }
+
+  int ring_fd_;
+  unsigned entries_;
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  io_uring_sqe* sqes_;
+  size_t sqes_size_;
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  io_uring_cqe* cqes_;
+  iovec iovecs_[kEntries];
+};
+
+const unsigned IoUring::kEntries;
+const int IoUring::kMaxBusyRetries;
+
+#endif  // LEVELDB_USE_IO_URING
+
+class IoUringRandomAccessFile : public RandomAccessFile {
+ public:
+  IoUringRandomAccessFile(const std::string& fname, int fd)
+      : filename_(fname), fd_(fd) {
+  }
+
+  virtual ~IoUringRandomAccessFile() {
+    close(fd_);
+  }
+
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const {
+    size_t done = 0;
+    Status s = PreadFrom(fd_, filename_, offset, n, scratch, &done);
+    *result = Slice(scratch, s.ok() ? done : 0);
+    return s;
+  }
+
+  virtual void MultiRead(ReadRequest* requests, int n) const {
+#if LEVELDB_USE_IO_URING
+    IoUring* ring = (n > 1) ? IoUring::ForThisThread() : nullptr;
+    if (ring != nullptr) {
+      int i = 0;
+      while (i < n) {
+        const int batch = std::min<int>(n - i, ring->entries());
+        if (!ring->Read(fd_, filename_, requests + i, batch)) {
+          break;
+        }
+        i += batch;
+      }
+      requests += i;
+      n -= i;
+    }
+#endif  // LEVELDB_USE_IO_URING
+    RandomAccessFile::MultiRead(requests, n);
+  }
+
+  virtual void Hint(AccessPattern pattern) {
+#if defined(POSIX_FADV_SEQUENTIAL)
+    int advice = POSIX_FADV_NORMAL;
+    if (pattern == kSequential) {
+      advice = POSIX_FADV_SEQUENTIAL;
+    } else if (pattern == kDontNeed) {
+      advice = POSIX_FADV_DONTNEED;
+    }
+    posix_fadvise(fd_, 0, 0, advice);
+#endif  // defined(POSIX_FADV_SEQUENTIAL)
+  }
+
+  virtual void Prefetch(uint64_t offset, size_t n) {
+#if defined(POSIX_FADV_WILLNEED)
+    posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(n),
+                  POSIX_FADV_WILLNEED);
+#endif  // defined(POSIX_FADV_WILLNEED)
+  }
+
+ private:
+  const std::string filename_;
+  const int fd_;
+};
+
+class IoUringEnv : public EnvWrapper {
+ public:
+  IoUringEnv() : EnvWrapper(Env::Default()) { }
+
+  virtual Status NewRandomAccessFile(const std::string& fname,
+                                     RandomAccessFile** result) {
+    int fd = open(fname.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      *result = nullptr;
+      return PosixError(fname, errno);
+    }
+    *result = new IoUringRandomAccessFile(fname, fd);
+    return Status::OK();
+  }
+};
+
+}  // namespace
+
+Env* NewIoUringEnv() {
+  return new IoUringEnv;
+}
+
+}  // namespace leveldb
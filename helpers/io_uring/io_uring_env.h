@@ -0,0 +1,25 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_HELPERS_IO_URING_IO_URING_ENV_H_
+#define STORAGE_LEVELDB_HELPERS_IO_URING_IO_URING_ENV_H_
+
+#include "leveldb/export.h"
+
+namespace leveldb {
+
+class Env;
+
+// Returns a new environment that delegates everything to Env::Default(),
+// except that its random access files are read with pread() instead of
+// being memory-mapped, and serve RandomAccessFile::MultiRead() by handing
+// the whole batch to the kernel through an io_uring in one system call.
+// Where io_uring is not available, the reads of a batch are issued one
+// pread() at a time.  The caller must delete the result when it is no
+// longer needed, after any database that uses it has been closed.
+LEVELDB_EXPORT Env* NewIoUringEnv();
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_HELPERS_IO_URING_IO_URING_ENV_H_
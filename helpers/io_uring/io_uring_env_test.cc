@@ -0,0 +1,115 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "helpers/io_uring/io_uring_env.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "util/random.h"
+#include "util/testharness.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+class IoUringEnvTest {
+ public:
+  Env* env_;
+  std::string test_dir_;
+
+  IoUringEnvTest() : env_(NewIoUringEnv()) {
+    ASSERT_OK(env_->GetTestDirectory(&test_dir_));
+  }
+  ~IoUringEnvTest() {
+    delete env_;
+  }
+};
+
+TEST(IoUringEnvTest, MultiRead) {
+  Random rnd(test::RandomSeed());
+  const std::string fname = test_dir_ + "/io_uring_multi_read";
+  std::string data;
+  test::RandomString(&rnd, 1 << 20, &data);
+  WritableFile* writable_file;
+  ASSERT_OK(env_->NewWritableFile(fname, &writable_file));
+  ASSERT_OK(writable_file->Append(data));
+  ASSERT_OK(writable_file->Close());
+  delete writable_file;
+
+  RandomAccessFile* file;
+  ASSERT_OK(env_->NewRandomAccessFile(fname, &file));
+  // More requests than one submission takes, some of them past the end
+  static const int kRequests = 300;
+  std::vector<ReadRequest> requests(kRequests);
+  std::vector<std::string> scratch(kRequests);
+  for (int i = 0; i < kRequests; i++) {
+    requests[i].offset = rnd.Uniform(data.size() + 1000);
+    requests[i].n = rnd.Skewed(15);
+    scratch[i].resize(std::max<size_t>(requests[i].n, 1));
+    requests[i].scratch = &scratch[i][0];
+  }
+  file->MultiRead(&requests[0], kRequests);
+  for (int i = 0; i < kRequests; i++) {
+    ASSERT_OK(requests[i].status);
+    std::string expected;
+    if (requests[i].offset < data.size()) {
+      expected = data.substr(requests[i].offset, requests[i].n);
+    }
+    ASSERT_EQ(expected.size(), requests[i].result.size());
+    ASSERT_TRUE(requests[i].result == Slice(expected));
+  }
+  delete file;
+  ASSERT_OK(env_->DeleteFile(fname));
+}
+
+TEST(IoUringEnvTest, DBMultiGet) {
+  const std::string dbname = test_dir_ + "/io_uring_db";
+  Options options;
+  options.env = env_;
+  options.create_if_missing = true;
+  options.block_size = 256;
+  DestroyDB(dbname, options);
+  DB* db;
+  ASSERT_OK(DB::Open(options, dbname, &db));
+  Random rnd(301);
+  std::vector<std::string> values(1000);
+  for (int i = 0; i < 1000; i++) {
+    char key[20];
+    snprintf(key, sizeof(key), "key%06d", i);
+    test::RandomString(&rnd, 100, &values[i]);
+    ASSERT_OK(db->Put(WriteOptions(), key, values[i]));
+  }
+  db->CompactRange(nullptr, nullptr);
+
+  // Keys of many blocks, some missing, read in one batch per table
+  std::vector<std::string> key_data;
+  for (int i = 0; i < 1100; i += 3) {
+    char key[20];
+    snprintf(key, sizeof(key), "key%06d", i);
+    key_data.push_back(key);
+  }
+  std::vector<Slice> keys(key_data.begin(), key_data.end());
+  std::vector<std::string> results;
+  std::vector<Status> statuses;
+  db->MultiGet(ReadOptions(), keys, &results, &statuses);
+  for (size_t k = 0; k < keys.size(); k++) {
+    const int i = 3 * k;
+    if (i < 1000) {
+      ASSERT_OK(statuses[k]);
+      ASSERT_EQ(values[i], results[k]);
+    } else {
+      ASSERT_TRUE(statuses[k].IsNotFound());
+    }
+  }
+  delete db;
+  ASSERT_OK(DestroyDB(dbname, options));
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
@@ -189,7 +189,9 @@ LEVELDB_EXPORT void leveldb_options_set_max_file_size(leveldb_options_t*,
 
 enum {
   leveldb_no_compression = 0,
-  leveldb_snappy_compression = 1
+  leveldb_snappy_compression = 1,
+  leveldb_lz4_compression = 4,
+  leveldb_zstd_compression = 7
 };
 LEVELDB_EXPORT void leveldb_options_set_compression(leveldb_options_t*, int);
 
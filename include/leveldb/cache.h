@@ -31,6 +31,21 @@ class LEVELDB_EXPORT Cache;
 // 对外的接口，返回一个new 的 Cache子类
 LEVELDB_EXPORT Cache* NewLRUCache(size_t capacity);
 
+// Like NewLRUCache(capacity), but up to high_pri_pool_ratio * capacity
+// bytes are reserved for entries that were inserted with kHighPriority or
+// that were looked up again after being inserted.  Other entries are
+// inserted in the middle of the LRU list, below the reserved pool, and are
+// evicted first, so a scan that reads every block once cannot push the
+// reserved entries out.  A ratio of zero gives plain LRU eviction.
+LEVELDB_EXPORT Cache* NewLRUCache(size_t capacity, double high_pri_pool_ratio);
+
+// Create a new cache with a fixed size capacity that is split into
+// 2^num_shard_bits shards.  This implementation of Cache uses the CLOCK
+// eviction policy: Lookup() and Release() of cached entries only use
+// atomic operations, so it scales better than NewLRUCache() when many
+// threads read at once.  Insert() and Erase() lock the shard.
+LEVELDB_EXPORT Cache* NewClockCache(size_t capacity, int num_shard_bits = 4);
+
 class LEVELDB_EXPORT Cache {
  public:
   Cache() = default;
@@ -45,6 +60,13 @@ class LEVELDB_EXPORT Cache {
   // Opaque handle to an entry stored in the cache.
   struct Handle { };
 
+  // Hint for how valuable an entry is.  Caches that do not support
+  // priorities treat every entry alike.
+  enum Priority {
+    kLowPriority = 0,
+    kHighPriority = 1
+  };
+
   // Insert a mapping from key->value into the cache and assign it
   // the specified charge against the total cache capacity.
   //
@@ -57,6 +79,12 @@ class LEVELDB_EXPORT Cache {
   virtual Handle* Insert(const Slice& key, void* value, size_t charge,
                          void (*deleter)(const Slice& key, void* value)) = 0;
 
+  // Like Insert(key, value, charge, deleter), but with the given priority.
+  // The default implementation ignores the priority.
+  virtual Handle* Insert(const Slice& key, void* value, size_t charge,
+                         void (*deleter)(const Slice& key, void* value),
+                         Priority priority);
+
   // If the cache has no mapping for "key", returns nullptr.
   //
   // Else return a handle that corresponds to the mapping.  The caller
@@ -64,6 +92,11 @@ class LEVELDB_EXPORT Cache {
   // longer needed.
   virtual Handle* Lookup(const Slice& key) = 0;
 
+  // Like Lookup(key), but counts the lookup in the statistics of the
+  // given priority, which should be the priority the entry would be
+  // inserted with.  The default implementation ignores the priority.
+  virtual Handle* Lookup(const Slice& key, Priority priority);
+
   // Release a mapping returned by a previous Lookup().
   // REQUIRES: handle must not have been released yet.
   // REQUIRES: handle must have been returned by a method on *this.
@@ -97,6 +130,13 @@ class LEVELDB_EXPORT Cache {
   // cache.
   virtual size_t TotalCharge() const = 0;
 
+  // Store in *lookups the number of lookups made with the given priority
+  // and in *hits how many of them found an entry.  Lookups made without a
+  // priority count as kLowPriority.  The default implementation, used by
+  // caches that keep no statistics, stores zero in both.
+  virtual void GetLookupStats(Priority priority, uint64_t* lookups,
+                              uint64_t* hits) const;
+
  private:
   void LRU_Remove(Handle* e);
   void LRU_Append(Handle* e);
@@ -7,6 +7,8 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string>
+#include <vector>
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
 #include "leveldb/options.h"
@@ -73,6 +75,17 @@ class LEVELDB_EXPORT DB {
   // Note: consider setting options.sync = true.
   virtual Status Delete(const WriteOptions& options, const Slice& key) = 0;
 
+  // Remove the database entries (if any) for every key in [begin, end).
+  // Returns OK on success, and a non-OK status on error.  The range is
+  // recorded as a single tombstone, so the cost does not depend on the
+  // number of keys it covers.
+  //
+  // The default implementation writes a batch holding one
+  // WriteBatch::DeleteRange() record.
+  // Note: consider setting options.sync = true.
+  virtual Status DeleteRange(const WriteOptions& options,
+                             const Slice& begin, const Slice& end);
+
   // Apply the specified updates to the database.
   // Returns OK on success, non-OK on failure.
   // Note: consider setting options.sync = true.
@@ -88,6 +101,18 @@ class LEVELDB_EXPORT DB {
   virtual Status Get(const ReadOptions& options,
                      const Slice& key, std::string* value) = 0;
 
+  // Look up every key in "keys" as of a single consistent state of the
+  // database.  On return, values and statuses have keys.size() entries:
+  // (*statuses)[i] holds the result that Get(options, keys[i], ...) would
+  // have returned, and (*values)[i] holds the value if it is ok().
+  //
+  // The default implementation simply calls Get() once per key; DB
+  // implementations may batch the lookups to share work between keys.
+  virtual void MultiGet(const ReadOptions& options,
+                        const std::vector<Slice>& keys,
+                        std::vector<std::string>* values,
+                        std::vector<Status>* statuses);
+
   // Return a heap-allocated iterator over the contents of the database.
   // The result of NewIterator() is initially invalid (caller must
   // call one of the Seek methods on the iterator before using it).
@@ -122,6 +147,21 @@ class LEVELDB_EXPORT DB {
   //     of the sstables that make up the db contents.
   //  "leveldb.approximate-memory-usage" - returns the approximate number of
   //     bytes of memory in use by the DB.
+  //  "leveldb.estimate-pending-compaction-bytes" - returns the estimated
+  //     number of bytes that compactions must rewrite to bring every level
+  //     within its size limit.
+  //  "leveldb.actual-delayed-write-rate" - returns the rate in bytes per
+  //     second to which writes are currently delayed, or 0 if they are not.
+  //  "leveldb.is-write-stopped" - returns "1" if writes that need a new
+  //     memtable must wait for compactions, and "0" otherwise.
+  //  "leveldb.statistics" - returns a dump of the tickers and histograms
+  //     of options.statistics, which include those of any other DB that
+  //     shares the object.  Not supported if options.statistics is null.
+  //  "leveldb.block-cache-stats" - returns the number of block cache lookups
+  //     for index blocks and filters (high priority) and for data blocks
+  //     (low priority), and how many of them hit.  Zero if
+  //     options.block_cache keeps no statistics.  The counts include the
+  //     lookups of any other DB that shares the cache.
   virtual bool GetProperty(const Slice& property, std::string* value) = 0;
 
   // For each i in [0,n-1], store in "sizes[i]", the approximate
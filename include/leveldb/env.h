@@ -91,6 +91,22 @@ class LEVELDB_EXPORT Env {
   virtual Status NewAppendableFile(const std::string& fname,
                                    WritableFile** result);
 
+  // Like NewRandomAccessFile(), but reads of the returned file bypass
+  // the operating system's page cache where the platform supports it, so
+  // that they neither fill it nor evict other data from it.
+  //
+  // The default implementation calls NewRandomAccessFile().
+  virtual Status NewDirectRandomAccessFile(const std::string& fname,
+                                           RandomAccessFile** result);
+
+  // Like NewWritableFile(), but writes to the returned file bypass the
+  // operating system's page cache where the platform supports it.
+  // Appended data may not reach the file before Sync() or Close().
+  //
+  // The default implementation calls NewWritableFile().
+  virtual Status NewDirectWritableFile(const std::string& fname,
+                                       WritableFile** result);
+
   // Returns true iff the named file exists.
   virtual bool FileExists(const std::string& fname) = 0;
 
@@ -147,6 +163,25 @@ class LEVELDB_EXPORT Env {
       void (*function)(void* arg),
       void* arg) = 0;
 
+  // Background work is queued by priority.  HIGH is meant for short jobs
+  // that foreground operations may be waiting on (e.g. writing out a full
+  // memtable), LOW for everything else (e.g. compactions).
+  enum Priority { LOW, HIGH };
+
+  // Like Schedule(function, arg), but queue the work item according to
+  // "pri".  Items of the same priority still run in FIFO order.
+  //
+  // The default implementation ignores "pri" and calls Schedule().
+  virtual void Schedule(void (*function)(void* arg), void* arg,
+                        Priority pri);
+
+  // Make sure that at least "number" background threads are available to
+  // run work scheduled with priority "pri".  Thread pools only ever grow:
+  // asking for fewer threads than a pool already has is a no-op.
+  //
+  // The default implementation does nothing.
+  virtual void SetBackgroundThreads(int number, Priority pri);
+
   // Start a new thread, invoking "function(arg)" within the new thread.
   // When "function(arg)" returns, the thread will be destroyed.
   virtual void StartThread(void (*function)(void* arg), void* arg) = 0;
@@ -198,6 +233,20 @@ class LEVELDB_EXPORT SequentialFile {
   virtual Status Skip(uint64_t n) = 0;
 };
 
+// One read of a RandomAccessFile::MultiRead() batch.
+struct LEVELDB_EXPORT ReadRequest {
+  // Read up to "n" bytes at "offset", with scratch[0..n-1] as for
+  // RandomAccessFile::Read().  Set by the caller.
+  uint64_t offset;
+  size_t n;
+  char* scratch;
+
+  // The data that was read and the outcome of the read.  Set by
+  // MultiRead().
+  Slice result;
+  Status status;
+};
+
 // A file abstraction for randomly reading the contents of a file.
 class LEVELDB_EXPORT RandomAccessFile {
  public:
@@ -221,6 +270,34 @@ class LEVELDB_EXPORT RandomAccessFile {
   // 存储空间由调用方管理，通过scratch传入
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const = 0;
+
+  enum AccessPattern {
+    kNormal,
+    kSequential,  // The file is about to be read from start to end
+    kDontNeed     // The file is about to be deleted
+  };
+
+  // Advise the file how it is going to be accessed, so that it can
+  // adjust its caching and readahead.  The default does nothing.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void Hint(AccessPattern pattern);
+
+  // Start reading [offset, offset+n) of the file in the background, into
+  // whatever cache later reads of it are served from, without waiting
+  // for it.  The default does nothing.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void Prefetch(uint64_t offset, size_t n);
+
+  // Perform the reads requests[0,n-1], as if by calling Read() for each,
+  // and store the outcome of each in its result and status.  An
+  // implementation may issue the reads concurrently, so that a batch of
+  // reads costs little more time than one read.  The default
+  // implementation calls Read() for each request in turn.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void MultiRead(ReadRequest* requests, int n) const;
 };
 
 // A file abstraction for sequential writing.  The implementation
@@ -307,6 +384,14 @@ class LEVELDB_EXPORT EnvWrapper : public Env {
   Status NewAppendableFile(const std::string& f, WritableFile** r) override {
     return target_->NewAppendableFile(f, r);
   }
+  Status NewDirectRandomAccessFile(const std::string& f,
+                                   RandomAccessFile** r) override {
+    return target_->NewDirectRandomAccessFile(f, r);
+  }
+  Status NewDirectWritableFile(const std::string& f,
+                               WritableFile** r) override {
+    return target_->NewDirectWritableFile(f, r);
+  }
   bool FileExists(const std::string& f) override {
     return target_->FileExists(f);
   }
@@ -336,6 +421,12 @@ class LEVELDB_EXPORT EnvWrapper : public Env {
   void Schedule(void (*f)(void*), void* a) override {
     return target_->Schedule(f, a);
   }
+  void Schedule(void (*f)(void*), void* a, Priority pri) override {
+    return target_->Schedule(f, a, pri);
+  }
+  void SetBackgroundThreads(int number, Priority pri) override {
+    return target_->SetBackgroundThreads(number, pri);
+  }
   void StartThread(void (*f)(void*), void* a) override {
     return target_->StartThread(f, a);
   }
@@ -0,0 +1,113 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// An EventListener is told about the background work of a database as it
+// happens: memtable flushes, compactions, changes in write stalls, and the
+// table files that they create and delete.  Applications can react to
+// these events without scraping the info log.
+//
+// The callbacks run on the background threads of the database (and on the
+// thread that opens it, for the work done during recovery) with no lock
+// of the database held, so they may call back into the database, e.g. to
+// read a property.  They hold up that background work while they run, so
+// they should return quickly.  Callbacks for different events may run
+// concurrently on different threads.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_LISTENER_H_
+#define STORAGE_LEVELDB_INCLUDE_LISTENER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "leveldb/export.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+struct LEVELDB_EXPORT FlushJobInfo {
+  std::string db_name;
+  // The table that the memtable was written to, and the level that it was
+  // placed at.  file_path is empty and file_number zero if the memtable
+  // held nothing to write.
+  std::string file_path;
+  uint64_t file_number;
+  uint64_t file_size;
+  int level;
+  uint64_t micros;
+};
+
+struct LEVELDB_EXPORT CompactionJobInfo {
+  std::string db_name;
+  // The compaction merged files of base_level and base_level + 1 into
+  // files of output_level (== base_level + 1).
+  int base_level;
+  int output_level;
+  std::vector<std::string> input_files;
+  std::vector<std::string> output_files;
+  uint64_t bytes_read;
+  uint64_t bytes_written;
+  uint64_t micros;
+  Status status;
+};
+
+enum WriteStallCondition {
+  kWriteStallNormal,
+  kWriteStallDelayed,   // Writes are paced to a reduced rate
+  kWriteStallStopped    // Writes that need a new memtable wait
+};
+
+struct LEVELDB_EXPORT WriteStallInfo {
+  std::string db_name;
+  WriteStallCondition cur;
+  WriteStallCondition prev;
+};
+
+enum TableFileCreationReason {
+  kTableFileFromFlush,
+  kTableFileFromCompaction
+};
+
+struct LEVELDB_EXPORT TableFileCreationInfo {
+  std::string db_name;
+  std::string file_path;
+  uint64_t file_number;
+  uint64_t file_size;
+  TableFileCreationReason reason;
+  // Not ok if the table could not be written; the file is then removed.
+  Status status;
+};
+
+struct LEVELDB_EXPORT TableFileDeletionInfo {
+  std::string db_name;
+  std::string file_path;
+  uint64_t file_number;
+  Status status;
+};
+
+class LEVELDB_EXPORT EventListener {
+ public:
+  virtual ~EventListener();
+
+  // A memtable was written to a table that is now part of the database.
+  virtual void OnFlushCompleted(const FlushJobInfo& info);
+
+  // A compaction finished, successfully or not.  Moves of a file to the
+  // next level, which neither read nor write a table, are not reported.
+  virtual void OnCompactionCompleted(const CompactionJobInfo& info);
+
+  // Writes started or stopped being delayed or stopped because
+  // compactions fell behind (see Options::level0_slowdown_writes_trigger
+  // and the options that follow it).
+  virtual void OnStallConditionsChanged(const WriteStallInfo& info);
+
+  // A flush or a compaction finished writing a table file.
+  virtual void OnTableFileCreated(const TableFileCreationInfo& info);
+
+  // A table file that the database no longer needs was deleted.
+  virtual void OnTableFileDeleted(const TableFileDeletionInfo& info);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_LISTENER_H_
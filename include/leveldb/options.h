@@ -6,6 +6,8 @@
 #define STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
 
 #include <stddef.h>
+#include <stdint.h>
+#include <vector>
 #include "leveldb/export.h"
 
 namespace leveldb {
@@ -13,8 +15,12 @@ namespace leveldb {
 class Cache;
 class Comparator;
 class Env;
+class EventListener;
 class FilterPolicy;
 class Logger;
+class RateLimiter;
+class SliceTransform;
+class Statistics;
 class Snapshot;
 
 // DB contents are stored in a set of blocks, each of which holds a
@@ -25,7 +31,27 @@ enum CompressionType {
   // NOTE: do not change the values of existing entries, as these are
   // part of the persistent format on disk.
   kNoCompression     = 0x0,
-  kSnappyCompression = 0x1
+  kSnappyCompression = 0x1,
+  kLZ4Compression    = 0x4,
+  kZstdCompression   = 0x7
+};
+
+// The layout of the filters that Options::filter_policy builds for a
+// table.  Every layout can be read regardless of this setting, so it may
+// be changed at any time.
+enum FilterFormat {
+  // One filter for every 2KB of data block offsets.  Lookups must seek
+  // the index block before they can probe the filter.  Tables can be read
+  // by older versions of leveldb.
+  kBlockBasedFilter = 0x0,
+  // A single filter for the whole table, which is probed before the
+  // index block is searched.
+  kFullFilter = 0x1,
+  // A whole-table filter cut into partitions of about
+  // Options::filter_partition_keys keys each, with an index that maps
+  // keys to partitions.  Only the index stays in memory; partitions are
+  // read through the block cache.  Suited to very large tables.
+  kPartitionedFilter = 0x2
 };
 
 // Options to control the behavior of a database (passed to DB::Open)
@@ -68,6 +94,19 @@ struct LEVELDB_EXPORT Options {
   // Default: nullptr
   Logger* info_log;
 
+  // If non-null, the DB records counters and latency histograms of its
+  // operations into this object.  See leveldb/statistics.h.
+  //
+  // Default: nullptr
+  Statistics* statistics;
+
+  // The DB notifies each of these objects of its flushes, compactions,
+  // changes in write stalls and the table files it creates and deletes.
+  // See leveldb/listener.h.  The listeners must outlive the DB.
+  //
+  // Default: empty
+  std::vector<EventListener*> listeners;
+
   // -------------------
   // Parameters that affect performance
 
@@ -83,6 +122,46 @@ struct LEVELDB_EXPORT Options {
   // Default: 4MB
   size_t write_buffer_size;
 
+  // A compaction of level-0 is started when it holds this many files.
+  //
+  // Default: 4
+  int level0_file_num_compaction_trigger;
+
+  // Soft limit on the number of level-0 files.  From this many files on,
+  // writes are delayed to a rate that falls from delayed_write_rate
+  // towards zero as the count approaches level0_stop_writes_trigger.
+  //
+  // Default: 8
+  int level0_slowdown_writes_trigger;
+
+  // Maximum number of level-0 files.  Once the memtable is full, writes
+  // stop until compactions bring the count below this.
+  //
+  // Default: 12
+  int level0_stop_writes_trigger;
+
+  // Soft limit on the estimated number of bytes that compactions must
+  // rewrite to bring every level within its size limit.  From this many
+  // bytes on, writes are delayed like for level0_slowdown_writes_trigger,
+  // at a rate that falls towards zero as the estimate approaches
+  // hard_pending_compaction_bytes_limit.  Zero disables the limit.
+  //
+  // Default: 64GB
+  uint64_t soft_pending_compaction_bytes_limit;
+
+  // Like level0_stop_writes_trigger, for the estimated bytes of pending
+  // compactions.  Zero disables the limit.
+  //
+  // Default: 256GB
+  uint64_t hard_pending_compaction_bytes_limit;
+
+  // Rate, in bytes per second, to which writes are delayed when a soft
+  // limit above is first reached.  The rate falls in proportion as the
+  // DB gets closer to the matching hard limit.
+  //
+  // Default: 16MB/s
+  uint64_t delayed_write_rate;
+
   // Number of open files that can be used by the DB.  You may need to
   // increase this if your database has a large working set (budget
   // one open file per 2MB of working set).
@@ -90,14 +169,116 @@ struct LEVELDB_EXPORT Options {
   // Default: 1000
   int max_open_files;
 
+  // If true, table files are read for Get() and iterators with direct
+  // I/O (see Env::NewDirectRandomAccessFile), bypassing the operating
+  // system's page cache.  block_cache is then the only cache of table
+  // data and should be sized accordingly.
+  //
+  // Default: false
+  bool use_direct_reads;
+
+  // If true, memtable flushes and compactions write their output tables
+  // with direct I/O, and compactions read their input tables with direct
+  // I/O, so that the data they stream through does not evict the data
+  // that serves user reads from the operating system's page cache.
+  //
+  // Default: false
+  bool use_direct_io_for_flush_and_compaction;
+
+  // If non-zero, compactions read each input table through a buffer of
+  // this many bytes, which is refilled with one large read, instead of
+  // reading one block at a time.  This cuts the number of I/Os on devices
+  // with a high cost per I/O, such as spinning disks and network block
+  // devices, and is recommended with use_direct_io_for_flush_and_compaction.
+  // Memory-mapped table files are read directly.
+  //
+  // Default: 0
+  size_t compaction_readahead_size;
+
+  // If non-null, every write to a table file made by a memtable flush or a
+  // compaction is first requested from this limiter, flushes at
+  // RateLimiter::kHigh and compactions at RateLimiter::kLow.  Capping the
+  // background writes keeps their bursts from starving the writes and
+  // syncs of the log.  See leveldb/rate_limiter.h.
+  //
+  // Default: nullptr
+  RateLimiter* rate_limiter;
+
+  // Maximum number of compactions that may run concurrently.  Concurrent
+  // compactions always work on different levels or on disjoint key
+  // ranges.  The DB makes sure that env has at least this many threads
+  // for Env::LOW priority work.
+  //
+  // Default: 1
+  int max_background_compactions;
+
+  // If positive, memtable compactions are scheduled on this many
+  // dedicated Env::HIGH priority threads, so that a full memtable never
+  // waits behind long compactions.  If zero, they share the compaction
+  // threads but are queued ahead of pending compactions.  There is at
+  // most one immutable memtable, so values above 1 are treated as 1.
+  //
+  // Default: 0
+  int max_background_flushes;
+
+  // Maximum number of threads that work on a single compaction.  A
+  // compaction whose inputs span several times max_file_size is split at
+  // input file boundaries into up to this many key ranges, which are
+  // merged in parallel and installed together.
+  //
+  // Default: 1
+  int max_subcompactions;
+
+  // If true, when several writers are grouped into one log write, each
+  // writer inserts its own batch into the memtable, in parallel with the
+  // others, instead of the group leader inserting all of them.  This
+  // lifts the single-core ceiling on ingest with many writing threads.
+  //
+  // Default: false
+  bool allow_concurrent_memtable_write;
+
+  // If true, a group of writers hands the log over to the next group as
+  // soon as its log record is written, and applies its batches to the
+  // memtable while the next group writes (and syncs) the log.  Groups
+  // still become visible to readers in log order.  Improves throughput
+  // with many concurrent writers, especially with WriteOptions::sync.
+  //
+  // Default: false
+  bool enable_pipelined_write;
+
   // Control over blocks (user data is stored in a set of blocks, and
   // a block is the unit of reading from disk).
 
   // If non-null, use the specified cache for blocks.
-  // If null, leveldb will automatically create and use an 8MB internal cache.
+  // If null, leveldb will automatically create and use an 8MB internal cache
+  // made by NewLRUCache(8 << 20), or by NewLRUCache(8 << 20, 0.5) if
+  // cache_index_and_filter_blocks is set.
+  //
+  // Data blocks are inserted with Cache::kLowPriority, and index blocks,
+  // filters and filter partitions with Cache::kHighPriority, so a cache
+  // with a high priority pool keeps them apart from blocks that a scan
+  // read only once.
   // Default: nullptr
   Cache* block_cache;
 
+  // If true and block_cache is non-null, the index block and the filter of
+  // each table are read through block_cache with Cache::kHighPriority and
+  // charged against its capacity, instead of being held by the table for
+  // as long as it is open.  This bounds the memory used by open tables at
+  // the cost of a block cache lookup for every index and filter access.
+  //
+  // Default: false
+  bool cache_index_and_filter_blocks;
+
+  // If true and cache_index_and_filter_blocks is true, the tables of
+  // level-0 files keep their index block and filter pinned in the block
+  // cache: they stay charged against its capacity, but are not evicted
+  // while the table is open.  Every lookup checks all level-0 files, so
+  // this saves those block cache lookups and rereads.
+  //
+  // Default: false
+  bool pin_l0_filter_and_index_blocks;
+
   // Approximate size of user data packed per block.  Note that the
   // block size specified here corresponds to uncompressed data.  The
   // actual size of the unit read from disk may be smaller if
@@ -139,8 +320,52 @@ struct LEVELDB_EXPORT Options {
   // worth switching to kNoCompression.  Even if the input data is
   // incompressible, the kSnappyCompression implementation will
   // efficiently detect that and will switch to uncompressed mode.
+  //
+  // kLZ4Compression compresses about as well as kSnappyCompression and
+  // is usually faster; kZstdCompression compresses considerably better
+  // at a higher CPU cost.  Blocks are stored uncompressed if the library
+  // for the chosen type was not available when leveldb was built.
   CompressionType compression;
 
+  // If non-empty, compression_per_level[i] is used instead of
+  // "compression" for the tables written to level i, and the last entry
+  // for every level after the end of the vector.  For example,
+  // {kLZ4Compression, kLZ4Compression, kZstdCompression} writes levels
+  // 0 and 1, which are rewritten most often, with the faster LZ4 and
+  // every deeper level with the denser Zstandard.  Tables made by a
+  // memtable flush always count as level 0.
+  //
+  // Default: empty
+  std::vector<CompressionType> compression_per_level;
+
+  // If non-zero, the tables that compactions write with kZstdCompression
+  // train a Zstandard dictionary of up to this many bytes on their first
+  // data blocks, store it in the table and compress all of their data
+  // blocks with it.  This greatly improves the compression of small,
+  // similar values, which otherwise share nothing across blocks.
+  //
+  // Default: 0, which writes no dictionaries
+  size_t zstd_max_dict_bytes;
+
+  // Amount of data block contents that a table collects as samples to
+  // train its dictionary.  These blocks are held in memory until the
+  // dictionary is ready.  Only used if zstd_max_dict_bytes is non-zero.
+  //
+  // Default: 256KB
+  size_t zstd_max_train_bytes;
+
+  // Number of threads that compress the data blocks of a table while it
+  // is being built.  With more than one, the thread that builds the table
+  // hands every finished data block to these threads and writes the
+  // blocks in order once they are compressed, so that slow compression
+  // such as kZstdCompression does not hold up flushes and compactions.
+  // Every table being built starts threads of its own.  The tables are
+  // the same as with a single thread, except that partitioned filters
+  // may be laid out differently.
+  //
+  // Default: 1, which compresses every block in the building thread
+  int compression_threads;
+
   // EXPERIMENTAL: If true, append to existing MANIFEST and log files
   // when a database is opened.  This can significantly speed up open.
   //
@@ -154,6 +379,27 @@ struct LEVELDB_EXPORT Options {
   // Default: nullptr
   const FilterPolicy* filter_policy;
 
+  // Layout of the filters that filter_policy builds for new tables.
+  //
+  // Default: kBlockBasedFilter
+  FilterFormat filter_format;
+
+  // Number of keys after which a kPartitionedFilter partition is closed.
+  // Partitions always end at a data block boundary.
+  //
+  // Default: 4096
+  int filter_partition_keys;
+
+  // If non-null and filter_policy is also set, the filters also hold the
+  // prefix of every key that the transform has a prefix for, so that
+  // iterators created with ReadOptions::prefix_same_as_start can skip
+  // the tables and blocks that hold no key with the prefix they seek.
+  // Tables built without the transform (or with a differently named one)
+  // are read as usual, without skipping.
+  //
+  // Default: nullptr
+  const SliceTransform* prefix_extractor;
+
   // Create an Options object with default values for all fields.
   Options();
 };
@@ -177,10 +423,29 @@ struct LEVELDB_EXPORT ReadOptions {
   // Default: nullptr
   const Snapshot* snapshot;
 
+  // If true and the database has a prefix_extractor, an iterator that
+  // was positioned with Seek(target) only yields keys that share the
+  // prefix of target, and becomes invalid after the last of them.  Tables
+  // and blocks whose filters rule out the prefix are not read.  Such an
+  // iterator does not support SeekToFirst(), SeekToLast() and Prev().
+  // Seek() targets that have no prefix are not limited.
+  // Default: false
+  bool prefix_same_as_start;
+
+  // If non-zero, an iterator that reads a data block of a table asks the
+  // table file (see RandomAccessFile::Prefetch) to read the following
+  // "readahead_size" bytes in the background, so that a long forward scan
+  // finds the next blocks cached or in flight when it reaches them.  The
+  // prefetched range is extended once the scan is halfway through it.
+  // Default: 0
+  size_t readahead_size;
+
   ReadOptions()
       : verify_checksums(false),
         fill_cache(true),
-        snapshot(nullptr) {
+        snapshot(nullptr),
+        prefix_same_as_start(false),
+        readahead_size(0) {
   }
 };
 
@@ -0,0 +1,97 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A PerfContext breaks down where the time of the reads issued by one
+// thread goes: waiting for the DB mutex, searching the memtables, finding
+// and opening tables, seeking in index blocks, checking filters, reading
+// and decompressing blocks.  Each thread has its own PerfContext, which
+// only collects while the thread's perf level allows it, so that a caller
+// can profile a single slow request:
+//
+//   leveldb::SetPerfLevel(leveldb::kEnableTime);
+//   leveldb::GetPerfContext()->Reset();
+//   db->Get(leveldb::ReadOptions(), key, &value);
+//   fprintf(stderr, "%s\n", leveldb::GetPerfContext()->ToString().c_str());
+//   leveldb::SetPerfLevel(leveldb::kDisablePerf);
+//
+// Work done on other threads, such as compactions, is not included.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_PERF_CONTEXT_H_
+#define STORAGE_LEVELDB_INCLUDE_PERF_CONTEXT_H_
+
+#include <stdint.h>
+#include <string>
+#include "leveldb/export.h"
+
+namespace leveldb {
+
+enum PerfLevel {
+  kDisablePerf = 0,   // Collect nothing (the default)
+  kEnableCount = 1,   // Collect the counters only
+  kEnableTime = 2     // Collect the counters and the timers
+};
+
+// Set the perf level of the calling thread.
+LEVELDB_EXPORT void SetPerfLevel(PerfLevel level);
+
+// Return the perf level of the calling thread.
+LEVELDB_EXPORT PerfLevel GetPerfLevel();
+
+// Timers are in nanoseconds.  The values add up until Reset() is called.
+struct LEVELDB_EXPORT PerfContext {
+  // Zero every counter and timer.
+  void Reset();
+
+  // Return a human-readable list of the counters and timers.  If
+  // "exclude_zero_counters" is true, those that are zero are left out.
+  std::string ToString(bool exclude_zero_counters = false) const;
+
+  // Waiting to acquire the DB mutex in Get() and MultiGet().
+  uint64_t db_mutex_lock_nanos;
+
+  // Searching the memtable and the immutable memtable, and the number of
+  // memtables searched.
+  uint64_t get_from_memtable_nanos;
+  uint64_t get_from_memtable_count;
+
+  // Searching the table files, in all, for keys that the memtables did
+  // not answer.  The number of table files searched, and the time spent
+  // finding them in the table cache (including opening those that were
+  // not cached) are part of it.
+  uint64_t get_from_output_files_nanos;
+  uint64_t file_probe_count;
+  uint64_t find_table_nanos;
+
+  // Seeking in the index blocks of tables.
+  uint64_t index_seek_nanos;
+
+  // Checking filters, and the number of keys that the filter of a table
+  // let through (hit) or ruled out (miss).
+  uint64_t filter_check_nanos;
+  uint64_t bloom_sst_hit_count;
+  uint64_t bloom_sst_miss_count;
+
+  // Lookups that found a block in Options::block_cache.
+  uint64_t block_cache_hit_count;
+
+  // Blocks read from table files: their number, bytes, the time spent
+  // reading them and the time spent decompressing them.
+  uint64_t block_read_count;
+  uint64_t block_read_byte;
+  uint64_t block_read_nanos;
+  uint64_t block_decompress_nanos;
+
+  // Seeking the internal iterators of DB iterators, and the entries
+  // stepped over because they were overwritten or deleted.
+  uint64_t seek_internal_seek_nanos;
+  uint64_t internal_key_skipped_count;
+  uint64_t internal_delete_skipped_count;
+};
+
+// Return the PerfContext of the calling thread.
+LEVELDB_EXPORT PerfContext* GetPerfContext();
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_PERF_CONTEXT_H_
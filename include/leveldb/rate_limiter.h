@@ -0,0 +1,71 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A RateLimiter caps the rate at which a database writes table files in
+// the background.  When a database is opened with Options::rate_limiter
+// set, every write to a table file made by a memtable flush or by a
+// compaction first asks the limiter for its bytes, so that the bursts of
+// background writes leave disk bandwidth to the writes and syncs of the
+// log that foreground writers wait for.
+//
+// A single RateLimiter may be shared by several databases to cap their
+// combined background writes.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+#define STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "leveldb/export.h"
+
+namespace leveldb {
+
+class LEVELDB_EXPORT RateLimiter {
+ public:
+  // Memtable flushes write at kHigh, compactions at kLow.  A flush that
+  // falls behind stalls the writers, whereas a compaction that falls
+  // behind only adds to the backlog of the next ones.
+  enum IOPriority { kLow, kHigh, kNumPriorities };
+
+  virtual ~RateLimiter();
+
+  // Block until "bytes" bytes may be written at priority "pri".  Waiting
+  // requests of priority kHigh are granted before those of kLow.
+  // Thread-safe.
+  virtual void Request(size_t bytes, IOPriority pri) = 0;
+
+  // Change the number of bytes per second that may be written.  In the
+  // auto-tuned mode this is the upper bound of the tuned rate.
+  // REQUIRES: bytes_per_second > 0
+  virtual void SetBytesPerSecond(int64_t bytes_per_second) = 0;
+
+  // Return the number of bytes per second currently allowed.
+  virtual int64_t GetBytesPerSecond() const = 0;
+
+  // Return the number of bytes requested so far at priority "pri".
+  virtual int64_t GetTotalBytesThrough(IOPriority pri) const = 0;
+};
+
+// Return a new token-bucket rate limiter that lets "bytes_per_second"
+// bytes be written per second, refilling its bucket every
+// "refill_period_us" microseconds.  Requests for more bytes than one
+// refill are granted in pieces, over several refill periods.
+//
+// If "auto_tuned" is true, the rate follows the demand for background
+// writes between bytes_per_second/20 and bytes_per_second: it is raised
+// while the writes keep draining the bucket, which is the case when
+// compactions are behind, and lowered while the bucket mostly goes
+// unused, which leaves the disk to foreground writes while there is
+// little compaction backlog.
+//
+// Callers must delete the result after any database that is using the
+// result has been closed.
+LEVELDB_EXPORT RateLimiter* NewGenericRateLimiter(
+    int64_t bytes_per_second,
+    int64_t refill_period_us = 100 * 1000,
+    bool auto_tuned = false);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
@@ -0,0 +1,55 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A SliceTransform maps a key to a prefix of it.  When a database is
+// opened with Options::prefix_extractor set, the filters of its tables
+// also hold the prefix of every key, so that iterators created with
+// ReadOptions::prefix_same_as_start can skip the tables and blocks that
+// hold no key with the prefix they are looking for.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+#define STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+
+#include <stddef.h>
+#include "leveldb/export.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+class LEVELDB_EXPORT SliceTransform {
+ public:
+  virtual ~SliceTransform();
+
+  // The name of the transform.  It is recorded in every table whose
+  // filter holds prefixes, and the prefixes of a table are only used if
+  // they were made by a transform of the same name.  The name must change
+  // whenever the transform changes in an incompatible way.
+  virtual const char* Name() const = 0;
+
+  // Return true iff "key" has a prefix.
+  virtual bool InDomain(const Slice& key) const = 0;
+
+  // Return the prefix of "key".  The result must start at key.data(),
+  // and the keys that share a prefix must be adjacent in the order of
+  // the database's comparator.
+  // REQUIRES: InDomain(key)
+  virtual Slice Transform(const Slice& key) const = 0;
+
+  // Return true iff "a" and "b", both results of Transform(), stand for
+  // the same prefix.  Table builders call this to store each prefix
+  // once.  The default implementation compares their bytes.
+  virtual bool SamePrefix(const Slice& a, const Slice& b) const;
+};
+
+// Return a new transform whose prefix is the first "prefix_len" bytes of
+// a key.  Keys shorter than that have no prefix.
+//
+// Callers must delete the result after any database that is using the
+// result has been closed.
+LEVELDB_EXPORT const SliceTransform* NewFixedPrefixTransform(
+    size_t prefix_len);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
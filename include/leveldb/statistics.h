@@ -0,0 +1,138 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A Statistics object collects counters ("tickers") and latency histograms
+// for the operations of a database.  When a database is opened with
+// Options::statistics set, it records into the object as it serves reads
+// and writes and runs compactions, and the "leveldb.statistics" property
+// returns a dump of everything collected.
+//
+// A single Statistics object may be shared by several databases, which
+// then add up their counts.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_STATISTICS_H_
+#define STORAGE_LEVELDB_INCLUDE_STATISTICS_H_
+
+#include <stdint.h>
+#include <string>
+#include "leveldb/export.h"
+
+namespace leveldb {
+
+enum Ticker {
+  // Lookups of blocks in Options::block_cache, and blocks added to it.
+  // The totals are broken down by the kind of block.
+  kBlockCacheMiss = 0,
+  kBlockCacheHit,
+  kBlockCacheAdd,
+  kBlockCacheIndexMiss,
+  kBlockCacheIndexHit,
+  kBlockCacheFilterMiss,
+  kBlockCacheFilterHit,
+  kBlockCacheDataMiss,
+  kBlockCacheDataHit,
+
+  // Point lookups in tables that had a filter: the ones that the filter
+  // ruled out (useful), the ones that it let through (positive), and the
+  // ones among those that found an entry for the key (true positive).
+  // Positives that are not true positives are false positives.
+  kBloomFilterUseful,
+  kBloomFilterPositive,
+  kBloomFilterTruePositive,
+
+  // Get() and MultiGet() keys answered by a memtable, or not.
+  kMemtableHit,
+  kMemtableMiss,
+
+  // Keys and bytes written by Write(), and looked up and returned by
+  // Get() and MultiGet().
+  kNumberKeysWritten,
+  kNumberKeysRead,
+  kBytesWritten,
+  kBytesRead,
+
+  // Calls of Seek(), Next() and Prev() on DB iterators.
+  kNumberDbSeek,
+  kNumberDbNext,
+  kNumberDbPrev,
+
+  // Bytes added to the log and syncs of the log.
+  kWalFileBytes,
+  kWalFileSynced,
+
+  // Microseconds that writes were delayed or stopped to let compactions
+  // catch up.
+  kStallMicros,
+
+  // Bytes read and written by compactions, and written by memtable
+  // flushes.
+  kCompactReadBytes,
+  kCompactWriteBytes,
+  kFlushWriteBytes,
+
+  kNumTickers
+};
+
+enum HistogramType {
+  kDbGetMicros = 0,
+  kDbMultiGetMicros,
+  kDbWriteMicros,
+  kDbSeekMicros,
+  kWalFileSyncMicros,
+  kCompactionMicros,
+  kFlushMicros,
+  kNumHistograms
+};
+
+struct LEVELDB_EXPORT HistogramData {
+  uint64_t count;
+  double sum;
+  double average;
+  double median;
+  double percentile95;
+  double percentile99;
+  double max;
+};
+
+class LEVELDB_EXPORT Statistics {
+ public:
+  virtual ~Statistics();
+
+  // Add "count" to the ticker.  Thread-safe.
+  virtual void RecordTick(Ticker ticker, uint64_t count = 1) = 0;
+
+  // Add a value (usually a number of microseconds) to the histogram.
+  // Thread-safe.
+  virtual void MeasureTime(HistogramType histogram, uint64_t value) = 0;
+
+  // Return the current value of the ticker.
+  virtual uint64_t GetTickerCount(Ticker ticker) const = 0;
+
+  // Store a summary of the histogram in *data.
+  virtual void GetHistogramData(HistogramType histogram,
+                                HistogramData* data) const = 0;
+
+  // Zero every ticker and histogram.
+  virtual void Reset() = 0;
+
+  // Return a human-readable dump of every ticker and histogram.
+  virtual std::string ToString() const = 0;
+};
+
+// Return the name under which ToString() reports the ticker or histogram,
+// such as "leveldb.block.cache.hit".
+LEVELDB_EXPORT const char* TickerName(Ticker ticker);
+LEVELDB_EXPORT const char* HistogramName(HistogramType histogram);
+
+// Return a new Statistics object whose tickers and histograms are split
+// across the CPUs, so that threads on different cores seldom touch the
+// same cache line.
+//
+// Callers must delete the result after any database that is using the
+// result has been closed.
+LEVELDB_EXPORT Statistics* CreateDBStatistics();
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_STATISTICS_H_
@@ -6,8 +6,10 @@
 #define STORAGE_LEVELDB_INCLUDE_TABLE_H_
 
 #include <stdint.h>
+#include "leveldb/cache.h"
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
+#include "leveldb/options.h"
 
 namespace leveldb {
 
@@ -41,6 +43,20 @@ class LEVELDB_EXPORT Table {
                      uint64_t file_size,
                      Table** table);
 
+  // Like Open() above, for the table of file "file_number" of a DB that
+  // got "cache_id" from options.block_cache->NewId().  The blocks of the
+  // table are cached under keys made of both numbers, so they are found
+  // again after the table is closed and opened again.  "level" is the
+  // level of the file, or -1 if it is not known; it decides whether
+  // options.pin_l0_filter_and_index_blocks applies.
+  static Status Open(const Options& options,
+                     RandomAccessFile* file,
+                     uint64_t file_size,
+                     uint64_t cache_id,
+                     uint64_t file_number,
+                     int level,
+                     Table** table);
+
   Table(const Table&) = delete;
   void operator=(const Table&) = delete;
 
@@ -61,11 +77,57 @@ class LEVELDB_EXPORT Table {
 
  private:
   struct Rep;
+  struct Filter;
   Rep* rep_;
 
   explicit Table(Rep* rep) { rep_ = rep; }
   static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
 
+  // Like BlockReader() and BlockMayHoldPrefix(), for iterators that read
+  // ahead (see ReadOptions::readahead_size).  The argument holds the
+  // table and the range of the file that the iterator last prefetched.
+  static Iterator* ReadaheadBlockReader(void*, const ReadOptions&,
+                                        const Slice&);
+  static bool ReadaheadBlockMayHoldPrefix(void*, const Slice& index_key,
+                                          const Slice& index_value,
+                                          const Slice& target);
+
+  // Returns the filter of the table, or nullptr if it has none or it
+  // cannot be read.  If *handle is non-null on return, the filter is held
+  // by the block cache and the caller must pass *handle to
+  // ReleaseCached() when done with it.
+  const Filter* GetFilter(Cache::Handle** handle) const;
+
+  // Like GetFilter(), for the index block.  Returns nullptr and stores
+  // the error in *status if the block cannot be read.
+  Block* GetIndexBlock(Cache::Handle** handle, Status* status) const;
+
+  void ReleaseCached(Cache::Handle* handle) const;
+
+  // Returns an iterator over the index block.
+  Iterator* NewIndexIterator() const;
+
+  // Returns false if the filters rule out that the block of the index
+  // entry (index_key, index_value) holds a key with the prefix of "target".
+  static bool BlockMayHoldPrefix(void*, const Slice& index_key,
+                                 const Slice& index_value,
+                                 const Slice& target);
+
+  // Returns false if "filter" is a full or partitioned filter that rules
+  // out that the table holds "key".  Does not search the index block.
+  bool KeyMayMatch(const Filter* filter, const Slice& key) const;
+
+  // Returns false if "filter" rules out that the block of the index
+  // entry (index_key, index_value) holds "key".
+  bool BlockMayMatch(const Filter* filter, const Slice& index_key,
+                     const Slice& index_value, const Slice& key) const;
+
+  // Returns false if the partition of "filter" that covers the data block
+  // with index key "index_key" rules out "key".  Reads the partition
+  // through the block cache.
+  bool PartitionMayMatch(const Filter* filter, const Slice& index_key,
+                         const Slice& key) const;
+
   // Calls (*handle_result)(arg, ...) with the entry found after a call
   // to Seek(key).  May not make such a call if filter policy says
   // that key is not present.
@@ -75,9 +137,28 @@ class LEVELDB_EXPORT Table {
       void* arg,
       void (*handle_result)(void* arg, const Slice& k, const Slice& v));
 
-
+  // Batched form of InternalGet() for keys[0,n-1], which must be sorted
+  // in ascending order.  Calls (*handle_result)(args[i], ...) for every
+  // key that is found and stores the status of each lookup in statuses[i].
+  // Consecutive keys that land in the same data block share a single
+  // index seek and a single block read.
+  void InternalMultiGet(
+      const ReadOptions&, int n, const Slice* keys, void* const* args,
+      void (*handle_result)(void* arg, const Slice& k, const Slice& v),
+      Status* statuses);
+
+  // Returns a new iterator over the entries that were added with
+  // TableBuilder::AddRangeDeletion().  The block is read from the file on
+  // every call.
+  Iterator* NewRangeDeletionIterator(const ReadOptions&) const;
+
+  // Returns false if the filter rules out that the table holds a key at or
+  // after "target" with the prefix of "target".  Reads no data blocks.
+  bool PrefixMayMatch(const Slice& target) const;
+
+  ReadOptions MetaReadOptions() const;
   void ReadMeta(const Footer& footer);
-  void ReadFilter(const Slice& filter_handle_value);
+  Filter* ReadFilter() const;
 };
 
 }  // namespace leveldb
@@ -50,6 +50,14 @@ class LEVELDB_EXPORT TableBuilder {
   // REQUIRES: Finish(), Abandon() have not been called
   void Add(const Slice& key, const Slice& value);
 
+  // Add key,value to a meta block that is kept apart from the entries
+  // added by Add(), for entries that must not show up in the table's
+  // iterators (the database stores range tombstones there).
+  // REQUIRES: key is after any previously added range deletion key
+  //           according to comparator.
+  // REQUIRES: Finish(), Abandon() have not been called
+  void AddRangeDeletion(const Slice& key, const Slice& value);
+
   // Advanced operation: flush any buffered key/value pairs to file.
   // Can be used to ensure that two adjacent entries never live in
   // the same data block.  Most clients should not need to use this method.
@@ -82,7 +90,16 @@ class LEVELDB_EXPORT TableBuilder {
   bool ok() const { return status().ok(); }
   void WriteBlock(BlockBuilder* block, BlockHandle* handle);
   void WriteRawBlock(const Slice& data, CompressionType, BlockHandle* handle);
-
+  void WriteRawBlock(const Slice& data, CompressionType, uint32_t crc,
+                     BlockHandle* handle);
+  void MaybeFlushFilterPartition(bool force);
+  void FinishBuffering();
+  void SubmitBlock();
+  void WritePendingBlocks(size_t max_pending);
+  void StopCompressionThreads();
+  static void CompressionThread(void* arg);
+
+  struct PendingBlock;
   struct Rep;//Rep是什么的简写
   Rep* rep_;
 };
@@ -46,6 +46,11 @@ class LEVELDB_EXPORT WriteBatch {
   // If the database contains a mapping for "key", erase it.  Else do nothing.
   void Delete(const Slice& key);
 
+  // Erase every mapping whose key k satisfies begin <= k < end, as ordered
+  // by the database's comparator.  Does nothing if begin >= end.  Unlike
+  // a Delete() per key, the whole range costs a single record.
+  void DeleteRange(const Slice& begin, const Slice& end);
+
   // Clear all updates buffered in this batch.
   void Clear();
 
@@ -61,6 +66,9 @@ class LEVELDB_EXPORT WriteBatch {
     virtual ~Handler();
     virtual void Put(const Slice& key, const Slice& value) = 0;
     virtual void Delete(const Slice& key) = 0;
+    // The default implementation ignores the record; handlers that copy
+    // or apply batches must override it.
+    virtual void DeleteRange(const Slice& begin, const Slice& end);
   };
   //遍历rep_，调用handler的Put/Delete接口写入数据
   Status Iterate(Handler* handler) const;
@@ -99,6 +99,11 @@ class AtomicPointer {
 
   // Set va as the stored pointer with no ordering guarantees.
   void NoBarrier_Store(void* v);
+
+  // If the stored pointer equals "expected", replace it with "desired"
+  // and return true; otherwise return false.  Acts as both an acquire
+  // and a release barrier.
+  bool CompareAndSwap(void* expected, void* desired);
 };
 
 // ------------------ Compression -------------------
@@ -124,6 +129,58 @@ bool Snappy_GetUncompressedLength(const char* input, size_t length,
 bool Snappy_Uncompress(const char* input_data, size_t input_length,
                        char* output);
 
+// Append the LZ4 compression of "input[0,input_length-1]" to *output.
+// Returns false if LZ4 is not supported by this port.
+bool LZ4_Compress(const char* input, size_t input_length,
+                  std::string* output);
+
+// Attempt to LZ4 uncompress input[0,input_length-1] into
+// output[0,output_length-1].  Returns true if successful, false if the
+// input is invalid or does not uncompress to exactly "output_length"
+// bytes.
+bool LZ4_Uncompress(const char* input_data, size_t input_length,
+                    char* output, size_t output_length);
+
+// Append the Zstandard compression of "input[0,input_length-1]" to
+// *output.  Returns false if Zstandard is not supported by this port.
+bool Zstd_Compress(const char* input, size_t input_length,
+                   std::string* output);
+
+// Like LZ4_Uncompress(), for data compressed by Zstd_Compress().
+bool Zstd_Uncompress(const char* input_data, size_t input_length,
+                     char* output, size_t output_length);
+
+// Train a Zstandard dictionary of at most "max_dict_bytes" bytes on the
+// samples stored one after another in "samples", with the size of each
+// sample in "sample_sizes", and store it in *dict.  Returns false if
+// Zstandard is not supported by this port or the samples are too few.
+bool Zstd_TrainDictionary(const std::string& samples,
+                          const std::vector<size_t>& sample_sizes,
+                          size_t max_dict_bytes, std::string* dict);
+
+// A dictionary prepared for Zstandard compression.  Thread-safe.
+class ZstdCompressDict {
+ public:
+  ZstdCompressDict(const char* dict, size_t size);
+  ~ZstdCompressDict();
+
+  // Like Zstd_Compress(), using the dictionary.
+  bool Compress(const char* input, size_t input_length,
+                std::string* output) const;
+};
+
+// A dictionary prepared for Zstandard uncompression.  Thread-safe.
+class ZstdUncompressDict {
+ public:
+  ZstdUncompressDict(const char* dict, size_t size);
+  ~ZstdUncompressDict();
+
+  // Like Zstd_Uncompress(), for data compressed with the same dictionary
+  // by ZstdCompressDict::Compress().
+  bool Uncompress(const char* input_data, size_t input_length,
+                  char* output, size_t output_length) const;
+};
+
 // ------------------ Miscellaneous -------------------
 
 // If heap profiling is not supported, returns false.
@@ -131,6 +188,11 @@ bool Snappy_Uncompress(const char* input_data, size_t input_length,
 // The concatenation of all "data[0,n-1]" fragments is the heap profile.
 bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg);
 
+// Return the index of the CPU that the calling thread is running on, or
+// -1 if it cannot be determined.  The thread may have moved to another CPU
+// by the time the result is used, so it may only serve as a hint.
+int PhysicalCoreID();
+
 // Extend the CRC to include the first n bytes of buf.
 //
 // Returns zero if the CRC cannot be extended using acceleration, else returns
@@ -28,6 +28,16 @@
 #if HAVE_SNAPPY
 #include <snappy.h>
 #endif  // HAVE_SNAPPY
+#if HAVE_LZ4
+#include <lz4.h>
+#endif  // HAVE_LZ4
+#if HAVE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif  // HAVE_ZSTD
+#if HAVE_SCHED_GETCPU
+#include <sched.h>
+#endif  // HAVE_SCHED_GETCPU
 
 #include <stddef.h>
 #include <stdint.h>
@@ -35,6 +45,7 @@
 #include <condition_variable>  // NOLINT
 #include <mutex>               // NOLINT
 #include <string>
+#include <vector>
 #include "port/atomic_pointer.h"
 #include "port/thread_annotations.h"
 
@@ -122,10 +133,196 @@ inline bool Snappy_Uncompress(const char* input, size_t length, char* output) {
 #endif  // HAVE_SNAPPY
 }
 
+inline bool LZ4_Compress(const char* input, size_t length,
+                         ::std::string* output) {
+#if HAVE_LZ4
+  if (length > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+    return false;
+  }
+  const size_t start = output->size();
+  const int bound = LZ4_compressBound(static_cast<int>(length));
+  output->resize(start + bound);
+  int outlen = LZ4_compress_default(input, &(*output)[start],
+                                    static_cast<int>(length), bound);
+  if (outlen <= 0) {
+    output->resize(start);
+    return false;
+  }
+  output->resize(start + outlen);
+  return true;
+#else
+  return false;
+#endif  // HAVE_LZ4
+}
+
+inline bool LZ4_Uncompress(const char* input, size_t length, char* output,
+                           size_t output_length) {
+#if HAVE_LZ4
+  return LZ4_decompress_safe(input, output, static_cast<int>(length),
+                             static_cast<int>(output_length)) ==
+         static_cast<int>(output_length);
+#else
+  return false;
+#endif  // HAVE_LZ4
+}
+
+inline bool Zstd_Compress(const char* input, size_t length,
+                          ::std::string* output) {
+#if HAVE_ZSTD
+  const size_t start = output->size();
+  const size_t bound = ZSTD_compressBound(length);
+  output->resize(start + bound);
+  size_t outlen = ZSTD_compress(&(*output)[start], bound, input, length,
+                                ZSTD_CLEVEL_DEFAULT);
+  if (ZSTD_isError(outlen)) {
+    output->resize(start);
+    return false;
+  }
+  output->resize(start + outlen);
+  return true;
+#else
+  return false;
+#endif  // HAVE_ZSTD
+}
+
+inline bool Zstd_Uncompress(const char* input, size_t length, char* output,
+                            size_t output_length) {
+#if HAVE_ZSTD
+  size_t outlen = ZSTD_decompress(output, output_length, input, length);
+  return !ZSTD_isError(outlen) && outlen == output_length;
+#else
+  return false;
+#endif  // HAVE_ZSTD
+}
+
+inline bool Zstd_TrainDictionary(const ::std::string& samples,
+                                 const ::std::vector<size_t>& sample_sizes,
+                                 size_t max_dict_bytes, ::std::string* dict) {
+#if HAVE_ZSTD
+  dict->resize(max_dict_bytes);
+  size_t n = ZDICT_trainFromBuffer(&(*dict)[0], max_dict_bytes,
+                                   samples.data(), sample_sizes.data(),
+                                   static_cast<unsigned>(sample_sizes.size()));
+  if (ZDICT_isError(n)) {
+    dict->clear();
+    return false;
+  }
+  dict->resize(n);
+  return true;
+#else
+  return false;
+#endif  // HAVE_ZSTD
+}
+
+class ZstdCompressDict {
+ public:
+  ZstdCompressDict(const char* dict, size_t size) {
+#if HAVE_ZSTD
+    cdict_ = ZSTD_createCDict(dict, size, ZSTD_CLEVEL_DEFAULT);
+#endif  // HAVE_ZSTD
+  }
+
+  ZstdCompressDict(const ZstdCompressDict&) = delete;
+  ZstdCompressDict& operator=(const ZstdCompressDict&) = delete;
+
+  ~ZstdCompressDict() {
+#if HAVE_ZSTD
+    ZSTD_freeCDict(cdict_);
+#endif  // HAVE_ZSTD
+  }
+
+  bool Compress(const char* input, size_t length,
+                ::std::string* output) const {
+#if HAVE_ZSTD
+    // Every thread keeps one context for all the tables it writes.
+    struct ThreadContext {
+      ZSTD_CCtx* ctx;
+      ThreadContext() : ctx(ZSTD_createCCtx()) { }
+      ~ThreadContext() { ZSTD_freeCCtx(ctx); }
+    };
+    static thread_local ThreadContext context;
+    if (context.ctx == nullptr || cdict_ == nullptr) {
+      return false;
+    }
+    const size_t start = output->size();
+    const size_t bound = ZSTD_compressBound(length);
+    output->resize(start + bound);
+    size_t outlen = ZSTD_compress_usingCDict(context.ctx, &(*output)[start],
+                                             bound, input, length, cdict_);
+    if (ZSTD_isError(outlen)) {
+      output->resize(start);
+      return false;
+    }
+    output->resize(start + outlen);
+    return true;
+#else
+    return false;
+#endif  // HAVE_ZSTD
+  }
+
+ private:
+#if HAVE_ZSTD
+  ZSTD_CDict* cdict_;
+#endif  // HAVE_ZSTD
+};
+
+class ZstdUncompressDict {
+ public:
+  ZstdUncompressDict(const char* dict, size_t size) {
+#if HAVE_ZSTD
+    ddict_ = ZSTD_createDDict(dict, size);
+#endif  // HAVE_ZSTD
+  }
+
+  ZstdUncompressDict(const ZstdUncompressDict&) = delete;
+  ZstdUncompressDict& operator=(const ZstdUncompressDict&) = delete;
+
+  ~ZstdUncompressDict() {
+#if HAVE_ZSTD
+    ZSTD_freeDDict(ddict_);
+#endif  // HAVE_ZSTD
+  }
+
+  bool Uncompress(const char* input, size_t length, char* output,
+                  size_t output_length) const {
+#if HAVE_ZSTD
+    // Every thread keeps one context for all the tables it reads.
+    struct ThreadContext {
+      ZSTD_DCtx* ctx;
+      ThreadContext() : ctx(ZSTD_createDCtx()) { }
+      ~ThreadContext() { ZSTD_freeDCtx(ctx); }
+    };
+    static thread_local ThreadContext context;
+    if (context.ctx == nullptr || ddict_ == nullptr) {
+      return false;
+    }
+    size_t outlen = ZSTD_decompress_usingDDict(context.ctx, output,
+                                               output_length, input, length,
+                                               ddict_);
+    return !ZSTD_isError(outlen) && outlen == output_length;
+#else
+    return false;
+#endif  // HAVE_ZSTD
+  }
+
+ private:
+#if HAVE_ZSTD
+  ZSTD_DDict* ddict_;
+#endif  // HAVE_ZSTD
+};
+
 inline bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg) {
   return false;
 }
 
+inline int PhysicalCoreID() {
+#if HAVE_SCHED_GETCPU
+  return ::sched_getcpu();
+#else
+  return -1;
+#endif  // HAVE_SCHED_GETCPU
+}
+
 inline uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size) {
 #if HAVE_CRC32C
   return ::crc32c::Extend(crc, reinterpret_cast<const uint8_t*>(buf), size);
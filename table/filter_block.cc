@@ -5,6 +5,7 @@
 #include "table/filter_block.h"
 
 #include "leveldb/filter_policy.h"
+#include "leveldb/slice_transform.h"
 #include "util/coding.h"
 
 namespace leveldb {
@@ -15,8 +16,10 @@ namespace leveldb {
 static const size_t kFilterBaseLg = 11;
 static const size_t kFilterBase = 1 << kFilterBaseLg;//2KB
 
-FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy)
-    : policy_(policy) {
+FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy,
+                                       const SliceTransform* prefix_extractor)
+    : policy_(policy),
+      prefix_extractor_(prefix_extractor) {
 }
 
 void FilterBlockBuilder::StartBlock(uint64_t block_offset) {
@@ -34,6 +37,18 @@ void FilterBlockBuilder::AddKey(const Slice& key) {
   //为什么不直接使用std::vecotr<std::string>?
   start_.push_back(keys_.size());
   keys_.append(k.data(), k.size());
+
+  // Keys arrive in order, so the keys that share a prefix are adjacent
+  if (prefix_extractor_ != nullptr && prefix_extractor_->InDomain(k)) {
+    Slice prefix = prefix_extractor_->Transform(k);
+    if (prefix_start_.empty() ||
+        !prefix_extractor_->SamePrefix(
+            prefix, Slice(prefixes_.data() + prefix_start_.back(),
+                          prefixes_.size() - prefix_start_.back()))) {
+      prefix_start_.push_back(prefixes_.size());
+      prefixes_.append(prefix.data(), prefix.size());
+    }
+  }
 }
 
 Slice FilterBlockBuilder::Finish() {
@@ -56,7 +71,7 @@ Slice FilterBlockBuilder::Finish() {
 }
 
 void FilterBlockBuilder::GenerateFilter() {
-  const size_t num_keys = start_.size();
+  const size_t num_keys = start_.size() + prefix_start_.size();
   //如果相比上一个filter data没有新的key
   //那么只更新offsets数组就返回
   if (num_keys == 0) {
@@ -69,13 +84,21 @@ void FilterBlockBuilder::GenerateFilter() {
   // starts最后一个元素是keys_的总大小，此时starts元素个数=num_keys + 1
   // 这样 [starts[i], starts[i+1]) 就可以还原所有的key了
   start_.push_back(keys_.size());  // Simplify length computation
+  prefix_start_.push_back(prefixes_.size());
   tmp_keys_.resize(num_keys);
   //遍历start_，同时通过keys_获取当前记录的所有key，存储到tmp_keys_
-  for (size_t i = 0; i < num_keys; i++) {
+  size_t n = 0;
+  for (size_t i = 0; i + 1 < start_.size(); i++) {
     const char* base = keys_.data() + start_[i];
     size_t length = start_[i+1] - start_[i];
-    tmp_keys_[i] = Slice(base, length);
+    tmp_keys_[n++] = Slice(base, length);
+  }
+  for (size_t i = 0; i + 1 < prefix_start_.size(); i++) {
+    const char* base = prefixes_.data() + prefix_start_[i];
+    size_t length = prefix_start_[i+1] - prefix_start_[i];
+    tmp_keys_[n++] = Slice(base, length);
   }
+  assert(n == num_keys);
 
   // Generate filter for current set of keys and append to result_.
   // 记录当前result_大小，也就是新的filter数据的offset
@@ -86,6 +109,65 @@ void FilterBlockBuilder::GenerateFilter() {
   tmp_keys_.clear();
   keys_.clear();
   start_.clear();
+  prefixes_.clear();
+  prefix_start_.clear();
+}
+
+FullFilterBlockBuilder::FullFilterBlockBuilder(
+    const FilterPolicy* policy, const SliceTransform* prefix_extractor)
+    : policy_(policy),
+      prefix_extractor_(prefix_extractor),
+      has_last_prefix_(false) {
+}
+
+void FullFilterBlockBuilder::AddKey(const Slice& key) {
+  start_.push_back(keys_.size());
+  keys_.append(key.data(), key.size());
+
+  // Keys arrive in order, so the keys that share a prefix are adjacent.
+  // Distinct prefixes are stored among the keys; the filter policy does
+  // not care about the order of its keys.
+  if (prefix_extractor_ != nullptr && prefix_extractor_->InDomain(key)) {
+    Slice prefix = prefix_extractor_->Transform(key);
+    if (!has_last_prefix_ ||
+        !prefix_extractor_->SamePrefix(prefix, Slice(last_prefix_))) {
+      last_prefix_.assign(prefix.data(), prefix.size());
+      has_last_prefix_ = true;
+      start_.push_back(keys_.size());
+      keys_.append(prefix.data(), prefix.size());
+    }
+  }
+}
+
+Slice FullFilterBlockBuilder::Finish() {
+  result_.clear();
+  const size_t num_keys = start_.size();
+  if (num_keys > 0) {
+    start_.push_back(keys_.size());  // Simplify length computation
+    tmp_keys_.resize(num_keys);
+    for (size_t i = 0; i < num_keys; i++) {
+      const char* base = keys_.data() + start_[i];
+      size_t length = start_[i+1] - start_[i];
+      tmp_keys_[i] = Slice(base, length);
+    }
+    policy_->CreateFilter(&tmp_keys_[0], static_cast<int>(num_keys),
+                          &result_);
+  }
+
+  tmp_keys_.clear();
+  keys_.clear();
+  start_.clear();
+  has_last_prefix_ = false;
+  return Slice(result_);
+}
+
+bool FullFilterMayMatch(const FilterPolicy* policy, const Slice& contents,
+                        const Slice& key) {
+  if (contents.empty()) {
+    // Empty filters do not match any keys
+    return false;
+  }
+  return policy->KeyMayMatch(key, contents);
 }
 
 FilterBlockReader::FilterBlockReader(const FilterPolicy* policy,
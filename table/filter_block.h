@@ -4,7 +4,8 @@
 //
 // A filter block is stored near the end of a Table file.  It contains
 // filters (e.g., bloom filters) for all data blocks in the table combined
-// into a single filter block.
+// into a single filter block.  A full filter block instead holds one
+// filter for all keys of the table, or of one partition of the table.
 
 #ifndef STORAGE_LEVELDB_TABLE_FILTER_BLOCK_H_
 #define STORAGE_LEVELDB_TABLE_FILTER_BLOCK_H_
@@ -19,16 +20,19 @@
 namespace leveldb {
 
 class FilterPolicy;
+class SliceTransform;
 
 // A FilterBlockBuilder is used to construct all of the filters for a
 // particular Table.  It generates a single string which is stored as
-// a special block in the Table.
+// a special block in the Table.  If a prefix extractor is supplied, the
+// filters also hold the prefix of every key that has one.
 //
 // The sequence of calls to FilterBlockBuilder must match the regexp:
 //      (StartBlock AddKey*)* Finish
 class FilterBlockBuilder {
  public:
-  explicit FilterBlockBuilder(const FilterPolicy*);
+  explicit FilterBlockBuilder(const FilterPolicy*,
+                              const SliceTransform* prefix_extractor = nullptr);
 
   void StartBlock(uint64_t block_offset);
   void AddKey(const Slice& key);
@@ -38,8 +42,11 @@ class FilterBlockBuilder {
   void GenerateFilter();
 
   const FilterPolicy* policy_;
+  const SliceTransform* prefix_extractor_;
   std::string keys_;              // Flattened key contents
   std::vector<size_t> start_;     // Starting index in keys_ of each key
+  std::string prefixes_;          // Flattened distinct prefixes of the keys
+  std::vector<size_t> prefix_start_;  // Starting index in prefixes_
   std::string result_;            // Filter data computed so far
   std::vector<Slice> tmp_keys_;   // policy_->CreateFilter() argument
   std::vector<uint32_t> filter_offsets_;
@@ -49,6 +56,46 @@ class FilterBlockBuilder {
   void operator=(const FilterBlockBuilder&);
 };
 
+// A FullFilterBlockBuilder builds a single filter over every key added
+// since the last call to Finish().
+//
+// The sequence of calls to FullFilterBlockBuilder must match the regexp:
+//      (AddKey* Finish)*
+class FullFilterBlockBuilder {
+ public:
+  explicit FullFilterBlockBuilder(
+      const FilterPolicy*, const SliceTransform* prefix_extractor = nullptr);
+
+  void AddKey(const Slice& key);
+
+  // Number of keys added since the last call to Finish()
+  size_t NumKeys() const { return start_.size(); }
+
+  // Return the filter for the keys added since the last call to Finish()
+  // and forget them.  The result is empty if there were no keys, and
+  // stays valid until the next call to Finish().
+  Slice Finish();
+
+ private:
+  const FilterPolicy* policy_;
+  const SliceTransform* prefix_extractor_;
+  std::string keys_;              // Flattened key contents
+  std::vector<size_t> start_;     // Starting index in keys_ of each key
+  std::string last_prefix_;       // Prefix of the last key, if any
+  bool has_last_prefix_;
+  std::string result_;            // Filter data returned by Finish()
+  std::vector<Slice> tmp_keys_;   // policy_->CreateFilter() argument
+
+  // No copying allowed
+  FullFilterBlockBuilder(const FullFilterBlockBuilder&);
+  void operator=(const FullFilterBlockBuilder&);
+};
+
+// Return true if the full filter "contents" may hold "key".  An empty
+// filter holds no keys.
+bool FullFilterMayMatch(const FilterPolicy* policy, const Slice& contents,
+                        const Slice& key);
+
 class FilterBlockReader {
  public:
  // REQUIRES: "contents" and *policy must stay live while *this is live.
@@ -5,6 +5,7 @@
 #include "table/filter_block.h"
 
 #include "leveldb/filter_policy.h"
+#include "leveldb/slice_transform.h"
 #include "util/coding.h"
 #include "util/hash.h"
 #include "util/logging.h"
@@ -121,6 +122,38 @@ TEST(FilterBlockTest, MultiChunk) {
   ASSERT_TRUE(! reader.KeyMayMatch(9000, "bar"));
 }
 
+TEST(FilterBlockTest, Prefixes) {
+  const SliceTransform* prefix_extractor = NewFixedPrefixTransform(3);
+  FilterBlockBuilder builder(&policy_, prefix_extractor);
+
+  // First filter
+  builder.StartBlock(0);
+  builder.AddKey("foo1");
+  builder.AddKey("foo2");
+  builder.AddKey("fo");
+
+  // Second filter
+  builder.StartBlock(3100);
+  builder.AddKey("bar1");
+
+  Slice block = builder.Finish();
+  FilterBlockReader reader(&policy_, block);
+
+  // Check first filter
+  ASSERT_TRUE(reader.KeyMayMatch(0, "foo1"));
+  ASSERT_TRUE(reader.KeyMayMatch(0, "foo2"));
+  ASSERT_TRUE(reader.KeyMayMatch(0, "fo"));
+  ASSERT_TRUE(reader.KeyMayMatch(0, "foo"));
+  ASSERT_TRUE(! reader.KeyMayMatch(0, "bar"));
+
+  // Check second filter
+  ASSERT_TRUE(reader.KeyMayMatch(3100, "bar1"));
+  ASSERT_TRUE(reader.KeyMayMatch(3100, "bar"));
+  ASSERT_TRUE(! reader.KeyMayMatch(3100, "foo"));
+
+  delete prefix_extractor;
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
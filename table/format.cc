@@ -4,11 +4,13 @@
 
 #include "table/format.h"
 
+#include <vector>
 #include "leveldb/env.h"
 #include "port/port.h"
 #include "table/block.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/perf_context.h"
 
 namespace leveldb {
 
@@ -64,29 +66,13 @@ Status Footer::DecodeFrom(Slice* input) {
   return result;
 }
 
-//从file读取数据，偏移量和size由handle指定
-//result->data记录数据部分(除去CompressionType + CRC.)
-//file可能是PosixMmapReadableFile or PosixRandomAccessFile
-//对于PosixMmapReadableFile，数据已经在内存，因此cachable=False,heap_allocated=False
-//对于PosixRandomAccessFile，不持有数据，因此cachable=True,heap_allocated=True
-Status ReadBlock(RandomAccessFile* file,
-                 const ReadOptions& options,
-                 const BlockHandle& handle,
-                 BlockContents* result) {
-  result->data = Slice();
-  result->cachable = false;
-  result->heap_allocated = false;
-
-  // Read the block contents as well as the type/crc footer.
-  // See table_builder.cc for the code that built this structure.
-  size_t n = static_cast<size_t>(handle.size());
-  char* buf = new char[n + kBlockTrailerSize];
-  Slice contents;
-  Status s = file->Read(handle.offset(), n + kBlockTrailerSize, &contents, buf);
-  if (!s.ok()) {
-    delete[] buf;
-    return s;
-  }
+// Check and uncompress "contents", the block of size "n" and its trailer
+// as read into "buf", a new[] array of n + kBlockTrailerSize bytes that
+// is passed on to *result or deleted.
+static Status DecodeBlock(const ReadOptions& options, size_t n, char* buf,
+                          const Slice& contents, BlockContents* result,
+                          const port::ZstdUncompressDict* dict) {
+  Status s;
   if (contents.size() != n + kBlockTrailerSize) {
     delete[] buf;
     return Status::Corruption("truncated block read");
@@ -106,6 +92,10 @@ Status ReadBlock(RandomAccessFile* file,
   }
 
   //倒数第5个字节读取CompressionType
+  PerfTimer decompress_timer(&PerfContext::block_decompress_nanos);
+  if (data[n] != kNoCompression) {
+    decompress_timer.Start();
+  }
   switch (data[n]) {
     case kNoCompression:
       if (data != buf) {
@@ -142,6 +132,35 @@ Status ReadBlock(RandomAccessFile* file,
       result->cachable = true;
       break;
     }
+    case kLZ4Compression:
+    case kZstdCompression: {
+      uint32_t ulength = 0;
+      const char* p = GetVarint32Ptr(data, data + n, &ulength);
+      if (p == nullptr) {
+        delete[] buf;
+        return Status::Corruption("corrupted compressed block contents");
+      }
+      const size_t clength = (data + n) - p;
+      char* ubuf = new char[ulength];
+      bool ok;
+      if (data[n] == kLZ4Compression) {
+        ok = port::LZ4_Uncompress(p, clength, ubuf, ulength);
+      } else if (dict != nullptr) {
+        ok = dict->Uncompress(p, clength, ubuf, ulength);
+      } else {
+        ok = port::Zstd_Uncompress(p, clength, ubuf, ulength);
+      }
+      if (!ok) {
+        delete[] buf;
+        delete[] ubuf;
+        return Status::Corruption("corrupted compressed block contents");
+      }
+      delete[] buf;
+      result->data = Slice(ubuf, ulength);
+      result->heap_allocated = true;
+      result->cachable = true;
+      break;
+    }
     default:
       delete[] buf;
       return Status::Corruption("bad block type");
@@ -150,4 +169,73 @@ Status ReadBlock(RandomAccessFile* file,
   return Status::OK();
 }
 
+//从file读取数据，偏移量和size由handle指定
+//result->data记录数据部分(除去CompressionType + CRC.)
+//file可能是PosixMmapReadableFile or PosixRandomAccessFile
+//对于PosixMmapReadableFile，数据已经在内存，因此cachable=False,heap_allocated=False
+//对于PosixRandomAccessFile，不持有数据，因此cachable=True,heap_allocated=True
+Status ReadBlock(RandomAccessFile* file,
+                 const ReadOptions& options,
+                 const BlockHandle& handle,
+                 BlockContents* result,
+                 const port::ZstdUncompressDict* dict) {
+  result->data = Slice();
+  result->cachable = false;
+  result->heap_allocated = false;
+
+  // Read the block contents as well as the type/crc footer.
+  // See table_builder.cc for the code that built this structure.
+  size_t n = static_cast<size_t>(handle.size());
+  char* buf = new char[n + kBlockTrailerSize];
+  Slice contents;
+  PerfTimer read_timer(&PerfContext::block_read_nanos);
+  read_timer.Start();
+  Status s = file->Read(handle.offset(), n + kBlockTrailerSize, &contents, buf);
+  read_timer.Stop();
+  PerfCount(&PerfContext::block_read_count);
+  PerfCount(&PerfContext::block_read_byte, n + kBlockTrailerSize);
+  if (!s.ok()) {
+    delete[] buf;
+    return s;
+  }
+  return DecodeBlock(options, n, buf, contents, result, dict);
+}
+
+void ReadBlocks(RandomAccessFile* file,
+                const ReadOptions& options,
+                int num_blocks,
+                const BlockHandle* handles,
+                BlockContents* results,
+                Status* statuses,
+                const port::ZstdUncompressDict* dict) {
+  std::vector<ReadRequest> requests(num_blocks);
+  uint64_t bytes = 0;
+  for (int i = 0; i < num_blocks; i++) {
+    results[i].data = Slice();
+    results[i].cachable = false;
+    results[i].heap_allocated = false;
+    requests[i].offset = handles[i].offset();
+    requests[i].n = static_cast<size_t>(handles[i].size()) + kBlockTrailerSize;
+    requests[i].scratch = new char[requests[i].n];
+    bytes += requests[i].n;
+  }
+  if (num_blocks > 0) {
+    PerfTimer read_timer(&PerfContext::block_read_nanos);
+    read_timer.Start();
+    file->MultiRead(&requests[0], num_blocks);
+  }
+  PerfCount(&PerfContext::block_read_count, num_blocks);
+  PerfCount(&PerfContext::block_read_byte, bytes);
+  for (int i = 0; i < num_blocks; i++) {
+    if (!requests[i].status.ok()) {
+      delete[] requests[i].scratch;
+      statuses[i] = requests[i].status;
+    } else {
+      statuses[i] = DecodeBlock(options, static_cast<size_t>(handles[i].size()),
+                                requests[i].scratch, requests[i].result,
+                                &results[i], dict);
+    }
+  }
+}
+
 }  // namespace leveldb
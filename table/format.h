@@ -10,6 +10,7 @@
 #include "leveldb/slice.h"
 #include "leveldb/status.h"
 #include "leveldb/table_builder.h"
+#include "port/port.h"
 
 namespace leveldb {
 
@@ -92,11 +93,24 @@ struct BlockContents {
 };
 
 // Read the block identified by "handle" from "file".  On failure
-// return non-OK.  On success fill *result and return OK.
+// return non-OK.  On success fill *result and return OK.  "dict", if
+// non-null, is the compression dictionary of the data blocks of the file.
 Status ReadBlock(RandomAccessFile* file,
                  const ReadOptions& options,
                  const BlockHandle& handle,
-                 BlockContents* result);
+                 BlockContents* result,
+                 const port::ZstdUncompressDict* dict = nullptr);
+
+// Like ReadBlock(), for the blocks handles[0,num_blocks-1], whose reads
+// are issued together through RandomAccessFile::MultiRead().  Stores the
+// outcome for each block in results[i] and statuses[i].
+void ReadBlocks(RandomAccessFile* file,
+                const ReadOptions& options,
+                int num_blocks,
+                const BlockHandle* handles,
+                BlockContents* results,
+                Status* statuses,
+                const port::ZstdUncompressDict* dict = nullptr);
 
 // Implementation details follow.  Clients should ignore,
 
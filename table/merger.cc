@@ -4,6 +4,8 @@
 
 #include "table/merger.h"
 
+#include <vector>
+
 #include "leveldb/comparator.h"
 #include "leveldb/iterator.h"
 #include "table/iterator_wrapper.h"
@@ -11,6 +13,12 @@
 namespace leveldb {
 
 namespace {
+
+// Above this many children, MergingIterator keeps the valid children in
+// a binary heap instead of scanning all of them on every step.  Merges
+// over a level-0 backlog or a large compaction can have dozens of inputs.
+static const int kMaxLinearChildren = 8;
+
 class MergingIterator : public Iterator {
  public:
   MergingIterator(const Comparator* comparator, Iterator** children, int n)
@@ -18,10 +26,14 @@ class MergingIterator : public Iterator {
         children_(new IteratorWrapper[n]),
         n_(n),
         current_(nullptr),
-        direction_(kForward) {
+        direction_(kForward),
+        use_heap_(n > kMaxLinearChildren) {
     for (int i = 0; i < n; i++) {
       children_[i].Set(children[i]);
     }
+    if (use_heap_) {
+      heap_.reserve(n);
+    }
   }
 
   virtual ~MergingIterator() {
@@ -36,24 +48,24 @@ class MergingIterator : public Iterator {
     for (int i = 0; i < n_; i++) {
       children_[i].SeekToFirst();
     }
-    FindSmallest();
     direction_ = kForward;
+    FindSmallest();
   }
 
   virtual void SeekToLast() {
     for (int i = 0; i < n_; i++) {
       children_[i].SeekToLast();
     }
-    FindLargest();
     direction_ = kReverse;
+    FindLargest();
   }
 
   virtual void Seek(const Slice& target) {
     for (int i = 0; i < n_; i++) {
       children_[i].Seek(target);
     }
-    FindSmallest();
     direction_ = kForward;
+    FindSmallest();
   }
 
   virtual void Next() {
@@ -76,10 +88,13 @@ class MergingIterator : public Iterator {
         }
       }
       direction_ = kForward;
+      current_->Next();
+      FindSmallest();
+      return;
     }
 
     current_->Next();
-    FindSmallest();
+    CurrentMoved();
   }
 
   virtual void Prev() {
@@ -105,10 +120,13 @@ class MergingIterator : public Iterator {
         }
       }
       direction_ = kReverse;
+      current_->Prev();
+      FindLargest();
+      return;
     }
 
     current_->Prev();
-    FindLargest();
+    CurrentMoved();
   }
 
   virtual Slice key() const {
@@ -133,12 +151,24 @@ class MergingIterator : public Iterator {
   }
 
  private:
+  // Point current_ at the smallest (largest) valid child.  When use_heap_
+  // is set, also rebuild heap_ for direction_, which must already be
+  // kForward (kReverse).
   void FindSmallest();
   void FindLargest();
 
-  // We might want to use a heap in case there are lots of children.
-  // For now we use a simple array since we expect a very small number
-  // of children in leveldb.
+  // Called after current_ stepped once in direction_ to restore
+  // current_ without revisiting children that did not move.
+  void CurrentMoved();
+
+  // Heap maintenance.  heap_ holds every valid child, ordered so that the
+  // child to yield next in direction_ is at heap_[0].
+  bool HeapBefore(const IteratorWrapper* a, const IteratorWrapper* b) const;
+  void BuildHeap();
+  void SiftDown(size_t pos);
+
+  // For a small number of children a simple scan over the array is
+  // cheapest; above kMaxLinearChildren we keep a heap.
   const Comparator* comparator_;
   IteratorWrapper* children_;
   int n_;
@@ -150,9 +180,17 @@ class MergingIterator : public Iterator {
     kReverse
   };
   Direction direction_;
+
+  const bool use_heap_;
+  std::vector<IteratorWrapper*> heap_;
 };
 
 void MergingIterator::FindSmallest() {
+  assert(direction_ == kForward);
+  if (use_heap_) {
+    BuildHeap();
+    return;
+  }
   IteratorWrapper* smallest = nullptr;
   for (int i = 0; i < n_; i++) {
     IteratorWrapper* child = &children_[i];
@@ -168,6 +206,11 @@ void MergingIterator::FindSmallest() {
 }
 
 void MergingIterator::FindLargest() {
+  assert(direction_ == kReverse);
+  if (use_heap_) {
+    BuildHeap();
+    return;
+  }
   IteratorWrapper* largest = nullptr;
   for (int i = n_-1; i >= 0; i--) {
     IteratorWrapper* child = &children_[i];
@@ -181,6 +224,74 @@ void MergingIterator::FindLargest() {
   }
   current_ = largest;
 }
+
+void MergingIterator::CurrentMoved() {
+  if (!use_heap_) {
+    if (direction_ == kForward) {
+      FindSmallest();
+    } else {
+      FindLargest();
+    }
+    return;
+  }
+
+  assert(!heap_.empty() && heap_[0] == current_);
+  if (!current_->Valid()) {
+    heap_[0] = heap_.back();
+    heap_.pop_back();
+  }
+  if (!heap_.empty()) {
+    SiftDown(0);
+  }
+  current_ = heap_.empty() ? nullptr : heap_[0];
+}
+
+// Ties are broken by position in children_ so that the heap yields equal
+// keys in the same order as the linear scan: lowest index first when
+// moving forward, highest index first when moving backward.
+bool MergingIterator::HeapBefore(const IteratorWrapper* a,
+                                 const IteratorWrapper* b) const {
+  int r = comparator_->Compare(a->key(), b->key());
+  if (direction_ == kForward) {
+    return r < 0 || (r == 0 && a < b);
+  } else {
+    return r > 0 || (r == 0 && a > b);
+  }
+}
+
+void MergingIterator::BuildHeap() {
+  heap_.clear();
+  for (int i = 0; i < n_; i++) {
+    if (children_[i].Valid()) {
+      heap_.push_back(&children_[i]);
+    }
+  }
+  for (size_t i = heap_.size() / 2; i > 0; i--) {
+    SiftDown(i - 1);
+  }
+  current_ = heap_.empty() ? nullptr : heap_[0];
+}
+
+void MergingIterator::SiftDown(size_t pos) {
+  const size_t size = heap_.size();
+  IteratorWrapper* item = heap_[pos];
+  while (true) {
+    size_t child = 2 * pos + 1;
+    if (child >= size) {
+      break;
+    }
+    if (child + 1 < size && HeapBefore(heap_[child + 1], heap_[child])) {
+      child++;
+    }
+    if (!HeapBefore(heap_[child], item)) {
+      break;
+    }
+    heap_[pos] = heap_[child];
+    pos = child;
+  }
+  heap_[pos] = item;
+}
+
 }  // namespace
 
 Iterator* NewMergingIterator(const Comparator* cmp, Iterator** list, int n) {
@@ -4,41 +4,158 @@
 
 #include "leveldb/table.h"
 
+#include <string.h>
+#include <vector>
+
 #include "leveldb/cache.h"
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/slice_transform.h"
 #include "table/block.h"
 #include "table/filter_block.h"
 #include "table/format.h"
 #include "table/two_level_iterator.h"
 #include "util/coding.h"
+#include "util/perf_context.h"
+#include "util/statistics.h"
 
 namespace leveldb {
 
+// The filter of a table, in one of the formats of FilterFormat.  Held by
+// Table::Rep, or by the block cache if cache_index_and_filter_blocks is set.
+struct Table::Filter {
+  FilterBlockReader* block_based;  // kBlockBasedFilter
+  Slice full;                      // kFullFilter
+  Block* partition_index;          // kPartitionedFilter
+  const char* heap_data;           // Heap copy of the filter data, if any
+
+  Filter() : block_based(nullptr), partition_index(nullptr),
+             heap_data(nullptr) { }
+  ~Filter() {
+    delete block_based;
+    delete partition_index;
+    delete[] heap_data;
+  }
+
+  static void DeleteCached(const Slice& key, void* value) {
+    delete reinterpret_cast<Filter*>(value);
+  }
+};
+
+// Length of a block cache key: see Rep::CacheKey()
+static const size_t kCacheKeyLength = 24;
+
 struct Table::Rep {
   ~Rep() {
-    delete filter;
-    delete [] filter_data;
-    delete index_block;
+    Cache* block_cache = options.block_cache;
+    if (pinned_filter != nullptr) {
+      block_cache->Release(pinned_filter);
+    } else {
+      delete filter;
+    }
+    if (pinned_index != nullptr) {
+      block_cache->Release(pinned_index);
+    } else {
+      delete index_block;
+    }
+    delete compression_dict;
+  }
+
+  // Block cache key of the block at "offset": cache_id, file_number and
+  // offset.  The result is stored in buf[0,kCacheKeyLength-1].
+  Slice CacheKey(uint64_t offset, char* buf) const {
+    EncodeFixed64(buf, cache_id);
+    EncodeFixed64(buf + 8, file_number);
+    EncodeFixed64(buf + 16, offset);
+    return Slice(buf, kCacheKeyLength);
   }
 
   Options options;
   Status status;
   RandomAccessFile* file;
   uint64_t cache_id;
-  FilterBlockReader* filter;
-  const char* filter_data;
+  uint64_t file_number;
+  bool cache_meta_blocks;        // Index and filter live in the block cache
+
+  bool has_filter;
+  FilterFormat filter_format;
+  BlockHandle filter_handle;
+  Filter* filter;                // Held by the table or pinned, or nullptr
+  Cache::Handle* pinned_filter;  // Block cache entry of "filter" if pinned
+  bool prefix_filtered;          // Whether filters hold the key prefixes
 
   BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
-  Block* index_block;
+  BlockHandle index_handle;
+  Block* index_block;            // Held by the table or pinned, or nullptr
+  Cache::Handle* pinned_index;   // Block cache entry of "index_block"
+
+  bool has_range_dels;           // Whether range_del_handle is valid
+  BlockHandle range_del_handle;  // Handle to the range deletion block
+
+  // Dictionary of the data blocks, or nullptr
+  port::ZstdUncompressDict* compression_dict;
 };
 
+// Make *contents own its data, which may point into a memory-mapped file.
+// Blocks cached under the stable keys of Rep::CacheKey() may outlive the
+// file mapping.
+static void CopyToHeap(BlockContents* contents) {
+  if (!contents->heap_allocated) {
+    char* buf = new char[contents->data.size()];
+    memcpy(buf, contents->data.data(), contents->data.size());
+    contents->data = Slice(buf, contents->data.size());
+    contents->heap_allocated = true;
+  }
+}
+
+static void DeleteBlock(void* arg, void* ignored) {
+  delete reinterpret_cast<Block*>(arg);
+}
+
+static void DeleteCachedBlock(const Slice& key, void* value) {
+  Block* block = reinterpret_cast<Block*>(value);
+  delete block;
+}
+
+static void ReleaseBlock(void* arg, void* h) {
+  Cache* cache = reinterpret_cast<Cache*>(arg);
+  Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(h);
+  cache->Release(handle);
+}
+
+// Record a block cache lookup in the totals and in "hit_ticker" or
+// "miss_ticker", which count the lookups of one kind of block, and count
+// hits in the PerfContext of the thread.
+static void RecordCacheLookup(Statistics* stats, const Cache::Handle* handle,
+                              Ticker hit_ticker, Ticker miss_ticker) {
+  if (handle != nullptr) {
+    PerfCount(&PerfContext::block_cache_hit_count);
+  }
+  if (stats != nullptr) {
+    const bool hit = (handle != nullptr);
+    stats->RecordTick(hit ? kBlockCacheHit : kBlockCacheMiss);
+    stats->RecordTick(hit ? hit_ticker : miss_ticker);
+  }
+}
+
 Status Table::Open(const Options& options,
                    RandomAccessFile* file,
                    uint64_t size,
                    Table** table) {
+  const uint64_t cache_id =
+      (options.block_cache ? options.block_cache->NewId() : 0);
+  return Open(options, file, size, cache_id, 0, -1, table);
+}
+
+Status Table::Open(const Options& options,
+                   RandomAccessFile* file,
+                   uint64_t size,
+                   uint64_t cache_id,
+                   uint64_t file_number,
+                   int level,
+                   Table** table) {
   *table = nullptr;
   //Footer采用固定长度编码，文件小于这个长度就直接忽略了
   if (size < Footer::kEncodedLength) {
@@ -57,54 +174,88 @@ Status Table::Open(const Options& options,
   s = footer.DecodeFrom(&footer_input);
   if (!s.ok()) return s;
 
+  Rep* rep = new Table::Rep;
+  rep->options = options;
+  rep->file = file;
+  rep->cache_id = cache_id;
+  rep->file_number = file_number;
+  rep->cache_meta_blocks = (options.cache_index_and_filter_blocks &&
+                            options.block_cache != nullptr);
+  rep->has_filter = false;
+  rep->filter_format = kBlockBasedFilter;
+  rep->filter = nullptr;
+  rep->pinned_filter = nullptr;
+  rep->prefix_filtered = false;
+  rep->metaindex_handle = footer.metaindex_handle();
+  rep->index_handle = footer.index_handle();
+  rep->index_block = nullptr;
+  rep->pinned_index = nullptr;
+  rep->has_range_dels = false;
+  rep->compression_dict = nullptr;
+  Table* t = new Table(rep);
+
   // Read the index block
   // footer里存储了index block的offset&size，即index_handle
   // 读取对应的内容，内容存储到index_block_contents
-  BlockContents index_block_contents;
-  if (s.ok()) {
-    ReadOptions opt;
-    if (options.paranoid_checks) {
-      opt.verify_checksums = true;
+  const bool pin = (rep->cache_meta_blocks && level == 0 &&
+                    options.pin_l0_filter_and_index_blocks);
+  if (!rep->cache_meta_blocks) {
+    BlockContents index_block_contents;
+    s = ReadBlock(file, t->MetaReadOptions(), footer.index_handle(),
+                  &index_block_contents);
+    if (s.ok()) {
+      // 根据index_block_contents解析出index_block
+      rep->index_block = new Block(index_block_contents);
+    }
+  } else {
+    // Reading the index block now reports a broken table at open time,
+    // like the branch above.
+    Block* block = t->GetIndexBlock(&rep->pinned_index, &s);
+    if (pin) {
+      rep->index_block = block;
+    } else if (rep->pinned_index != nullptr) {
+      options.block_cache->Release(rep->pinned_index);
+      rep->pinned_index = nullptr;
     }
-    s = ReadBlock(file, opt, footer.index_handle(), &index_block_contents);
   }
 
   if (s.ok()) {
     // We've successfully read the footer and the index block: we're
     // ready to serve requests.
-    // 根据index_block_contents解析出index_block
-    Block* index_block = new Block(index_block_contents);
-    Rep* rep = new Table::Rep;
-    rep->options = options;
-    rep->file = file;
-    rep->metaindex_handle = footer.metaindex_handle();
-    rep->index_block = index_block;
-    rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);//获取一个全局唯一的ID
-    rep->filter_data = nullptr;
-    rep->filter = nullptr;
-    *table = new Table(rep);
     // 读取filter数据
-    (*table)->ReadMeta(footer);
+    t->ReadMeta(footer);
+    if (rep->has_filter && !rep->cache_meta_blocks) {
+      rep->filter = t->ReadFilter();
+    } else if (rep->has_filter && pin) {
+      rep->filter = const_cast<Filter*>(t->GetFilter(&rep->pinned_filter));
+    }
+    *table = t;
+  } else {
+    delete t;
   }
-
   return s;
 }
 
-//读取filter
-void Table::ReadMeta(const Footer& footer) {
-  if (rep_->options.filter_policy == nullptr) {
-    return;  // Do not need any metadata
-  }
-
-  // TODO(sanjay): Skip this if footer.metaindex_handle() size indicates
-  // it is an empty block.
+ReadOptions Table::MetaReadOptions() const {
   ReadOptions opt;
   if (rep_->options.paranoid_checks) {
     opt.verify_checksums = true;
   }
+  return opt;
+}
+
+//读取filter
+void Table::ReadMeta(const Footer& footer) {
+  // An empty metaindex block holds just its restart array: a single
+  // restart point and the number of restarts.
+  if (footer.metaindex_handle().size() <= 2 * sizeof(uint32_t)) {
+    return;  // No meta blocks
+  }
+
   BlockContents contents;
   //读取metaindex_handle指向的内容，即metaindex_block，存储到contents
-  if (!ReadBlock(rep_->file, opt, footer.metaindex_handle(), &contents).ok()) {
+  if (!ReadBlock(rep_->file, MetaReadOptions(), footer.metaindex_handle(),
+                 &contents).ok()) {
     // Do not propagate errors since meta info is not needed for operation
     return;
   }
@@ -112,59 +263,167 @@ void Table::ReadMeta(const Footer& footer) {
 
   //metaindex_block存储了filter_block的信息：key=filter.${FilterName}, value=size&offset of filter_block
   Iterator* iter = meta->NewIterator(BytewiseComparator());
-  std::string key = "filter.";
-  key.append(rep_->options.filter_policy->Name());
-  iter->Seek(key);
-  if (iter->Valid() && iter->key() == Slice(key)) {
-    //iter->value()即filter_blcok的size&offset
-    ReadFilter(iter->value());
+  if (rep_->options.filter_policy != nullptr) {
+    // A table holds filters of at most one format
+    static const FilterFormat kFormats[] = {
+      kFullFilter, kPartitionedFilter, kBlockBasedFilter
+    };
+    static const char* kPrefixes[] = {
+      "fullfilter.", "partitionedfilter.", "filter."
+    };
+    for (int i = 0; i < 3; i++) {
+      std::string key = kPrefixes[i];
+      key.append(rep_->options.filter_policy->Name());
+      iter->Seek(key);
+      if (iter->Valid() && iter->key() == Slice(key)) {
+        //iter->value()即filter_blcok的size&offset
+        Slice v = iter->value();
+        rep_->has_filter = rep_->filter_handle.DecodeFrom(&v).ok();
+        rep_->filter_format = kFormats[i];
+        break;
+      }
+    }
+  }
+  if (rep_->has_filter && rep_->options.prefix_extractor != nullptr) {
+    std::string key = "prefix.";
+    key.append(rep_->options.prefix_extractor->Name());
+    iter->Seek(key);
+    rep_->prefix_filtered = (iter->Valid() && iter->key() == Slice(key));
+  }
+  iter->Seek("leveldb.range_del");
+  if (iter->Valid() && iter->key() == Slice("leveldb.range_del")) {
+    Slice v = iter->value();
+    rep_->has_range_dels = rep_->range_del_handle.DecodeFrom(&v).ok();
+  }
+  iter->Seek("leveldb.compression_dict");
+  if (iter->Valid() && iter->key() == Slice("leveldb.compression_dict")) {
+    // Without the dictionary, reading the data blocks reports corruption
+    Slice v = iter->value();
+    BlockHandle handle;
+    BlockContents dict;
+    if (handle.DecodeFrom(&v).ok() &&
+        ReadBlock(rep_->file, MetaReadOptions(), handle, &dict).ok()) {
+      rep_->compression_dict = new port::ZstdUncompressDict(
+          dict.data.data(), dict.data.size());
+      if (dict.heap_allocated) {
+        delete[] dict.data.data();
+      }
+    }
   }
   delete iter;
   delete meta;
 }
 
-void Table::ReadFilter(const Slice& filter_handle_value) {
-  Slice v = filter_handle_value;
-  BlockHandle filter_handle;
-  if (!filter_handle.DecodeFrom(&v).ok()) {
-    return;
-  }
-
+Table::Filter* Table::ReadFilter() const {
   // We might want to unify with ReadBlock() if we start
   // requiring checksum verification in Table::Open.
-  ReadOptions opt;
-  if (rep_->options.paranoid_checks) {
-    opt.verify_checksums = true;
-  }
   BlockContents block;
   //读取filter_handle指向的内容，即filter_block，存储到block
-  if (!ReadBlock(rep_->file, opt, filter_handle, &block).ok()) {
-    return;
+  if (!ReadBlock(rep_->file, MetaReadOptions(), rep_->filter_handle,
+                 &block).ok()) {
+    return nullptr;
+  }
+  if (rep_->cache_meta_blocks) {
+    CopyToHeap(&block);
+  }
+  Filter* filter = new Filter;
+  if (rep_->filter_format == kPartitionedFilter) {
+    // The partition index is an ordinary block that owns its contents
+    filter->partition_index = new Block(block);
+    return filter;
   }
   if (block.heap_allocated) {
-    rep_->filter_data = block.data.data();     // Will need to delete later
+    filter->heap_data = block.data.data();     // Will need to delete later
   }
-  //根据block内的数据构造FilterBlockReader
-  rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data);
+  if (rep_->filter_format == kFullFilter) {
+    filter->full = block.data;
+  } else {
+    //根据block内的数据构造FilterBlockReader
+    filter->block_based = new FilterBlockReader(rep_->options.filter_policy,
+                                                block.data);
+  }
+  return filter;
 }
 
-Table::~Table() {
-  delete rep_;
+const Table::Filter* Table::GetFilter(Cache::Handle** handle) const {
+  *handle = nullptr;
+  if (!rep_->has_filter) {
+    return nullptr;
+  } else if (rep_->filter != nullptr) {
+    return rep_->filter;
+  } else if (!rep_->cache_meta_blocks) {
+    // The filter could not be read when the table was opened
+    return nullptr;
+  }
+
+  Cache* block_cache = rep_->options.block_cache;
+  char cache_key_buffer[kCacheKeyLength];
+  Slice key = rep_->CacheKey(rep_->filter_handle.offset(), cache_key_buffer);
+  *handle = block_cache->Lookup(key, Cache::kHighPriority);
+  RecordCacheLookup(rep_->options.statistics, *handle, kBlockCacheFilterHit,
+                    kBlockCacheFilterMiss);
+  if (*handle == nullptr) {
+    Filter* filter = ReadFilter();
+    if (filter == nullptr) {
+      return nullptr;  // Errors are treated as potential matches
+    }
+    *handle = block_cache->Insert(key, filter, rep_->filter_handle.size(),
+                                  &Filter::DeleteCached, Cache::kHighPriority);
+    RecordTick(rep_->options.statistics, kBlockCacheAdd);
+  }
+  return reinterpret_cast<Filter*>(block_cache->Value(*handle));
 }
 
-static void DeleteBlock(void* arg, void* ignored) {
-  delete reinterpret_cast<Block*>(arg);
+Block* Table::GetIndexBlock(Cache::Handle** handle, Status* s) const {
+  *handle = nullptr;
+  if (rep_->index_block != nullptr) {
+    return rep_->index_block;
+  }
+
+  Cache* block_cache = rep_->options.block_cache;
+  char cache_key_buffer[kCacheKeyLength];
+  Slice key = rep_->CacheKey(rep_->index_handle.offset(), cache_key_buffer);
+  *handle = block_cache->Lookup(key, Cache::kHighPriority);
+  RecordCacheLookup(rep_->options.statistics, *handle, kBlockCacheIndexHit,
+                    kBlockCacheIndexMiss);
+  if (*handle == nullptr) {
+    BlockContents contents;
+    *s = ReadBlock(rep_->file, MetaReadOptions(), rep_->index_handle,
+                   &contents);
+    if (!s->ok()) {
+      return nullptr;
+    }
+    CopyToHeap(&contents);
+    Block* block = new Block(contents);
+    *handle = block_cache->Insert(key, block, block->size(),
+                                  &DeleteCachedBlock, Cache::kHighPriority);
+    RecordTick(rep_->options.statistics, kBlockCacheAdd);
+  }
+  return reinterpret_cast<Block*>(block_cache->Value(*handle));
 }
 
-static void DeleteCachedBlock(const Slice& key, void* value) {
-  Block* block = reinterpret_cast<Block*>(value);
-  delete block;
+void Table::ReleaseCached(Cache::Handle* handle) const {
+  if (handle != nullptr) {
+    rep_->options.block_cache->Release(handle);
+  }
 }
 
-static void ReleaseBlock(void* arg, void* h) {
-  Cache* cache = reinterpret_cast<Cache*>(arg);
-  Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(h);
-  cache->Release(handle);
+Iterator* Table::NewIndexIterator() const {
+  Cache::Handle* handle;
+  Status s;
+  Block* index_block = GetIndexBlock(&handle, &s);
+  if (index_block == nullptr) {
+    return NewErrorIterator(s);
+  }
+  Iterator* iter = index_block->NewIterator(rep_->options.comparator);
+  if (handle != nullptr) {
+    iter->RegisterCleanup(&ReleaseBlock, rep_->options.block_cache, handle);
+  }
+  return iter;
+}
+
+Table::~Table() {
+  delete rep_;
 }
 
 // Convert an index iterator value (i.e., an encoded BlockHandle)
@@ -187,30 +446,34 @@ Iterator* Table::BlockReader(void* arg,
   if (s.ok()) {
     BlockContents contents;
     if (block_cache != nullptr) {
-      // cache key = (cache_id + offset)
+      // cache key = (cache_id + file_number + offset)
       // cache_id不同Table间保证唯一
       // 同一Table的不同data block有唯一的offset
       // 因此可以作为cache key.
-      char cache_key_buffer[16];
-      EncodeFixed64(cache_key_buffer, table->rep_->cache_id);
-      EncodeFixed64(cache_key_buffer+8, handle.offset());
-      Slice key(cache_key_buffer, sizeof(cache_key_buffer));
-      cache_handle = block_cache->Lookup(key);
+      char cache_key_buffer[kCacheKeyLength];
+      Slice key = table->rep_->CacheKey(handle.offset(), cache_key_buffer);
+      cache_handle = block_cache->Lookup(key, Cache::kLowPriority);
+      RecordCacheLookup(table->rep_->options.statistics, cache_handle,
+                        kBlockCacheDataHit, kBlockCacheDataMiss);
       if (cache_handle != nullptr) {
         block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
       } else {
-        s = ReadBlock(table->rep_->file, options, handle, &contents);
+        s = ReadBlock(table->rep_->file, options, handle, &contents,
+                      table->rep_->compression_dict);
         if (s.ok()) {
           block = new Block(contents);
           if (contents.cachable && options.fill_cache) {//本次DB::Get结果是否充缓存
             cache_handle = block_cache->Insert(
-                key, block, block->size(), &DeleteCachedBlock);
+                key, block, block->size(), &DeleteCachedBlock,
+                Cache::kLowPriority);
+            RecordTick(table->rep_->options.statistics, kBlockCacheAdd);
           }
         }
       }
     } else {
       //从table->rep_->file按照handle读取数据，数据存储到contents
-      s = ReadBlock(table->rep_->file, options, handle, &contents);
+      s = ReadBlock(table->rep_->file, options, handle, &contents,
+                    table->rep_->compression_dict);
       if (s.ok()) {
         block = new Block(contents);
       }
@@ -231,30 +494,258 @@ Iterator* Table::BlockReader(void* arg,
   return iter;
 }
 
+Iterator* Table::NewRangeDeletionIterator(const ReadOptions& options) const {
+  if (!rep_->has_range_dels) {
+    return NewEmptyIterator();
+  }
+  BlockContents contents;
+  Status s = ReadBlock(rep_->file, options, rep_->range_del_handle, &contents);
+  if (!s.ok()) {
+    return NewErrorIterator(s);
+  }
+  Block* block = new Block(contents);
+  Iterator* iter = block->NewIterator(rep_->options.comparator);
+  iter->RegisterCleanup(&DeleteBlock, block, nullptr);
+  return iter;
+}
+
+static void DeleteCachedFilterPartition(const Slice& key, void* value) {
+  delete[] reinterpret_cast<char*>(value);
+}
+
+bool Table::PartitionMayMatch(const Filter* filter, const Slice& index_key,
+                              const Slice& key) const {
+  Iterator* iter =
+      filter->partition_index->NewIterator(rep_->options.comparator);
+  iter->Seek(index_key);
+  BlockHandle handle;
+  Slice input;
+  if (iter->Valid()) {
+    input = iter->value();
+  }
+  if (!iter->Valid() || !handle.DecodeFrom(&input).ok()) {
+    // Keys past the last partition are not in the table
+    bool may_match = !iter->status().ok() || iter->Valid();
+    delete iter;
+    return may_match;
+  }
+  delete iter;
+
+  // Partitions share the block cache (and its key space) with the data
+  // blocks of the table.  Cached partitions hold the partition data,
+  // whose size is the size of the partition's block handle.
+  Cache* block_cache = rep_->options.block_cache;
+  Cache::Handle* cache_handle = nullptr;
+  char cache_key_buffer[kCacheKeyLength];
+  Slice cache_key = rep_->CacheKey(handle.offset(), cache_key_buffer);
+  if (block_cache != nullptr) {
+    cache_handle = block_cache->Lookup(cache_key, Cache::kHighPriority);
+    RecordCacheLookup(rep_->options.statistics, cache_handle,
+                      kBlockCacheFilterHit, kBlockCacheFilterMiss);
+  }
+  bool may_match = true;  // Errors are treated as potential matches
+  if (cache_handle != nullptr) {
+    Slice data(reinterpret_cast<const char*>(block_cache->Value(cache_handle)),
+               handle.size());
+    may_match = FullFilterMayMatch(rep_->options.filter_policy, data, key);
+    block_cache->Release(cache_handle);
+  } else {
+    BlockContents contents;
+    if (ReadBlock(rep_->file, MetaReadOptions(), handle, &contents).ok() &&
+        contents.data.size() == handle.size()) {
+      may_match = FullFilterMayMatch(rep_->options.filter_policy,
+                                     contents.data, key);
+      // Unlike data blocks, partitions that were read from a memory-mapped
+      // file are cached too (as a copy), which saves the Read() on the
+      // next lookup.
+      if (block_cache != nullptr) {
+        CopyToHeap(&contents);
+        block_cache->Release(block_cache->Insert(
+            cache_key, const_cast<char*>(contents.data.data()),
+            contents.data.size(), &DeleteCachedFilterPartition,
+            Cache::kHighPriority));
+        RecordTick(rep_->options.statistics, kBlockCacheAdd);
+      } else if (contents.heap_allocated) {
+        delete[] contents.data.data();
+      }
+    }
+  }
+  return may_match;
+}
+
+bool Table::KeyMayMatch(const Filter* filter, const Slice& key) const {
+  if (filter == nullptr) {
+    return true;
+  } else if (filter->partition_index != nullptr) {
+    return PartitionMayMatch(filter, key, key);
+  } else if (filter->block_based == nullptr) {
+    return FullFilterMayMatch(rep_->options.filter_policy, filter->full, key);
+  }
+  return true;
+}
+
+bool Table::BlockMayMatch(const Filter* filter, const Slice& index_key,
+                          const Slice& index_value, const Slice& key) const {
+  if (filter != nullptr && filter->block_based != nullptr) {
+    BlockHandle handle;
+    Slice input = index_value;
+    return !handle.DecodeFrom(&input).ok() ||
+           filter->block_based->KeyMayMatch(handle.offset(), key);
+  } else if (filter != nullptr && filter->partition_index != nullptr) {
+    // The partition that holds the block ends with a block whose index
+    // key is >= index_key.
+    return PartitionMayMatch(filter, index_key, key);
+  }
+  return KeyMayMatch(filter, key);
+}
+
+bool Table::BlockMayHoldPrefix(void* arg, const Slice& index_key,
+                               const Slice& index_value, const Slice& target) {
+  Table* table = reinterpret_cast<Table*>(arg);
+  const SliceTransform* prefix_extractor =
+      table->rep_->options.prefix_extractor;
+  if (!table->rep_->prefix_filtered || !prefix_extractor->InDomain(target)) {
+    return true;
+  }
+  Cache::Handle* filter_handle;
+  const Filter* filter = table->GetFilter(&filter_handle);
+  bool may_match = table->BlockMayMatch(filter, index_key, index_value,
+                                        prefix_extractor->Transform(target));
+  table->ReleaseCached(filter_handle);
+  return may_match;
+}
+
+bool Table::PrefixMayMatch(const Slice& target) const {
+  if (!rep_->prefix_filtered ||
+      !rep_->options.prefix_extractor->InDomain(target)) {
+    return true;
+  }
+  // The first key at or after target is either in the block that Seek()
+  // lands on or the first key of the next block.
+  Iterator* iiter = NewIndexIterator();
+  iiter->Seek(target);
+  bool may_match = false;
+  for (int i = 0; i < 2 && iiter->Valid() && !may_match; i++) {
+    may_match = BlockMayHoldPrefix(const_cast<Table*>(this), iiter->key(),
+                                   iiter->value(), target);
+    iiter->Next();
+  }
+  if (!iiter->status().ok()) {
+    may_match = true;
+  }
+  delete iiter;
+  return may_match;
+}
+
+namespace {
+
+// The range of the file that an iterator last prefetched
+struct Readahead {
+  Table* table;
+  uint64_t start;
+  uint64_t limit;
+};
+
+void DeleteReadahead(void* arg, void* ignored) {
+  delete reinterpret_cast<Readahead*>(arg);
+}
+
+}  // namespace
+
+Iterator* Table::ReadaheadBlockReader(void* arg,
+                                      const ReadOptions& options,
+                                      const Slice& index_value) {
+  Readahead* r = reinterpret_cast<Readahead*>(arg);
+  Iterator* iter = BlockReader(r->table, options, index_value);
+
+  BlockHandle handle;
+  Slice input = index_value;
+  if (handle.DecodeFrom(&input).ok()) {
+    // Prefetch from the end of the block, unless the scan is still in the
+    // first half of the prefetched range
+    const uint64_t end = handle.offset() + handle.size() + kBlockTrailerSize;
+    if (end < r->start || end + options.readahead_size / 2 > r->limit) {
+      const uint64_t from =
+          (end >= r->start && end <= r->limit) ? r->limit : end;
+      r->start = end;
+      r->limit = end + options.readahead_size;
+      r->table->rep_->file->Prefetch(from, r->limit - from);
+    }
+  }
+  return iter;
+}
+
+bool Table::ReadaheadBlockMayHoldPrefix(void* arg, const Slice& index_key,
+                                        const Slice& index_value,
+                                        const Slice& target) {
+  return BlockMayHoldPrefix(reinterpret_cast<Readahead*>(arg)->table,
+                            index_key, index_value, target);
+}
+
 Iterator* Table::NewIterator(const ReadOptions& options) const {
+  if (options.readahead_size > 0) {
+    Readahead* r = new Readahead;
+    r->table = const_cast<Table*>(this);
+    r->start = 0;
+    r->limit = 0;
+    Iterator* iter = NewTwoLevelIterator(
+        NewIndexIterator(), &Table::ReadaheadBlockReader, r, options,
+        rep_->prefix_filtered ? &Table::ReadaheadBlockMayHoldPrefix : nullptr);
+    iter->RegisterCleanup(&DeleteReadahead, r, nullptr);
+    return iter;
+  }
   return NewTwoLevelIterator(
       //传入index_block的iterator
-      rep_->index_block->NewIterator(rep_->options.comparator),
-      &Table::BlockReader, const_cast<Table*>(this), options);
+      NewIndexIterator(),
+      &Table::BlockReader, const_cast<Table*>(this), options,
+      rep_->prefix_filtered ? &Table::BlockMayHoldPrefix : nullptr);
 }
 
 Status Table::InternalGet(const ReadOptions& options, const Slice& k,
                           void* arg,
                           void (*saver)(void*, const Slice&, const Slice&)) {
+  Statistics* stats = rep_->options.statistics;
+  Cache::Handle* filter_handle;
+  const Filter* filter = GetFilter(&filter_handle);
+  // Whole-table filters can reject k without searching the index
+  PerfTimer filter_timer(&PerfContext::filter_check_nanos);
+  filter_timer.Start();
+  const bool table_may_match = KeyMayMatch(filter, k);
+  filter_timer.Stop();
+  if (!table_may_match) {
+    RecordTick(stats, kBloomFilterUseful);
+    PerfCount(&PerfContext::bloom_sst_miss_count);
+    ReleaseCached(filter_handle);
+    return Status::OK();
+  }
+
   Status s;
-  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  Iterator* iiter = NewIndexIterator();
   //在index block内查找k可能位于哪个data block
+  PerfTimer index_timer(&PerfContext::index_seek_nanos);
+  index_timer.Start();
   iiter->Seek(k);
+  index_timer.Stop();
   if (iiter->Valid()) {
     Slice handle_value = iiter->value();
-    FilterBlockReader* filter = rep_->filter;
     BlockHandle handle;
-    if (filter != nullptr &&
-        handle.DecodeFrom(&handle_value).ok() &&
-        !filter->KeyMayMatch(handle.offset(), k)) {
+    bool block_may_match = true;
+    if (filter != nullptr && filter->block_based != nullptr &&
+        handle.DecodeFrom(&handle_value).ok()) {
+      filter_timer.Start();
+      block_may_match = filter->block_based->KeyMayMatch(handle.offset(), k);
+      filter_timer.Stop();
+    }
+    if (!block_may_match) {
       //filter判断不存在，那么一定不存在
       // Not found
+      RecordTick(stats, kBloomFilterUseful);
+      PerfCount(&PerfContext::bloom_sst_miss_count);
     } else {
+      if (filter != nullptr) {
+        RecordTick(stats, kBloomFilterPositive);
+        PerfCount(&PerfContext::bloom_sst_hit_count);
+      }
       //iiter->value记录了一个data block的offset && size，读取之
       Iterator* block_iter = BlockReader(this, options, iiter->value());
       //在data block内查找k
@@ -270,13 +761,163 @@ Status Table::InternalGet(const ReadOptions& options, const Slice& k,
     s = iiter->status();
   }
   delete iiter;
+  ReleaseCached(filter_handle);
   return s;
 }
 
+void Table::InternalMultiGet(
+    const ReadOptions& options, int n, const Slice* keys, void* const* args,
+    void (*saver)(void*, const Slice&, const Slice&), Status* statuses) {
+  const Comparator* cmp = rep_->options.comparator;
+  Statistics* stats = rep_->options.statistics;
+  Cache::Handle* filter_handle;
+  const Filter* filter = GetFilter(&filter_handle);
+  FilterBlockReader* block_filter =
+      (filter != nullptr ? filter->block_based : nullptr);
+
+  // Find the data block of every key that the filters do not rule out.
+  // block_of[i] indexes "handles", or is -1 if statuses[i] is already set.
+  std::vector<int> block_of(n, -1);
+  std::vector<BlockHandle> handles;
+  Iterator* iiter = NewIndexIterator();
+  bool positioned = false;
+  for (int i = 0; i < n; i++) {
+    const Slice& k = keys[i];
+    if (!KeyMayMatch(filter, k)) {
+      // Not found
+      RecordTick(stats, kBloomFilterUseful);
+      PerfCount(&PerfContext::bloom_sst_miss_count);
+      statuses[i] = Status::OK();
+      continue;
+    }
+    // keys[] is sorted, so the index entry found for an earlier key is
+    // still the right one for k unless k sorts after its separator key.
+    if (!positioned ||
+        (iiter->Valid() && cmp->Compare(iiter->key(), k) < 0)) {
+      PerfTimer index_timer(&PerfContext::index_seek_nanos);
+      index_timer.Start();
+      iiter->Seek(k);
+      positioned = true;
+    }
+    if (!iiter->Valid()) {
+      // k (and therefore every later key) is past the end of the table
+      statuses[i] = iiter->status();
+      continue;
+    }
+
+    Slice handle_value = iiter->value();
+    BlockHandle handle;
+    Status s = handle.DecodeFrom(&handle_value);
+    if (!s.ok()) {
+      statuses[i] = s;
+      continue;
+    }
+    if (block_filter != nullptr &&
+        !block_filter->KeyMayMatch(handle.offset(), k)) {
+      // Not found
+      RecordTick(stats, kBloomFilterUseful);
+      PerfCount(&PerfContext::bloom_sst_miss_count);
+      statuses[i] = Status::OK();
+      continue;
+    }
+    if (filter != nullptr) {
+      RecordTick(stats, kBloomFilterPositive);
+      PerfCount(&PerfContext::bloom_sst_hit_count);
+    }
+    if (handles.empty() || handles.back().offset() != handle.offset()) {
+      handles.push_back(handle);
+    }
+    block_of[i] = static_cast<int>(handles.size()) - 1;
+  }
+  delete iiter;
+
+  // Take the blocks from the block cache where possible and read all the
+  // others with one batch of reads.
+  const int num_blocks = static_cast<int>(handles.size());
+  Cache* block_cache = rep_->options.block_cache;
+  std::vector<Block*> blocks(num_blocks, nullptr);
+  std::vector<Cache::Handle*> cache_handles(num_blocks, nullptr);
+  std::vector<Status> block_statuses(num_blocks);
+  std::vector<int> missing;
+  std::vector<BlockHandle> missing_handles;
+  char cache_key_buffer[kCacheKeyLength];
+  for (int b = 0; b < num_blocks; b++) {
+    if (block_cache != nullptr) {
+      Slice key = rep_->CacheKey(handles[b].offset(), cache_key_buffer);
+      cache_handles[b] = block_cache->Lookup(key, Cache::kLowPriority);
+      RecordCacheLookup(stats, cache_handles[b], kBlockCacheDataHit,
+                        kBlockCacheDataMiss);
+      if (cache_handles[b] != nullptr) {
+        blocks[b] = reinterpret_cast<Block*>(block_cache->Value(
+            cache_handles[b]));
+        continue;
+      }
+    }
+    missing.push_back(b);
+    missing_handles.push_back(handles[b]);
+  }
+  if (!missing.empty()) {
+    const int num_missing = static_cast<int>(missing.size());
+    std::vector<BlockContents> contents(num_missing);
+    std::vector<Status> read_statuses(num_missing);
+    ReadBlocks(rep_->file, options, num_missing, &missing_handles[0],
+               &contents[0], &read_statuses[0], rep_->compression_dict);
+    for (int m = 0; m < num_missing; m++) {
+      const int b = missing[m];
+      block_statuses[b] = read_statuses[m];
+      if (!read_statuses[m].ok()) {
+        continue;
+      }
+      blocks[b] = new Block(contents[m]);
+      if (block_cache != nullptr && contents[m].cachable &&
+          options.fill_cache) {
+        Slice key = rep_->CacheKey(handles[b].offset(), cache_key_buffer);
+        cache_handles[b] = block_cache->Insert(
+            key, blocks[b], blocks[b]->size(), &DeleteCachedBlock,
+            Cache::kLowPriority);
+        RecordTick(stats, kBlockCacheAdd);
+      }
+    }
+  }
+
+  // Look the keys up in their blocks
+  Iterator* block_iter = nullptr;
+  int current = -1;
+  for (int i = 0; i < n; i++) {
+    const int b = block_of[i];
+    if (b < 0) {
+      continue;
+    }
+    if (!block_statuses[b].ok()) {
+      statuses[i] = block_statuses[b];
+      continue;
+    }
+    if (b != current) {
+      delete block_iter;
+      block_iter = blocks[b]->NewIterator(cmp);
+      current = b;
+    }
+    block_iter->Seek(keys[i]);
+    if (block_iter->Valid()) {
+      (*saver)(args[i], block_iter->key(), block_iter->value());
+    }
+    statuses[i] = block_iter->status();
+  }
+  delete block_iter;
+
+  for (int b = 0; b < num_blocks; b++) {
+    if (cache_handles[b] != nullptr) {
+      block_cache->Release(cache_handles[b]);
+    } else {
+      delete blocks[b];
+    }
+  }
+  ReleaseCached(filter_handle);
+}
+
 
 uint64_t Table::ApproximateOffsetOf(const Slice& key) const {
-  Iterator* index_iter =
-      rep_->index_block->NewIterator(rep_->options.comparator);
+  Iterator* index_iter = NewIndexIterator();
   index_iter->Seek(key);
   uint64_t result;
   if (index_iter->Valid()) {
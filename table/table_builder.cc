@@ -5,18 +5,93 @@
 #include "leveldb/table_builder.h"
 
 #include <assert.h>
+#include <deque>
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/slice_transform.h"
+#include "port/port.h"
 #include "table/block_builder.h"
 #include "table/filter_block.h"
 #include "table/format.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/mutexlock.h"
 
 namespace leveldb {
 
+// Compress "raw" with *type and return the contents to store, which may
+// point into *compressed.  Sets *type to kNoCompression if the data was
+// stored uncompressed.  "dict", if non-null, is used for kZstdCompression.
+static Slice CompressBlock(const Slice& raw,
+                           const port::ZstdCompressDict* dict,
+                           CompressionType* type,
+                           std::string* compressed) {
+  bool ok = false;
+  // TODO(postrelease): Support more compression options: zlib?
+  switch (*type) {
+    //不采用任何压缩方式，直接取raw数据
+    case kNoCompression:
+      return raw;
+
+    case kSnappyCompression:
+      //调用snappy压缩raw，压缩结果存储到compressed
+      ok = port::Snappy_Compress(raw.data(), raw.size(), compressed);
+      break;
+
+    case kLZ4Compression:
+    case kZstdCompression:
+      // The compressed data is preceded by the uncompressed size of the
+      // block, which neither library records in a raw block by itself.
+      PutVarint32(compressed, static_cast<uint32_t>(raw.size()));
+      if (*type == kLZ4Compression) {
+        ok = port::LZ4_Compress(raw.data(), raw.size(), compressed);
+      } else if (dict != nullptr) {
+        ok = dict->Compress(raw.data(), raw.size(), compressed);
+      } else {
+        ok = port::Zstd_Compress(raw.data(), raw.size(), compressed);
+      }
+      break;
+
+    default:
+      break;
+  }
+  //如果compressed.size < raw.size() * 7/8，即压缩后大小小于原来的87.5，则使用压缩后数据
+  if (ok && compressed->size() < raw.size() - (raw.size() / 8u)) {
+    return *compressed;
+  }
+  //压缩比例太小，则即使指定了压缩方式，也不采用任何压缩方式
+  // Not supported, or compressed less than 12.5%, so just store
+  // uncompressed form
+  *type = kNoCompression;
+  return raw;
+}
+
+// Return the masked crc of "contents" and its block type, as stored in
+// the block trailer.
+static uint32_t BlockChecksum(const Slice& contents, CompressionType type) {
+  char type_byte = type;
+  uint32_t crc = crc32c::Value(contents.data(), contents.size());
+  crc = crc32c::Extend(crc, &type_byte, 1);  // Extend crc to cover block type
+  return crc32c::Mask(crc);
+}
+
+// A data block on its way through the compression threads.
+struct TableBuilder::PendingBlock {
+  std::string raw;        // Uncompressed contents
+  std::string keys;       // Length-prefixed keys of the block, for filter_block
+  std::string index_key;  // Valid once has_index_key is set
+  bool has_index_key;
+
+  // Set by the compression thread; valid once done is set
+  std::string compressed;
+  Slice contents;
+  CompressionType type;
+  uint32_t crc;
+  bool done;
+};
+
 struct TableBuilder::Rep {
   Options options;
   Options index_block_options;
@@ -27,10 +102,17 @@ struct TableBuilder::Rep {
   //不过block_restart_interval参数不同
   BlockBuilder data_block;
   BlockBuilder index_block;
+  BlockBuilder range_del_block;
   std::string last_key;
   int64_t num_entries;
   bool closed;          // Either Finish() or Abandon() has been called.
+  // At most one of filter_block and full_filter is non-null, depending
+  // on options.filter_format.
   FilterBlockBuilder* filter_block;
+  FullFilterBlockBuilder* full_filter;
+  // kPartitionedFilter: maps the index key of the last data block of each
+  // written partition to the handle of that partition.
+  BlockBuilder filter_index_block;
 
   // We do not emit the index entry for a block until we have seen the
   // first key for the next data block.  This allows us to use shorter
@@ -48,6 +130,34 @@ struct TableBuilder::Rep {
 
   std::string compressed_output;
 
+  // While "buffering" is set, Add() only records the key/value pairs in
+  // "buffered" and the contents of the data blocks they make up in
+  // "samples".  Once enough samples are collected, the compression
+  // dictionary is trained on them and the buffered pairs are added again.
+  bool buffering;
+  std::string buffered;
+  std::vector<size_t> buffered_block_ends;  // Block boundaries in "buffered"
+  std::string samples;
+  std::vector<size_t> sample_sizes;
+  std::string compression_dict;
+  port::ZstdCompressDict* zstd_dict;  // Compresses the data blocks, or null
+
+  // With options.compression_threads > 1, Flush() hands data blocks to
+  // compression threads and the blocks are written in order as they come
+  // back.  The index entry of a block, and its keys for a block-based
+  // filter (whose layout depends on block offsets), are added when the
+  // block is written.
+  bool parallel;
+  std::deque<PendingBlock*> pending_blocks;  // In file order
+  std::string block_keys;  // Keys of data_block, for filter_block
+  uint64_t pending_bytes;  // Uncompressed size of pending_blocks
+
+  port::Mutex mu;
+  port::CondVar cv;  // Signalled when a block or a thread is done
+  std::deque<PendingBlock*> compress_queue GUARDED_BY(mu);
+  int running_threads GUARDED_BY(mu);
+  bool stop_threads GUARDED_BY(mu);
+
   Rep(const Options& opt, WritableFile* f)
       : options(opt),
         index_block_options(opt),
@@ -55,12 +165,29 @@ struct TableBuilder::Rep {
         offset(0),
         data_block(&options),
         index_block(&index_block_options),
+        range_del_block(&options),
         num_entries(0),
         closed(false),
         //default opt.filter_policy is nullptr
-        filter_block(opt.filter_policy == nullptr ? nullptr
-                     : new FilterBlockBuilder(opt.filter_policy)),
-        pending_index_entry(false) {
+        filter_block(opt.filter_policy == nullptr ||
+                     opt.filter_format != kBlockBasedFilter ? nullptr
+                     : new FilterBlockBuilder(opt.filter_policy,
+                                              opt.prefix_extractor)),
+        full_filter(opt.filter_policy == nullptr ||
+                    opt.filter_format == kBlockBasedFilter ? nullptr
+                    : new FullFilterBlockBuilder(opt.filter_policy,
+                                                 opt.prefix_extractor)),
+        filter_index_block(&index_block_options),
+        pending_index_entry(false),
+        buffering(opt.compression == kZstdCompression &&
+                  opt.zstd_max_dict_bytes > 0),
+        zstd_dict(nullptr),
+        parallel(opt.compression_threads > 1 &&
+                 opt.compression != kNoCompression),
+        pending_bytes(0),
+        cv(&mu),
+        running_threads(0),
+        stop_threads(false) {
     //index_block调用一次Add，同时更新restarts_
     index_block_options.block_restart_interval = 1;
   }
@@ -72,11 +199,20 @@ TableBuilder::TableBuilder(const Options& options, WritableFile* file)
   if (rep_->filter_block != nullptr) {
     rep_->filter_block->StartBlock(0);
   }
+  if (rep_->parallel) {
+    rep_->running_threads = options.compression_threads;
+    for (int i = 0; i < options.compression_threads; i++) {
+      options.env->StartThread(&TableBuilder::CompressionThread, rep_);
+    }
+  }
 }
 
 TableBuilder::~TableBuilder() {
   assert(rep_->closed);  // Catch errors where caller forgot to call Finish()
+  assert(rep_->pending_blocks.empty());
   delete rep_->filter_block;
+  delete rep_->full_filter;
+  delete rep_->zstd_dict;
   delete rep_;
 }
 
@@ -87,6 +223,10 @@ Status TableBuilder::ChangeOptions(const Options& options) {
   if (options.comparator != rep_->options.comparator) {
     return Status::InvalidArgument("changing comparator while building table");
   }
+  if (options.filter_format != rep_->options.filter_format) {
+    return Status::InvalidArgument(
+        "changing filter format while building table");
+  }
 
   // Note that any live BlockBuilders point to rep_->options and therefore
   // will automatically pick up the updated options.
@@ -106,21 +246,50 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
     assert(r->options.comparator->Compare(key, Slice(r->last_key)) > 0);
   }
 
+  if (r->buffering) {
+    PutLengthPrefixedSlice(&r->buffered, key);
+    PutLengthPrefixedSlice(&r->buffered, value);
+    r->last_key.assign(key.data(), key.size());
+    r->num_entries++;
+    r->data_block.Add(key, value);
+    if (r->data_block.CurrentSizeEstimate() >= r->options.block_size) {
+      Flush();
+    }
+    return;
+  }
+
   //刚写入了一个data block后设置为true
   if (r->pending_index_entry) {
     assert(r->data_block.empty());
     //计算满足>=r->last_key && < key的第一个字符串，存储到r->last_key
     //例如(abcdefg, abcdxyz) -> 1st_arg = abcdf
     r->options.comparator->FindShortestSeparator(&r->last_key, key);
-    std::string handle_encoding;
-    //pending_handle记录的是上个block写入前的offset及大小
-    r->pending_handle.EncodeTo(&handle_encoding);
-    r->index_block.Add(r->last_key, Slice(handle_encoding));
+    if (r->parallel) {
+      PendingBlock* block = r->pending_blocks.back();
+      block->index_key = r->last_key;
+      block->has_index_key = true;
+    } else {
+      std::string handle_encoding;
+      //pending_handle记录的是上个block写入前的offset及大小
+      r->pending_handle.EncodeTo(&handle_encoding);
+      r->index_block.Add(r->last_key, Slice(handle_encoding));
+    }
     r->pending_index_entry = false;
+    MaybeFlushFilterPartition(false);
+    if (r->parallel) {
+      WritePendingBlocks(r->options.compression_threads * 2);
+    }
   }
 
   if (r->filter_block != nullptr) {
-    r->filter_block->AddKey(key);
+    if (r->parallel) {
+      PutLengthPrefixedSlice(&r->block_keys, key);
+    } else {
+      r->filter_block->AddKey(key);
+    }
+  }
+  if (r->full_filter != nullptr) {
+    r->full_filter->AddKey(key);
   }
 
   r->last_key.assign(key.data(), key.size());
@@ -134,13 +303,36 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
   }
 }
 
+void TableBuilder::AddRangeDeletion(const Slice& key, const Slice& value) {
+  Rep* r = rep_;
+  assert(!r->closed);
+  if (!ok()) return;
+  r->range_del_block.Add(key, value);
+}
+
 //写入data block，更新pending handle, filter_block
 void TableBuilder::Flush() {
   Rep* r = rep_;
   assert(!r->closed);
   if (!ok()) return;
   if (r->data_block.empty()) return;
+  if (r->buffering) {
+    Slice raw = r->data_block.Finish();
+    r->samples.append(raw.data(), raw.size());
+    r->sample_sizes.push_back(raw.size());
+    r->buffered_block_ends.push_back(r->buffered.size());
+    r->data_block.Reset();
+    if (r->samples.size() >= r->options.zstd_max_train_bytes) {
+      FinishBuffering();
+    }
+    return;
+  }
   assert(!r->pending_index_entry);
+  if (r->parallel) {
+    SubmitBlock();
+    r->pending_index_entry = true;
+    return;
+  }
   //写入r->data_block到r->file
   //更新pending_handle: size为r->data_block的大小，offset为写入data_block前的offset
   //因此pending_handle可以定位一个完整的data_block
@@ -156,6 +348,174 @@ void TableBuilder::Flush() {
   }
 }
 
+// Train the compression dictionary on the samples and add the buffered
+// key/value pairs for real, in data blocks with the same boundaries.
+void TableBuilder::FinishBuffering() {
+  Rep* r = rep_;
+  assert(r->buffering);
+  r->buffering = false;
+  if (port::Zstd_TrainDictionary(r->samples, r->sample_sizes,
+                                 r->options.zstd_max_dict_bytes,
+                                 &r->compression_dict)) {
+    r->zstd_dict = new port::ZstdCompressDict(r->compression_dict.data(),
+                                              r->compression_dict.size());
+  }
+  std::string().swap(r->samples);
+  std::vector<size_t>().swap(r->sample_sizes);
+
+  std::string buffered;
+  std::vector<size_t> block_ends;
+  buffered.swap(r->buffered);
+  block_ends.swap(r->buffered_block_ends);
+  r->data_block.Reset();
+  r->last_key.clear();
+  r->num_entries = 0;
+  Slice input(buffered);
+  Slice key, value;
+  size_t next_block = 0;
+  while (ok() && GetLengthPrefixedSlice(&input, &key) &&
+         GetLengthPrefixedSlice(&input, &value)) {
+    Add(key, value);
+    const size_t consumed = buffered.size() - input.size();
+    if (next_block < block_ends.size() && consumed == block_ends[next_block]) {
+      Flush();
+      next_block++;
+    }
+  }
+}
+
+// Hand the contents of data_block to the compression threads.
+void TableBuilder::SubmitBlock() {
+  Rep* r = rep_;
+  PendingBlock* block = new PendingBlock;
+  Slice raw = r->data_block.Finish();
+  block->raw.assign(raw.data(), raw.size());
+  block->keys.swap(r->block_keys);
+  block->has_index_key = false;
+  block->type = r->options.compression;
+  block->crc = 0;
+  block->done = false;
+  r->data_block.Reset();
+  r->pending_bytes += block->raw.size();
+  r->pending_blocks.push_back(block);
+
+  MutexLock l(&r->mu);
+  r->compress_queue.push_back(block);
+  r->cv.SignalAll();
+}
+
+// Write the pending blocks that have been compressed and have their index
+// key, in order.  Waits for the compression of the oldest blocks while
+// more than "max_pending" blocks are pending.
+void TableBuilder::WritePendingBlocks(size_t max_pending) {
+  Rep* r = rep_;
+  while (!r->pending_blocks.empty()) {
+    PendingBlock* block = r->pending_blocks.front();
+    if (!block->has_index_key) {
+      break;
+    }
+    {
+      MutexLock l(&r->mu);
+      if (!block->done && r->pending_blocks.size() <= max_pending) {
+        break;
+      }
+      while (!block->done) {
+        r->cv.Wait();
+      }
+    }
+    if (ok()) {
+      if (r->filter_block != nullptr) {
+        Slice input(block->keys);
+        Slice key;
+        while (GetLengthPrefixedSlice(&input, &key)) {
+          r->filter_block->AddKey(key);
+        }
+      }
+      BlockHandle handle;
+      WriteRawBlock(block->contents, block->type, block->crc, &handle);
+      if (ok()) {
+        std::string handle_encoding;
+        handle.EncodeTo(&handle_encoding);
+        r->index_block.Add(block->index_key, Slice(handle_encoding));
+        r->status = r->file->Flush();
+      }
+      if (r->filter_block != nullptr) {
+        r->filter_block->StartBlock(r->offset);
+      }
+    }
+    r->pending_bytes -= block->raw.size();
+    r->pending_blocks.pop_front();
+    delete block;
+  }
+}
+
+// Let the compression threads finish their queue and exit, and drop the
+// blocks that were not written.
+void TableBuilder::StopCompressionThreads() {
+  Rep* r = rep_;
+  {
+    MutexLock l(&r->mu);
+    r->stop_threads = true;
+    r->cv.SignalAll();
+    while (r->running_threads > 0) {
+      r->cv.Wait();
+    }
+  }
+  while (!r->pending_blocks.empty()) {
+    delete r->pending_blocks.front();
+    r->pending_blocks.pop_front();
+  }
+  r->pending_bytes = 0;
+}
+
+void TableBuilder::CompressionThread(void* arg) {
+  Rep* r = reinterpret_cast<Rep*>(arg);
+  MutexLock l(&r->mu);
+  while (true) {
+    while (r->compress_queue.empty() && !r->stop_threads) {
+      r->cv.Wait();
+    }
+    if (r->compress_queue.empty()) {
+      break;
+    }
+    PendingBlock* block = r->compress_queue.front();
+    r->compress_queue.pop_front();
+    r->mu.Unlock();
+    block->contents = CompressBlock(block->raw, r->zstd_dict, &block->type,
+                                    &block->compressed);
+    block->crc = BlockChecksum(block->contents, block->type);
+    r->mu.Lock();
+    block->done = true;
+    r->cv.SignalAll();
+  }
+  r->running_threads--;
+  r->cv.SignalAll();
+}
+
+// Called right after the index entry of a data block was added, with
+// r->last_key holding its key.  Writes the partition of full_filter that
+// ends with that block if it is large enough, or if "force" is set.
+void TableBuilder::MaybeFlushFilterPartition(bool force) {
+  Rep* r = rep_;
+  if (r->full_filter == nullptr ||
+      r->options.filter_format != kPartitionedFilter || !ok()) {
+    return;
+  }
+  const size_t num_keys = r->full_filter->NumKeys();
+  if (num_keys == 0 ||
+      (!force && num_keys < static_cast<size_t>(
+          r->options.filter_partition_keys))) {
+    return;
+  }
+  BlockHandle handle;
+  WriteRawBlock(r->full_filter->Finish(), kNoCompression, &handle);
+  if (ok()) {
+    std::string handle_encoding;
+    handle.EncodeTo(&handle_encoding);
+    r->filter_index_block.Add(r->last_key, handle_encoding);
+  }
+}
+
 //从block取出数据写入到文件，handle记录本次写入的数据size，以及写入前的offset
 void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
   // File format contains a sequence of blocks where each block has:
@@ -167,32 +527,12 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
   //获取BlockBuilder内部格式组织的数据
   Slice raw = block->Finish();
 
-  Slice block_contents;
   CompressionType type = r->options.compression;
-  // TODO(postrelease): Support more compression options: zlib?
-  switch (type) {
-    //不采用任何压缩方式，直接取raw数据
-    case kNoCompression:
-      block_contents = raw;
-      break;
-
-    case kSnappyCompression: {
-      std::string* compressed = &r->compressed_output;
-      //调用snappy压缩raw，压缩结果存储到compressed
-      //如果compressed.size < raw.size() * 7/8，即压缩后大小小于原来的87.5，则使用压缩后数据
-      if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
-          compressed->size() < raw.size() - (raw.size() / 8u)) {
-        block_contents = *compressed;
-      } else {
-        //压缩比例太小，则即使指定了kSnappyCompression，也不采用任何压缩方式
-        // Snappy not supported, or compressed less than 12.5%, so just
-        // store uncompressed form
-        block_contents = raw;
-        type = kNoCompression;
-      }
-      break;
-    }
-  }
+  // Only data blocks use the dictionary, so that the other blocks can be
+  // read before it.
+  Slice block_contents = CompressBlock(
+      raw, (block == &r->data_block) ? r->zstd_dict : nullptr, &type,
+      &r->compressed_output);
   WriteRawBlock(block_contents, type, handle);
   r->compressed_output.clear();
   block->Reset();
@@ -205,6 +545,15 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
 void TableBuilder::WriteRawBlock(const Slice& block_contents,
                                  CompressionType type,
                                  BlockHandle* handle) {
+  WriteRawBlock(block_contents, type, BlockChecksum(block_contents, type),
+                handle);
+}
+
+// Like WriteRawBlock() above, with the checksum of the trailer given.
+void TableBuilder::WriteRawBlock(const Slice& block_contents,
+                                 CompressionType type,
+                                 uint32_t crc,
+                                 BlockHandle* handle) {
   Rep* r = rep_;
   handle->set_offset(r->offset);
   // set_size的是block_contents的源大小，不包括接下来追加的trailer.
@@ -215,9 +564,7 @@ void TableBuilder::WriteRawBlock(const Slice& block_contents,
     //5 bytes:|compression type  |crc(by block_contents)  |
     char trailer[kBlockTrailerSize];
     trailer[0] = type;
-    uint32_t crc = crc32c::Value(block_contents.data(), block_contents.size());
-    crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
-    EncodeFixed32(trailer+1, crc32c::Mask(crc));
+    EncodeFixed32(trailer+1, crc);
     //接着写5 bytes的block trailer(type + crc)
     r->status = r->file->Append(Slice(trailer, kBlockTrailerSize));
     if (r->status.ok()) {
@@ -232,6 +579,13 @@ Status TableBuilder::status() const {
 
 Status TableBuilder::Finish() {
   Rep* r = rep_;
+  if (r->buffering) {
+    // Small table: train the dictionary on what there is
+    Flush();
+    if (r->buffering) {
+      FinishBuffering();
+    }
+  }
   //更新未写入的block
   Flush();
   assert(!r->closed);
@@ -239,6 +593,32 @@ Status TableBuilder::Finish() {
 
   //注意接下来只调用了r->file->Append
   BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
+  BlockHandle range_del_block_handle, dict_block_handle;
+  const bool has_range_dels = !r->range_del_block.empty();
+  const bool has_dict = (r->zstd_dict != nullptr);
+
+  // Add the index entry of the last data block, which also ends the last
+  // filter partition
+  if (ok() && r->pending_index_entry) {
+    //第一个>r->last_key的字符串
+    //例如r->last_key = "ace"，调用后r->last_key = "b"
+    r->options.comparator->FindShortSuccessor(&r->last_key);
+    if (r->parallel) {
+      PendingBlock* block = r->pending_blocks.back();
+      block->index_key = r->last_key;
+      block->has_index_key = true;
+      WritePendingBlocks(0);
+    } else {
+      std::string handle_encoding;
+      r->pending_handle.EncodeTo(&handle_encoding);
+      r->index_block.Add(r->last_key, Slice(handle_encoding));
+    }
+    r->pending_index_entry = false;
+    MaybeFlushFilterPartition(true);
+  }
+  if (r->parallel) {
+    StopCompressionThreads();
+  }
 
   // Write filter block
   // 一次性写入filter block
@@ -246,6 +626,24 @@ Status TableBuilder::Finish() {
     WriteRawBlock(r->filter_block->Finish(), kNoCompression,
                   &filter_block_handle);
   }
+  if (ok() && r->full_filter != nullptr) {
+    if (r->options.filter_format == kPartitionedFilter) {
+      WriteBlock(&r->filter_index_block, &filter_block_handle);
+    } else {
+      WriteRawBlock(r->full_filter->Finish(), kNoCompression,
+                    &filter_block_handle);
+    }
+  }
+
+  // Write range deletion block
+  if (ok() && has_range_dels) {
+    WriteBlock(&r->range_del_block, &range_del_block_handle);
+  }
+
+  // Write compression dictionary block
+  if (ok() && has_dict) {
+    WriteRawBlock(r->compression_dict, kNoCompression, &dict_block_handle);
+  }
 
   // Write metaindex block
   // 写入index of filter block，这里称为meta_index_block
@@ -253,15 +651,50 @@ Status TableBuilder::Finish() {
     //meta_index_block只写入一条数据
     //key: filter.$filter_name
     //value: filter_block的起始位置和大小
-    BlockBuilder meta_index_block(&r->options);
+    // Table::ReadMeta() looks the entries up with BytewiseComparator()
+    Options meta_index_options = r->options;
+    meta_index_options.comparator = BytewiseComparator();
+    BlockBuilder meta_index_block(&meta_index_options);
+    // Entries must be added in sorted order
+    std::string filter_key;
     if (r->filter_block != nullptr) {
       // Add mapping from "filter.Name" to location of filter data
-      std::string key = "filter.";
+      filter_key = "filter.";
+    } else if (r->options.filter_format == kFullFilter) {
+      filter_key = "fullfilter.";
+    }
+    if (!filter_key.empty()) {
+      filter_key.append(r->options.filter_policy->Name());
+      std::string handle_encoding;
+      filter_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add(filter_key, handle_encoding);
+    }
+    if (has_dict) {
+      std::string handle_encoding;
+      dict_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add("leveldb.compression_dict", handle_encoding);
+    }
+    if (has_range_dels) {
+      std::string handle_encoding;
+      range_del_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add("leveldb.range_del", handle_encoding);
+    }
+    if (r->full_filter != nullptr &&
+        r->options.filter_format == kPartitionedFilter) {
+      // Add mapping from "partitionedfilter.Name" to the partition index
+      std::string key = "partitionedfilter.";
       key.append(r->options.filter_policy->Name());
       std::string handle_encoding;
       filter_block_handle.EncodeTo(&handle_encoding);
       meta_index_block.Add(key, handle_encoding);
     }
+    if (r->options.filter_policy != nullptr &&
+        r->options.prefix_extractor != nullptr) {
+      // Record that the filters also hold the prefixes of the keys
+      std::string key = "prefix.";
+      key.append(r->options.prefix_extractor->Name());
+      meta_index_block.Add(key, Slice());
+    }
 
     // TODO(postrelease): Add stats and other meta blocks
     WriteBlock(&meta_index_block, &metaindex_block_handle);
@@ -270,15 +703,6 @@ Status TableBuilder::Finish() {
   // Write index block
   // 写入Rep->index_block
   if (ok()) {
-    if (r->pending_index_entry) {
-      //第一个>r->last_key的字符串
-      //例如r->last_key = "ace"，调用后r->last_key = "b"
-      r->options.comparator->FindShortSuccessor(&r->last_key);
-      std::string handle_encoding;
-      r->pending_handle.EncodeTo(&handle_encoding);
-      r->index_block.Add(r->last_key, Slice(handle_encoding));
-      r->pending_index_entry = false;
-    }
     WriteBlock(&r->index_block, &index_block_handle);
   }
 
@@ -301,6 +725,9 @@ void TableBuilder::Abandon() {
   Rep* r = rep_;
   assert(!r->closed);
   r->closed = true;
+  if (r->parallel) {
+    StopCompressionThreads();
+  }
 }
 
 uint64_t TableBuilder::NumEntries() const {
@@ -308,7 +735,10 @@ uint64_t TableBuilder::NumEntries() const {
 }
 
 uint64_t TableBuilder::FileSize() const {
-  return rep_->offset;
+  // Count the pairs held back for the dictionary and the blocks still
+  // being compressed at their uncompressed size, so that compactions
+  // still cut their output files in time.
+  return rep_->offset + rep_->buffered.size() + rep_->pending_bytes;
 }
 
 }  // namespace leveldb
@@ -11,11 +11,13 @@
 #include "db/write_batch_internal.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
 #include "leveldb/iterator.h"
 #include "leveldb/table_builder.h"
 #include "table/block.h"
 #include "table/block_builder.h"
 #include "table/format.h"
+#include "table/merger.h"
 #include "util/random.h"
 #include "util/testharness.h"
 #include "util/testutil.h"
@@ -757,6 +759,87 @@ TEST(Harness, RandomizedLongDB) {
   ASSERT_GT(files, 0);
 }
 
+class MergerTest { };
+
+// Spread random keys over "n" blocks and check that merging them yields
+// the same sequence as a single sorted map, under random mixes of seeks
+// and direction changes.  Covers both the linear-scan and the heap
+// implementations.
+TEST(MergerTest, MatchesSortedMap) {
+  const int kNumChildren[] = { 2, 3, 8, 9, 20 };
+  Random rnd(test::RandomSeed());
+  Options options;
+  for (size_t t = 0; t < sizeof(kNumChildren) / sizeof(int); t++) {
+    const int n = kNumChildren[t];
+    std::vector<BlockConstructor*> blocks;
+    for (int i = 0; i < n; i++) {
+      blocks.push_back(new BlockConstructor(BytewiseComparator()));
+    }
+    std::map<std::string, std::string> model;
+    for (int i = 0; i < 500; i++) {
+      std::string key = test::RandomKey(&rnd, 1 + rnd.Uniform(8));
+      if (model.count(key) == 0) {
+        std::string value;
+        test::RandomString(&rnd, 5, &value);
+        model[key] = value;
+        blocks[rnd.Uniform(n)]->Add(key, value);
+      }
+    }
+    std::vector<Iterator*> children;
+    for (int i = 0; i < n; i++) {
+      std::vector<std::string> keys;
+      KVMap kvmap;
+      blocks[i]->Finish(options, &keys, &kvmap);
+      children.push_back(blocks[i]->NewIterator());
+    }
+    Iterator* iter = NewMergingIterator(BytewiseComparator(), &children[0], n);
+
+    std::map<std::string, std::string>::const_iterator pos = model.end();
+    for (int step = 0; step < 2000; step++) {
+      switch (rnd.Uniform(5)) {
+        case 0:
+          iter->SeekToFirst();
+          pos = model.begin();
+          break;
+        case 1:
+          iter->SeekToLast();
+          pos = model.empty() ? model.end() : --model.end();
+          break;
+        case 2: {
+          std::string target = test::RandomKey(&rnd, 1 + rnd.Uniform(8));
+          iter->Seek(target);
+          pos = model.lower_bound(target);
+          break;
+        }
+        case 3:
+          if (iter->Valid()) {
+            iter->Next();
+            ++pos;
+          }
+          break;
+        case 4:
+          if (iter->Valid()) {
+            iter->Prev();
+            pos = (pos == model.begin()) ? model.end() : --pos;
+          }
+          break;
+      }
+      if (pos == model.end()) {
+        ASSERT_TRUE(!iter->Valid());
+      } else {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(pos->first, iter->key().ToString());
+        ASSERT_EQ(pos->second, iter->value().ToString());
+      }
+    }
+    ASSERT_OK(iter->status());
+    delete iter;
+    for (int i = 0; i < n; i++) {
+      delete blocks[i];
+    }
+  }
+}
+
 class MemTableTest { };
 
 TEST(MemTableTest, Simple) {
@@ -827,15 +910,25 @@ TEST(TableTest, ApproximateOffsetOfPlain) {
 
 }
 
-static bool SnappyCompressionSupported() {
+static bool CompressionSupported(CompressionType type) {
   std::string out;
   Slice in = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
-  return port::Snappy_Compress(in.data(), in.size(), &out);
+  switch (type) {
+    case kSnappyCompression:
+      return port::Snappy_Compress(in.data(), in.size(), &out);
+    case kLZ4Compression:
+      return port::LZ4_Compress(in.data(), in.size(), &out);
+    case kZstdCompression:
+      return port::Zstd_Compress(in.data(), in.size(), &out);
+    default:
+      return false;
+  }
 }
 
-TEST(TableTest, ApproximateOffsetOfCompressed) {
-  if (!SnappyCompressionSupported()) {
-    fprintf(stderr, "skipping compression tests\n");
+static void CheckCompressedOffsets(CompressionType type) {
+  if (!CompressionSupported(type)) {
+    fprintf(stderr, "skipping compression test for type %d\n",
+            static_cast<int>(type));
     return;
   }
 
@@ -850,7 +943,7 @@ TEST(TableTest, ApproximateOffsetOfCompressed) {
   KVMap kvmap;
   Options options;
   options.block_size = 1024;
-  options.compression = kSnappyCompression;
+  options.compression = type;
   c.Finish(options, &keys, &kvmap);
 
   // Expected upper and lower bounds of space used by compressible strings.
@@ -867,6 +960,217 @@ TEST(TableTest, ApproximateOffsetOfCompressed) {
   ASSERT_TRUE(Between(c.ApproximateOffsetOf("k04"), min_z, max_z));
   // Have now emitted two large compressible strings, so adjust expected offset.
   ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"), 2 * min_z, 2 * max_z));
+
+  // The blocks read back intact.
+  Iterator* iter = c.NewIterator();
+  KVMap::const_iterator model = kvmap.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++model) {
+    ASSERT_TRUE(model != kvmap.end());
+    ASSERT_EQ(model->first, iter->key().ToString());
+    ASSERT_EQ(model->second, iter->value().ToString());
+  }
+  ASSERT_TRUE(model == kvmap.end());
+  ASSERT_OK(iter->status());
+  delete iter;
+}
+
+TEST(TableTest, ApproximateOffsetOfCompressed) {
+  CheckCompressedOffsets(kSnappyCompression);
+}
+
+TEST(TableTest, ApproximateOffsetOfLZ4Compressed) {
+  CheckCompressedOffsets(kLZ4Compression);
+}
+
+TEST(TableTest, ApproximateOffsetOfZstdCompressed) {
+  CheckCompressedOffsets(kZstdCompression);
+}
+
+static std::string BuildTableContents(
+    const Options& options, const std::map<std::string, std::string>& data) {
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  for (std::map<std::string, std::string>::const_iterator it = data.begin();
+       it != data.end(); ++it) {
+    builder.Add(it->first, it->second);
+  }
+  ASSERT_OK(builder.Finish());
+  ASSERT_EQ(sink.contents().size(), builder.FileSize());
+  return sink.contents();
+}
+
+TEST(TableTest, ParallelCompression) {
+  const FilterPolicy* policy = NewBloomFilterPolicy(10);
+  Random rnd(301);
+  std::map<std::string, std::string> data;
+  for (int i = 0; i < 5000; i++) {
+    char key[20];
+    snprintf(key, sizeof(key), "k%06d", i);
+    test::CompressibleString(&rnd, 0.5, 100, &data[key]);
+  }
+
+  static const FilterFormat kFormats[] = {
+    kBlockBasedFilter, kFullFilter, kPartitionedFilter
+  };
+  for (int f = 0; f < 3; f++) {
+    Options options;
+    options.block_size = 1024;
+    options.filter_policy = policy;
+    options.filter_format = kFormats[f];
+    options.filter_partition_keys = 500;
+    if (CompressionSupported(kZstdCompression)) {
+      options.compression = kZstdCompression;
+    }
+    const std::string serial = BuildTableContents(options, data);
+    options.compression_threads = 4;
+    const std::string parallel = BuildTableContents(options, data);
+    if (kFormats[f] != kPartitionedFilter) {
+      // Filter partitions are written ahead of the data blocks that are
+      // still being compressed; everything else is laid out the same.
+      ASSERT_TRUE(serial == parallel) << "filter format " << f;
+    }
+
+    StringSource source(parallel);
+    Table* table;
+    ASSERT_OK(Table::Open(options, &source, parallel.size(), &table));
+    Iterator* iter = table->NewIterator(ReadOptions());
+    std::map<std::string, std::string>::const_iterator model = data.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++model) {
+      ASSERT_TRUE(model != data.end());
+      ASSERT_EQ(model->first, iter->key().ToString());
+      ASSERT_EQ(model->second, iter->value().ToString());
+    }
+    ASSERT_TRUE(model == data.end());
+    ASSERT_OK(iter->status());
+    delete iter;
+    delete table;
+  }
+  delete policy;
+}
+
+// A StringSource that records the ranges it is asked to prefetch
+class PrefetchRecordingSource : public StringSource {
+ public:
+  explicit PrefetchRecordingSource(const Slice& contents)
+      : StringSource(contents) { }
+
+  virtual void Prefetch(uint64_t offset, size_t n) {
+    prefetches.push_back(std::make_pair(offset, n));
+  }
+
+  std::vector<std::pair<uint64_t, size_t> > prefetches;
+};
+
+TEST(TableTest, Readahead) {
+  Random rnd(301);
+  std::map<std::string, std::string> data;
+  for (int i = 0; i < 2000; i++) {
+    char key[20];
+    snprintf(key, sizeof(key), "k%06d", i);
+    test::RandomString(&rnd, 100, &data[key]);
+  }
+  Options options;
+  options.block_size = 1024;
+  options.compression = kNoCompression;
+  const std::string contents = BuildTableContents(options, data);
+
+  PrefetchRecordingSource source(contents);
+  Table* table;
+  ASSERT_OK(Table::Open(options, &source, contents.size(), &table));
+
+  // No prefetching unless asked for
+  Iterator* iter = table->NewIterator(ReadOptions());
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) { }
+  ASSERT_OK(iter->status());
+  delete iter;
+  ASSERT_EQ(0u, source.prefetches.size());
+
+  // A forward scan prefetches contiguous ranges, each once the scan is
+  // halfway through the one before it
+  ReadOptions ro;
+  ro.readahead_size = 16384;
+  iter = table->NewIterator(ro);
+  int n = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    n++;
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(static_cast<int>(data.size()), n);
+  delete iter;
+  const uint64_t data_size = table->ApproximateOffsetOf("k999999");
+  ASSERT_GE(source.prefetches.size(), data_size / ro.readahead_size);
+  ASSERT_LE(source.prefetches.size(), 2 * data_size / ro.readahead_size + 2);
+  uint64_t limit = source.prefetches[0].first + source.prefetches[0].second;
+  ASSERT_LT(source.prefetches[0].first, options.block_size + 100);
+  for (size_t i = 1; i < source.prefetches.size(); i++) {
+    ASSERT_EQ(limit, source.prefetches[i].first);
+    limit += source.prefetches[i].second;
+  }
+  ASSERT_GE(limit, data_size);
+
+  // A seek elsewhere starts a new range at the block it lands on
+  source.prefetches.clear();
+  iter = table->NewIterator(ro);
+  iter->Seek("k001000");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(1u, source.prefetches.size());
+  ASSERT_EQ(ro.readahead_size, source.prefetches[0].second);
+  ASSERT_GT(source.prefetches[0].first, table->ApproximateOffsetOf("k001000"));
+  delete iter;
+  delete table;
+}
+
+TEST(TableTest, ZstdDictionary) {
+  if (!CompressionSupported(kZstdCompression)) {
+    fprintf(stderr, "skipping compression dictionary test\n");
+    return;
+  }
+
+  // Small, similar JSON documents
+  static const char* kNames[] = { "alice", "bob", "carol", "dave", "eve" };
+  Random rnd(301);
+  TableConstructor plain(BytewiseComparator());
+  TableConstructor with_dict(BytewiseComparator());
+  for (int i = 0; i < 4000; i++) {
+    char key[20];
+    snprintf(key, sizeof(key), "k%06d", i);
+    char value[200];
+    snprintf(value, sizeof(value),
+             "{\"id\":%d,\"name\":\"%s\",\"email\":\"%s%d@example.com\","
+             "\"active\":%s,\"score\":%d}",
+             i, kNames[rnd.Uniform(5)], kNames[rnd.Uniform(5)],
+             static_cast<int>(rnd.Uniform(1000)),
+             rnd.OneIn(2) ? "true" : "false",
+             static_cast<int>(rnd.Uniform(100000)));
+    plain.Add(key, value);
+    with_dict.Add(key, value);
+  }
+  std::vector<std::string> keys;
+  KVMap kvmap;
+  Options options;
+  options.block_size = 1024;
+  options.compression = kZstdCompression;
+  plain.Finish(options, &keys, &kvmap);
+  options.zstd_max_dict_bytes = 4096;
+  options.zstd_max_train_bytes = 64 << 10;
+  with_dict.Finish(options, &keys, &kvmap);
+
+  const uint64_t plain_size = plain.ApproximateOffsetOf("z");
+  const uint64_t dict_size = with_dict.ApproximateOffsetOf("z");
+  fprintf(stderr, "data blocks: %d bytes, %d bytes with dictionary\n",
+          static_cast<int>(plain_size), static_cast<int>(dict_size));
+  ASSERT_LT(dict_size, plain_size * 3 / 4);
+
+  Iterator* iter = with_dict.NewIterator();
+  KVMap::const_iterator model = kvmap.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++model) {
+    ASSERT_TRUE(model != kvmap.end());
+    ASSERT_EQ(model->first, iter->key().ToString());
+    ASSERT_EQ(model->second, iter->value().ToString());
+  }
+  ASSERT_TRUE(model == kvmap.end());
+  ASSERT_OK(iter->status());
+  delete iter;
 }
 
 }  // namespace leveldb
@@ -14,6 +14,8 @@ namespace leveldb {
 namespace {
 
 typedef Iterator* (*BlockFunction)(void*, const ReadOptions&, const Slice&);
+typedef bool (*PrefixFunction)(void*, const Slice&, const Slice&,
+                               const Slice&);
 
 class TwoLevelIterator: public Iterator {
  public:
@@ -21,7 +23,8 @@ class TwoLevelIterator: public Iterator {
     Iterator* index_iter,
     BlockFunction block_function,
     void* arg,
-    const ReadOptions& options);
+    const ReadOptions& options,
+    PrefixFunction prefix_function);
 
   virtual ~TwoLevelIterator();
 
@@ -62,9 +65,20 @@ class TwoLevelIterator: public Iterator {
   void SetDataIterator(Iterator* data_iter);
   void InitDataBlock();
 
+  // Whether the block at index_iter_ may hold keys of prefix_target_
+  bool BlockMayHoldPrefix() {
+    return !has_prefix_target_ ||
+           (*prefix_function_)(arg_, index_iter_.key(), index_iter_.value(),
+                               prefix_target_);
+  }
+
   BlockFunction block_function_;
   void* arg_;
   const ReadOptions options_;
+  PrefixFunction prefix_function_;
+  // The last Seek() target, if blocks are skipped by prefix
+  bool has_prefix_target_;
+  std::string prefix_target_;
   Status status_;
   IteratorWrapper index_iter_;
   IteratorWrapper data_iter_; // May be nullptr
@@ -77,10 +91,14 @@ TwoLevelIterator::TwoLevelIterator(
     Iterator* index_iter,
     BlockFunction block_function,
     void* arg,
-    const ReadOptions& options)
+    const ReadOptions& options,
+    PrefixFunction prefix_function)
     : block_function_(block_function),
       arg_(arg),
       options_(options),
+      prefix_function_(options.prefix_same_as_start ? prefix_function
+                                                     : nullptr),
+      has_prefix_target_(false),
       index_iter_(index_iter),
       data_iter_(nullptr) {
 }
@@ -89,15 +107,25 @@ TwoLevelIterator::~TwoLevelIterator() {
 }
 
 void TwoLevelIterator::Seek(const Slice& target) {
+  has_prefix_target_ = (prefix_function_ != nullptr);
+  if (has_prefix_target_) {
+    prefix_target_.assign(target.data(), target.size());
+  }
   // 先在 index block 找到第一个>= target 的k:v, v是某个data_block的size&offset
   index_iter_.Seek(target);
-  // 根据v读取data_block，data_iter_指向该data_block内的k:v
-  InitDataBlock();
-  if (data_iter_.iter() != nullptr) data_iter_.Seek(target);
+  if (index_iter_.Valid() && !BlockMayHoldPrefix()) {
+    // Move on to the next block without reading this one
+    SetDataIterator(nullptr);
+  } else {
+    // 根据v读取data_block，data_iter_指向该data_block内的k:v
+    InitDataBlock();
+    if (data_iter_.iter() != nullptr) data_iter_.Seek(target);
+  }
   SkipEmptyDataBlocksForward();
 }
 
 void TwoLevelIterator::SeekToFirst() {
+  has_prefix_target_ = false;
   index_iter_.SeekToFirst();
   InitDataBlock();
   if (data_iter_.iter() != nullptr) data_iter_.SeekToFirst();
@@ -105,6 +133,7 @@ void TwoLevelIterator::SeekToFirst() {
 }
 
 void TwoLevelIterator::SeekToLast() {
+  has_prefix_target_ = false;
   index_iter_.SeekToLast();
   InitDataBlock();
   if (data_iter_.iter() != nullptr) data_iter_.SeekToLast();
@@ -132,6 +161,11 @@ void TwoLevelIterator::SkipEmptyDataBlocksForward() {
       return;
     }
     index_iter_.Next();
+    if (index_iter_.Valid() && !BlockMayHoldPrefix()) {
+      // The keys of the prefix have ended
+      SetDataIterator(nullptr);
+      return;
+    }
     InitDataBlock();
     if (data_iter_.iter() != nullptr) data_iter_.SeekToFirst();
   }
@@ -179,8 +213,10 @@ Iterator* NewTwoLevelIterator(
     Iterator* index_iter,
     BlockFunction block_function,
     void* arg,
-    const ReadOptions& options) {
-  return new TwoLevelIterator(index_iter, block_function, arg, options);
+    const ReadOptions& options,
+    PrefixFunction prefix_function) {
+  return new TwoLevelIterator(index_iter, block_function, arg, options,
+                              prefix_function);
 }
 
 }  // namespace leveldb
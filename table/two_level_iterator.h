@@ -20,6 +20,13 @@ struct ReadOptions;
 //
 // Uses a supplied function to convert an index_iter value into
 // an iterator over the contents of the corresponding block.
+//
+// If options.prefix_same_as_start is set and prefix_function is non-null,
+// prefix_function(arg, index_key, index_value, target) must return false
+// only if the block of that index entry holds no key that is >= target
+// and has the prefix of the last Seek() target.  Seek() then skips the
+// blocks that are ruled out, and the iterator stops at the first block
+// ruled out after that, since the keys that share a prefix are adjacent.
 Iterator* NewTwoLevelIterator(
     Iterator* index_iter,
     Iterator* (*block_function)(
@@ -27,7 +34,12 @@ Iterator* NewTwoLevelIterator(
         const ReadOptions& options,
         const Slice& index_value),
     void* arg,
-    const ReadOptions& options);
+    const ReadOptions& options,
+    bool (*prefix_function)(
+        void* arg,
+        const Slice& index_key,
+        const Slice& index_value,
+        const Slice& target) = nullptr);
 
 }  // namespace leveldb
 
@@ -24,6 +24,12 @@ class Arena {
   // Allocate memory with the normal alignment guarantees provided by malloc
   char* AllocateAligned(size_t bytes);
 
+  // Thread-safe versions of Allocate() and AllocateAligned().  Any number
+  // of threads may call these at the same time, but never concurrently
+  // with the unsynchronized versions above.
+  char* AllocateConcurrent(size_t bytes);
+  char* AllocateAlignedConcurrent(size_t bytes);
+
   // Returns an estimate of the total memory usage of data allocated
   // by the arena.
   size_t MemoryUsage() const {
@@ -44,6 +50,9 @@ class Arena {
   // Total memory usage of the arena.
   port::AtomicPointer memory_usage_;
 
+  // Serializes the *Concurrent() allocation paths.
+  port::Mutex mu_;
+
   // No copying allowed
   Arena(const Arena&);
   void operator=(const Arena&);
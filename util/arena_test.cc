@@ -4,6 +4,9 @@
 
 #include "util/arena.h"
 
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
 #include "util/random.h"
 #include "util/testharness.h"
 
@@ -61,6 +64,66 @@ TEST(ArenaTest, Simple) {
   }
 }
 
+namespace {
+
+struct ConcurrentArenaState {
+  Arena* arena;
+  port::Mutex mu;
+  port::CondVar cv;
+  int next_id;
+  int done;
+  std::vector<std::pair<size_t, char*> > allocated[4];
+
+  explicit ConcurrentArenaState(Arena* a)
+      : arena(a), cv(&mu), next_id(0), done(0) { }
+};
+
+void ConcurrentAllocator(void* arg) {
+  ConcurrentArenaState* state = reinterpret_cast<ConcurrentArenaState*>(arg);
+  int id;
+  {
+    MutexLock l(&state->mu);
+    id = state->next_id++;
+  }
+  Random rnd(301 + id);
+  for (int i = 0; i < 20000; i++) {
+    size_t s = rnd.OneIn(1000) ? 1 + rnd.Uniform(6000) : 1 + rnd.Uniform(40);
+    char* r = rnd.OneIn(2) ? state->arena->AllocateAlignedConcurrent(s)
+                           : state->arena->AllocateConcurrent(s);
+    memset(r, id, s);
+    state->allocated[id].push_back(std::make_pair(s, r));
+  }
+  MutexLock l(&state->mu);
+  state->done++;
+  state->cv.Signal();
+}
+
+}  // namespace
+
+TEST(ArenaTest, Concurrent) {
+  Arena arena;
+  ConcurrentArenaState state(&arena);
+  for (int i = 0; i < 4; i++) {
+    Env::Default()->StartThread(&ConcurrentAllocator, &state);
+  }
+  {
+    MutexLock l(&state.mu);
+    while (state.done < 4) {
+      state.cv.Wait();
+    }
+  }
+  // Every allocation must still hold the pattern of the thread that made
+  // it, i.e. no two threads were handed overlapping memory.
+  for (int id = 0; id < 4; id++) {
+    for (size_t i = 0; i < state.allocated[id].size(); i++) {
+      const char* p = state.allocated[id][i].second;
+      for (size_t b = 0; b < state.allocated[id][i].first; b++) {
+        ASSERT_EQ(id, p[b]);
+      }
+    }
+  }
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
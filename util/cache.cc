@@ -5,6 +5,10 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
 
 #include "leveldb/cache.h"
 #include "port/port.h"
@@ -17,6 +21,22 @@ namespace leveldb {
 Cache::~Cache() {
 }
 
+Cache::Handle* Cache::Insert(const Slice& key, void* value, size_t charge,
+                             void (*deleter)(const Slice& key, void* value),
+                             Priority priority) {
+  return Insert(key, value, charge, deleter);
+}
+
+Cache::Handle* Cache::Lookup(const Slice& key, Priority priority) {
+  return Lookup(key);
+}
+
+void Cache::GetLookupStats(Priority priority, uint64_t* lookups,
+                           uint64_t* hits) const {
+  *lookups = 0;
+  *hits = 0;
+}
+
 namespace {
 
 // LRU cache implementation
@@ -37,6 +57,13 @@ namespace {
 // Elements are moved between these lists by the Ref() and Unref() methods,
 // when they detect an element in the cache acquiring or losing its only
 // external reference.
+//
+// The LRU list is split in two at lru_low_pri_.  The newer part is the
+// high priority pool: entries that were inserted with kHighPriority or
+// that were looked up after their insertion go there when they are
+// released.  Other entries are inserted at the head of the older part, so
+// they are evicted before anything in the pool.  Whenever the pool holds
+// more than its capacity, its oldest entries move to the older part.
 
 // An entry is a variable length heap-allocated structure.  Entries
 // are kept in a circular doubly linked list ordered by access time.
@@ -51,6 +78,9 @@ struct LRUHandle {
   size_t key_length;// key长度
   // 是否在LRUCache in_use_ 链表
   bool in_cache;      // Whether entry is in the cache.
+  bool high_pri;      // Whether entry was inserted with kHighPriority.
+  bool hit;           // Whether entry was looked up since its insertion.
+  bool in_high_pri_pool;  // Whether entry is in the high priority pool.
   // 引用计数，用于删除数据
   uint32_t refs;      // References, including cache reference, if present.
   // key 对应的hash值
@@ -178,13 +208,19 @@ class LRUCache {
   ~LRUCache();
 
   // Separate from constructor so caller can easily make an array of LRUCache
-  void SetCapacity(size_t capacity) { capacity_ = capacity; }
+  void SetCapacity(size_t capacity, double high_pri_pool_ratio) {
+    capacity_ = capacity;
+    high_pri_pool_capacity_ =
+        static_cast<size_t>(capacity * high_pri_pool_ratio);
+  }
 
   // Like Cache methods, but with an extra "hash" parameter.
   Cache::Handle* Insert(const Slice& key, uint32_t hash,
                         void* value, size_t charge,
-                        void (*deleter)(const Slice& key, void* value));
-  Cache::Handle* Lookup(const Slice& key, uint32_t hash);
+                        void (*deleter)(const Slice& key, void* value),
+                        Cache::Priority priority);
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash,
+                        Cache::Priority priority);
   void Release(Cache::Handle* handle);
   void Erase(const Slice& key, uint32_t hash);
   void Prune();
@@ -192,16 +228,24 @@ class LRUCache {
     MutexLock l(&mutex_);
     return usage_;
   }
+  void AddLookupStats(Cache::Priority priority, uint64_t* lookups,
+                      uint64_t* hits) const {
+    MutexLock l(&mutex_);
+    *lookups += lookups_[priority];
+    *hits += hits_[priority];
+  }
 
  private:
   void LRU_Remove(LRUHandle* e);
   void LRU_Append(LRUHandle*list, LRUHandle* e);
+  void LRU_Insert(LRUHandle* e) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void Ref(LRUHandle* e);
   void Unref(LRUHandle* e);
   bool FinishErase(LRUHandle* e) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   // Initialized before use.
   size_t capacity_;
+  size_t high_pri_pool_capacity_;
 
   // mutex_ protects the following state.
   mutable port::Mutex mutex_;//Insert/Lookup等操作时都先加锁
@@ -212,6 +256,15 @@ class LRUCache {
   // Entries have refs==1 and in_cache==true.
   LRUHandle lru_ GUARDED_BY(mutex_);
 
+  // Newest entry of the LRU list that is not in the high priority pool,
+  // or &lru_ if there is none.
+  LRUHandle* lru_low_pri_ GUARDED_BY(mutex_);
+  size_t high_pri_pool_usage_ GUARDED_BY(mutex_);
+
+  // Lookup counts, indexed by Cache::Priority.
+  uint64_t lookups_[2] GUARDED_BY(mutex_);
+  uint64_t hits_[2] GUARDED_BY(mutex_);
+
   // Dummy head of in-use list.
   // Entries are in use by clients, and have refs >= 2 and in_cache==true.
   LRUHandle in_use_ GUARDED_BY(mutex_);
@@ -220,11 +273,17 @@ class LRUCache {
 };
 
 LRUCache::LRUCache()
-    : usage_(0) {
+    : capacity_(0),
+      high_pri_pool_capacity_(0),
+      usage_(0),
+      lru_low_pri_(&lru_),
+      high_pri_pool_usage_(0) {
   // Make empty circular linked lists.
   // 初始化时,lru_ in_use_都只有自身一个节点
   lru_.next = &lru_;
   lru_.prev = &lru_;
+  lookups_[0] = lookups_[1] = 0;
+  hits_[0] = hits_[1] = 0;
   in_use_.next = &in_use_;
   in_use_.prev = &in_use_;
 }
@@ -263,15 +322,44 @@ void LRUCache::Unref(LRUHandle* e) {
     // 表示节点可以由对象本身控制，因此移动到lru_
     // No longer in use; move to lru_ list.
     LRU_Remove(e);
-    LRU_Append(&lru_, e);
+    LRU_Insert(e);
   }
 }
 
 void LRUCache::LRU_Remove(LRUHandle* e) {
+  if (e == lru_low_pri_) {
+    lru_low_pri_ = e->prev;
+  }
+  if (e->in_high_pri_pool) {
+    assert(high_pri_pool_usage_ >= e->charge);
+    high_pri_pool_usage_ -= e->charge;
+    e->in_high_pri_pool = false;
+  }
   e->next->prev = e->prev;
   e->prev->next = e->next;
 }
 
+void LRUCache::LRU_Insert(LRUHandle* e) {
+  if (high_pri_pool_capacity_ > 0 && (e->high_pri || e->hit)) {
+    // Make "e" the newest entry of the pool, then move the oldest entries
+    // of the pool below it until it fits again.
+    LRU_Append(&lru_, e);
+    e->in_high_pri_pool = true;
+    high_pri_pool_usage_ += e->charge;
+    while (high_pri_pool_usage_ > high_pri_pool_capacity_) {
+      LRUHandle* oldest = lru_low_pri_->next;
+      assert(oldest != &lru_ && oldest->in_high_pri_pool);
+      oldest->in_high_pri_pool = false;
+      high_pri_pool_usage_ -= oldest->charge;
+      lru_low_pri_ = oldest;
+    }
+  } else {
+    // Make "e" the newest entry below the pool.
+    LRU_Append(lru_low_pri_->next, e);
+    lru_low_pri_ = e;
+  }
+}
+
 void LRUCache::LRU_Append(LRUHandle* list, LRUHandle* e) {
   // Make "e" newest entry by inserting just before *list
   e->next = list;
@@ -280,10 +368,14 @@ void LRUCache::LRU_Append(LRUHandle* list, LRUHandle* e) {
   e->next->prev = e;
 }
 
-Cache::Handle* LRUCache::Lookup(const Slice& key, uint32_t hash) {
+Cache::Handle* LRUCache::Lookup(const Slice& key, uint32_t hash,
+                                 Cache::Priority priority) {
   MutexLock l(&mutex_);
+  lookups_[priority]++;
   LRUHandle* e = table_.Lookup(key, hash);
   if (e != nullptr) {
+    hits_[priority]++;
+    e->hit = true;
     Ref(e);
   }
   return reinterpret_cast<Cache::Handle*>(e);
@@ -296,7 +388,8 @@ void LRUCache::Release(Cache::Handle* handle) {
 
 Cache::Handle* LRUCache::Insert(
     const Slice& key, uint32_t hash, void* value, size_t charge,
-    void (*deleter)(const Slice& key, void* value)) {
+    void (*deleter)(const Slice& key, void* value),
+    Cache::Priority priority) {
   MutexLock l(&mutex_);
 
   // 申请动态大小的LRUHandle内存，初始化该结构体
@@ -311,6 +404,9 @@ Cache::Handle* LRUCache::Insert(
   e->key_length = key.size();
   e->hash = hash;
   e->in_cache = false;
+  e->high_pri = (priority == Cache::kHighPriority);
+  e->hit = false;
+  e->in_high_pri_pool = false;
   e->refs = 1;  // for the returned handle.
   memcpy(e->key_data, key.data(), key.size());
 
@@ -388,22 +484,31 @@ class ShardedLRUCache : public Cache {
   }
 
  public:
-  explicit ShardedLRUCache(size_t capacity)
+  ShardedLRUCache(size_t capacity, double high_pri_pool_ratio)
       : last_id_(0) {
     const size_t per_shard = (capacity + (kNumShards - 1)) / kNumShards;
     for (int s = 0; s < kNumShards; s++) {
-      shard_[s].SetCapacity(per_shard);
+      shard_[s].SetCapacity(per_shard, high_pri_pool_ratio);
     }
   }
   virtual ~ShardedLRUCache() { }
   virtual Handle* Insert(const Slice& key, void* value, size_t charge,
                          void (*deleter)(const Slice& key, void* value)) {
+    return Insert(key, value, charge, deleter, kLowPriority);
+  }
+  virtual Handle* Insert(const Slice& key, void* value, size_t charge,
+                         void (*deleter)(const Slice& key, void* value),
+                         Priority priority) {
     const uint32_t hash = HashSlice(key);
-    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter);
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter,
+                                      priority);
   }
   virtual Handle* Lookup(const Slice& key) {
+    return Lookup(key, kLowPriority);
+  }
+  virtual Handle* Lookup(const Slice& key, Priority priority) {
     const uint32_t hash = HashSlice(key);
-    return shard_[Shard(hash)].Lookup(key, hash);
+    return shard_[Shard(hash)].Lookup(key, hash, priority);
   }
   virtual void Release(Handle* handle) {
     LRUHandle* h = reinterpret_cast<LRUHandle*>(handle);
@@ -432,12 +537,516 @@ class ShardedLRUCache : public Cache {
     }
     return total;
   }
+  virtual void GetLookupStats(Priority priority, uint64_t* lookups,
+                              uint64_t* hits) const {
+    *lookups = 0;
+    *hits = 0;
+    for (int s = 0; s < kNumShards; s++) {
+      shard_[s].AddLookupStats(priority, lookups, hits);
+    }
+  }
+};
+
+// CLOCK cache implementation
+//
+// Entries live in ClockHandles that are owned by their shard and are
+// recycled, never freed, until the shard is destroyed.  The state of a
+// handle is packed into one atomic word: whether the cache holds it
+// (in_cache), whether it was used since the clock hand last passed it
+// (usage), and the number of references held by clients.
+//
+// Lookup() probes an open-addressing table without taking the shard
+// mutex: it takes a reference with a compare-and-swap that only succeeds
+// while the handle is in the cache, then checks that the handle still
+// holds the key it was looking for.  Release() drops the reference with a
+// single atomic decrement, and only takes the mutex when the last
+// reference to an entry that left the cache goes away.
+//
+// Insert(), Erase(), Prune() and eviction take the mutex.  Eviction moves
+// the clock hand over the handles: referenced entries are skipped, used
+// entries lose their usage bit, and the first unused unreferenced entry is
+// evicted.  New entries start without the usage bit, so an entry that is
+// inserted once and never looked up again is evicted first.
+struct ClockHandle {
+  std::atomic<uint32_t> flags;
+  uint32_t hash;
+  size_t charge;
+  void* value;
+  void (*deleter)(const Slice&, void* value);
+  std::string key;
+
+  ClockHandle() : flags(0), hash(0), charge(0), value(nullptr),
+                  deleter(nullptr) { }
+};
+
+// One entry of the hash table of a shard.  "hash" is a copy of the hash
+// of "handle" that lets a lookup skip most other keys without touching
+// their handles.
+struct ClockSlot {
+  std::atomic<ClockHandle*> handle;   // nullptr if the slot was never used
+  std::atomic<uint32_t> hash;
+};
+
+struct ClockTable {
+  uint32_t mask;                      // Number of slots - 1
+  ClockSlot* slots;
+
+  explicit ClockTable(uint32_t size) : mask(size - 1),
+                                       slots(new ClockSlot[size]) {
+    for (uint32_t i = 0; i < size; i++) {
+      slots[i].handle.store(nullptr, std::memory_order_relaxed);
+      slots[i].hash.store(0, std::memory_order_relaxed);
+    }
+  }
+  ~ClockTable() { delete[] slots; }
+};
+
+// A single shard of sharded cache.
+class ClockCache {
+ public:
+  ClockCache();
+  ~ClockCache();
+
+  // Separate from constructor so caller can easily make an array of ClockCache
+  void SetCapacity(size_t capacity) { capacity_ = capacity; }
+
+  // Like Cache methods, but with an extra "hash" parameter.
+  Cache::Handle* Insert(const Slice& key, uint32_t hash,
+                        void* value, size_t charge,
+                        void (*deleter)(const Slice& key, void* value));
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash);
+  void Release(Cache::Handle* handle);
+  void Erase(const Slice& key, uint32_t hash);
+  void Prune();
+  size_t TotalCharge() const {
+    MutexLock l(&mutex_);
+    return usage_;
+  }
+
+ private:
+  static const uint32_t kInCache = 1;
+  static const uint32_t kUsage = 2;
+  static const uint32_t kOneRef = 4;
+
+  static uint32_t Refs(uint32_t flags) { return flags / kOneRef; }
+
+  bool TryRef(ClockHandle* h);
+  void Unref(ClockHandle* h);
+  void Recycle(ClockHandle* h) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void RemoveFromCache(ClockHandle* h) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void EvictIfNeeded() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Hash table operations.  Tables are only changed with mutex_ held.
+  ClockHandle* TableInsert(ClockHandle* h) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  ClockHandle* TableRemove(const Slice& key, uint32_t hash,
+                           const ClockHandle* h)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void TableRebuild(uint32_t size) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Initialized before use.
+  size_t capacity_;
+
+  // mutex_ protects the following state.
+  mutable port::Mutex mutex_;
+  size_t usage_ GUARDED_BY(mutex_);
+  std::deque<ClockHandle> handles_ GUARDED_BY(mutex_);
+  std::vector<ClockHandle*> free_ GUARDED_BY(mutex_);
+  size_t hand_ GUARDED_BY(mutex_);
+  uint32_t table_elems_ GUARDED_BY(mutex_);
+  uint32_t table_tombstones_ GUARDED_BY(mutex_);
+
+  // Tables that were replaced by bigger ones.  Lookups that started
+  // before the replacement may still be reading them, so they are only
+  // freed with the shard.  Their total size is bounded by the size of the
+  // current table.
+  std::vector<ClockTable*> retired_tables_ GUARDED_BY(mutex_);
+
+  // Read by Lookup() without holding mutex_.
+  std::atomic<ClockTable*> table_;
+
+  // Marks table slots whose handle was removed.  It is never in the
+  // cache, so lookups cannot take a reference on it.
+  ClockHandle tombstone_;
+
+  // No copying allowed
+  ClockCache(const ClockCache&);
+  void operator=(const ClockCache&);
+};
+
+ClockCache::ClockCache()
+    : capacity_(0),
+      usage_(0),
+      hand_(0),
+      table_elems_(0),
+      table_tombstones_(0),
+      table_(new ClockTable(16)) {
+}
+
+ClockCache::~ClockCache() {
+  for (size_t i = 0; i < handles_.size(); i++) {
+    ClockHandle* h = &handles_[i];
+    uint32_t flags = h->flags.load(std::memory_order_relaxed);
+    assert(Refs(flags) == 0);  // Error if caller has an unreleased handle
+    if (flags & kInCache) {
+      (*h->deleter)(h->key, h->value);
+    }
+  }
+  delete table_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < retired_tables_.size(); i++) {
+    delete retired_tables_[i];
+  }
+}
+
+bool ClockCache::TryRef(ClockHandle* h) {
+  uint32_t flags = h->flags.load(std::memory_order_relaxed);
+  while (flags & kInCache) {
+    if (h->flags.compare_exchange_weak(flags, flags + kOneRef,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClockCache::Unref(ClockHandle* h) {
+  const uint32_t flags =
+      h->flags.fetch_sub(kOneRef, std::memory_order_acq_rel) - kOneRef;
+  // A lookup that raced with Erase() may have set the usage bit of an
+  // entry that already left the cache, so ignore it.
+  if ((flags & ~kUsage) == 0) {
+    MutexLock l(&mutex_);
+    Recycle(h);
+  }
+}
+
+void ClockCache::Recycle(ClockHandle* h) {
+  (*h->deleter)(h->key, h->value);
+  h->value = nullptr;
+  h->deleter = nullptr;
+  free_.push_back(h);
+}
+
+void ClockCache::RemoveFromCache(ClockHandle* h) {
+  const uint32_t flags =
+      h->flags.fetch_and(~(kInCache | kUsage), std::memory_order_acq_rel);
+  assert(flags & kInCache);
+  usage_ -= h->charge;
+  if (Refs(flags) == 0) {
+    Recycle(h);
+  }
+}
+
+void ClockCache::EvictIfNeeded() {
+  // Two passes over the handles are enough to clear every usage bit and
+  // come back to an entry that was not used since; if nothing could be
+  // evicted by then, every entry is referenced.
+  size_t steps = 2 * handles_.size();
+  while (usage_ > capacity_ && steps > 0) {
+    steps--;
+    if (hand_ >= handles_.size()) {
+      hand_ = 0;
+    }
+    ClockHandle* h = &handles_[hand_++];
+    uint32_t flags = h->flags.load(std::memory_order_relaxed);
+    if ((flags & kInCache) == 0 || Refs(flags) > 0) {
+      continue;
+    }
+    if (flags & kUsage) {
+      h->flags.fetch_and(~kUsage, std::memory_order_relaxed);
+      continue;
+    }
+    // Fails if a lookup took a reference since the load above.
+    if (h->flags.compare_exchange_strong(flags, 0,
+                                         std::memory_order_acq_rel)) {
+      TableRemove(h->key, h->hash, h);
+      usage_ -= h->charge;
+      Recycle(h);
+    }
+  }
+}
+
+ClockHandle* ClockCache::TableInsert(ClockHandle* h) {
+  ClockTable* t = table_.load(std::memory_order_relaxed);
+  const uint32_t size = t->mask + 1;
+  if ((table_elems_ + table_tombstones_ + 1) * 4 > size * 3) {
+    // Grow when more than half of the slots would be live, otherwise just
+    // clear the tombstones.
+    TableRebuild((table_elems_ + 1) * 2 > size ? size * 2 : size);
+    t = table_.load(std::memory_order_relaxed);
+  }
+
+  ClockSlot* free_slot = nullptr;
+  for (uint32_t i = h->hash & t->mask; ; i = (i + 1) & t->mask) {
+    ClockSlot* slot = &t->slots[i];
+    ClockHandle* old = slot->handle.load(std::memory_order_relaxed);
+    if (old == &tombstone_) {
+      if (free_slot == nullptr) {
+        free_slot = slot;
+      }
+      continue;
+    }
+    if (old == nullptr) {
+      break;
+    }
+    if (old->hash == h->hash && old->key == h->key) {
+      slot->hash.store(h->hash, std::memory_order_relaxed);
+      slot->handle.store(h, std::memory_order_release);
+      return old;
+    }
+  }
+  // The table always keeps an empty slot, so the loop above ends.
+  if (free_slot == nullptr) {
+    for (uint32_t i = h->hash & t->mask; ; i = (i + 1) & t->mask) {
+      if (t->slots[i].handle.load(std::memory_order_relaxed) == nullptr) {
+        free_slot = &t->slots[i];
+        break;
+      }
+    }
+  } else {
+    table_tombstones_--;
+  }
+  free_slot->hash.store(h->hash, std::memory_order_relaxed);
+  free_slot->handle.store(h, std::memory_order_release);
+  table_elems_++;
+  return nullptr;
+}
+
+ClockHandle* ClockCache::TableRemove(const Slice& key, uint32_t hash,
+                                     const ClockHandle* h) {
+  ClockTable* t = table_.load(std::memory_order_relaxed);
+  for (uint32_t i = hash & t->mask; ; i = (i + 1) & t->mask) {
+    ClockSlot* slot = &t->slots[i];
+    ClockHandle* e = slot->handle.load(std::memory_order_relaxed);
+    if (e == nullptr) {
+      return nullptr;
+    }
+    if (e != &tombstone_ &&
+        (h != nullptr ? e == h : (e->hash == hash && e->key == key))) {
+      slot->handle.store(&tombstone_, std::memory_order_release);
+      table_elems_--;
+      table_tombstones_++;
+      return e;
+    }
+  }
+}
+
+void ClockCache::TableRebuild(uint32_t size) {
+  ClockTable* old = table_.load(std::memory_order_relaxed);
+  std::vector<ClockHandle*> live;
+  live.reserve(table_elems_);
+  for (uint32_t i = 0; i <= old->mask; i++) {
+    ClockHandle* h = old->slots[i].handle.load(std::memory_order_relaxed);
+    if (h != nullptr && h != &tombstone_) {
+      live.push_back(h);
+    }
+  }
+
+  ClockTable* t = old;
+  if (size != old->mask + 1) {
+    t = new ClockTable(size);
+  } else {
+    // Clearing the table in place may make concurrent lookups miss
+    // entries that are being moved, which a cache is allowed to do.
+    for (uint32_t i = 0; i <= t->mask; i++) {
+      t->slots[i].handle.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+  for (size_t n = 0; n < live.size(); n++) {
+    ClockHandle* h = live[n];
+    uint32_t i = h->hash & t->mask;
+    while (t->slots[i].handle.load(std::memory_order_relaxed) != nullptr) {
+      i = (i + 1) & t->mask;
+    }
+    t->slots[i].hash.store(h->hash, std::memory_order_relaxed);
+    t->slots[i].handle.store(h, std::memory_order_release);
+  }
+  table_tombstones_ = 0;
+  if (t != old) {
+    table_.store(t, std::memory_order_release);
+    retired_tables_.push_back(old);
+  }
+}
+
+Cache::Handle* ClockCache::Lookup(const Slice& key, uint32_t hash) {
+  ClockTable* t = table_.load(std::memory_order_acquire);
+  uint32_t i = hash & t->mask;
+  for (uint32_t n = 0; n <= t->mask; n++, i = (i + 1) & t->mask) {
+    ClockSlot* slot = &t->slots[i];
+    ClockHandle* h = slot->handle.load(std::memory_order_acquire);
+    if (h == nullptr) {
+      break;
+    }
+    if (slot->hash.load(std::memory_order_relaxed) != hash || !TryRef(h)) {
+      continue;
+    }
+    // The handle may have been recycled for another key after it was
+    // read from the slot; the reference keeps it from changing now.
+    if (h->hash == hash && h->key == key) {
+      if ((h->flags.load(std::memory_order_relaxed) & kUsage) == 0) {
+        h->flags.fetch_or(kUsage, std::memory_order_relaxed);
+      }
+      return reinterpret_cast<Cache::Handle*>(h);
+    }
+    Unref(h);
+  }
+  return nullptr;
+}
+
+void ClockCache::Release(Cache::Handle* handle) {
+  Unref(reinterpret_cast<ClockHandle*>(handle));
+}
+
+Cache::Handle* ClockCache::Insert(
+    const Slice& key, uint32_t hash, void* value, size_t charge,
+    void (*deleter)(const Slice& key, void* value)) {
+  MutexLock l(&mutex_);
+
+  ClockHandle* h;
+  if (free_.empty()) {
+    handles_.emplace_back();
+    h = &handles_.back();
+  } else {
+    h = free_.back();
+    free_.pop_back();
+  }
+  h->key.assign(key.data(), key.size());
+  h->hash = hash;
+  h->charge = charge;
+  h->value = value;
+  h->deleter = deleter;
+
+  if (capacity_ > 0) {
+    h->flags.store(kInCache | kOneRef, std::memory_order_release);
+    usage_ += charge;
+    ClockHandle* old = TableInsert(h);
+    if (old != nullptr) {
+      RemoveFromCache(old);
+    }
+    EvictIfNeeded();
+  } else {  // don't cache. (capacity_==0 is supported and turns off caching.)
+    h->flags.store(kOneRef, std::memory_order_release);
+  }
+  return reinterpret_cast<Cache::Handle*>(h);
+}
+
+void ClockCache::Erase(const Slice& key, uint32_t hash) {
+  MutexLock l(&mutex_);
+  ClockHandle* h = TableRemove(key, hash, nullptr);
+  if (h != nullptr) {
+    RemoveFromCache(h);
+  }
+}
+
+void ClockCache::Prune() {
+  MutexLock l(&mutex_);
+  for (size_t i = 0; i < handles_.size(); i++) {
+    ClockHandle* h = &handles_[i];
+    uint32_t flags = h->flags.load(std::memory_order_relaxed);
+    while ((flags & kInCache) != 0 && Refs(flags) == 0) {
+      if (h->flags.compare_exchange_weak(flags, 0,
+                                         std::memory_order_acq_rel)) {
+        TableRemove(h->key, h->hash, h);
+        usage_ -= h->charge;
+        Recycle(h);
+        break;
+      }
+    }
+  }
+}
+
+class ShardedClockCache : public Cache {
+ private:
+  const int num_shard_bits_;
+  ClockCache* shard_;
+  port::Mutex id_mutex_;
+  uint64_t last_id_;
+
+  static inline uint32_t HashSlice(const Slice& s) {
+    return Hash(s.data(), s.size(), 0);
+  }
+
+  uint32_t Shard(uint32_t hash) const {
+    return num_shard_bits_ > 0 ? hash >> (32 - num_shard_bits_) : 0;
+  }
+
+ public:
+  ShardedClockCache(size_t capacity, int num_shard_bits)
+      : num_shard_bits_(num_shard_bits),
+        shard_(new ClockCache[1 << num_shard_bits]),
+        last_id_(0) {
+    const int num_shards = 1 << num_shard_bits_;
+    const size_t per_shard = (capacity + (num_shards - 1)) / num_shards;
+    for (int s = 0; s < num_shards; s++) {
+      shard_[s].SetCapacity(per_shard);
+    }
+  }
+  virtual ~ShardedClockCache() { delete[] shard_; }
+
+  // Priorities are ignored.
+  using Cache::Insert;
+  using Cache::Lookup;
+
+  virtual Handle* Insert(const Slice& key, void* value, size_t charge,
+                         void (*deleter)(const Slice& key, void* value)) {
+    const uint32_t hash = HashSlice(key);
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter);
+  }
+  virtual Handle* Lookup(const Slice& key) {
+    const uint32_t hash = HashSlice(key);
+    return shard_[Shard(hash)].Lookup(key, hash);
+  }
+  virtual void Release(Handle* handle) {
+    ClockHandle* h = reinterpret_cast<ClockHandle*>(handle);
+    shard_[Shard(h->hash)].Release(handle);
+  }
+  virtual void Erase(const Slice& key) {
+    const uint32_t hash = HashSlice(key);
+    shard_[Shard(hash)].Erase(key, hash);
+  }
+  virtual void* Value(Handle* handle) {
+    return reinterpret_cast<ClockHandle*>(handle)->value;
+  }
+  virtual uint64_t NewId() {
+    MutexLock l(&id_mutex_);
+    return ++(last_id_);
+  }
+  virtual void Prune() {
+    for (int s = 0; s < (1 << num_shard_bits_); s++) {
+      shard_[s].Prune();
+    }
+  }
+  virtual size_t TotalCharge() const {
+    size_t total = 0;
+    for (int s = 0; s < (1 << num_shard_bits_); s++) {
+      total += shard_[s].TotalCharge();
+    }
+    return total;
+  }
 };
 
 }  // end anonymous namespace
 
 Cache* NewLRUCache(size_t capacity) {
-  return new ShardedLRUCache(capacity);
+  return new ShardedLRUCache(capacity, 0.0);
+}
+
+Cache* NewLRUCache(size_t capacity, double high_pri_pool_ratio) {
+  if (high_pri_pool_ratio < 0.0) {
+    high_pri_pool_ratio = 0.0;
+  } else if (high_pri_pool_ratio > 1.0) {
+    high_pri_pool_ratio = 1.0;
+  }
+  return new ShardedLRUCache(capacity, high_pri_pool_ratio);
+}
+
+Cache* NewClockCache(size_t capacity, int num_shard_bits) {
+  if (num_shard_bits < 0) {
+    num_shard_bits = 0;
+  } else if (num_shard_bits > 16) {
+    num_shard_bits = 16;
+  }
+  return new ShardedClockCache(capacity, num_shard_bits);
 }
 
 }  // namespace leveldb
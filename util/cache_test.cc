@@ -4,8 +4,11 @@
 
 #include "leveldb/cache.h"
 
+#include <atomic>
 #include <vector>
+#include "leveldb/env.h"
 #include "util/coding.h"
+#include "util/random.h"
 #include "util/testharness.h"
 
 namespace leveldb {
@@ -59,6 +62,12 @@ class CacheTest {
                                    &CacheTest::Deleter));
   }
 
+  void InsertHighPriority(int key, int value) {
+    cache_->Release(cache_->Insert(EncodeKey(key), EncodeValue(value), 1,
+                                   &CacheTest::Deleter,
+                                   Cache::kHighPriority));
+  }
+
   Cache::Handle* InsertAndReturnHandle(int key, int value, int charge = 1) {
     return cache_->Insert(EncodeKey(key), EncodeValue(value), charge,
                           &CacheTest::Deleter);
@@ -227,6 +236,328 @@ TEST(CacheTest, ZeroSizeCache) {
   ASSERT_EQ(-1, Lookup(1));
 }
 
+TEST(CacheTest, HighPriorityPool) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0.5);
+
+  for (int i = 0; i < 100; i++) {
+    InsertHighPriority(i, 1000+i);
+  }
+  // A scan of low priority entries that are never looked up again must
+  // not evict the high priority entries.
+  for (int i = 0; i < 2 * kCacheSize; i++) {
+    Insert(10000+i, 20000+i);
+  }
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(1000+i, Lookup(i));
+  }
+  ASSERT_LE(cache_->TotalCharge(),
+            static_cast<size_t>(kCacheSize + kCacheSize/10));
+}
+
+TEST(CacheTest, NoHighPriorityPool) {
+  // Without a pool, priorities make no difference.
+  for (int i = 0; i < 100; i++) {
+    InsertHighPriority(i, 1000+i);
+  }
+  for (int i = 0; i < 2 * kCacheSize; i++) {
+    Insert(10000+i, 20000+i);
+  }
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(-1, Lookup(i));
+  }
+}
+
+TEST(CacheTest, HitEntriesJoinHighPriorityPool) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0.5);
+
+  for (int i = 0; i < 100; i++) {
+    Insert(i, 1000+i);
+    ASSERT_EQ(1000+i, Lookup(i));
+  }
+  for (int i = 0; i < 2 * kCacheSize; i++) {
+    Insert(10000+i, 20000+i);
+  }
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(1000+i, Lookup(i));
+  }
+}
+
+TEST(CacheTest, HighPriorityPoolOverflow) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0.5);
+
+  // More high priority entries than the pool holds: the older ones leave
+  // the pool and are evicted like low priority entries.
+  for (int i = 0; i < 2 * kCacheSize; i++) {
+    InsertHighPriority(i, 1000+i);
+  }
+  ASSERT_LE(cache_->TotalCharge(),
+            static_cast<size_t>(kCacheSize + kCacheSize/10));
+  ASSERT_EQ(-1, Lookup(0));
+  ASSERT_EQ(1000 + 2 * kCacheSize - 1, Lookup(2 * kCacheSize - 1));
+}
+
+TEST(CacheTest, LookupStats) {
+  Insert(1, 100);
+  InsertHighPriority(2, 200);
+
+  cache_->Release(cache_->Lookup(EncodeKey(2), Cache::kHighPriority));
+  ASSERT_TRUE(cache_->Lookup(EncodeKey(3), Cache::kHighPriority) == nullptr);
+  ASSERT_EQ(100, Lookup(1));
+  ASSERT_EQ(-1, Lookup(4));
+  ASSERT_EQ(-1, Lookup(5));
+
+  uint64_t lookups, hits;
+  cache_->GetLookupStats(Cache::kHighPriority, &lookups, &hits);
+  ASSERT_EQ(2, lookups);
+  ASSERT_EQ(1, hits);
+  cache_->GetLookupStats(Cache::kLowPriority, &lookups, &hits);
+  ASSERT_EQ(3, lookups);
+  ASSERT_EQ(1, hits);
+}
+
+class ClockCacheTest : public CacheTest {
+ public:
+  ClockCacheTest() {
+    delete cache_;
+    cache_ = NewClockCache(kCacheSize);
+  }
+};
+
+TEST(ClockCacheTest, ClockHitAndMiss) {
+  ASSERT_EQ(-1, Lookup(100));
+
+  Insert(100, 101);
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1,  Lookup(200));
+
+  Insert(200, 201);
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(201, Lookup(200));
+
+  Insert(100, 102);
+  ASSERT_EQ(102, Lookup(100));
+  ASSERT_EQ(201, Lookup(200));
+
+  ASSERT_EQ(1, deleted_keys_.size());
+  ASSERT_EQ(100, deleted_keys_[0]);
+  ASSERT_EQ(101, deleted_values_[0]);
+}
+
+TEST(ClockCacheTest, ClockErase) {
+  Erase(200);
+  ASSERT_EQ(0, deleted_keys_.size());
+
+  Insert(100, 101);
+  Insert(200, 201);
+  Erase(100);
+  ASSERT_EQ(-1,  Lookup(100));
+  ASSERT_EQ(201, Lookup(200));
+  ASSERT_EQ(1, deleted_keys_.size());
+  ASSERT_EQ(100, deleted_keys_[0]);
+  ASSERT_EQ(101, deleted_values_[0]);
+
+  Erase(100);
+  ASSERT_EQ(1, deleted_keys_.size());
+
+  // Erased keys can be inserted again.
+  Insert(100, 102);
+  ASSERT_EQ(102, Lookup(100));
+}
+
+TEST(ClockCacheTest, ClockEntriesArePinned) {
+  Insert(100, 101);
+  Cache::Handle* h1 = cache_->Lookup(EncodeKey(100));
+  ASSERT_EQ(101, DecodeValue(cache_->Value(h1)));
+
+  Insert(100, 102);
+  Cache::Handle* h2 = cache_->Lookup(EncodeKey(100));
+  ASSERT_EQ(102, DecodeValue(cache_->Value(h2)));
+  ASSERT_EQ(0, deleted_keys_.size());
+
+  cache_->Release(h1);
+  ASSERT_EQ(1, deleted_keys_.size());
+  ASSERT_EQ(100, deleted_keys_[0]);
+  ASSERT_EQ(101, deleted_values_[0]);
+
+  Erase(100);
+  ASSERT_EQ(-1, Lookup(100));
+  ASSERT_EQ(1, deleted_keys_.size());
+
+  cache_->Release(h2);
+  ASSERT_EQ(2, deleted_keys_.size());
+  ASSERT_EQ(100, deleted_keys_[1]);
+  ASSERT_EQ(102, deleted_values_[1]);
+}
+
+TEST(ClockCacheTest, ClockEvictionPolicy) {
+  Insert(100, 101);
+  Insert(200, 201);
+  Insert(300, 301);
+  Cache::Handle* h = cache_->Lookup(EncodeKey(300));
+
+  // An entry that was used since the clock hand last passed it must be
+  // kept around, as must things that are still in use.  Entries that are
+  // inserted and never looked up are evicted first.
+  for (int i = 0; i < kCacheSize + 100; i++) {
+    Insert(1000+i, 2000+i);
+    ASSERT_EQ(101, Lookup(100));
+  }
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1, Lookup(200));
+  ASSERT_EQ(301, Lookup(300));
+  cache_->Release(h);
+}
+
+TEST(ClockCacheTest, ClockUseExceedsCacheSize) {
+  // Overfill the cache, keeping handles on all inserted entries.
+  std::vector<Cache::Handle*> h;
+  for (int i = 0; i < kCacheSize + 100; i++) {
+    h.push_back(InsertAndReturnHandle(1000+i, 2000+i));
+  }
+
+  // Check that all the entries can be found in the cache.
+  for (size_t i = 0; i < h.size(); i++) {
+    const int k = static_cast<int>(i);
+    ASSERT_EQ(2000+k, Lookup(1000+k));
+  }
+
+  for (size_t i = 0; i < h.size(); i++) {
+    cache_->Release(h[i]);
+  }
+}
+
+TEST(ClockCacheTest, ClockHeavyEntries) {
+  const int kLight = 1;
+  const int kHeavy = 10;
+  int added = 0;
+  int index = 0;
+  while (added < 2*kCacheSize) {
+    const int weight = (index & 1) ? kLight : kHeavy;
+    Insert(index, 1000+index, weight);
+    added += weight;
+    index++;
+  }
+
+  int cached_weight = 0;
+  for (int i = 0; i < index; i++) {
+    const int weight = (i & 1 ? kLight : kHeavy);
+    int r = Lookup(i);
+    if (r >= 0) {
+      cached_weight += weight;
+      ASSERT_EQ(1000+i, r);
+    }
+  }
+  ASSERT_LE(cached_weight, kCacheSize + kCacheSize/10);
+  ASSERT_EQ(cached_weight, cache_->TotalCharge());
+}
+
+TEST(ClockCacheTest, ClockPrune) {
+  Insert(1, 100);
+  Insert(2, 200);
+
+  Cache::Handle* handle = cache_->Lookup(EncodeKey(1));
+  ASSERT_TRUE(handle);
+  cache_->Prune();
+  cache_->Release(handle);
+
+  ASSERT_EQ(100, Lookup(1));
+  ASSERT_EQ(-1, Lookup(2));
+  ASSERT_EQ(1, cache_->TotalCharge());
+}
+
+TEST(ClockCacheTest, ClockZeroSizeCache) {
+  delete cache_;
+  cache_ = NewClockCache(0);
+
+  Insert(1, 100);
+  ASSERT_EQ(-1, Lookup(1));
+  ASSERT_EQ(1, deleted_keys_.size());
+}
+
+TEST(ClockCacheTest, ClockShardBits) {
+  for (int bits = 0; bits <= 6; bits++) {
+    delete cache_;
+    cache_ = NewClockCache(kCacheSize, bits);
+    for (int i = 0; i < 100; i++) {
+      Insert(i, 1000+i);
+    }
+    for (int i = 0; i < 100; i++) {
+      ASSERT_EQ(1000+i, Lookup(i));
+    }
+  }
+}
+
+namespace {
+
+struct ConcurrentState {
+  Cache* cache;
+  std::atomic<int> live;       // Values not yet passed to the deleter
+  std::atomic<int> done;
+  std::atomic<bool> failed;
+};
+
+void CountingDeleter(const Slice& key, void* v) {
+  ConcurrentState* state = reinterpret_cast<ConcurrentState*>(v);
+  state->live.fetch_sub(1);
+}
+
+struct ConcurrentThread {
+  ConcurrentState* state;
+  int id;
+};
+
+void ConcurrentBody(void* arg) {
+  ConcurrentThread* t = reinterpret_cast<ConcurrentThread*>(arg);
+  ConcurrentState* state = t->state;
+  Cache* cache = state->cache;
+  Random rnd(301 + t->id);
+  for (int i = 0; i < 20000; i++) {
+    const int k = rnd.Uniform(500);
+    const std::string key = EncodeKey(k);
+    Cache::Handle* h = cache->Lookup(key);
+    if (h == nullptr) {
+      state->live.fetch_add(1);
+      h = cache->Insert(key, state, 1, &CountingDeleter);
+    } else if (rnd.OneIn(50)) {
+      cache->Erase(key);
+    }
+    if (cache->Value(h) != state) {
+      state->failed.store(true);
+    }
+    cache->Release(h);
+  }
+  state->done.fetch_add(1);
+}
+
+}  // namespace
+
+TEST(ClockCacheTest, ClockConcurrent) {
+  const int kThreads = 8;
+  ConcurrentState state;
+  state.cache = NewClockCache(100, 2);
+  state.live.store(0);
+  state.done.store(0);
+  state.failed.store(false);
+
+  ConcurrentThread threads[kThreads];
+  for (int i = 0; i < kThreads; i++) {
+    threads[i].state = &state;
+    threads[i].id = i;
+    Env::Default()->StartThread(&ConcurrentBody, &threads[i]);
+  }
+  while (state.done.load() < kThreads) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  ASSERT_TRUE(!state.failed.load());
+  ASSERT_LE(state.cache->TotalCharge(), 100u);
+
+  delete state.cache;
+  ASSERT_EQ(0, state.live.load());
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
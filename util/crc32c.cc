@@ -11,6 +11,7 @@
 
 #include "port/port.h"
 #include "util/coding.h"
+#include "util/crc32c_internal.h"
 
 namespace leveldb {
 namespace crc32c {
@@ -262,23 +263,7 @@ constexpr inline const uint8_t* RoundUp(const uint8_t* pointer) {
 
 }  // namespace
 
-// Determine if the CPU running this program can accelerate the CRC32C
-// calculation.
-static bool CanAccelerateCRC32C() {
-  // port::AcceleretedCRC32C returns zero when unable to accelerate.
-  static const char kTestCRCBuffer[] = "TestCRCBuffer";
-  static const char kBufSize = sizeof(kTestCRCBuffer) - 1;
-  static const uint32_t kTestCRCValue = 0xdcbc59fa;
-
-  return port::AcceleratedCRC32C(0, kTestCRCBuffer, kBufSize) == kTestCRCValue;
-}
-
-uint32_t Extend(uint32_t crc, const char* buf, size_t size) {
-  static bool accelerate = CanAccelerateCRC32C();
-  if (accelerate) {
-    return port::AcceleratedCRC32C(crc, buf, size);
-  }
-
+uint32_t ExtendPortable(uint32_t crc, const char* buf, size_t size) {
   const uint8_t* p = reinterpret_cast<const uint8_t*>(buf);
   const uint8_t* e = p + size;
   uint32_t l = crc ^ kCRC32Xor;
@@ -376,5 +361,152 @@ uint32_t Extend(uint32_t crc, const char* buf, size_t size) {
   return l ^ kCRC32Xor;
 }
 
+namespace {
+
+// Zero-operator tables used by ShiftLong() and ShiftShort().  Entry
+// table[k][b] is the crc register that results from feeding "len" zero
+// bytes into a register holding (b << (8*k)); by linearity the shift of
+// any register is the xor of four lookups.
+struct ZeroTables {
+  uint32_t long_table[4][256];
+  uint32_t short_table[4][256];
+
+  ZeroTables() {
+    Build(long_table, kLongBlock);
+    Build(short_table, kShortBlock);
+  }
+
+  // Multiply the 32x32 GF(2) matrix "mat" by the vector "vec".
+  static uint32_t MatrixTimes(const uint32_t* mat, uint32_t vec) {
+    uint32_t sum = 0;
+    while (vec != 0) {
+      if (vec & 1) {
+        sum ^= *mat;
+      }
+      vec >>= 1;
+      mat++;
+    }
+    return sum;
+  }
+
+  static void MatrixSquare(uint32_t* square, const uint32_t* mat) {
+    for (int n = 0; n < 32; n++) {
+      square[n] = MatrixTimes(mat, mat[n]);
+    }
+  }
+
+  // Fill "table" for a power-of-two number of zero bytes "len".
+  static void Build(uint32_t table[4][256], size_t len) {
+    // Operator for a single zero bit: shift right, folding in the
+    // (reflected) Castagnoli polynomial.
+    uint32_t odd[32];
+    uint32_t even[32];
+    odd[0] = 0x82f63b78u;
+    uint32_t row = 1;
+    for (int n = 1; n < 32; n++) {
+      odd[n] = row;
+      row <<= 1;
+    }
+    MatrixSquare(even, odd);  // 2 zero bits
+    MatrixSquare(odd, even);  // 4 zero bits
+
+    // Each squaring doubles the number of zeros; the first one below
+    // yields the operator for one zero byte.
+    const uint32_t* op;
+    while (true) {
+      MatrixSquare(even, odd);
+      len >>= 1;
+      if (len == 0) {
+        op = even;
+        break;
+      }
+      MatrixSquare(odd, even);
+      len >>= 1;
+      if (len == 0) {
+        op = odd;
+        break;
+      }
+    }
+
+    for (uint32_t n = 0; n < 256; n++) {
+      table[0][n] = MatrixTimes(op, n);
+      table[1][n] = MatrixTimes(op, n << 8);
+      table[2][n] = MatrixTimes(op, n << 16);
+      table[3][n] = MatrixTimes(op, n << 24);
+    }
+  }
+};
+
+const ZeroTables& GetZeroTables() {
+  static const ZeroTables tables;
+  return tables;
+}
+
+inline uint32_t Shift(const uint32_t table[4][256], uint32_t crc) {
+  return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^
+         table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+}
+
+// Determine if the CPU running this program can accelerate the CRC32C
+// calculation.
+bool CanAccelerateCRC32C() {
+  // port::AcceleretedCRC32C returns zero when unable to accelerate.
+  static const char kTestCRCBuffer[] = "TestCRCBuffer";
+  static const char kBufSize = sizeof(kTestCRCBuffer) - 1;
+  static const uint32_t kTestCRCValue = 0xdcbc59fa;
+
+  return port::AcceleratedCRC32C(0, kTestCRCBuffer, kBufSize) == kTestCRCValue;
+}
+
+uint32_t ExtendAccelerated(uint32_t crc, const char* buf, size_t size) {
+  return port::AcceleratedCRC32C(crc, buf, size);
+}
+
+struct Implementation {
+  const char* name;
+  uint32_t (*extend)(uint32_t crc, const char* buf, size_t size);
+};
+
+// Pick the fastest kernel available on this CPU: the crc32 instruction
+// when we know how to use it ourselves, then the CRC32C library, then
+// the portable tables.
+Implementation ChooseImplementation() {
+  if (CanUseSse42()) {
+    GetZeroTables();
+    return Implementation{"sse4.2", &ExtendSse42};
+  }
+  if (CanUseArm64()) {
+    GetZeroTables();
+    return Implementation{"armv8-crc", &ExtendArm64};
+  }
+  if (CanAccelerateCRC32C()) {
+    return Implementation{"crc32c-library", &ExtendAccelerated};
+  }
+  return Implementation{"portable", &ExtendPortable};
+}
+
+const Implementation& GetImplementation() {
+  static const Implementation impl = ChooseImplementation();
+  return impl;
+}
+
+}  // namespace
+
+uint32_t ShiftLong(uint32_t crc) {
+  return Shift(GetZeroTables().long_table, crc);
+}
+
+uint32_t ShiftShort(uint32_t crc) {
+  return Shift(GetZeroTables().short_table, crc);
+}
+
+uint32_t Extend(uint32_t crc, const char* buf, size_t size) {
+  return GetImplementation().extend(crc, buf, size);
+}
+
+const char* ImplementationName() {
+  return GetImplementation().name;
+}
+
 }  // namespace crc32c
 }  // namespace leveldb
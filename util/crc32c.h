@@ -18,6 +18,10 @@ namespace crc32c {
 // crc32c of a stream of data.
 uint32_t Extend(uint32_t init_crc, const char* data, size_t n);
 
+// Return the name of the kernel Extend() dispatches to on this CPU, e.g.
+// "sse4.2", "armv8-crc", "crc32c-library" or "portable".
+const char* ImplementationName();
+
 // Return the crc32c of data[0,n-1]
 inline uint32_t Value(const char* data, size_t n) {
   return Extend(0, data, n);
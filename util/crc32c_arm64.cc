@@ -0,0 +1,117 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// crc32c kernel for AArch64 CPUs that implement the optional ARMv8 CRC
+// extension.  As with crc32c_sse42.cc, only the functions below are
+// built for the extension and they are only called after CanUseArm64()
+// checked the CPU at runtime.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "port/port.h"
+#include "util/crc32c_internal.h"
+
+#if HAVE_ARM64_CRC32C
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#endif  // HAVE_ARM64_CRC32C
+
+namespace leveldb {
+namespace crc32c {
+
+#if HAVE_ARM64_CRC32C
+
+// GCC and clang spell the target feature differently.
+#if defined(__clang__)
+#define LEVELDB_TARGET_CRC __attribute__((target("crc")))
+#else
+#define LEVELDB_TARGET_CRC __attribute__((target("+crc")))
+#endif
+
+namespace {
+
+inline uint64_t LoadUint64(const uint8_t* p) {
+  uint64_t word;
+  memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+// See ExtendThreeBlocks() in crc32c_sse42.cc.
+LEVELDB_TARGET_CRC
+inline void ExtendThreeBlocks(uint32_t* crc, const uint8_t** next,
+                              size_t block, uint32_t (*shift)(uint32_t)) {
+  const uint8_t* p = *next;
+  const uint8_t* end = p + block;
+  uint32_t crc0 = *crc;
+  uint32_t crc1 = 0;
+  uint32_t crc2 = 0;
+  do {
+    crc0 = __crc32cd(crc0, LoadUint64(p));
+    crc1 = __crc32cd(crc1, LoadUint64(p + block));
+    crc2 = __crc32cd(crc2, LoadUint64(p + 2 * block));
+    p += 8;
+  } while (p < end);
+  crc0 = (*shift)(crc0) ^ crc1;
+  crc0 = (*shift)(crc0) ^ crc2;
+  *crc = crc0;
+  *next = p + 2 * block;
+}
+
+}  // namespace
+
+LEVELDB_TARGET_CRC
+uint32_t ExtendArm64(uint32_t crc, const char* buf, size_t size) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(buf);
+  uint32_t l = crc ^ 0xffffffffu;
+
+  // Bring p to an 8-byte boundary.
+  while (size > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    l = __crc32cb(l, *p++);
+    size--;
+  }
+
+  while (size >= 3 * kLongBlock) {
+    ExtendThreeBlocks(&l, &p, kLongBlock, &ShiftLong);
+    size -= 3 * kLongBlock;
+  }
+  while (size >= 3 * kShortBlock) {
+    ExtendThreeBlocks(&l, &p, kShortBlock, &ShiftShort);
+    size -= 3 * kShortBlock;
+  }
+
+  // Whatever is left is too short to be worth interleaving.
+  while (size >= 8) {
+    l = __crc32cd(l, LoadUint64(p));
+    p += 8;
+    size -= 8;
+  }
+  while (size > 0) {
+    l = __crc32cb(l, *p++);
+    size--;
+  }
+  return l ^ 0xffffffffu;
+}
+
+bool CanUseArm64() {
+  return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+#undef LEVELDB_TARGET_CRC
+
+#else  // !HAVE_ARM64_CRC32C
+
+uint32_t ExtendArm64(uint32_t crc, const char* buf, size_t size) {
+  return ExtendPortable(crc, buf, size);
+}
+
+bool CanUseArm64() {
+  return false;
+}
+
+#endif  // HAVE_ARM64_CRC32C
+
+}  // namespace crc32c
+}  // namespace leveldb
@@ -0,0 +1,44 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Building blocks shared by the crc32c implementations.  Only crc32c.cc
+// and the hardware kernels should include this file; everybody else
+// goes through util/crc32c.h.
+
+#ifndef STORAGE_LEVELDB_UTIL_CRC32C_INTERNAL_H_
+#define STORAGE_LEVELDB_UTIL_CRC32C_INTERNAL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace leveldb {
+namespace crc32c {
+
+// Table-driven implementation of Extend() that runs on any CPU.
+uint32_t ExtendPortable(uint32_t crc, const char* data, size_t n);
+
+// Implementations of Extend() built on the crc32 instruction of SSE4.2
+// (x86-64) or of the ARMv8 CRC extension.  CanUseXXX() returns true iff
+// the kernel was compiled in and the CPU running this program supports
+// it; ExtendXXX() must not be called otherwise.
+bool CanUseSse42();
+uint32_t ExtendSse42(uint32_t crc, const char* data, size_t n);
+bool CanUseArm64();
+uint32_t ExtendArm64(uint32_t crc, const char* data, size_t n);
+
+// The hardware kernels hide the latency of the crc32 instruction by
+// running three independent streams over adjacent blocks of kLongBlock
+// (then kShortBlock) bytes, and stitching the partial results together
+// with the functions below.  ShiftLong(crc) returns the raw (not
+// pre/post-conditioned) crc register after feeding kLongBlock zero bytes
+// into "crc"; ShiftShort() does the same for kShortBlock bytes.
+static const size_t kLongBlock = 8192;
+static const size_t kShortBlock = 256;
+uint32_t ShiftLong(uint32_t crc);
+uint32_t ShiftShort(uint32_t crc);
+
+}  // namespace crc32c
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_CRC32C_INTERNAL_H_
@@ -0,0 +1,110 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// crc32c kernel for x86-64 CPUs that implement SSE4.2.  The file is
+// compiled without -msse4.2 so that the rest of the binary keeps running
+// on older CPUs; only the functions below are built for SSE4.2 and they
+// are only called after CanUseSse42() checked the CPU at runtime.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "port/port.h"
+#include "util/crc32c_internal.h"
+
+#if HAVE_SSE42_CRC32C
+#include <nmmintrin.h>
+#endif  // HAVE_SSE42_CRC32C
+
+namespace leveldb {
+namespace crc32c {
+
+#if HAVE_SSE42_CRC32C
+
+namespace {
+
+inline uint64_t LoadUint64(const uint8_t* p) {
+  uint64_t word;
+  memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+// Run the crc32 instruction over three adjacent blocks of "block" bytes
+// at once and fold the results into *crc.  The instruction has a
+// latency of three cycles but a throughput of one per cycle, so three
+// independent dependency chains keep the unit busy.
+__attribute__((target("sse4.2")))
+inline void ExtendThreeBlocks(uint64_t* crc, const uint8_t** next,
+                              size_t block, uint32_t (*shift)(uint32_t)) {
+  const uint8_t* p = *next;
+  const uint8_t* end = p + block;
+  uint64_t crc0 = *crc;
+  uint64_t crc1 = 0;
+  uint64_t crc2 = 0;
+  do {
+    crc0 = _mm_crc32_u64(crc0, LoadUint64(p));
+    crc1 = _mm_crc32_u64(crc1, LoadUint64(p + block));
+    crc2 = _mm_crc32_u64(crc2, LoadUint64(p + 2 * block));
+    p += 8;
+  } while (p < end);
+  crc0 = (*shift)(static_cast<uint32_t>(crc0)) ^ crc1;
+  crc0 = (*shift)(static_cast<uint32_t>(crc0)) ^ crc2;
+  *crc = crc0;
+  *next = p + 2 * block;
+}
+
+}  // namespace
+
+__attribute__((target("sse4.2")))
+uint32_t ExtendSse42(uint32_t crc, const char* buf, size_t size) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(buf);
+  uint64_t l = crc ^ 0xffffffffu;
+
+  // Bring p to an 8-byte boundary.
+  while (size > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    l = _mm_crc32_u8(static_cast<uint32_t>(l), *p++);
+    size--;
+  }
+
+  while (size >= 3 * kLongBlock) {
+    ExtendThreeBlocks(&l, &p, kLongBlock, &ShiftLong);
+    size -= 3 * kLongBlock;
+  }
+  while (size >= 3 * kShortBlock) {
+    ExtendThreeBlocks(&l, &p, kShortBlock, &ShiftShort);
+    size -= 3 * kShortBlock;
+  }
+
+  // Whatever is left is too short to be worth interleaving.
+  while (size >= 8) {
+    l = _mm_crc32_u64(l, LoadUint64(p));
+    p += 8;
+    size -= 8;
+  }
+  while (size > 0) {
+    l = _mm_crc32_u8(static_cast<uint32_t>(l), *p++);
+    size--;
+  }
+  return static_cast<uint32_t>(l) ^ 0xffffffffu;
+}
+
+bool CanUseSse42() {
+  return __builtin_cpu_supports("sse4.2");
+}
+
+#else  // !HAVE_SSE42_CRC32C
+
+uint32_t ExtendSse42(uint32_t crc, const char* buf, size_t size) {
+  return ExtendPortable(crc, buf, size);
+}
+
+bool CanUseSse42() {
+  return false;
+}
+
+#endif  // HAVE_SSE42_CRC32C
+
+}  // namespace crc32c
+}  // namespace leveldb
@@ -3,6 +3,8 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include "util/crc32c.h"
+#include "util/crc32c_internal.h"
+#include "util/random.h"
 #include "util/testharness.h"
 
 namespace leveldb {
@@ -56,6 +58,43 @@ TEST(CRC, Extend) {
             Extend(Value("hello ", 6), "world", 5));
 }
 
+TEST(CRC, MatchesPortable) {
+  // Cover every alignment and sizes on both sides of the interleaved
+  // block thresholds of the hardware kernels.
+  Random rnd(301);
+  std::string data;
+  for (size_t i = 0; i < 3 * kLongBlock * 2 + 100; i++) {
+    data.push_back(static_cast<char>(rnd.Uniform(256)));
+  }
+  const size_t sizes[] = {
+    0, 1, 7, 8, 9, 63, 64, 65,
+    3 * kShortBlock - 1, 3 * kShortBlock, 3 * kShortBlock + 13,
+    3 * kLongBlock - 1, 3 * kLongBlock, 3 * kLongBlock + 3 * kShortBlock + 5,
+    3 * kLongBlock * 2 + 90,
+  };
+  for (size_t offset = 0; offset < 8; offset++) {
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      const uint32_t init = rnd.Next();
+      const char* p = data.data() + offset;
+      ASSERT_EQ(ExtendPortable(init, p, sizes[s]), Extend(init, p, sizes[s]));
+    }
+  }
+  fprintf(stderr, "crc32c implementation: %s\n", ImplementationName());
+}
+
+TEST(CRC, Shift) {
+  // Shifting by a block of zeros must agree with feeding the zeros in.
+  std::string zeros(kLongBlock, '\0');
+  Random rnd(302);
+  for (int i = 0; i < 10; i++) {
+    const uint32_t crc = rnd.Next();
+    // ExtendPortable() conditions its input and output with ~0.
+    ASSERT_EQ(~ExtendPortable(~crc, zeros.data(), kLongBlock), ShiftLong(crc));
+    ASSERT_EQ(~ExtendPortable(~crc, zeros.data(), kShortBlock),
+              ShiftShort(crc));
+  }
+}
+
 TEST(CRC, Mask) {
   uint32_t crc = Value("foo", 3);
   ASSERT_NE(crc, Mask(crc));
@@ -13,12 +13,42 @@ Status Env::NewAppendableFile(const std::string& fname, WritableFile** result) {
   return Status::NotSupported("NewAppendableFile", fname);
 }
 
+Status Env::NewDirectRandomAccessFile(const std::string& fname,
+                                      RandomAccessFile** result) {
+  return NewRandomAccessFile(fname, result);
+}
+
+Status Env::NewDirectWritableFile(const std::string& fname,
+                                  WritableFile** result) {
+  return NewWritableFile(fname, result);
+}
+
+void Env::Schedule(void (*function)(void*), void* arg, Priority pri) {
+  Schedule(function, arg);
+}
+
+void Env::SetBackgroundThreads(int number, Priority pri) {
+}
+
 SequentialFile::~SequentialFile() {
 }
 
 RandomAccessFile::~RandomAccessFile() {
 }
 
+void RandomAccessFile::Hint(AccessPattern pattern) {
+}
+
+void RandomAccessFile::Prefetch(uint64_t offset, size_t n) {
+}
+
+void RandomAccessFile::MultiRead(ReadRequest* requests, int n) const {
+  for (int i = 0; i < n; i++) {
+    ReadRequest* r = &requests[i];
+    r->status = Read(r->offset, r->n, &r->result, r->scratch);
+  }
+}
+
 WritableFile::~WritableFile() {
 }
 
@@ -139,6 +139,20 @@ class PosixSequentialFile: public SequentialFile {
   }
 };
 
+// Pass an access pattern on to the kernel.  Errors are ignored, since
+// the advice only affects performance.
+static void Fadvise(int fd, RandomAccessFile::AccessPattern pattern) {
+#if defined(POSIX_FADV_SEQUENTIAL)
+  int advice = POSIX_FADV_NORMAL;
+  if (pattern == RandomAccessFile::kSequential) {
+    advice = POSIX_FADV_SEQUENTIAL;
+  } else if (pattern == RandomAccessFile::kDontNeed) {
+    advice = POSIX_FADV_DONTNEED;
+  }
+  posix_fadvise(fd, 0, 0, advice);
+#endif  // defined(POSIX_FADV_SEQUENTIAL)
+}
+
 // pread() based random-access
 class PosixRandomAccessFile: public RandomAccessFile {
  private:
@@ -188,6 +202,22 @@ class PosixRandomAccessFile: public RandomAccessFile {
     }
     return s;
   }
+
+  virtual void Hint(AccessPattern pattern) {
+    if (!temporary_fd_) {
+      Fadvise(fd_, pattern);
+    }
+  }
+
+  virtual void Prefetch(uint64_t offset, size_t n) {
+#if defined(POSIX_FADV_WILLNEED)
+    if (!temporary_fd_) {
+      // Ignoring any potential errors
+      posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(n),
+                    POSIX_FADV_WILLNEED);
+    }
+#endif  // defined(POSIX_FADV_WILLNEED)
+  }
 };
 
 // mmap() based random-access
@@ -223,6 +253,30 @@ class PosixMmapReadableFile: public RandomAccessFile {
     }
     return s;
   }
+
+  virtual void Hint(AccessPattern pattern) {
+    int advice = MADV_NORMAL;
+    if (pattern == kSequential) {
+      advice = MADV_SEQUENTIAL;
+    } else if (pattern == kDontNeed) {
+      advice = MADV_DONTNEED;
+    }
+    // Ignoring any potential errors
+    madvise(mmapped_region_, length_, advice);
+  }
+
+  virtual void Prefetch(uint64_t offset, size_t n) {
+    if (offset >= length_) {
+      return;
+    }
+    n = std::min<uint64_t>(n, length_ - offset);
+    // madvise() needs a page aligned address
+    static const uint64_t page_size = sysconf(_SC_PAGESIZE);
+    const uint64_t start = offset - offset % page_size;
+    // Ignoring any potential errors
+    madvise(reinterpret_cast<char*>(mmapped_region_) + start,
+            offset + n - start, MADV_WILLNEED);
+  }
 };
 
 class PosixWritableFile : public WritableFile {
@@ -363,6 +417,224 @@ class PosixWritableFile : public WritableFile {
   }
 };
 
+// Direct I/O requires the buffer, file offset and length of every read
+// and write to be multiples of the logical block size of the device;
+// 4096 covers every common device.
+static const size_t kDirectIOAlignment = 4096;
+static const size_t kDirectBufSize = 1 << 20;
+
+static size_t RoundUpToAlignment(size_t n) {
+  return (n + kDirectIOAlignment - 1) & ~(kDirectIOAlignment - 1);
+}
+
+// Open fname so that its reads and writes bypass the page cache.  Returns
+// -1 with errno set to EINVAL if the file system does not support it.
+static int OpenDirect(const char* fname, int flags, mode_t mode) {
+#if defined(O_DIRECT)
+  return open(fname, flags | O_DIRECT, mode);
+#else
+  int fd = open(fname, flags, mode);
+#if defined(F_NOCACHE)
+  if (fd >= 0 && fcntl(fd, F_NOCACHE, 1) != 0) {
+    close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+#endif  // defined(F_NOCACHE)
+  return fd;
+#endif  // defined(O_DIRECT)
+}
+
+// pread() based random-access that bypasses the page cache.  Every read
+// covers the aligned range around the requested bytes and is copied out
+// of an aligned buffer into scratch.
+class PosixDirectRandomAccessFile: public RandomAccessFile {
+ private:
+  std::string filename_;
+  bool temporary_fd_;  // If true, fd_ is -1 and we open on every read.
+  int fd_;
+  Limiter* limiter_;
+
+ public:
+  PosixDirectRandomAccessFile(const std::string& fname, int fd,
+                              Limiter* limiter)
+      : filename_(fname), fd_(fd), limiter_(limiter) {
+    temporary_fd_ = !limiter->Acquire();
+    if (temporary_fd_) {
+      // Open file on every access.
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  virtual ~PosixDirectRandomAccessFile() {
+    if (!temporary_fd_) {
+      close(fd_);
+      limiter_->Release();
+    }
+  }
+
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const {
+    *result = Slice(scratch, 0);
+    if (n == 0) {
+      return Status::OK();
+    }
+    int fd = fd_;
+    if (temporary_fd_) {
+      fd = OpenDirect(filename_.c_str(), O_RDONLY, 0);
+      if (fd < 0) {
+        return PosixError(filename_, errno);
+      }
+    }
+
+    const uint64_t aligned_offset = offset & ~(kDirectIOAlignment - 1);
+    const size_t prefix = static_cast<size_t>(offset - aligned_offset);
+    const size_t aligned_size = RoundUpToAlignment(prefix + n);
+    Status s;
+    void* buf = nullptr;
+    if (posix_memalign(&buf, kDirectIOAlignment, aligned_size) != 0) {
+      s = Status::IOError(filename_, "cannot allocate aligned buffer");
+    } else {
+      // Read until the whole range is in, or the file ends
+      size_t done = 0;
+      while (done < aligned_size) {
+        ssize_t r = pread(fd, reinterpret_cast<char*>(buf) + done,
+                          aligned_size - done,
+                          static_cast<off_t>(aligned_offset + done));
+        if (r < 0) {
+          if (errno == EINTR) {
+            continue;  // Retry
+          }
+          s = PosixError(filename_, errno);
+          break;
+        }
+        if (r == 0) {
+          break;
+        }
+        done += r;
+      }
+      if (s.ok() && done > prefix) {
+        const size_t copy = std::min(n, done - prefix);
+        memcpy(scratch, reinterpret_cast<char*>(buf) + prefix, copy);
+        *result = Slice(scratch, copy);
+      }
+      free(buf);
+    }
+    if (temporary_fd_) {
+      // Close the temporary file descriptor opened earlier.
+      close(fd);
+    }
+    return s;
+  }
+};
+
+// Writable file that bypasses the page cache.  Data is collected in an
+// aligned buffer and written out one full buffer at a time.  Sync() and
+// Close() write the partial buffer padded to the alignment and then cut
+// the file back to its logical size; after Sync() the partial buffer is
+// kept and rewritten in place once more data has been appended to it.
+class PosixDirectWritableFile : public WritableFile {
+ private:
+  std::string filename_;
+  int fd_;
+  char* buf_;             // kDirectBufSize bytes, aligned
+  size_t pos_;            // buf_[0, pos_-1] holds data not yet in the file
+  uint64_t buf_offset_;   // File offset of buf_[0], a multiple of the size
+
+ public:
+  PosixDirectWritableFile(const std::string& fname, int fd, char* buf)
+      : filename_(fname), fd_(fd), buf_(buf), pos_(0), buf_offset_(0) { }
+
+  ~PosixDirectWritableFile() {
+    if (fd_ >= 0) {
+      // Ignoring any potential errors
+      Close();
+    }
+    free(buf_);
+  }
+
+  virtual Status Append(const Slice& data) {
+    const char* p = data.data();
+    size_t n = data.size();
+    while (n > 0) {
+      size_t copy = std::min(n, kDirectBufSize - pos_);
+      memcpy(buf_ + pos_, p, copy);
+      p += copy;
+      n -= copy;
+      pos_ += copy;
+      if (pos_ == kDirectBufSize) {
+        Status s = WriteAligned(kDirectBufSize);
+        if (!s.ok()) {
+          return s;
+        }
+        buf_offset_ += kDirectBufSize;
+        pos_ = 0;
+      }
+    }
+    return Status::OK();
+  }
+
+  virtual Status Close() {
+    Status result = WriteTail();
+    const int r = close(fd_);
+    if (r < 0 && result.ok()) {
+      result = PosixError(filename_, errno);
+    }
+    fd_ = -1;
+    return result;
+  }
+
+  // Writes of less than a full buffer are deferred to Sync() or Close().
+  virtual Status Flush() {
+    return Status::OK();
+  }
+
+  virtual Status Sync() {
+    Status s = WriteTail();
+    if (s.ok()) {
+      if (fdatasync(fd_) != 0) {
+        s = PosixError(filename_, errno);
+      }
+    }
+    return s;
+  }
+
+ private:
+  // Write the partial buffer zero-padded to the alignment and truncate
+  // the padding away again.
+  Status WriteTail() {
+    if (pos_ == 0) {
+      return Status::OK();
+    }
+    const size_t padded = RoundUpToAlignment(pos_);
+    memset(buf_ + pos_, 0, padded - pos_);
+    Status s = WriteAligned(padded);
+    if (s.ok() &&
+        ftruncate(fd_, static_cast<off_t>(buf_offset_ + pos_)) != 0) {
+      s = PosixError(filename_, errno);
+    }
+    return s;
+  }
+
+  // Write buf_[0, n-1] at buf_offset_.
+  Status WriteAligned(size_t n) {
+    size_t done = 0;
+    while (done < n) {
+      ssize_t r = pwrite(fd_, buf_ + done, n - done,
+                         static_cast<off_t>(buf_offset_ + done));
+      if (r < 0) {
+        if (errno == EINTR) {
+          continue;  // Retry
+        }
+        return PosixError(filename_, errno);
+      }
+      done += r;
+    }
+    return Status::OK();
+  }
+};
+
 static int LockOrUnlock(int fd, bool lock) {
   errno = 0;
   struct flock f;
@@ -462,6 +734,42 @@ class PosixEnv : public Env {
     return s;
   }
 
+  virtual Status NewDirectRandomAccessFile(const std::string& fname,
+                                           RandomAccessFile** result) {
+    *result = nullptr;
+    int fd = OpenDirect(fname.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+      if (errno == EINVAL) {
+        // The file system does not support direct I/O
+        return NewRandomAccessFile(fname, result);
+      }
+      return PosixError(fname, errno);
+    }
+    *result = new PosixDirectRandomAccessFile(fname, fd, &fd_limit_);
+    return Status::OK();
+  }
+
+  virtual Status NewDirectWritableFile(const std::string& fname,
+                                       WritableFile** result) {
+    *result = nullptr;
+    int fd = OpenDirect(fname.c_str(), O_TRUNC | O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+      if (errno == EINVAL) {
+        // The file system does not support direct I/O
+        return NewWritableFile(fname, result);
+      }
+      return PosixError(fname, errno);
+    }
+    void* buf = nullptr;
+    if (posix_memalign(&buf, kDirectIOAlignment, kDirectBufSize) != 0) {
+      close(fd);
+      return Status::IOError(fname, "cannot allocate aligned buffer");
+    }
+    *result = new PosixDirectWritableFile(fname, fd,
+                                          reinterpret_cast<char*>(buf));
+    return Status::OK();
+  }
+
   virtual Status NewAppendableFile(const std::string& fname,
                                    WritableFile** result) {
     Status s;
@@ -574,6 +882,10 @@ class PosixEnv : public Env {
 
   virtual void Schedule(void (*function)(void*), void* arg);
 
+  virtual void Schedule(void (*function)(void*), void* arg, Priority pri);
+
+  virtual void SetBackgroundThreads(int number, Priority pri);
+
   virtual void StartThread(void (*function)(void* arg), void* arg);
 
   virtual Status GetTestDirectory(std::string* result) {
@@ -626,22 +938,39 @@ class PosixEnv : public Env {
     }
   }
 
-  // BGThread() is the body of the background thread
-  void BGThread();
+  // Entry per Schedule() call
+  struct BGItem { void* arg; void (*function)(void*); Priority pri; };
+  typedef std::deque<BGItem> BGQueue;
+
+  // The work queued for one Priority and the threads that serve it.
+  struct BGPool {
+    pthread_cond_t signal;
+    int num_threads;
+    BGQueue queue;
+  };
+
+  struct BGThreadArg {
+    PosixEnv* env;
+    BGPool* pool;
+  };
+
+  // BGThread() is the body of every background thread
+  void BGThread(BGPool* pool);
   static void* BGThreadWrapper(void* arg) {
-    reinterpret_cast<PosixEnv*>(arg)->BGThread();
+    BGThreadArg* a = reinterpret_cast<BGThreadArg*>(arg);
+    PosixEnv* env = a->env;
+    BGPool* pool = a->pool;
+    delete a;
+    env->BGThread(pool);
     return nullptr;
   }
 
-  pthread_mutex_t mu_;
-  pthread_cond_t bgsignal_;
-  pthread_t bgthread_;
-  bool started_bgthread_;
+  // Start one more thread serving *pool.
+  // REQUIRES: mu_ is held.
+  void StartBGThread(BGPool* pool);
 
-  // Entry per Schedule() call
-  struct BGItem { void* arg; void (*function)(void*); };
-  typedef std::deque<BGItem> BGQueue;
-  BGQueue queue_;
+  pthread_mutex_t mu_;
+  BGPool pools_[2];  // Indexed by Priority
 
   PosixLockTable locks_;
   Limiter mmap_limit_;
@@ -677,50 +1006,86 @@ static intptr_t MaxOpenFiles() {
 }
 
 PosixEnv::PosixEnv()
-    : started_bgthread_(false),
-      mmap_limit_(MaxMmaps()),
+    : mmap_limit_(MaxMmaps()),
       fd_limit_(MaxOpenFiles()) {
   PthreadCall("mutex_init", pthread_mutex_init(&mu_, nullptr));
-  PthreadCall("cvar_init", pthread_cond_init(&bgsignal_, nullptr));
+  for (int i = 0; i < 2; i++) {
+    PthreadCall("cvar_init", pthread_cond_init(&pools_[i].signal, nullptr));
+    pools_[i].num_threads = 0;
+  }
 }
 
 void PosixEnv::Schedule(void (*function)(void*), void* arg) {
+  Schedule(function, arg, LOW);
+}
+
+void PosixEnv::Schedule(void (*function)(void*), void* arg, Priority pri) {
   PthreadCall("lock", pthread_mutex_lock(&mu_));
 
+  // Without dedicated HIGH threads, HIGH items jump ahead of the LOW items
+  // that are still waiting in the LOW pool.
+  BGPool* pool = &pools_[pri];
+  if (pool->num_threads == 0 && pri == HIGH) {
+    pool = &pools_[LOW];
+  }
+
   //启动一个线程，入口函数为BGThreadWrapper
   // Start background thread if necessary
-  if (!started_bgthread_) {
-    started_bgthread_ = true;
-    PthreadCall(
-        "create thread",
-        pthread_create(&bgthread_, nullptr,  &PosixEnv::BGThreadWrapper, this));
+  if (pool->num_threads == 0) {
+    StartBGThread(pool);
   }
 
-  // If the queue is currently empty, the background thread may currently be
-  // waiting.
-  if (queue_.empty()) {
-    PthreadCall("signal", pthread_cond_signal(&bgsignal_));
+  BGQueue::iterator pos = pool->queue.end();
+  if (pri == HIGH) {
+    pos = pool->queue.begin();
+    while (pos != pool->queue.end() && pos->pri == HIGH) {
+      ++pos;
+    }
   }
+  BGItem item;
+  item.function = function;
+  item.arg = arg;
+  item.pri = pri;
+  pool->queue.insert(pos, item);
 
-  // Add to priority queue
-  queue_.push_back(BGItem());
-  queue_.back().function = function;
-  queue_.back().arg = arg;
+  // Some thread of the pool may currently be waiting.
+  PthreadCall("signal", pthread_cond_signal(&pool->signal));
 
   PthreadCall("unlock", pthread_mutex_unlock(&mu_));
 }
 
-void PosixEnv::BGThread() {
+void PosixEnv::SetBackgroundThreads(int number, Priority pri) {
+  PthreadCall("lock", pthread_mutex_lock(&mu_));
+  BGPool* pool = &pools_[pri];
+  while (pool->num_threads < number) {
+    StartBGThread(pool);
+  }
+  PthreadCall("unlock", pthread_mutex_unlock(&mu_));
+}
+
+void PosixEnv::StartBGThread(BGPool* pool) {
+  BGThreadArg* arg = new BGThreadArg;
+  arg->env = this;
+  arg->pool = pool;
+  pthread_t t;
+  PthreadCall(
+      "create thread",
+      pthread_create(&t, nullptr,  &PosixEnv::BGThreadWrapper, arg));
+  PthreadCall("detach thread", pthread_detach(t));
+  pool->num_threads++;
+}
+
+void PosixEnv::BGThread(BGPool* pool) {
   while (true) {
     // Wait until there is an item that is ready to run
     PthreadCall("lock", pthread_mutex_lock(&mu_));
-    while (queue_.empty()) {
-      PthreadCall("wait", pthread_cond_wait(&bgsignal_, &mu_));
+    while (pool->queue.empty()) {
+      PthreadCall("wait", pthread_cond_wait(&pool->signal, &mu_));
     }
 
-    void (*function)(void*) = queue_.front().function;
-    void* arg = queue_.front().arg;
-    queue_.pop_front();
+    void (*function)(void*) = pool->queue.front().function;
+    void* arg = pool->queue.front().arg;
+    pool->queue.pop_front();
 
     PthreadCall("unlock", pthread_mutex_unlock(&mu_));
     (*function)(arg);
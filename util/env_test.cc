@@ -76,6 +76,58 @@ TEST(EnvTest, ReadWrite) {
   delete sequential_file;
 }
 
+TEST(EnvTest, DirectReadWrite) {
+  Random rnd(test::RandomSeed());
+
+  std::string test_dir;
+  ASSERT_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file_name = test_dir + "/direct_read_write.txt";
+  WritableFile* writable_file;
+  ASSERT_OK(env_->NewDirectWritableFile(test_file_name, &writable_file));
+
+  // Unaligned appends, with syncs that leave a partial buffer behind.
+  static const size_t kDataSize = 3 * 1048576 + 1234;
+  std::string data;
+  while (data.size() < kDataSize) {
+    int len = rnd.Skewed(18);
+    std::string r;
+    test::RandomString(&rnd, len, &r);
+    ASSERT_OK(writable_file->Append(r));
+    data += r;
+    if (rnd.OneIn(10)) {
+      ASSERT_OK(writable_file->Sync());
+      uint64_t size;
+      ASSERT_OK(env_->GetFileSize(test_file_name, &size));
+      ASSERT_EQ(data.size(), size);
+    }
+  }
+  ASSERT_OK(writable_file->Close());
+  delete writable_file;
+
+  std::string contents;
+  ASSERT_OK(ReadFileToString(env_, test_file_name, &contents));
+  ASSERT_TRUE(contents == data);
+
+  RandomAccessFile* file;
+  ASSERT_OK(env_->NewDirectRandomAccessFile(test_file_name, &file));
+  std::string scratch;
+  for (int i = 0; i < 1000; i++) {
+    uint64_t offset = rnd.Uniform(data.size() + 100);
+    size_t len = rnd.Skewed(16);
+    scratch.resize(std::max<size_t>(len, 1));
+    Slice read;
+    ASSERT_OK(file->Read(offset, len, &read, &scratch[0]));
+    std::string expected;
+    if (offset < data.size()) {
+      expected = data.substr(offset, len);
+    }
+    ASSERT_EQ(expected.size(), read.size());
+    ASSERT_TRUE(read == Slice(expected));
+  }
+  delete file;
+  env_->DeleteFile(test_file_name);
+}
+
 TEST(EnvTest, RunImmediately) {
   port::AtomicPointer called(nullptr);
   env_->Schedule(&SetBool, &called);
@@ -150,6 +202,104 @@ TEST(EnvTest, StartThread) {
   ASSERT_EQ(state.val, 3);
 }
 
+namespace {
+struct ScheduleState {
+  port::Mutex mu;
+  port::CondVar cv;
+  bool released GUARDED_BY(mu);
+  int num_started GUARDED_BY(mu);
+  int num_done GUARDED_BY(mu);
+  std::string order GUARDED_BY(mu);
+
+  ScheduleState()
+      : cv(&mu), released(false), num_started(0), num_done(0) { }
+};
+
+struct ScheduleItem {
+  ScheduleState* state;
+  char id;
+};
+}  // namespace
+
+// Waits until the test releases it
+static void BlockBody(void* arg) {
+  ScheduleState* s = reinterpret_cast<ScheduleState*>(arg);
+  MutexLock l(&s->mu);
+  while (!s->released) {
+    s->cv.Wait();
+  }
+}
+
+static void RecordBody(void* arg) {
+  ScheduleItem* item = reinterpret_cast<ScheduleItem*>(arg);
+  MutexLock l(&item->state->mu);
+  item->state->order.push_back(item->id);
+  item->state->num_done++;
+}
+
+// Waits until three items have started
+static void BarrierBody(void* arg) {
+  ScheduleState* s = reinterpret_cast<ScheduleState*>(arg);
+  MutexLock l(&s->mu);
+  s->num_started++;
+  s->cv.SignalAll();
+  while (s->num_started < 3) {
+    s->cv.Wait();
+  }
+  s->num_done++;
+}
+
+TEST(EnvTest, ScheduleHighPriorityFirst) {
+  // There are no HIGH threads yet, so HIGH items must jump ahead of the
+  // LOW items that are queued behind the blocked one.
+  ScheduleState state;
+  ScheduleItem l1 = { &state, 'a' };
+  ScheduleItem l2 = { &state, 'b' };
+  ScheduleItem h1 = { &state, 'X' };
+  ScheduleItem h2 = { &state, 'Y' };
+  env_->Schedule(&BlockBody, &state, Env::LOW);
+  env_->Schedule(&RecordBody, &l1, Env::LOW);
+  env_->Schedule(&RecordBody, &h1, Env::HIGH);
+  env_->Schedule(&RecordBody, &l2, Env::LOW);
+  env_->Schedule(&RecordBody, &h2, Env::HIGH);
+  {
+    MutexLock l(&state.mu);
+    state.released = true;
+    state.cv.SignalAll();
+  }
+  while (true) {
+    state.mu.Lock();
+    int num = state.num_done;
+    state.mu.Unlock();
+    if (num == 4) {
+      break;
+    }
+    env_->SleepForMicroseconds(kDelayMicros);
+  }
+
+  MutexLock l(&state.mu);
+  ASSERT_EQ("XYab", state.order);
+}
+
+TEST(EnvTest, SetBackgroundThreads) {
+  // The items wait for each other, so they only finish if the pool runs
+  // them in parallel.
+  env_->SetBackgroundThreads(3, Env::HIGH);
+  ScheduleState state;
+  for (int i = 0; i < 3; i++) {
+    env_->Schedule(&BarrierBody, &state, Env::HIGH);
+  }
+  while (true) {
+    state.mu.Lock();
+    int num = state.num_done;
+    state.mu.Unlock();
+    if (num == 3) {
+      break;
+    }
+    env_->SleepForMicroseconds(kDelayMicros);
+  }
+}
+
 TEST(EnvTest, TestOpenNonExistentFile) {
   // Write some test data to a single file that will be opened |n| times.
   std::string test_dir;
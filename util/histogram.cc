@@ -4,6 +4,7 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <algorithm>
 #include "port/port.h"
 #include "util/histogram.h"
 
@@ -42,11 +43,11 @@ void Histogram::Clear() {
 }
 
 void Histogram::Add(double value) {
-  // Linear search is fast enough for our usage in db_bench
-  int b = 0;
-  while (b < kNumBuckets - 1 && kBucketLimit[b] <= value) {
-    b++;
-  }
+  // The first bucket whose limit is above value; the last bucket is
+  // unbounded.  Statistics add to histograms on hot paths, so search.
+  int b = static_cast<int>(
+      std::upper_bound(kBucketLimit, kBucketLimit + kNumBuckets - 1, value) -
+      kBucketLimit);
   buckets_[b] += 1.0;
   if (min_ > value) min_ = value;
   if (max_ < value) max_ = value;
@@ -16,15 +16,39 @@ Options::Options()
       paranoid_checks(false),
       env(Env::Default()),
       info_log(nullptr),
+      statistics(nullptr),
       write_buffer_size(4<<20),//4M
+      level0_file_num_compaction_trigger(4),
+      level0_slowdown_writes_trigger(8),
+      level0_stop_writes_trigger(12),
+      soft_pending_compaction_bytes_limit(64ull << 30),
+      hard_pending_compaction_bytes_limit(256ull << 30),
+      delayed_write_rate(16 << 20),
       max_open_files(1000),
+      use_direct_reads(false),
+      use_direct_io_for_flush_and_compaction(false),
+      compaction_readahead_size(0),
+      rate_limiter(nullptr),
+      max_background_compactions(1),
+      max_background_flushes(0),
+      max_subcompactions(1),
+      allow_concurrent_memtable_write(false),
+      enable_pipelined_write(false),
       block_cache(nullptr),
+      cache_index_and_filter_blocks(false),
+      pin_l0_filter_and_index_blocks(false),
       block_size(4096),
       block_restart_interval(16),
       max_file_size(2<<20),
       compression(kSnappyCompression),
+      zstd_max_dict_bytes(0),
+      zstd_max_train_bytes(256 << 10),
+      compression_threads(1),
       reuse_logs(false),
-      filter_policy(nullptr) {
+      filter_policy(nullptr),
+      filter_format(kBlockBasedFilter),
+      filter_partition_keys(4096),
+      prefix_extractor(nullptr) {
 }
 
 }  // namespace leveldb
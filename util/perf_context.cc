@@ -0,0 +1,74 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/perf_context.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace leveldb {
+
+// Neither has a constructor, so that both are zero-initialized without
+// a guard on every access.
+thread_local PerfLevel perf_level = kDisablePerf;
+thread_local PerfContext perf_context;
+
+void SetPerfLevel(PerfLevel level) {
+  perf_level = level;
+}
+
+PerfLevel GetPerfLevel() {
+  return perf_level;
+}
+
+PerfContext* GetPerfContext() {
+  return &perf_context;
+}
+
+void PerfContext::Reset() {
+  memset(this, 0, sizeof(*this));
+}
+
+std::string PerfContext::ToString(bool exclude_zero_counters) const {
+  struct Field {
+    const char* name;
+    uint64_t value;
+  };
+  const Field fields[] = {
+    { "db_mutex_lock_nanos", db_mutex_lock_nanos },
+    { "get_from_memtable_nanos", get_from_memtable_nanos },
+    { "get_from_memtable_count", get_from_memtable_count },
+    { "get_from_output_files_nanos", get_from_output_files_nanos },
+    { "file_probe_count", file_probe_count },
+    { "find_table_nanos", find_table_nanos },
+    { "index_seek_nanos", index_seek_nanos },
+    { "filter_check_nanos", filter_check_nanos },
+    { "bloom_sst_hit_count", bloom_sst_hit_count },
+    { "bloom_sst_miss_count", bloom_sst_miss_count },
+    { "block_cache_hit_count", block_cache_hit_count },
+    { "block_read_count", block_read_count },
+    { "block_read_byte", block_read_byte },
+    { "block_read_nanos", block_read_nanos },
+    { "block_decompress_nanos", block_decompress_nanos },
+    { "seek_internal_seek_nanos", seek_internal_seek_nanos },
+    { "internal_key_skipped_count", internal_key_skipped_count },
+    { "internal_delete_skipped_count", internal_delete_skipped_count },
+  };
+  std::string result;
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+    if (exclude_zero_counters && fields[i].value == 0) {
+      continue;
+    }
+    char buf[100];
+    snprintf(buf, sizeof(buf), "%s = %llu, ", fields[i].name,
+             static_cast<unsigned long long>(fields[i].value));
+    result.append(buf);
+  }
+  if (!result.empty()) {
+    result.resize(result.size() - 2);  // Drop the last ", "
+  }
+  return result;
+}
+
+}  // namespace leveldb
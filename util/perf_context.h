@@ -0,0 +1,66 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_PERF_CONTEXT_H_
+#define STORAGE_LEVELDB_UTIL_PERF_CONTEXT_H_
+
+#include <stdint.h>
+#include <chrono>
+#include "leveldb/perf_context.h"
+
+namespace leveldb {
+
+// The perf level and PerfContext of the current thread.  While the level
+// is kDisablePerf, the helpers below cost a load and a branch.
+extern thread_local PerfLevel perf_level;
+extern thread_local PerfContext perf_context;
+
+// Add "n" to a counter of the current thread's PerfContext.
+inline void PerfCount(uint64_t PerfContext::*counter, uint64_t n = 1) {
+  if (perf_level >= kEnableCount) {
+    perf_context.*counter += n;
+  }
+}
+
+// Adds the nanoseconds between each Start() and the next Stop() (or the
+// destructor) to a timer of the current thread's PerfContext.  The clock
+// is only read at perf level kEnableTime.
+class PerfTimer {
+ public:
+  explicit PerfTimer(uint64_t PerfContext::*timer)
+      : timer_(timer), start_(0) {
+  }
+
+  ~PerfTimer() { Stop(); }
+
+  void Start() {
+    if (perf_level >= kEnableTime) {
+      start_ = NowNanos();
+    }
+  }
+
+  void Stop() {
+    if (start_ != 0) {
+      perf_context.*timer_ += NowNanos() - start_;
+      start_ = 0;
+    }
+  }
+
+ private:
+  static uint64_t NowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  uint64_t PerfContext::* const timer_;
+  uint64_t start_;
+
+  // No copying allowed
+  PerfTimer(const PerfTimer&);
+  void operator=(const PerfTimer&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_PERF_CONTEXT_H_
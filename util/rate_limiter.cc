@@ -0,0 +1,238 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/rate_limiter.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <deque>
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+RateLimiter::~RateLimiter() { }
+
+namespace {
+
+// In the auto-tuned mode the rate is reconsidered after this many refill
+// periods.
+static const int kTunePeriods = 100;
+
+class GenericRateLimiter : public RateLimiter {
+ public:
+  GenericRateLimiter(int64_t bytes_per_second, int64_t refill_period_us,
+                     bool auto_tuned)
+      : env_(Env::Default()),
+        refill_period_us_(refill_period_us),
+        auto_tuned_(auto_tuned),
+        cv_(&mu_),
+        max_bytes_per_second_(bytes_per_second),
+        bytes_per_second_(0),
+        refill_bytes_(0),
+        available_(0),
+        next_refill_us_(env_->NowMicros()),
+        leader_waiting_(false),
+        tune_start_us_(next_refill_us_),
+        drained_periods_(0) {
+    assert(bytes_per_second > 0);
+    assert(refill_period_us > 0);
+    total_bytes_[kLow] = 0;
+    total_bytes_[kHigh] = 0;
+    SetRate(bytes_per_second);
+  }
+
+  virtual void Request(size_t bytes, IOPriority pri) {
+    assert(pri == kLow || pri == kHigh);
+    MutexLock l(&mu_);
+    total_bytes_[pri] += bytes;
+    while (bytes > 0) {
+      // Pieces of at most one refill keep a large request from holding
+      // up others for longer than it has to.
+      size_t piece = std::min<size_t>(bytes, refill_bytes_);
+      RequestPiece(piece, pri);
+      bytes -= piece;
+    }
+  }
+
+  virtual void SetBytesPerSecond(int64_t bytes_per_second) {
+    assert(bytes_per_second > 0);
+    MutexLock l(&mu_);
+    max_bytes_per_second_ = bytes_per_second;
+    if (!auto_tuned_ || bytes_per_second_ > bytes_per_second) {
+      SetRate(bytes_per_second);
+    }
+  }
+
+  virtual int64_t GetBytesPerSecond() const {
+    MutexLock l(&mu_);
+    return bytes_per_second_;
+  }
+
+  virtual int64_t GetTotalBytesThrough(IOPriority pri) const {
+    assert(pri == kLow || pri == kHigh);
+    MutexLock l(&mu_);
+    return total_bytes_[pri];
+  }
+
+ private:
+  struct Waiter {
+    int64_t bytes;
+    bool granted;
+  };
+
+  void SetRate(int64_t bytes_per_second) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    bytes_per_second_ = bytes_per_second;
+    refill_bytes_ = std::max<int64_t>(
+        1, bytes_per_second * refill_period_us_ / 1000000);
+  }
+
+  void RequestPiece(int64_t bytes, IOPriority pri)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (queue_[kHigh].empty() && queue_[kLow].empty() &&
+        available_ >= bytes) {
+      available_ -= bytes;
+      return;
+    }
+
+    Waiter r;
+    r.bytes = bytes;
+    r.granted = false;
+    queue_[pri].push_back(&r);
+    while (!r.granted) {
+      if (leader_waiting_) {
+        // Another request is waiting for the next refill
+        cv_.Wait();
+        continue;
+      }
+      // Wait for the next refill and grant the queued requests it covers
+      leader_waiting_ = true;
+      uint64_t now = env_->NowMicros();
+      if (now < next_refill_us_) {
+        mu_.Unlock();
+        env_->SleepForMicroseconds(static_cast<int>(next_refill_us_ - now));
+        mu_.Lock();
+      }
+      Refill();
+      leader_waiting_ = false;
+      cv_.SignalAll();
+    }
+  }
+
+  // Add one period's worth of bytes to the bucket and grant the queued
+  // requests in priority order.
+  void Refill() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const uint64_t now = env_->NowMicros();
+    next_refill_us_ = now + refill_period_us_;
+    available_ = std::min(available_ + refill_bytes_, refill_bytes_);
+
+    bool blocked = false;
+    for (int pri = kHigh; pri >= kLow && !blocked; pri--) {
+      std::deque<Waiter*>* queue = &queue_[pri];
+      while (!queue->empty()) {
+        Waiter* r = queue->front();
+        // A full bucket grants any request, in case the rate was lowered
+        // below one of the queued pieces; the debt is paid by the next
+        // refills.
+        if (available_ < r->bytes && available_ < refill_bytes_) {
+          blocked = true;
+          break;
+        }
+        available_ -= r->bytes;
+        r->granted = true;
+        queue->pop_front();
+      }
+    }
+
+    if (auto_tuned_) {
+      Tune(now);
+    }
+  }
+
+  // Only requests that found the bucket drained wait for a refill, so
+  // the refills count the periods in which the demand met the rate.
+  // Raise the rate if that was nearly every period of the last
+  // kTunePeriods, and lower it if it was less than half of them.
+  void Tune(uint64_t now) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    drained_periods_++;
+    const int64_t periods = (now - tune_start_us_) / refill_period_us_;
+    if (periods < kTunePeriods) {
+      return;
+    }
+    const int64_t percent = drained_periods_ * 100 / periods;
+    int64_t rate = bytes_per_second_;
+    if (percent >= 90) {
+      rate = std::min(max_bytes_per_second_,
+                      rate + std::max<int64_t>(1, rate / 20));
+    } else if (percent < 50) {
+      rate = std::max(max_bytes_per_second_ / 20, rate - rate / 20);
+    }
+    rate = std::max<int64_t>(1, rate);
+    if (rate != bytes_per_second_) {
+      SetRate(rate);
+    }
+    tune_start_us_ = now;
+    drained_periods_ = 0;
+  }
+
+  Env* const env_;
+  const int64_t refill_period_us_;
+  const bool auto_tuned_;
+
+  mutable port::Mutex mu_;
+  port::CondVar cv_ GUARDED_BY(mu_);
+  int64_t max_bytes_per_second_ GUARDED_BY(mu_);
+  int64_t bytes_per_second_ GUARDED_BY(mu_);
+  int64_t refill_bytes_ GUARDED_BY(mu_);
+  int64_t available_ GUARDED_BY(mu_);    // Negative while in debt
+  uint64_t next_refill_us_ GUARDED_BY(mu_);
+  bool leader_waiting_ GUARDED_BY(mu_);  // A request sleeps until refill
+  std::deque<Waiter*> queue_[kNumPriorities] GUARDED_BY(mu_);
+  int64_t total_bytes_[kNumPriorities] GUARDED_BY(mu_);
+  uint64_t tune_start_us_ GUARDED_BY(mu_);
+  int64_t drained_periods_ GUARDED_BY(mu_);
+};
+
+class RateLimitedWritableFile : public WritableFile {
+ public:
+  RateLimitedWritableFile(WritableFile* file, RateLimiter* limiter,
+                          RateLimiter::IOPriority pri)
+      : file_(file), limiter_(limiter), pri_(pri) {
+  }
+
+  virtual ~RateLimitedWritableFile() { delete file_; }
+
+  virtual Status Append(const Slice& data) {
+    limiter_->Request(data.size(), pri_);
+    return file_->Append(data);
+  }
+
+  virtual Status Close() { return file_->Close(); }
+  virtual Status Flush() { return file_->Flush(); }
+  virtual Status Sync() { return file_->Sync(); }
+
+ private:
+  WritableFile* const file_;
+  RateLimiter* const limiter_;
+  const RateLimiter::IOPriority pri_;
+};
+
+}  // namespace
+
+RateLimiter* NewGenericRateLimiter(int64_t bytes_per_second,
+                                   int64_t refill_period_us,
+                                   bool auto_tuned) {
+  return new GenericRateLimiter(bytes_per_second, refill_period_us,
+                                auto_tuned);
+}
+
+WritableFile* NewRateLimitedWritableFile(WritableFile* file,
+                                         RateLimiter* limiter,
+                                         RateLimiter::IOPriority pri) {
+  return new RateLimitedWritableFile(file, limiter, pri);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,25 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_RATE_LIMITER_H_
+#define STORAGE_LEVELDB_UTIL_RATE_LIMITER_H_
+
+#include "leveldb/rate_limiter.h"
+
+namespace leveldb {
+
+class WritableFile;
+
+// Return a file that asks "limiter" for the bytes of every Append() at
+// priority "pri" before passing it on to "file".  Flush(), Sync() and
+// Close() write no bytes of their own and are passed on directly.
+//
+// The result owns "file" and deletes it when it is deleted.
+WritableFile* NewRateLimitedWritableFile(WritableFile* file,
+                                         RateLimiter* limiter,
+                                         RateLimiter::IOPriority pri);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_RATE_LIMITER_H_
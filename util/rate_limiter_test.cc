@@ -0,0 +1,129 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/rate_limiter.h"
+
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/mutexlock.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class RateLimiterTest { };
+
+TEST(RateLimiterTest, Rate) {
+  // 10KB per refill of 10ms
+  RateLimiter* limiter = NewGenericRateLimiter(1 << 20, 10 * 1000);
+  Env* env = Env::Default();
+  const uint64_t start = env->NowMicros();
+  for (int i = 0; i < 75; i++) {
+    limiter->Request(4096, RateLimiter::kLow);
+  }
+  const uint64_t elapsed = env->NowMicros() - start;
+  ASSERT_EQ(75 * 4096, limiter->GetTotalBytesThrough(RateLimiter::kLow));
+  ASSERT_EQ(0, limiter->GetTotalBytesThrough(RateLimiter::kHigh));
+  // 300KB at 1MB/s
+  ASSERT_GE(elapsed, 200u * 1000);
+  ASSERT_LE(elapsed, 2u * 1000 * 1000);
+  delete limiter;
+}
+
+TEST(RateLimiterTest, LargeRequest) {
+  // A request of five refills is granted over five periods
+  const int kRefillBytes = (1 << 20) / 100;
+  RateLimiter* limiter = NewGenericRateLimiter(1 << 20, 10 * 1000);
+  Env* env = Env::Default();
+  uint64_t start = env->NowMicros();
+  limiter->Request(5 * kRefillBytes, RateLimiter::kHigh);
+  ASSERT_GE(env->NowMicros() - start, 30u * 1000);
+
+  limiter->SetBytesPerSecond(2 << 20);
+  ASSERT_EQ(2 << 20, limiter->GetBytesPerSecond());
+  start = env->NowMicros();
+  limiter->Request(10 * kRefillBytes, RateLimiter::kHigh);
+  ASSERT_GE(env->NowMicros() - start, 30u * 1000);
+  ASSERT_EQ(15 * kRefillBytes,
+            limiter->GetTotalBytesThrough(RateLimiter::kHigh));
+  delete limiter;
+}
+
+namespace {
+
+struct PriorityState {
+  RateLimiter* limiter;
+  port::Mutex mu;
+  port::CondVar cv;
+  int num_running GUARDED_BY(mu);
+  std::string order GUARDED_BY(mu);
+
+  explicit PriorityState(RateLimiter* l)
+      : limiter(l), cv(&mu), num_running(0) { }
+};
+
+template <RateLimiter::IOPriority pri>
+void PriorityBody(void* arg) {
+  PriorityState* state = reinterpret_cast<PriorityState*>(arg);
+  for (int i = 0; i < 20; i++) {
+    state->limiter->Request(1024, pri);
+  }
+  MutexLock l(&state->mu);
+  state->order.push_back(pri == RateLimiter::kHigh ? 'H' : 'L');
+  state->num_running--;
+  state->cv.SignalAll();
+}
+
+}  // namespace
+
+TEST(RateLimiterTest, Priority) {
+  // 1KB per refill of 10ms.  Both threads keep requests queued, and the
+  // high-priority one is served first even though it starts last.
+  RateLimiter* limiter = NewGenericRateLimiter(100 << 10, 10 * 1000);
+  Env* env = Env::Default();
+  PriorityState state(limiter);
+  state.num_running = 2;
+  env->StartThread(&PriorityBody<RateLimiter::kLow>, &state);
+  env->SleepForMicroseconds(20 * 1000);
+  env->StartThread(&PriorityBody<RateLimiter::kHigh>, &state);
+  {
+    MutexLock l(&state.mu);
+    while (state.num_running > 0) {
+      state.cv.Wait();
+    }
+    ASSERT_EQ("HL", state.order);
+  }
+  delete limiter;
+}
+
+TEST(RateLimiterTest, AutoTune) {
+  // 50KB per refill of 5ms, reconsidered every 500ms
+  const int64_t kMaxRate = 10 << 20;
+  const int kRefillBytes = 50 << 10;
+  RateLimiter* limiter = NewGenericRateLimiter(kMaxRate, 5 * 1000, true);
+  Env* env = Env::Default();
+  ASSERT_EQ(kMaxRate, limiter->GetBytesPerSecond());
+
+  // An idle limiter lowers its rate
+  env->SleepForMicroseconds(550 * 1000);
+  limiter->Request(kRefillBytes, RateLimiter::kLow);
+  const int64_t lowered = limiter->GetBytesPerSecond();
+  ASSERT_LT(lowered, kMaxRate);
+  ASSERT_GE(lowered, kMaxRate / 20);
+
+  // A limiter that is drained in every period raises it again
+  const uint64_t start = env->NowMicros();
+  while (env->NowMicros() - start < 700u * 1000) {
+    limiter->Request(kRefillBytes, RateLimiter::kLow);
+  }
+  ASSERT_GT(limiter->GetBytesPerSecond(), lowered);
+  ASSERT_LE(limiter->GetBytesPerSecond(), kMaxRate);
+  delete limiter;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/readahead_file.h"
+
+#include <string.h>
+#include <algorithm>
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+namespace {
+
+class ReadaheadRandomAccessFile : public RandomAccessFile {
+ public:
+  ReadaheadRandomAccessFile(RandomAccessFile* file, size_t readahead_size)
+      : file_(file),
+        readahead_size_(readahead_size),
+        buffer_(new char[readahead_size]),
+        buffer_offset_(0),
+        buffer_len_(0),
+        zero_copy_(false) {
+  }
+
+  virtual ~ReadaheadRandomAccessFile() {
+    delete[] buffer_;
+    delete file_;
+  }
+
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const {
+    if (n >= readahead_size_) {
+      return file_->Read(offset, n, result, scratch);
+    }
+
+    MutexLock l(&mu_);
+    if (zero_copy_) {
+      return file_->Read(offset, n, result, scratch);
+    }
+    if (offset < buffer_offset_ || offset + n > buffer_offset_ + buffer_len_) {
+      Slice data;
+      Status s = file_->Read(offset, readahead_size_, &data, buffer_);
+      if (!s.ok()) {
+        buffer_len_ = 0;
+        *result = Slice();
+        return s;
+      }
+      if (data.data() != buffer_ && !data.empty()) {
+        // The file needs no buffer of ours
+        buffer_len_ = 0;
+        zero_copy_ = true;
+        return file_->Read(offset, n, result, scratch);
+      }
+      buffer_offset_ = offset;
+      buffer_len_ = data.size();
+    }
+
+    size_t available = 0;
+    if (offset < buffer_offset_ + buffer_len_) {
+      available = std::min<size_t>(n, buffer_offset_ + buffer_len_ - offset);
+      memcpy(scratch, buffer_ + (offset - buffer_offset_), available);
+    }
+    *result = Slice(scratch, available);
+    return Status::OK();
+  }
+
+  virtual void Hint(AccessPattern pattern) {
+    file_->Hint(pattern);
+  }
+
+  virtual void Prefetch(uint64_t offset, size_t n) {
+    file_->Prefetch(offset, n);
+  }
+
+ private:
+  RandomAccessFile* const file_;
+  const size_t readahead_size_;
+
+  mutable port::Mutex mu_;
+  char* const buffer_ PT_GUARDED_BY(mu_);
+  // buffer_[0, buffer_len_-1] holds the file at buffer_offset_
+  mutable uint64_t buffer_offset_ GUARDED_BY(mu_);
+  mutable size_t buffer_len_ GUARDED_BY(mu_);
+  mutable bool zero_copy_ GUARDED_BY(mu_);
+};
+
+}  // namespace
+
+RandomAccessFile* NewReadaheadRandomAccessFile(RandomAccessFile* file,
+                                               size_t readahead_size) {
+  return new ReadaheadRandomAccessFile(file, readahead_size);
+}
+
+}  // namespace leveldb
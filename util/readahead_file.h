@@ -0,0 +1,27 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_READAHEAD_FILE_H_
+#define STORAGE_LEVELDB_UTIL_READAHEAD_FILE_H_
+
+#include <stddef.h>
+
+namespace leveldb {
+
+class RandomAccessFile;
+
+// Return a file that serves reads of less than "readahead_size" bytes
+// from a buffer, which it refills with a single read of
+// "readahead_size" bytes of "file" starting at the first offset it
+// misses.  Meant for files that are read from start to end, such as the
+// inputs of a compaction.  Files that return data without copying it
+// into the caller's scratch space (like mmap-ed files) are read directly.
+//
+// The result owns "file" and deletes it when it is deleted.
+RandomAccessFile* NewReadaheadRandomAccessFile(RandomAccessFile* file,
+                                               size_t readahead_size);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_READAHEAD_FILE_H_
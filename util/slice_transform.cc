@@ -0,0 +1,51 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/slice_transform.h"
+
+#include <assert.h>
+#include <string>
+#include "util/logging.h"
+
+namespace leveldb {
+
+SliceTransform::~SliceTransform() { }
+
+bool SliceTransform::SamePrefix(const Slice& a, const Slice& b) const {
+  return a == b;
+}
+
+namespace {
+class FixedPrefixTransform : public SliceTransform {
+ public:
+  explicit FixedPrefixTransform(size_t prefix_len)
+      : prefix_len_(prefix_len),
+        name_("leveldb.FixedPrefix.") {
+    AppendNumberTo(&name_, prefix_len);
+  }
+
+  virtual const char* Name() const {
+    return name_.c_str();
+  }
+
+  virtual bool InDomain(const Slice& key) const {
+    return key.size() >= prefix_len_;
+  }
+
+  virtual Slice Transform(const Slice& key) const {
+    assert(InDomain(key));
+    return Slice(key.data(), prefix_len_);
+  }
+
+ private:
+  const size_t prefix_len_;
+  std::string name_;
+};
+}  // namespace
+
+const SliceTransform* NewFixedPrefixTransform(size_t prefix_len) {
+  return new FixedPrefixTransform(prefix_len);
+}
+
+}  // namespace leveldb
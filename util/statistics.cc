@@ -0,0 +1,209 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/statistics.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/histogram.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+static const char* const kTickerNames[] = {
+  "leveldb.block.cache.miss",
+  "leveldb.block.cache.hit",
+  "leveldb.block.cache.add",
+  "leveldb.block.cache.index.miss",
+  "leveldb.block.cache.index.hit",
+  "leveldb.block.cache.filter.miss",
+  "leveldb.block.cache.filter.hit",
+  "leveldb.block.cache.data.miss",
+  "leveldb.block.cache.data.hit",
+  "leveldb.bloom.filter.useful",
+  "leveldb.bloom.filter.positive",
+  "leveldb.bloom.filter.true.positive",
+  "leveldb.memtable.hit",
+  "leveldb.memtable.miss",
+  "leveldb.number.keys.written",
+  "leveldb.number.keys.read",
+  "leveldb.bytes.written",
+  "leveldb.bytes.read",
+  "leveldb.number.db.seek",
+  "leveldb.number.db.next",
+  "leveldb.number.db.prev",
+  "leveldb.wal.bytes",
+  "leveldb.wal.synced",
+  "leveldb.stall.micros",
+  "leveldb.compact.read.bytes",
+  "leveldb.compact.write.bytes",
+  "leveldb.flush.write.bytes",
+};
+static_assert(sizeof(kTickerNames) / sizeof(kTickerNames[0]) == kNumTickers,
+              "every ticker needs a name");
+
+static const char* const kHistogramNames[] = {
+  "leveldb.db.get.micros",
+  "leveldb.db.multiget.micros",
+  "leveldb.db.write.micros",
+  "leveldb.db.seek.micros",
+  "leveldb.wal.file.sync.micros",
+  "leveldb.compaction.micros",
+  "leveldb.flush.micros",
+};
+static_assert(sizeof(kHistogramNames) / sizeof(kHistogramNames[0]) ==
+                  kNumHistograms,
+              "every histogram needs a name");
+
+const char* TickerName(Ticker ticker) {
+  assert(ticker >= 0 && ticker < kNumTickers);
+  return kTickerNames[ticker];
+}
+
+const char* HistogramName(HistogramType histogram) {
+  assert(histogram >= 0 && histogram < kNumHistograms);
+  return kHistogramNames[histogram];
+}
+
+Statistics::~Statistics() { }
+
+namespace {
+
+class StatisticsImpl : public Statistics {
+ public:
+  StatisticsImpl()
+      : num_shards_(std::max(1u, std::min(64u,
+                                          std::thread::hardware_concurrency()))),
+        shards_(new Shard[num_shards_]) {
+    Reset();
+  }
+
+  virtual ~StatisticsImpl() {
+    delete[] shards_;
+  }
+
+  virtual void RecordTick(Ticker ticker, uint64_t count) {
+    assert(ticker >= 0 && ticker < kNumTickers);
+    CurrentShard()->tickers[ticker].fetch_add(count,
+                                              std::memory_order_relaxed);
+  }
+
+  virtual void MeasureTime(HistogramType histogram, uint64_t value) {
+    assert(histogram >= 0 && histogram < kNumHistograms);
+    Shard* shard = CurrentShard();
+    MutexLock l(&shard->mu);
+    shard->histograms[histogram].Add(static_cast<double>(value));
+  }
+
+  virtual uint64_t GetTickerCount(Ticker ticker) const {
+    assert(ticker >= 0 && ticker < kNumTickers);
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < num_shards_; i++) {
+      sum += shards_[i].tickers[ticker].load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  virtual void GetHistogramData(HistogramType histogram,
+                                HistogramData* data) const {
+    Histogram merged;
+    MergeHistogram(histogram, &merged);
+    data->count = static_cast<uint64_t>(merged.Count());
+    if (data->count == 0) {
+      data->sum = data->average = data->median = 0;
+      data->percentile95 = data->percentile99 = data->max = 0;
+      return;
+    }
+    data->sum = merged.Sum();
+    data->average = merged.Average();
+    data->median = merged.Median();
+    data->percentile95 = merged.Percentile(95);
+    data->percentile99 = merged.Percentile(99);
+    data->max = merged.Max();
+  }
+
+  virtual void Reset() {
+    for (unsigned i = 0; i < num_shards_; i++) {
+      Shard* shard = &shards_[i];
+      for (int t = 0; t < kNumTickers; t++) {
+        shard->tickers[t].store(0, std::memory_order_relaxed);
+      }
+      MutexLock l(&shard->mu);
+      for (int h = 0; h < kNumHistograms; h++) {
+        shard->histograms[h].Clear();
+      }
+    }
+  }
+
+  virtual std::string ToString() const {
+    std::string result;
+    char buf[200];
+    for (int t = 0; t < kNumTickers; t++) {
+      snprintf(buf, sizeof(buf), "%s COUNT : %llu\n", kTickerNames[t],
+               static_cast<unsigned long long>(
+                   GetTickerCount(static_cast<Ticker>(t))));
+      result.append(buf);
+    }
+    for (int h = 0; h < kNumHistograms; h++) {
+      HistogramData data;
+      GetHistogramData(static_cast<HistogramType>(h), &data);
+      snprintf(buf, sizeof(buf),
+               "%s P50 : %.2f P95 : %.2f P99 : %.2f MAX : %.2f "
+               "COUNT : %llu SUM : %.0f\n",
+               kHistogramNames[h], data.median, data.percentile95,
+               data.percentile99, data.max,
+               static_cast<unsigned long long>(data.count), data.sum);
+      result.append(buf);
+    }
+    return result;
+  }
+
+ private:
+  // The tickers and histograms recorded by threads running on one CPU
+  struct Shard {
+    std::atomic<uint64_t> tickers[kNumTickers];
+    port::Mutex mu;
+    Histogram histograms[kNumHistograms] GUARDED_BY(mu);
+    // Keeps the tickers of neighbouring shards off each other's cache
+    // lines
+    char padding[64];
+  };
+
+  Shard* CurrentShard() {
+    int cpu = port::PhysicalCoreID();
+    if (cpu < 0) {
+      // Spread the threads over the shards instead
+      static std::atomic<unsigned> next_thread(0);
+      static thread_local unsigned thread_index =
+          next_thread.fetch_add(1, std::memory_order_relaxed);
+      cpu = static_cast<int>(thread_index % num_shards_);
+    }
+    return &shards_[static_cast<unsigned>(cpu) % num_shards_];
+  }
+
+  void MergeHistogram(HistogramType histogram, Histogram* merged) const {
+    assert(histogram >= 0 && histogram < kNumHistograms);
+    merged->Clear();
+    for (unsigned i = 0; i < num_shards_; i++) {
+      MutexLock l(&shards_[i].mu);
+      merged->Merge(shards_[i].histograms[histogram]);
+    }
+  }
+
+  const unsigned num_shards_;
+  Shard* const shards_;
+};
+
+}  // namespace
+
+Statistics* CreateDBStatistics() {
+  return new StatisticsImpl;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,60 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_STATISTICS_H_
+#define STORAGE_LEVELDB_UTIL_STATISTICS_H_
+
+#include <stdint.h>
+#include "leveldb/env.h"
+#include "leveldb/statistics.h"
+
+namespace leveldb {
+
+// Helpers for recording into an optional Statistics object.  They do
+// nothing when "stats" is null.
+
+inline void RecordTick(Statistics* stats, Ticker ticker, uint64_t count = 1) {
+  if (stats != nullptr) {
+    stats->RecordTick(ticker, count);
+  }
+}
+
+inline void MeasureTime(Statistics* stats, HistogramType histogram,
+                        uint64_t value) {
+  if (stats != nullptr) {
+    stats->MeasureTime(histogram, value);
+  }
+}
+
+// Adds the microseconds between its construction and destruction to a
+// histogram.  The clock is only read if "stats" is non-null.
+class StopWatch {
+ public:
+  StopWatch(Env* env, Statistics* stats, HistogramType histogram)
+      : env_(env),
+        stats_(stats),
+        histogram_(histogram),
+        start_(stats != nullptr ? env->NowMicros() : 0) {
+  }
+
+  ~StopWatch() {
+    if (stats_ != nullptr) {
+      stats_->MeasureTime(histogram_, env_->NowMicros() - start_);
+    }
+  }
+
+ private:
+  Env* const env_;
+  Statistics* const stats_;
+  const HistogramType histogram_;
+  const uint64_t start_;
+
+  // No copying allowed
+  StopWatch(const StopWatch&);
+  void operator=(const StopWatch&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_STATISTICS_H_
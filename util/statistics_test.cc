@@ -0,0 +1,135 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/statistics.h"
+
+#include <string>
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class StatisticsTest {
+ public:
+  Statistics* stats_;
+
+  StatisticsTest() : stats_(CreateDBStatistics()) { }
+  ~StatisticsTest() { delete stats_; }
+};
+
+TEST(StatisticsTest, Tickers) {
+  for (int t = 0; t < kNumTickers; t++) {
+    ASSERT_EQ(0u, stats_->GetTickerCount(static_cast<Ticker>(t)));
+  }
+  stats_->RecordTick(kBlockCacheHit);
+  stats_->RecordTick(kBlockCacheHit, 41);
+  stats_->RecordTick(kBytesWritten, 1000);
+  ASSERT_EQ(42u, stats_->GetTickerCount(kBlockCacheHit));
+  ASSERT_EQ(1000u, stats_->GetTickerCount(kBytesWritten));
+  ASSERT_EQ(0u, stats_->GetTickerCount(kBlockCacheMiss));
+}
+
+TEST(StatisticsTest, Histograms) {
+  HistogramData data;
+  stats_->GetHistogramData(kDbGetMicros, &data);
+  ASSERT_EQ(0u, data.count);
+  ASSERT_EQ(0, data.max);
+
+  for (int i = 1; i <= 100; i++) {
+    stats_->MeasureTime(kDbGetMicros, i);
+  }
+  stats_->GetHistogramData(kDbGetMicros, &data);
+  ASSERT_EQ(100u, data.count);
+  ASSERT_EQ(5050, data.sum);
+  ASSERT_EQ(100, data.max);
+  ASSERT_TRUE(data.average > 50 && data.average < 51);
+  ASSERT_TRUE(data.median > 40 && data.median < 60);
+  ASSERT_TRUE(data.percentile95 >= data.median);
+  ASSERT_TRUE(data.percentile99 >= data.percentile95);
+  ASSERT_TRUE(data.percentile99 <= data.max);
+
+  stats_->GetHistogramData(kDbWriteMicros, &data);
+  ASSERT_EQ(0u, data.count);
+}
+
+TEST(StatisticsTest, Reset) {
+  stats_->RecordTick(kMemtableHit, 7);
+  stats_->MeasureTime(kDbWriteMicros, 10);
+  stats_->Reset();
+  ASSERT_EQ(0u, stats_->GetTickerCount(kMemtableHit));
+  HistogramData data;
+  stats_->GetHistogramData(kDbWriteMicros, &data);
+  ASSERT_EQ(0u, data.count);
+}
+
+TEST(StatisticsTest, ToString) {
+  stats_->RecordTick(kNumberKeysRead, 3);
+  stats_->MeasureTime(kFlushMicros, 250);
+  const std::string s = stats_->ToString();
+  ASSERT_NE(std::string::npos,
+            s.find(std::string(TickerName(kNumberKeysRead)) + " COUNT : 3\n"));
+  ASSERT_NE(std::string::npos,
+            s.find(std::string(TickerName(kBlockCacheMiss)) + " COUNT : 0\n"));
+  ASSERT_NE(std::string::npos, s.find(HistogramName(kFlushMicros)));
+  ASSERT_NE(std::string::npos, s.find("COUNT : 1 SUM : 250\n"));
+  ASSERT_EQ(std::string("leveldb.block.cache.hit"),
+            TickerName(kBlockCacheHit));
+  ASSERT_EQ(std::string("leveldb.db.get.micros"),
+            HistogramName(kDbGetMicros));
+}
+
+namespace {
+
+struct ConcurrentState {
+  Statistics* stats;
+  port::Mutex mu;
+  port::CondVar cv;
+  int num_running;
+
+  explicit ConcurrentState(Statistics* s)
+      : stats(s), cv(&mu), num_running(0) { }
+};
+
+void ConcurrentBody(void* arg) {
+  ConcurrentState* state = reinterpret_cast<ConcurrentState*>(arg);
+  for (int i = 0; i < 10000; i++) {
+    state->stats->RecordTick(kNumberDbNext);
+    if (i % 10 == 0) {
+      state->stats->MeasureTime(kDbSeekMicros, i);
+    }
+  }
+  MutexLock l(&state->mu);
+  state->num_running--;
+  state->cv.SignalAll();
+}
+
+}  // namespace
+
+TEST(StatisticsTest, Concurrent) {
+  const int kThreads = 4;
+  ConcurrentState state(stats_);
+  state.num_running = kThreads;
+  for (int i = 0; i < kThreads; i++) {
+    Env::Default()->StartThread(&ConcurrentBody, &state);
+  }
+  {
+    MutexLock l(&state.mu);
+    while (state.num_running > 0) {
+      state.cv.Wait();
+    }
+  }
+  ASSERT_EQ(static_cast<uint64_t>(kThreads) * 10000,
+            stats_->GetTickerCount(kNumberDbNext));
+  HistogramData data;
+  stats_->GetHistogramData(kDbSeekMicros, &data);
+  ASSERT_EQ(static_cast<uint64_t>(kThreads) * 1000, data.count);
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}